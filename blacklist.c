@@ -0,0 +1,165 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include "blacklist.h"
+
+/* The snapshot is never modified after it is published,
+   so the capture threads can use it without any locking */
+typedef struct blacklist
+{
+    volatile gint ref_count;
+    gint generation;
+    gboolean enabled;
+    gboolean inverted;
+    gint64 *keys;
+    GHashTable *addresses;
+    GHashTable *prefixes;
+} blacklist_t;
+
+typedef struct blacklist_build
+{
+    blacklist_t *blacklist;
+    guint count;
+} blacklist_build_t;
+
+static gboolean blacklist_set_foreach(gpointer, gpointer, gpointer);
+
+static blacklist_t *blacklist_current = NULL;
+static volatile gint blacklist_generation = 0;
+G_LOCK_DEFINE_STATIC(blacklist_current);
+
+void
+blacklist_set(gboolean  enabled,
+              gboolean  inverted,
+              GTree    *tree)
+{
+    blacklist_build_t build;
+    blacklist_t *blacklist;
+    blacklist_t *previous;
+
+    blacklist = g_malloc(sizeof(blacklist_t));
+    blacklist->ref_count = 1;
+    blacklist->enabled = enabled;
+    blacklist->inverted = inverted;
+    blacklist->keys = g_new(gint64, MAX(g_tree_nnodes(tree), 1));
+    blacklist->addresses = g_hash_table_new(g_int64_hash, g_int64_equal);
+    blacklist->prefixes = g_hash_table_new(g_int64_hash, g_int64_equal);
+
+    build.blacklist = blacklist;
+    build.count = 0;
+    g_tree_foreach(tree, blacklist_set_foreach, &build);
+
+    /* Swap the snapshot, readers holding the previous one keep it alive */
+    G_LOCK(blacklist_current);
+    previous = blacklist_current;
+    blacklist->generation = g_atomic_int_add(&blacklist_generation, 1) + 1;
+    blacklist_current = blacklist;
+    G_UNLOCK(blacklist_current);
+
+    if(previous)
+        blacklist_unref(previous);
+}
+
+static gboolean
+blacklist_set_foreach(gpointer key,
+                      gpointer value,
+                      gpointer data)
+{
+    blacklist_build_t *build = (blacklist_build_t*)data;
+    gint64 *entry = &build->blacklist->keys[build->count++];
+
+    *entry = *(gint64*)key;
+    if(*entry & BLACKLIST_OUI)
+    {
+        *entry &= BLACKLIST_OUI_MASK;
+        g_hash_table_add(build->blacklist->prefixes, entry);
+    }
+    else
+    {
+        g_hash_table_add(build->blacklist->addresses, entry);
+    }
+    return FALSE;
+}
+
+blacklist_t*
+blacklist_get(void)
+{
+    blacklist_t *blacklist;
+
+    G_LOCK(blacklist_current);
+    blacklist = blacklist_current;
+    if(blacklist)
+        g_atomic_int_inc(&blacklist->ref_count);
+    G_UNLOCK(blacklist_current);
+
+    return blacklist;
+}
+
+blacklist_t*
+blacklist_refresh(blacklist_t *blacklist)
+{
+    /* Cheap check for every frame, the lock is taken on change only */
+    if(blacklist &&
+       blacklist->generation == g_atomic_int_get(&blacklist_generation))
+        return blacklist;
+
+    if(blacklist)
+        blacklist_unref(blacklist);
+    return blacklist_get();
+}
+
+gboolean
+blacklist_match(const blacklist_t *blacklist,
+                gint64             address)
+{
+    gint64 oui;
+    gboolean found;
+
+    if(!blacklist || !blacklist->enabled)
+        return FALSE;
+
+    oui = address >> 24;
+    found = g_hash_table_contains(blacklist->addresses, &address) ||
+            g_hash_table_contains(blacklist->prefixes, &oui);
+
+    return (blacklist->inverted ? !found : found);
+}
+
+void
+blacklist_unref(blacklist_t *blacklist)
+{
+    if(!g_atomic_int_dec_and_test(&blacklist->ref_count))
+        return;
+
+    g_hash_table_destroy(blacklist->addresses);
+    g_hash_table_destroy(blacklist->prefixes);
+    g_free(blacklist->keys);
+    g_free(blacklist);
+}
+
+void
+blacklist_free(void)
+{
+    blacklist_t *blacklist;
+
+    G_LOCK(blacklist_current);
+    blacklist = blacklist_current;
+    blacklist_current = NULL;
+    G_UNLOCK(blacklist_current);
+
+    if(blacklist)
+        blacklist_unref(blacklist);
+}
@@ -0,0 +1,33 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_BLACKLIST_H_
+#define MTSCAN_BLACKLIST_H_
+
+/* Vendor rules are kept along with the addresses,
+   the OUI is stored in the lowest 24 bits */
+#define BLACKLIST_OUI      G_GINT64_CONSTANT(0x1000000000000)
+#define BLACKLIST_OUI_MASK G_GINT64_CONSTANT(0xFFFFFF)
+
+typedef struct blacklist blacklist_t;
+
+void blacklist_set(gboolean, gboolean, GTree*);
+blacklist_t* blacklist_get(void);
+blacklist_t* blacklist_refresh(blacklist_t*);
+gboolean blacklist_match(const blacklist_t*, gint64);
+void blacklist_unref(blacklist_t*);
+void blacklist_free(void);
+
+#endif
@@ -17,7 +17,8 @@
 #include "ui-callbacks.h"
 
 static void callback_mt_ssh_info(const mt_ssh_t *, const mt_ssh_info_t *);
-static void callback_mt_ssh_net(const mt_ssh_t *, const mt_ssh_net_t *);
+static void callback_mt_ssh_net(const mt_ssh_t *, mt_ssh_net_t *);
+static void callback_mt_ssh_frame(const mt_ssh_t *, mt_ssh_frame_t *);
 static void callback_mt_ssh_snf(const mt_ssh_t *, const mt_ssh_snf_t *);
 
 void
@@ -82,7 +83,7 @@ callback_mt_ssh(mt_ssh_t     *context,
 void
 callback_mt_ssh_msg(const mt_ssh_t    *context,
                     mt_ssh_msg_type_t  type,
-                    gconstpointer      data)
+                    gpointer           data)
 {
     switch(type)
     {
@@ -91,7 +92,7 @@ callback_mt_ssh_msg(const mt_ssh_t    *context,
             break;
 
         case MT_SSH_MSG_NET:
-            callback_mt_ssh_net(context, data);
+            callback_mt_ssh_frame(context, data);
             break;
 
         case MT_SSH_MSG_SNF:
@@ -168,28 +169,44 @@ callback_mt_ssh_info(const mt_ssh_t      *context,
 }
 
 static void
-callback_mt_ssh_net(const mt_ssh_t     *context,
-                    const mt_ssh_net_t *data)
+callback_mt_ssh_frame(const mt_ssh_t *context,
+                      mt_ssh_frame_t *frame)
+{
+    guint i;
+
+    for(i = 0; i < mt_ssh_frame_get_count(frame); i++)
+        callback_mt_ssh_net(context, mt_ssh_frame_get_net(frame, i));
+
+    for(i = 0; i < mt_ssh_frame_get_seen_count(frame); i++)
+        ui_callback_network_seen(context, mt_ssh_frame_get_seen(frame, i), mt_ssh_frame_get_timestamp(frame));
+
+    ui_callback_heartbeat(context);
+}
+
+static void
+callback_mt_ssh_net(const mt_ssh_t *context,
+                    mt_ssh_net_t   *data)
 {
     network_t *net = g_malloc(sizeof(network_t));
     network_init(net);
     net->address = mt_ssh_net_get_address(data);
     net->frequency = mt_ssh_net_get_frequency(data);
-    net->channel = g_strdup(mt_ssh_net_get_channel(data));
-    net->mode = g_strdup(mt_ssh_net_get_mode(data));
-    net->ssid = g_strdup(mt_ssh_net_get_ssid(data));
-    net->radioname = g_strdup(mt_ssh_net_get_radioname(data));
+    net->channel = mt_ssh_net_steal_channel(data);
+    net->mode = mt_ssh_net_steal_mode(data);
+    net->ssid = mt_ssh_net_steal_ssid(data);
+    net->radioname = mt_ssh_net_steal_radioname(data);
     net->rssi = mt_ssh_net_get_rssi(data);
     net->noise = mt_ssh_net_get_noise(data);
-    net->routeros_ver = g_strdup(mt_ssh_net_get_routeros_ver(data));
+    net->routeros_ver = mt_ssh_net_steal_routeros_ver(data);
     net->flags.privacy = mt_ssh_net_get_privacy(data);
     net->flags.routeros = mt_ssh_net_get_routeros(data);
     net->flags.nstreme = mt_ssh_net_get_nstreme(data);
     net->flags.tdma = mt_ssh_net_get_tdma(data);
     net->flags.wds = mt_ssh_net_get_wds(data);
     net->flags.bridge = mt_ssh_net_get_bridge(data);
-    net->firstseen = mt_ssh_net_get_timestamp(data);
-    net->lastseen = mt_ssh_net_get_timestamp(data);
+    net->captured = mt_ssh_net_get_timestamp(data);
+    net->firstseen = net->captured / G_USEC_PER_SEC;
+    net->lastseen = net->firstseen;
 
     ui_callback_network(context, net);
 }
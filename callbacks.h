@@ -17,7 +17,7 @@
 #define MTSCAN_CALLBACKS_H_
 
 void callback_mt_ssh(mt_ssh_t *, mt_ssh_ret_t, const gchar *);
-void callback_mt_ssh_msg(const mt_ssh_t *, mt_ssh_msg_type_t, gconstpointer);
+void callback_mt_ssh_msg(const mt_ssh_t *, mt_ssh_msg_type_t, gpointer);
 
 #endif
 
@@ -21,6 +21,7 @@ typedef struct conf_profile
     gchar *name;
     gchar *host;
     gint port;
+    mtscan_conf_profile_protocol_t protocol;
     gchar *login;
     gchar *password;
     gchar *iface;
@@ -33,22 +34,24 @@ typedef struct conf_profile
 
 
 conf_profile_t*
-conf_profile_new(gchar                      *name,
-                 gchar                      *host,
-                 gint                        port,
-                 gchar                      *login,
-                 gchar                      *password,
-                 gchar                      *iface,
-                 mtscan_conf_profile_mode_t  mode,
-                 gint                        duration_time,
-                 gboolean                    duration,
-                 gboolean                    remote,
-                 gboolean                    background)
+conf_profile_new(gchar                          *name,
+                 gchar                          *host,
+                 gint                            port,
+                 mtscan_conf_profile_protocol_t  protocol,
+                 gchar                          *login,
+                 gchar                          *password,
+                 gchar                          *iface,
+                 mtscan_conf_profile_mode_t      mode,
+                 gint                            duration_time,
+                 gboolean                        duration,
+                 gboolean                        remote,
+                 gboolean                        background)
 {
     conf_profile_t* p = g_malloc(sizeof(conf_profile_t));
     p->name = name;
     p->host = host;
     p->port = port;
+    p->protocol = protocol;
     p->login = login;
     p->password = password;
     p->iface = iface;
@@ -92,6 +95,12 @@ conf_profile_get_port(const conf_profile_t *p)
     return p->port;
 }
 
+mtscan_conf_profile_protocol_t
+conf_profile_get_protocol(const conf_profile_t *p)
+{
+    return p->protocol;
+}
+
 const gchar*
 conf_profile_get_login(const conf_profile_t *p)
 {
@@ -147,6 +156,7 @@ conf_profile_list_new(void)
                               G_TYPE_STRING,    /* CONF_PROFILE_COL_NAME          */
                               G_TYPE_STRING,    /* CONF_PROFILE_COL_HOST          */
                               G_TYPE_INT,       /* CONF_PROFILE_COL_PORT          */
+                              G_TYPE_INT,       /* CONF_PROFILE_COL_PROTOCOL      */
                               G_TYPE_STRING,    /* CONF_PROFILE_COL_LOGIN         */
                               G_TYPE_STRING,    /* CONF_PROFILE_COL_PASSWORD      */
                               G_TYPE_STRING,    /* CONF_PROFILE_COL_INTERFACE     */
@@ -168,6 +178,7 @@ conf_profile_list_add(GtkListStore         *model,
                        CONF_PROFILE_COL_NAME, p->name,
                        CONF_PROFILE_COL_HOST, p->host,
                        CONF_PROFILE_COL_PORT, p->port,
+                       CONF_PROFILE_COL_PROTOCOL, p->protocol,
                        CONF_PROFILE_COL_LOGIN, p->login,
                        CONF_PROFILE_COL_PASSWORD, p->password,
                        CONF_PROFILE_COL_INTERFACE, p->iface,
@@ -189,6 +200,7 @@ conf_profile_list_get(GtkListStore *model,
                        CONF_PROFILE_COL_NAME, &p->name,
                        CONF_PROFILE_COL_HOST, &p->host,
                        CONF_PROFILE_COL_PORT, &p->port,
+                       CONF_PROFILE_COL_PROTOCOL, &p->protocol,
                        CONF_PROFILE_COL_LOGIN, &p->login,
                        CONF_PROFILE_COL_PASSWORD, &p->password,
                        CONF_PROFILE_COL_INTERFACE, &p->iface,
@@ -21,9 +21,11 @@
 #include "ui-view.h"
 #include "misc.h"
 #include "conf-scanlist.h"
+#include "blacklist.h"
 
-#define CONF_DIR  "mtscan"
-#define CONF_FILE "mtscan.conf"
+#define CONF_DIR       "mtscan"
+#define CONF_FILE      "mtscan.conf"
+#define CONF_CACHE_DIR "cache"
 
 #define CONF_DEFAULT_WINDOW_X         (-1)
 #define CONF_DEFAULT_WINDOW_Y         (-1)
@@ -42,6 +44,7 @@
 #define CONF_DEFAULT_PROFILE_NAME           "unnamed"
 #define CONF_DEFAULT_PROFILE_HOST           ""
 #define CONF_DEFAULT_PROFILE_PORT           22
+#define CONF_DEFAULT_PROFILE_PROTOCOL       MTSCAN_CONF_PROFILE_PROTOCOL_SSH
 #define CONF_DEFAULT_PROFILE_LOGIN          "admin"
 #define CONF_DEFAULT_PROFILE_PASSWORD       ""
 #define CONF_DEFAULT_PROFILE_INTERFACE      "wlan1"
@@ -80,6 +83,8 @@
 #define CONF_DEFAULT_PREFERENCES_TZSP_INTERFACE         "eno1"
 #define CONF_DEFAULT_PREFERENCES_TZSP_CHANNEL_WIDTH     20
 #define CONF_DEFAULT_PREFERENCES_TZSP_BAND              MTSCAN_CONF_TZSP_BAND_5GHZ
+#define CONF_DEFAULT_PREFERENCES_TZSP_SENSORS           ""
+#define CONF_DEFAULT_PREFERENCES_TZSP_STATIONS          FALSE
 #define CONF_DEFAULT_PREFERENCES_GPS_HOSTNAME           "localhost"
 #define CONF_DEFAULT_PREFERENCES_GPS_TCP_PORT           2947
 #define CONF_DEFAULT_PREFERENCES_GPS_SHOW_ALTITUDE      TRUE
@@ -112,6 +117,7 @@
 typedef struct conf
 {
     gchar    *path;
+    gchar    *path_cache;
     GKeyFile *keyfile;
 
     /* [window] */
@@ -173,6 +179,8 @@ typedef struct conf
     gchar                   *preferences_tzsp_interface;
     gint                     preferences_tzsp_channel_width;
     mtscan_conf_tzsp_band_t  preferences_tzsp_band;
+    gchar                   *preferences_tzsp_sensors;
+    gboolean                 preferences_tzsp_stations;
 
     gchar    *preferences_gps_hostname;
     gint      preferences_gps_tcp_port;
@@ -235,6 +243,7 @@ static void             conf_save_gint64_tree(GKeyFile*, const gchar*, const gch
 static gboolean         conf_save_gint64_tree_foreach(gpointer, gpointer, gpointer);
 
 static void             conf_change_string(gchar**, const gchar*);
+static void             conf_update_blacklist(void);
 
 void
 conf_init(const gchar *custom_path)
@@ -250,6 +259,11 @@ conf_init(const gchar *custom_path)
         g_free(directory);
     }
 
+    /* Cached data is kept next to the configuration */
+    directory = g_path_get_dirname(conf.path);
+    conf.path_cache = g_build_filename(directory, CONF_CACHE_DIR, NULL);
+    g_free(directory);
+
     conf.keyfile = g_key_file_new();
     conf.blacklist = g_tree_new_full((GCompareDataFunc)gint64cmp, NULL, g_free, NULL);
     conf.highlightlist = g_tree_new_full((GCompareDataFunc)gint64cmp, NULL, g_free, NULL);
@@ -324,6 +338,8 @@ conf_read(void)
     conf.preferences_tzsp_interface = conf_read_string("preferences", "tzsp_interface", CONF_DEFAULT_PREFERENCES_TZSP_INTERFACE);
     conf.preferences_tzsp_channel_width = conf_read_integer("preferences", "tzsp_channel_width", CONF_DEFAULT_PREFERENCES_TZSP_CHANNEL_WIDTH);
     conf.preferences_tzsp_band = (mtscan_conf_tzsp_band_t)conf_read_integer("preferences", "tzsp_band", CONF_DEFAULT_PREFERENCES_TZSP_BAND);
+    conf.preferences_tzsp_sensors = conf_read_string("preferences", "tzsp_sensors", CONF_DEFAULT_PREFERENCES_TZSP_SENSORS);
+    conf.preferences_tzsp_stations = conf_read_boolean("preferences", "tzsp_stations", CONF_DEFAULT_PREFERENCES_TZSP_STATIONS);
 
     conf.preferences_gps_hostname = conf_read_string("preferences", "gps_hostname", CONF_DEFAULT_PREFERENCES_GPS_HOSTNAME);
     conf.preferences_gps_tcp_port = conf_read_integer("preferences", "gps_tcp_port", CONF_DEFAULT_PREFERENCES_GPS_TCP_PORT);
@@ -339,6 +355,7 @@ conf_read(void)
     conf.preferences_blacklist_enabled = conf_read_boolean("preferences", "blacklist_enabled", CONF_DEFAULT_PREFERENCES_BLACKLIST_ENABLED);
     conf.preferences_blacklist_inverted = conf_read_boolean("preferences", "blacklist_inverted", CONF_DEFAULT_PREFERENCES_BLACKLIST_INVERTED);
     conf_read_gint64_tree(conf.keyfile, "preferences", "blacklist", conf.blacklist);
+    conf_update_blacklist();
 
     conf.preferences_highlightlist_enabled = conf_read_boolean("preferences", "highlightlist_enabled", CONF_DEFAULT_PREFERENCES_HIGHLIGHTLIST_ENABLED);
     conf.preferences_highlightlist_inverted = conf_read_boolean("preferences", "highlightlist_inverted", CONF_DEFAULT_PREFERENCES_HIGHLIGHTLIST_INVERTED);
@@ -536,6 +553,7 @@ conf_read_profile(const gchar *group_name)
     p = conf_profile_new(conf_read_string(group_name, "name", CONF_DEFAULT_PROFILE_NAME),
                          conf_read_string(group_name, "host", CONF_DEFAULT_PROFILE_HOST),
                          conf_read_integer(group_name, "port", CONF_DEFAULT_PROFILE_PORT),
+                         (mtscan_conf_profile_protocol_t)conf_read_integer(group_name, "protocol", CONF_DEFAULT_PROFILE_PROTOCOL),
                          conf_read_string(group_name, "login", CONF_DEFAULT_PROFILE_LOGIN),
                          conf_read_string(group_name, "password", CONF_DEFAULT_PROFILE_PASSWORD),
                          conf_read_string(group_name, "interface", CONF_DEFAULT_PROFILE_INTERFACE),
@@ -585,6 +603,11 @@ conf_read_gint64_tree(GKeyFile    *keyfile,
         {
             if(((addr = str_addr_to_gint64(*it, strlen(*it))) >= 0))
                 g_tree_insert(tree, gint64dup(&addr), GINT_TO_POINTER(TRUE));
+            else if(((addr = str_oui_to_gint64(*it, strlen(*it))) >= 0))
+            {
+                addr |= BLACKLIST_OUI;
+                g_tree_insert(tree, gint64dup(&addr), GINT_TO_POINTER(TRUE));
+            }
         }
         g_strfreev(values);
     }
@@ -651,6 +674,8 @@ conf_save(void)
     g_key_file_set_string(conf.keyfile, "preferences", "tzsp_interface", conf.preferences_tzsp_interface);
     g_key_file_set_integer(conf.keyfile, "preferences", "tzsp_channel_width", conf.preferences_tzsp_channel_width);
     g_key_file_set_integer(conf.keyfile, "preferences", "tzsp_band", conf.preferences_tzsp_band);
+    g_key_file_set_string(conf.keyfile, "preferences", "tzsp_sensors", conf.preferences_tzsp_sensors);
+    g_key_file_set_boolean(conf.keyfile, "preferences", "tzsp_stations", conf.preferences_tzsp_stations);
 
     g_key_file_set_string(conf.keyfile, "preferences", "gps_hostname", conf.preferences_gps_hostname);
     g_key_file_set_integer(conf.keyfile, "preferences", "gps_tcp_port", conf.preferences_gps_tcp_port);
@@ -757,6 +782,7 @@ conf_save_profile(GKeyFile             *keyfile,
     g_key_file_set_string(keyfile, group_name, "name", conf_profile_get_name(p));
     g_key_file_set_string(keyfile, group_name, "host", conf_profile_get_host(p));
     g_key_file_set_integer(keyfile, group_name, "port", conf_profile_get_port(p));
+    g_key_file_set_integer(keyfile, group_name, "protocol", conf_profile_get_protocol(p));
     g_key_file_set_string(keyfile, group_name, "login", conf_profile_get_login(p));
     g_key_file_set_string(keyfile, group_name, "password", conf_profile_get_password(p));
     g_key_file_set_string(keyfile, group_name, "interface", conf_profile_get_interface(p));
@@ -832,7 +858,12 @@ conf_save_gint64_tree_foreach(gpointer key,
 {
 
     gchar ***ptr = (gchar***)data;
-    *((*ptr)++) = g_strdup(model_format_address(*(gint64*)key, FALSE));
+    gint64 addr = *(gint64*)key;
+
+    if(addr & BLACKLIST_OUI)
+        *((*ptr)++) = g_strdup_printf("%06X", (gint)(addr & BLACKLIST_OUI_MASK));
+    else
+        *((*ptr)++) = g_strdup(model_format_address(addr, FALSE));
     return FALSE;
 }
 
@@ -844,6 +875,15 @@ conf_change_string(gchar      **ptr,
     *ptr = g_strdup(value);
 }
 
+static void
+conf_update_blacklist(void)
+{
+    /* Publish a new snapshot for the capture threads */
+    blacklist_set(conf.preferences_blacklist_enabled,
+                  conf.preferences_blacklist_inverted,
+                  conf.blacklist);
+}
+
 gint
 conf_get_window_x(void)
 {
@@ -1005,6 +1045,12 @@ conf_get_scanlists(void)
     return conf.scanlists;
 }
 
+const gchar*
+conf_get_path_cache(void)
+{
+    return conf.path_cache;
+}
+
 const gchar*
 conf_get_path_log_open(void)
 {
@@ -1331,6 +1377,30 @@ conf_set_preferences_tzsp_band(mtscan_conf_tzsp_band_t value)
     conf.preferences_tzsp_band = value;
 }
 
+const gchar*
+conf_get_preferences_tzsp_sensors(void)
+{
+    return conf.preferences_tzsp_sensors;
+}
+
+void
+conf_set_preferences_tzsp_sensors(const gchar *value)
+{
+    conf_change_string(&conf.preferences_tzsp_sensors, value);
+}
+
+gboolean
+conf_get_preferences_tzsp_stations(void)
+{
+    return conf.preferences_tzsp_stations;
+}
+
+void
+conf_set_preferences_tzsp_stations(gboolean value)
+{
+    conf.preferences_tzsp_stations = value;
+}
+
 const gchar*
 conf_get_preferences_gps_hostname(void)
 {
@@ -1449,6 +1519,7 @@ void
 conf_set_preferences_blacklist_enabled(gboolean value)
 {
     conf.preferences_blacklist_enabled = value;
+    conf_update_blacklist();
 }
 
 gboolean
@@ -1461,6 +1532,7 @@ void
 conf_set_preferences_blacklist_inverted(gboolean value)
 {
     conf.preferences_blacklist_inverted = value;
+    conf_update_blacklist();
 }
 
 gboolean
@@ -1477,6 +1549,7 @@ conf_set_preferences_blacklist(gint64 value)
         g_tree_insert(conf.blacklist, gint64dup(&value), GINT_TO_POINTER(TRUE));
     else
         g_tree_remove(conf.blacklist, &value);
+    conf_update_blacklist();
 }
 
 void
@@ -1486,6 +1559,7 @@ conf_del_preferences_blacklist(gint64 value)
         g_tree_remove(conf.blacklist, &value);
     else
         g_tree_insert(conf.blacklist, gint64dup(&value), GINT_TO_POINTER(TRUE));
+    conf_update_blacklist();
 }
 
 GtkListStore*
@@ -1498,6 +1572,7 @@ void
 conf_set_preferences_blacklist_from_liststore(GtkListStore *model)
 {
     fill_tree_from_liststore(conf.blacklist, model);
+    conf_update_blacklist();
 }
 
 gboolean
@@ -78,6 +78,8 @@ GtkListStore* conf_get_profiles(void);
 GtkListStore* conf_get_scanlists(void);
 
 /* Configuration [path] */
+const gchar* conf_get_path_cache(void);
+
 const gchar* conf_get_path_log_open(void);
 void conf_set_path_log_open(const gchar*);
 
@@ -160,6 +162,11 @@ void conf_set_preferences_tzsp_channel_width(gint);
 mtscan_conf_tzsp_band_t conf_get_preferences_tzsp_band(void);
 void conf_set_preferences_tzsp_band(mtscan_conf_tzsp_band_t);
 
+const gchar* conf_get_preferences_tzsp_sensors(void);
+void conf_set_preferences_tzsp_sensors(const gchar*);
+gboolean conf_get_preferences_tzsp_stations(void);
+void conf_set_preferences_tzsp_stations(gboolean);
+
 const gchar* conf_get_preferences_gps_hostname(void);
 void conf_set_preferences_gps_hostname(const gchar*);
 
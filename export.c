@@ -14,6 +14,7 @@
  */
 
 #include <string.h>
+#include <math.h>
 #include <glib/gstdio.h>
 #include "export.h"
 #include "model.h"
@@ -25,6 +26,7 @@ typedef struct mtscan_export
 {
     FILE *fp;
     GSList *cols;
+    const mtscan_track_t *track;
 } mtscan_export_t;
 
 static const gchar *html_header =
@@ -109,14 +111,16 @@ static const gchar *html_footer =
 static gboolean export_write(mtscan_export_t*, const gchar*);
 static gboolean export_write_css(mtscan_export_t*, const gchar*, guint);
 static gboolean export_foreach(GtkTreeModel*, GtkTreePath*, GtkTreeIter*, gpointer);
+static void export_position(const mtscan_track_t*, const signals_t*, gdouble*, gdouble*);
 
 
 gboolean
-export_html(const gchar        *filename,
-            const gchar        *name,
-            mtscan_model_t     *model,
-            const gchar* const *order,
-            const gchar* const *hidden)
+export_html(const gchar          *filename,
+            const gchar          *name,
+            mtscan_model_t       *model,
+            const mtscan_track_t *track,
+            const gchar* const   *order,
+            const gchar* const   *hidden)
 {
     mtscan_export_t e;
     gchar *string;
@@ -130,6 +134,7 @@ export_html(const gchar        *filename,
         return FALSE;
 
     e.cols = NULL;
+    e.track = track;
 
     now = g_date_time_new_now_local();
     date = g_date_time_format(now, "%Y-%m-%d %H:%M:%S");
@@ -219,6 +224,8 @@ export_foreach(GtkTreeModel *store,
     GSList *it;
     gint col;
     gfloat distance;
+    gint clients;
+    signals_t *signals;
 
     network_init(&net);
     gtk_tree_model_get(store, iter,
@@ -247,8 +254,14 @@ export_foreach(GtkTreeModel *store,
                        COL_LONGITUDE, &net.longitude,
                        COL_AZIMUTH, &net.azimuth,
                        COL_DISTANCE, &distance,
+                       COL_SOURCE, &net.source,
+                       COL_CLIENTS, &clients,
+                       COL_SIGNALS, &signals,
                        -1);
 
+    if(isnan(net.latitude) || isnan(net.longitude))
+        export_position(e->track, signals, &net.latitude, &net.longitude);
+
     str = g_string_new("<tr>");
     for(it = e->cols; it; it=it->next)
     {
@@ -315,6 +328,15 @@ export_foreach(GtkTreeModel *store,
             g_string_append_printf(str, "<td align=\"right\">%s</td>", model_format_azimuth(net.azimuth, TRUE));
         else if(col == MTSCAN_VIEW_COL_DISTANCE)
             g_string_append_printf(str, "<td align=\"right\">%s</td>", model_format_distance(distance));
+        else if(col == MTSCAN_VIEW_COL_SOURCE)
+            cstr = g_markup_printf_escaped("%s", net.source);
+        else if(col == MTSCAN_VIEW_COL_CLIENTS)
+        {
+            if(clients > 0)
+                g_string_append_printf(str, "<td align=\"right\">%d</td>", clients);
+            else
+                g_string_append(str, "<td></td>");
+        }
 
         if(cstr)
         {
@@ -331,3 +353,32 @@ export_foreach(GtkTreeModel *store,
     network_free(&net);
     return FALSE;
 }
+
+static void
+export_position(const mtscan_track_t *track,
+                const signals_t      *signals,
+                gdouble              *latitude,
+                gdouble              *longitude)
+{
+    const signals_node_t *sample;
+    gdouble lat, lon;
+    gint8 rssi = G_MININT8;
+
+    if(!track || !signals || !mtscan_track_count(track))
+        return;
+
+    /* Networks without a position are placed on the GPS track
+       at their strongest sample that the track covers */
+    for(sample = signals->head; sample; sample = sample->next)
+    {
+        if(sample->rssi <= rssi)
+            continue;
+
+        if(!mtscan_track_lookup(track, sample->timestamp, &lat, &lon))
+            continue;
+
+        rssi = sample->rssi;
+        *latitude = lat;
+        *longitude = lon;
+    }
+}
@@ -16,8 +16,9 @@
 #ifndef MTSCAN_EXPORT_H_
 #define MTSCAN_EXPORT_H_
 #include "model.h"
+#include "track.h"
 
-gboolean export_html(const gchar*, const gchar*, mtscan_model_t*, const gchar* const*, const gchar* const*);
+gboolean export_html(const gchar*, const gchar*, mtscan_model_t*, const mtscan_track_t*, const gchar* const*, const gchar* const*);
 
 #endif
 
@@ -0,0 +1,246 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include <string.h>
+#include <stdlib.h>
+#include "geoloc-cache.h"
+
+#define GEOLOC_CACHE_MAGIC   "MTSGEOC"
+#define GEOLOC_CACHE_VERSION 1
+#define GEOLOC_CACHE_EXT     ".geoloc"
+#define GEOLOC_CACHE_NO_SSID G_MAXUINT32
+
+/* Cache file layout: header, entries sorted by BSSID, SSID pool.
+   The file is mapped and binary searched in place,
+   so it is written in native byte order. */
+typedef struct geoloc_cache_header
+{
+    gchar   magic[8];
+    guint32 version;
+    guint32 byte_order;
+    gint64  source_mtime;
+    gint64  source_size;
+    guint32 count;
+    guint32 pool_size;
+} geoloc_cache_header_t;
+
+typedef struct geoloc_cache_entry
+{
+    gint64  bssid;
+    gdouble lat;
+    gdouble lon;
+    guint32 ssid;
+    guint32 reserved;
+} geoloc_cache_entry_t;
+
+struct geoloc_cache
+{
+    GMappedFile *file;
+    const geoloc_cache_entry_t *entries;
+    const gchar *pool;
+    guint32 count;
+    guint32 pool_size;
+};
+
+static gint geoloc_cache_compare(gconstpointer, gconstpointer);
+
+
+gchar*
+geoloc_cache_filename(const gchar *directory,
+                      const gchar *source)
+{
+    gchar *checksum;
+    gchar *name;
+    gchar *path;
+
+    /* One cache file for each source log */
+    checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, source, -1);
+    name = g_strconcat(checksum, GEOLOC_CACHE_EXT, NULL);
+    path = g_build_filename(directory, name, NULL);
+    g_free(checksum);
+    g_free(name);
+    return path;
+}
+
+geoloc_cache_t*
+geoloc_cache_open(const gchar *filename,
+                  gint64       source_mtime,
+                  gint64       source_size)
+{
+    GMappedFile *file;
+    const geoloc_cache_header_t *header;
+    geoloc_cache_t *cache;
+    const gchar *contents;
+    gsize length;
+
+    file = g_mapped_file_new(filename, FALSE, NULL);
+    if(!file)
+        return NULL;
+
+    contents = g_mapped_file_get_contents(file);
+    length = g_mapped_file_get_length(file);
+    header = (const geoloc_cache_header_t*)contents;
+
+    /* Anything unexpected makes the cache outdated */
+    if(length < sizeof(geoloc_cache_header_t) ||
+       memcmp(header->magic, GEOLOC_CACHE_MAGIC, sizeof(header->magic)) ||
+       header->version != GEOLOC_CACHE_VERSION ||
+       header->byte_order != G_BYTE_ORDER ||
+       header->source_mtime != source_mtime ||
+       header->source_size != source_size ||
+       (length - sizeof(geoloc_cache_header_t)) / sizeof(geoloc_cache_entry_t) < header->count ||
+       length - sizeof(geoloc_cache_header_t) - header->count * sizeof(geoloc_cache_entry_t) != header->pool_size ||
+       (header->pool_size && contents[length-1] != '\0'))
+    {
+        g_mapped_file_unref(file);
+        return NULL;
+    }
+
+    cache = g_malloc(sizeof(geoloc_cache_t));
+    cache->file = file;
+    cache->count = header->count;
+    cache->pool_size = header->pool_size;
+    cache->entries = (const geoloc_cache_entry_t*)(contents + sizeof(geoloc_cache_header_t));
+    cache->pool = (const gchar*)(cache->entries + cache->count);
+    return cache;
+}
+
+gboolean
+geoloc_cache_write(const gchar       *filename,
+                   gint64             source_mtime,
+                   gint64             source_size,
+                   geoloc_database_t *database)
+{
+    geoloc_cache_header_t header;
+    geoloc_cache_entry_t *entries;
+    geoloc_cache_entry_t *entry;
+    GHashTable *offsets;
+    GHashTableIter iter;
+    gpointer key, value;
+    const geoloc_data_t *data;
+    GString *pool;
+    GByteArray *output;
+    gpointer offset;
+    gboolean ret;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, GEOLOC_CACHE_MAGIC, sizeof(header.magic));
+    header.version = GEOLOC_CACHE_VERSION;
+    header.byte_order = G_BYTE_ORDER;
+    header.source_mtime = source_mtime;
+    header.source_size = source_size;
+    header.count = geoloc_database_size(database);
+
+    entries = g_new0(geoloc_cache_entry_t, header.count);
+    offsets = g_hash_table_new(g_str_hash, g_str_equal);
+    pool = g_string_new(NULL);
+
+    entry = entries;
+    g_hash_table_iter_init(&iter, database);
+    while(g_hash_table_iter_next(&iter, &key, &value))
+    {
+        data = (const geoloc_data_t*)value;
+        entry->bssid = *(gint64*)key;
+        entry->lat = data->lat;
+        entry->lon = data->lon;
+        entry->ssid = GEOLOC_CACHE_NO_SSID;
+
+        if(data->ssid)
+        {
+            /* SSIDs are often repeated, store each one once */
+            if(!g_hash_table_lookup_extended(offsets, data->ssid, NULL, &offset))
+            {
+                offset = GUINT_TO_POINTER(pool->len);
+                g_string_append_len(pool, data->ssid, strlen(data->ssid) + 1);
+                g_hash_table_insert(offsets, data->ssid, offset);
+            }
+            entry->ssid = GPOINTER_TO_UINT(offset);
+        }
+        entry++;
+    }
+
+    qsort(entries, header.count, sizeof(geoloc_cache_entry_t), geoloc_cache_compare);
+    header.pool_size = (guint32)pool->len;
+
+    output = g_byte_array_sized_new(sizeof(header) + header.count * sizeof(geoloc_cache_entry_t) + pool->len);
+    g_byte_array_append(output, (const guint8*)&header, sizeof(header));
+    g_byte_array_append(output, (const guint8*)entries, header.count * sizeof(geoloc_cache_entry_t));
+    g_byte_array_append(output, (const guint8*)pool->str, pool->len);
+
+    /* The file is replaced atomically */
+    ret = g_file_set_contents(filename, (const gchar*)output->data, output->len, NULL);
+
+    g_byte_array_free(output, TRUE);
+    g_string_free(pool, TRUE);
+    g_hash_table_destroy(offsets);
+    g_free(entries);
+    return ret;
+}
+
+guint
+geoloc_cache_size(const geoloc_cache_t *cache)
+{
+    return cache->count;
+}
+
+gboolean
+geoloc_cache_lookup(const geoloc_cache_t *cache,
+                    gint64                bssid,
+                    geoloc_data_t        *data)
+{
+    const geoloc_cache_entry_t *entry;
+    guint32 low = 0;
+    guint32 high = cache->count;
+    guint32 mid;
+
+    /* Entries are sorted by BSSID, search the mapped file in place */
+    while(low < high)
+    {
+        mid = low + (high - low) / 2;
+        entry = &cache->entries[mid];
+
+        if(entry->bssid < bssid)
+            low = mid + 1;
+        else if(entry->bssid > bssid)
+            high = mid;
+        else
+        {
+            /* The SSID points into the mapped pool */
+            data->ssid = (entry->ssid < cache->pool_size ? (gchar*)cache->pool + entry->ssid : NULL);
+            data->lat = entry->lat;
+            data->lon = entry->lon;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void
+geoloc_cache_free(geoloc_cache_t *cache)
+{
+    g_mapped_file_unref(cache->file);
+    g_free(cache);
+}
+
+static gint
+geoloc_cache_compare(gconstpointer a,
+                     gconstpointer b)
+{
+    gint64 bssid_a = ((const geoloc_cache_entry_t*)a)->bssid;
+    gint64 bssid_b = ((const geoloc_cache_entry_t*)b)->bssid;
+    return (bssid_a > bssid_b) - (bssid_a < bssid_b);
+}
@@ -0,0 +1,30 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_GEOLOC_CACHE_H_
+#define MTSCAN_GEOLOC_CACHE_H_
+
+#include "geoloc-database.h"
+
+typedef struct geoloc_cache geoloc_cache_t;
+
+gchar* geoloc_cache_filename(const gchar*, const gchar*);
+geoloc_cache_t* geoloc_cache_open(const gchar*, gint64, gint64);
+gboolean geoloc_cache_write(const gchar*, gint64, gint64, geoloc_database_t*);
+guint geoloc_cache_size(const geoloc_cache_t*);
+gboolean geoloc_cache_lookup(const geoloc_cache_t*, gint64, geoloc_data_t*);
+void geoloc_cache_free(geoloc_cache_t*);
+
+#endif
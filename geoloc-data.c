@@ -14,13 +14,7 @@
  */
 #include <glib.h>
 #include <math.h>
-
-typedef struct geoloc_data
-{
-    gchar *ssid;
-    gdouble lat;
-    gdouble lon;
-} geoloc_data_t;
+#include "geoloc-data.h"
 
 geoloc_data_t*
 geoloc_data_new(const gchar *ssid,
@@ -16,7 +16,14 @@
 #ifndef MTSCAN_GEOLOC_DATA_H_
 #define MTSCAN_GEOLOC_DATA_H_
 
-typedef struct geoloc_data geoloc_data_t;
+#include <glib.h>
+
+typedef struct geoloc_data
+{
+    gchar *ssid;
+    gdouble lat;
+    gdouble lon;
+} geoloc_data_t;
 
 geoloc_data_t* geoloc_data_new(const gchar*, gdouble, gdouble);
 void geoloc_data_free(geoloc_data_t*);
@@ -0,0 +1,128 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include "geoloc-index.h"
+
+/* Each source is either a mapped cache or, when the cache
+   could not be written, the log parsed into memory */
+typedef struct geoloc_index_source
+{
+    geoloc_cache_t *cache;
+    geoloc_database_t *database;
+} geoloc_index_source_t;
+
+struct geoloc_index
+{
+    /* Sources in priority order, the first log comes first */
+    GArray *sources;
+    guint size;
+};
+
+static void geoloc_index_add(geoloc_index_t*, geoloc_cache_t*, geoloc_database_t*);
+
+
+geoloc_index_t*
+geoloc_index_new(void)
+{
+    geoloc_index_t *index = g_malloc(sizeof(geoloc_index_t));
+    index->sources = g_array_new(FALSE, FALSE, sizeof(geoloc_index_source_t));
+    index->size = 0;
+    return index;
+}
+
+void
+geoloc_index_add_cache(geoloc_index_t *index,
+                       geoloc_cache_t *cache)
+{
+    index->size += geoloc_cache_size(cache);
+    geoloc_index_add(index, cache, NULL);
+}
+
+void
+geoloc_index_add_database(geoloc_index_t    *index,
+                          geoloc_database_t *database)
+{
+    index->size += geoloc_database_size(database);
+    geoloc_index_add(index, NULL, database);
+}
+
+guint
+geoloc_index_size(const geoloc_index_t *index)
+{
+    return index->size;
+}
+
+gboolean
+geoloc_index_lookup(const geoloc_index_t *index,
+                    gint64                bssid,
+                    guint                *position,
+                    geoloc_data_t        *data)
+{
+    const geoloc_index_source_t *source;
+    const geoloc_data_t *found;
+
+    /* Candidates are returned one by one in priority order,
+       the search starts with the source at *position (initially 0) */
+    while(*position < index->sources->len)
+    {
+        source = &g_array_index(index->sources, geoloc_index_source_t, (*position)++);
+
+        if(source->cache)
+        {
+            if(geoloc_cache_lookup(source->cache, bssid, data))
+                return TRUE;
+        }
+        else if((found = geoloc_database_lookup(source->database, bssid)))
+        {
+            *data = *found;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void
+geoloc_index_free(geoloc_index_t *index)
+{
+    geoloc_index_source_t *source;
+    guint i;
+
+    for(i = 0; i < index->sources->len; i++)
+    {
+        source = &g_array_index(index->sources, geoloc_index_source_t, i);
+        if(source->cache)
+            geoloc_cache_free(source->cache);
+        if(source->database)
+            geoloc_database_free(source->database);
+    }
+
+    g_array_free(index->sources, TRUE);
+    g_free(index);
+}
+
+static void
+geoloc_index_add(geoloc_index_t    *index,
+                 geoloc_cache_t    *cache,
+                 geoloc_database_t *database)
+{
+    geoloc_index_source_t source;
+
+    /* Sources added later have lower priority */
+    source.cache = cache;
+    source.database = database;
+    g_array_append_val(index->sources, source);
+}
@@ -0,0 +1,30 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_GEOLOC_INDEX_H_
+#define MTSCAN_GEOLOC_INDEX_H_
+
+#include "geoloc-cache.h"
+
+typedef struct geoloc_index geoloc_index_t;
+
+geoloc_index_t* geoloc_index_new(void);
+void geoloc_index_add_cache(geoloc_index_t*, geoloc_cache_t*);
+void geoloc_index_add_database(geoloc_index_t*, geoloc_database_t*);
+guint geoloc_index_size(const geoloc_index_t*);
+gboolean geoloc_index_lookup(const geoloc_index_t*, gint64, guint*, geoloc_data_t*);
+void geoloc_index_free(geoloc_index_t*);
+
+#endif
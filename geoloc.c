@@ -16,19 +16,25 @@
 #include <glib.h>
 #include <math.h>
 #include <string.h>
+#include <glib/gstdio.h>
 #include "geoloc.h"
 #include "geoloc-database.h"
+#include "geoloc-index.h"
+#include "geoloc-cache.h"
 #include "geoloc-utils.h"
 #include "wigle/wigle.h"
 #include "network.h"
 #include "log.h"
 #include "conf.h"
+#include "task.h"
 
 typedef struct geoloc_loader_t
 {
-    GSList *databases;
+    task_t *task;
+    geoloc_index_t *index;
     GSList *filenames;
-    size_t count;
+    gchar *cache_dir;
+    guint rebuilt;
 } geoloc_loader_t;
 
 typedef struct geoloc
@@ -36,8 +42,9 @@ typedef struct geoloc
     gboolean            init;
     geoloc_loader_t    *loader;
     wigle_t            *wigle;
-    GSList             *db_mtscan;
+    geoloc_index_t     *db_mtscan;
     geoloc_database_t  *db_wigle;
+    geoloc_data_t       match;
     void              (*callback)(gint64);
 } geoloc_t;
 
@@ -51,8 +58,9 @@ static geoloc_t geoloc =
     .callback = NULL
 };
 
-static gpointer geoloc_loader(gpointer);
-static gboolean geoloc_loader_callback(gpointer);
+static void geoloc_loader(task_t*, gpointer);
+static void geoloc_loader_callback(task_t*, gpointer);
+static geoloc_cache_t* geoloc_loader_cache(geoloc_loader_t*, const gchar*, geoloc_database_t**);
 static void geoloc_loader_network_callback(network_t*, gpointer);
 
 static void geoloc_wigle_cb(wigle_t*);
@@ -90,12 +98,17 @@ geoloc_reinit(const gchar* const *filenames)
             list = g_slist_append(list, g_strdup(*f));
 
         context = g_malloc(sizeof(geoloc_loader_t));
-        context->databases = NULL;
+        context->index = geoloc_index_new();
         context->filenames = list;
-        context->count = 0;
+        context->cache_dir = g_strdup(conf_get_path_cache());
+        context->rebuilt = 0;
+
+        /* The previous databases are outdated, do not finish them */
+        if(geoloc.loader)
+            task_cancel(geoloc.loader->task);
 
         geoloc.loader = context;
-        g_thread_unref(g_thread_new("geoloc_loader", geoloc_loader, context));
+        context->task = task_run(TASK_PRIORITY_BATCH, geoloc_loader, geoloc_loader_callback, context);
     }
 
     if(!geoloc.db_wigle)
@@ -103,52 +116,93 @@ geoloc_reinit(const gchar* const *filenames)
 
 }
 
-static gpointer
-geoloc_loader(gpointer user_data)
+static void
+geoloc_loader(task_t   *task,
+              gpointer  user_data)
 {
     geoloc_loader_t *context = (geoloc_loader_t*)user_data;
     geoloc_database_t *database;
-    const gchar *filename;
+    geoloc_cache_t *cache;
     GSList *it;
-    gint count;
 
-    for(it = context->filenames; it; it = it->next)
-    {
-        filename = (const gchar*)it->data;
-        database = geoloc_database_new();
+    g_mkdir_with_parents(context->cache_dir, 0700);
 
-        count = log_read(filename,
-                         geoloc_loader_network_callback,
-                         database,
-                         TRUE);
+    /* The caches stay mapped and are searched in place,
+     * the first log has the highest priority */
+    for(it = context->filenames; it && !task_is_canceled(task); it = it->next)
+    {
+        database = NULL;
+        cache = geoloc_loader_cache(context, (const gchar*)it->data, &database);
 
-        if(!count)
+        if(cache)
+        {
+            geoloc_index_add_cache(context->index, cache);
+            if(database)
+                geoloc_database_free(database);
+        }
+        else if(database)
         {
-            geoloc_database_free(database);
-            continue;
+            /* No cache is available, use the parsed log */
+            geoloc_index_add_database(context->index, database);
         }
+    }
+}
+
+static geoloc_cache_t*
+geoloc_loader_cache(geoloc_loader_t    *context,
+                    const gchar        *filename,
+                    geoloc_database_t **database)
+{
+    geoloc_cache_t *cache;
+    gchar *cache_name;
+    GStatBuf st;
+
+    if(g_stat(filename, &st) != 0)
+        return NULL;
 
-        context->databases = g_slist_append(context->databases, database);
-        context->count += geoloc_database_size(database);
+    cache_name = geoloc_cache_filename(context->cache_dir, filename);
+    cache = geoloc_cache_open(cache_name, (gint64)st.st_mtime, (gint64)st.st_size);
+
+    if(!cache)
+    {
+        /* The log was changed since the cache was written.
+         * If the previous index still maps the old cache, the write
+         * may fail on Windows and the parsed log is used instead. */
+        *database = geoloc_database_new();
+
+        if(log_read(filename,
+                    geoloc_loader_network_callback,
+                    NULL,
+                    NULL,
+                    *database,
+                    TRUE) >= 0 &&
+           !task_is_canceled(context->task) &&
+           geoloc_cache_write(cache_name, (gint64)st.st_mtime, (gint64)st.st_size, *database))
+        {
+            cache = geoloc_cache_open(cache_name, (gint64)st.st_mtime, (gint64)st.st_size);
+            context->rebuilt++;
+        }
     }
 
-    g_idle_add(geoloc_loader_callback, context);
-    return NULL;
+    g_free(cache_name);
+    return cache;
 }
 
-static gboolean
-geoloc_loader_callback(gpointer user_data)
+static void
+geoloc_loader_callback(task_t   *task,
+                       gpointer  user_data)
 {
     geoloc_loader_t *context = (geoloc_loader_t*)user_data;
 
     if(geoloc.loader == context)
     {
         if(geoloc.db_mtscan)
-            g_slist_free_full(geoloc.db_mtscan, (GDestroyNotify)geoloc_database_free);
+            geoloc_index_free(geoloc.db_mtscan);
 
-        g_print("geoloc_mtscan: %zu entries in local databases\n", context->count);
+        g_print("geoloc_mtscan: %u entries in local databases, %u rebuilt\n",
+                geoloc_index_size(context->index), context->rebuilt);
 
-        geoloc.db_mtscan = context->databases;
+        geoloc.db_mtscan = context->index;
         geoloc.loader = NULL;
 
         /* Update all networks */
@@ -157,13 +211,12 @@ geoloc_loader_callback(gpointer user_data)
     }
     else
     {
-        g_slist_free_full(context->databases, (GDestroyNotify)geoloc_database_free);
+        geoloc_index_free(context->index);
     }
 
     g_slist_free_full(context->filenames, g_free);
+    g_free(context->cache_dir);
     g_free(context);
-
-    return G_SOURCE_REMOVE;
 }
 
 static void
@@ -252,29 +305,26 @@ geoloc_match(gint64       bssid,
              gfloat      *distance_out)
 {
     const geoloc_data_t *data;
-    geoloc_database_t *database;
-    GSList *it;
+    geoloc_data_t candidate;
+    guint position = 0;
     gboolean ssid_match = FALSE;
 
-    /* We need to check each local database from MTscan logs,
-     * starting from the first, which has the highest priority */
+    /* Candidates from MTscan logs come in priority order */
     if(conf_get_preferences_location_mtscan() &&
        geoloc.db_mtscan)
     {
-        for(it = geoloc.db_mtscan; it; it = it->next)
+        while(geoloc_index_lookup(geoloc.db_mtscan, bssid, &position, &candidate))
         {
-            database = (geoloc_database_t*)it->data;
-            data = geoloc_database_lookup(database, bssid);
-
-            if(data &&
-               geoloc_data_is_vaild(data) &&
-               geoloc_match_ssid(data, ssid))
+            if(geoloc_data_is_vaild(&candidate) &&
+               geoloc_match_ssid(&candidate, ssid))
             {
                 ssid_match = TRUE;
-                if(geoloc_match_azimuth(data, azimuth) &&
-                   geoloc_match_distance(data, conf_get_preferences_location_max_distance(), distance_out))
+                if(geoloc_match_azimuth(&candidate, azimuth) &&
+                   geoloc_match_distance(&candidate, conf_get_preferences_location_max_distance(), distance_out))
                 {
-                    return data;
+                    /* Valid until the next match */
+                    geoloc.match = candidate;
+                    return &geoloc.match;
                 }
             }
         }
@@ -17,16 +17,42 @@
 #include <math.h>
 #include "gps.h"
 #include "gpsd.h"
+#include "track.h"
 
 #define GPS_RECONNECT_SEC    1
 #define GPS_DATA_TIMEOUT_SEC 5
 
+/* Over 25 seconds of fixes from a 10 Hz receiver */
+#define GPS_HISTORY_LEN         256
+#define GPS_HISTORY_GAP_USEC    (2 * G_USEC_PER_SEC)
+#define GPS_EXTRAPOLATE_USEC    G_USEC_PER_SEC
+#define GPS_EARTH_RADIUS        6371008.8
+
+/* The recorded track keeps only points that add something to the route */
+#define GPS_TRACK_DISTANCE      25.0
+#define GPS_TRACK_TURN_DISTANCE 5.0
+#define GPS_TRACK_TURN_ANGLE    15.0
+
+typedef struct gps_fix
+{
+    gint64  timestamp;
+    gdouble lat;
+    gdouble lon;
+    gdouble track;
+    gdouble speed;
+} gps_fix_t;
+
 typedef struct gps_context
 {
     gpsd_conn_t       *conn;
     gboolean           connected;
     guint              timeout_id;
     mtscan_gps_data_t  data;
+    gps_fix_t          history[GPS_HISTORY_LEN];
+    guint              history_head;
+    guint              history_count;
+    mtscan_track_t    *track;
+    gdouble            track_heading;
     void             (*update_cb)(mtscan_gps_state_t, const mtscan_gps_data_t*, gpointer);
     gpointer           update_cb_user_data;
 } gps_context_t;
@@ -37,12 +63,21 @@ static gps_context_t gps =
     .connected = FALSE,
     .timeout_id = 0,
     .data = {0},
+    .history_head = 0,
+    .history_count = 0,
+    .track = NULL,
+    .track_heading = NAN,
     .update_cb = NULL,
     .update_cb_user_data = NULL
 };
 
 static void gps_null(void);
 static void gps_update(void);
+static void gps_history_add(gint64, gdouble, gdouble, gdouble, gdouble);
+static const gps_fix_t* gps_history_get(guint);
+static void gps_extrapolate(const gps_fix_t*, gint64, gdouble*, gdouble*);
+static void gps_track_record(gint64, gdouble, gdouble);
+static gdouble gps_distance(gdouble, gdouble, gdouble, gdouble);
 static void gps_cb(gpsd_conn_t*);
 static void gps_cb_msg(const gpsd_conn_t*, gpsd_msg_type_t, gconstpointer);
 static void gps_cb_msg_info(gpsd_msg_info_t);
@@ -78,6 +113,13 @@ gps_set_callback(void     (*cb)(mtscan_gps_state_t, const mtscan_gps_data_t*, gp
     gps_update();
 }
 
+void
+gps_set_track(mtscan_track_t *track)
+{
+    gps.track = track;
+    gps.track_heading = NAN;
+}
+
 mtscan_gps_state_t
 gps_get_data(const mtscan_gps_data_t **gps_out)
 {
@@ -101,6 +143,90 @@ gps_get_data(const mtscan_gps_data_t **gps_out)
     return GPS_OK;
 }
 
+gboolean
+gps_get_position(gint64   timestamp,
+                 gdouble *lat,
+                 gdouble *lon)
+{
+    const mtscan_gps_data_t *data;
+    const gps_fix_t *prev = NULL;
+    const gps_fix_t *next = NULL;
+    gdouble ratio, delta;
+    guint i;
+
+    if(!timestamp)
+    {
+        /* Capture time is unknown, use the current position */
+        if(gps_get_data(&data) != GPS_OK)
+            return FALSE;
+
+        *lat = data->lat;
+        *lon = data->lon;
+        return TRUE;
+    }
+
+    /* Look for the fixes around the capture time, the latest first */
+    for(i = 0; i < gps.history_count; i++)
+    {
+        prev = gps_history_get(i);
+        if(prev->timestamp <= timestamp)
+            break;
+        next = prev;
+        prev = NULL;
+    }
+
+    if(!prev && !next)
+        return FALSE;
+
+    if(!next)
+    {
+        /* Captured after the latest fix, the next one is not here yet */
+        if(timestamp - prev->timestamp > GPS_HISTORY_GAP_USEC)
+            return FALSE;
+
+        gps_extrapolate(prev, timestamp, lat, lon);
+        return TRUE;
+    }
+
+    if(!prev)
+    {
+        /* Captured before the oldest fix in the history */
+        if(next->timestamp - timestamp > GPS_HISTORY_GAP_USEC)
+            return FALSE;
+
+        *lat = next->lat;
+        *lon = next->lon;
+        return TRUE;
+    }
+
+    if(next->timestamp - prev->timestamp > GPS_HISTORY_GAP_USEC)
+    {
+        /* Do not interpolate over a gap in fixes, take the closer one */
+        if(timestamp - prev->timestamp > next->timestamp - timestamp)
+            prev = next;
+
+        *lat = prev->lat;
+        *lon = prev->lon;
+        return TRUE;
+    }
+
+    ratio = (gdouble)(timestamp - prev->timestamp) / (gdouble)MAX(next->timestamp - prev->timestamp, 1);
+
+    delta = next->lon - prev->lon;
+    if(delta > 180.0)
+        delta -= 360.0;
+    else if(delta < -180.0)
+        delta += 360.0;
+
+    *lat = prev->lat + ratio * (next->lat - prev->lat);
+    *lon = prev->lon + ratio * delta;
+    if(*lon > 180.0)
+        *lon -= 360.0;
+    else if(*lon < -180.0)
+        *lon += 360.0;
+    return TRUE;
+}
+
 static void
 gps_null(void)
 {
@@ -112,6 +238,7 @@ gps_null(void)
 
     gps.connected = FALSE;
     gps.conn = NULL;
+    gps.history_count = 0;
     gps_update();
 }
 
@@ -182,6 +309,7 @@ gps_cb_msg_info(gpsd_msg_info_t type)
         case GPSD_INFO_CONNECTED:
             gps.connected = TRUE;
             gps.data.valid = FALSE;
+            gps.history_count = 0;
             gps_update();
             break;
 
@@ -206,6 +334,22 @@ gps_cb_msg_data(const gpsd_data_t *data)
     gps.data.epy = gpsd_data_get_epy(data);
     gps.data.epv = gpsd_data_get_epv(data);
     gps.data.valid = TRUE;
+
+    if(gps.data.fix &&
+       !isnan(gps.data.lat) &&
+       !isnan(gps.data.lon))
+    {
+        gps_history_add(gpsd_data_get_received(data),
+                        gps.data.lat,
+                        gps.data.lon,
+                        gpsd_data_get_track(data),
+                        gpsd_data_get_speed(data));
+
+        gps_track_record(gpsd_data_get_received(data),
+                         gpsd_data_get_track(data),
+                         gpsd_data_get_speed(data));
+    }
+
     gps_update();
 
     if(gps.timeout_id)
@@ -220,4 +364,112 @@ gps_cb_timeout(gpointer user_data)
     gps_update();
     gps.timeout_id = 0;
     return G_SOURCE_REMOVE;
-}
\ No newline at end of file
+}
+
+static void
+gps_history_add(gint64  timestamp,
+                gdouble lat,
+                gdouble lon,
+                gdouble track,
+                gdouble speed)
+{
+    gps_fix_t *fix;
+
+    /* The clock went back, older fixes can not be compared anymore */
+    if(gps.history_count && gps_history_get(0)->timestamp > timestamp)
+        gps.history_count = 0;
+
+    gps.history_head = (gps.history_head + 1) % GPS_HISTORY_LEN;
+    if(gps.history_count < GPS_HISTORY_LEN)
+        gps.history_count++;
+
+    fix = &gps.history[gps.history_head];
+    fix->timestamp = timestamp;
+    fix->lat = lat;
+    fix->lon = lon;
+    fix->track = track;
+    fix->speed = speed;
+}
+
+static const gps_fix_t*
+gps_history_get(guint age)
+{
+    /* Index 0 is the latest fix */
+    return &gps.history[(gps.history_head + GPS_HISTORY_LEN - age) % GPS_HISTORY_LEN];
+}
+
+static void
+gps_extrapolate(const gps_fix_t *fix,
+                gint64           timestamp,
+                gdouble         *lat,
+                gdouble         *lon)
+{
+    gdouble distance, track;
+
+    *lat = fix->lat;
+    *lon = fix->lon;
+
+    if(isnan(fix->speed) ||
+       isnan(fix->track) ||
+       timestamp - fix->timestamp > GPS_EXTRAPOLATE_USEC)
+        return;
+
+    /* Move along the last known track for a short while */
+    distance = fix->speed * (gdouble)(timestamp - fix->timestamp) / G_USEC_PER_SEC;
+    track = fix->track * M_PI / 180.0;
+
+    *lat += (distance * cos(track) / GPS_EARTH_RADIUS) * 180.0 / M_PI;
+    *lon += (distance * sin(track) / (GPS_EARTH_RADIUS * cos(fix->lat * M_PI / 180.0))) * 180.0 / M_PI;
+}
+
+static void
+gps_track_record(gint64  received,
+                 gdouble heading,
+                 gdouble speed)
+{
+    const track_point_t *last;
+    track_point_t point;
+    gdouble distance;
+    gdouble turn;
+
+    if(!gps.track)
+        return;
+
+    point.timestamp = received / G_USEC_PER_SEC;
+    point.latitude = gps.data.lat;
+    point.longitude = gps.data.lon;
+    point.speed = speed;
+    point.accuracy = (isnan(gps.data.epx) || isnan(gps.data.epy) ? NAN : MAX(gps.data.epx, gps.data.epy));
+
+    last = mtscan_track_last(gps.track);
+    if(last && last->timestamp >= point.timestamp - MTSCAN_TRACK_INTERVAL_MAX)
+    {
+        /* At most one point per second */
+        if(last->timestamp >= point.timestamp)
+            return;
+
+        distance = gps_distance(last->latitude, last->longitude, point.latitude, point.longitude);
+        turn = (isnan(heading) || isnan(gps.track_heading) ? 0.0 : fabs(remainder(heading - gps.track_heading, 360.0)));
+
+        if(distance < GPS_TRACK_DISTANCE &&
+           (distance < GPS_TRACK_TURN_DISTANCE || turn < GPS_TRACK_TURN_ANGLE))
+            return;
+    }
+
+    mtscan_track_add(gps.track, &point);
+    gps.track_heading = heading;
+}
+
+static gdouble
+gps_distance(gdouble lat1,
+             gdouble lon1,
+             gdouble lat2,
+             gdouble lon2)
+{
+    gdouble x, y;
+
+    /* Equirectangular approximation is fine for short distances */
+    x = remainder(lon2 - lon1, 360.0) * M_PI / 180.0 * cos((lat1 + lat2) / 2.0 * M_PI / 180.0);
+    y = (lat2 - lat1) * M_PI / 180.0;
+    return sqrt(x * x + y * y) * GPS_EARTH_RADIUS;
+}
@@ -15,6 +15,7 @@
 
 #ifndef MTSCAN_GPS_H_
 #define MTSCAN_GPS_H_
+#include "track.h"
 
 typedef enum mtscan_gps_state
 {
@@ -39,7 +40,9 @@ typedef struct mtscan_gps_data
 
 void gps_start(const gchar*, gint);
 void gps_stop(void);
+void gps_set_track(mtscan_track_t*);
 void gps_set_callback(void (*cb)(mtscan_gps_state_t, const mtscan_gps_data_t*, gpointer), gpointer);
 mtscan_gps_state_t gps_get_data(const mtscan_gps_data_t**);
+gboolean gps_get_position(gint64, gdouble*, gdouble*);
 
 #endif
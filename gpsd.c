@@ -20,6 +20,7 @@
 #include <unistd.h>
 #include <yajl/yajl_parse.h>
 #include "gpsd.h"
+#include "msgbus.h"
 #ifdef G_OS_WIN32
 #include <winsock2.h>
 #include <windows.h>
@@ -71,6 +72,7 @@ typedef struct gpsd_data
     gchar *device;
     gpsd_mode_t mode;
     gint64 time;
+    gint64 received;
     gdouble ept;
     gdouble lat;
     gdouble lon;
@@ -178,6 +180,7 @@ typedef struct gpsd_json
 
 static gpsd_msg_t* gpsd_msg_new(const gpsd_conn_t*, gpsd_msg_type_t, gpointer);
 static void gpsd_msg_free(gpsd_msg_t*);
+static void gpsd_post(gpsd_conn_t*, gpsd_msg_type_t, gpointer);
 
 static gpsd_data_t* gpsd_data_new();
 static void gpsd_data_free(gpsd_data_t*);
@@ -297,6 +300,17 @@ gpsd_msg_free(gpsd_msg_t *msg)
     g_free(msg);
 }
 
+static void
+gpsd_post(gpsd_conn_t     *context,
+          gpsd_msg_type_t  type,
+          gpointer         data)
+{
+    gpsd_msg_t *msg = gpsd_msg_new(context, type, data);
+
+    /* Every fix is kept in the GPS history, none can be coalesced */
+    msgbus_post(MSGBUS_QUEUE_GPSD, gpsd_cb_msg, msg);
+}
+
 static gpsd_data_t*
 gpsd_data_new()
 {
@@ -305,6 +319,7 @@ gpsd_data_new()
     data->device = NULL;
     data->mode = GPSD_MODE_INVALID;
     data->time = -1;
+    data->received = 0;
     data->ept = NAN;
     data->lat = NAN;
     data->lon = NAN;
@@ -349,6 +364,12 @@ gpsd_data_get_time(const gpsd_data_t *data)
     return data->time;
 }
 
+gint64
+gpsd_data_get_received(const gpsd_data_t *data)
+{
+    return data->received;
+}
+
 gdouble
 gpsd_data_get_ept(const gpsd_data_t *data)
 {
@@ -455,9 +476,9 @@ gpsd_conn_thread(gpointer user_data)
         if(gpsd_conn_open(context))
         {
             if(!gpsd_conn_read(context))
-                g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_MISMATCH)));
+                gpsd_post(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_MISMATCH));
 
-            g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_DISCONNECTED)));
+            gpsd_post(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_DISCONNECTED));
             gpsd_conn_close(context);
         }
 
@@ -473,7 +494,7 @@ gpsd_conn_thread(gpointer user_data)
 #if DEBUG
     g_print("gpsd_conn@%p: thread stop\n", (gpointer)context);
 #endif
-    g_idle_add(gpsd_cb, context);
+    msgbus_post(MSGBUS_QUEUE_GPSD, gpsd_cb, context);
     return NULL;
 }
 
@@ -492,13 +513,13 @@ gpsd_conn_open(gpsd_conn_t *context)
     hints.ai_socktype = SOCK_STREAM;
 
     /* Resolve the hostname */
-    g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_RESOLVING)));
+    gpsd_post(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_RESOLVING));
     if(getaddrinfo(context->hostname, context->port, &hints, &result))
     {
 #if DEBUG
         g_print("gpsd_conn@%p: failed to resolve the hostname\n", (gpointer)context);
 #endif
-        g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_RESOLV)));
+        gpsd_post(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_RESOLV));
         return FALSE;
     }
 
@@ -508,7 +529,7 @@ gpsd_conn_open(gpsd_conn_t *context)
         return FALSE;
     }
 
-    g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_CONNECTING)));
+    gpsd_post(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_CONNECTING));
     context->fd = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
 #ifdef G_OS_WIN32
     if(context->fd == INVALID_SOCKET)
@@ -520,7 +541,7 @@ gpsd_conn_open(gpsd_conn_t *context)
         g_print("gpsd_conn@%p: failed to create a socket\n", (gpointer)context);
 #endif
         freeaddrinfo(result);
-        g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_CONN)));
+        gpsd_post(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_CONN));
         return FALSE;
     }
 
@@ -531,7 +552,7 @@ gpsd_conn_open(gpsd_conn_t *context)
 #endif
         gpsd_conn_close(context);
         freeaddrinfo(result);
-        g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_CONN)));
+        gpsd_post(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_CONN));
         return FALSE;
     }
     freeaddrinfo(result);
@@ -595,7 +616,7 @@ gpsd_conn_read(gpsd_conn_t *context)
 #if DEBUG
             g_print("gpsd_conn@%p: data timeout (%d sec)\n", (gpointer)context, GPSD_DATA_TIMEOUT_SEC);
 #endif
-            g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_TIMEOUT)));
+            gpsd_post(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_ERR_TIMEOUT));
             break;
         }
 
@@ -771,7 +792,7 @@ gpsd_conn_parse(gpsd_conn_t *context,
 #if DEBUG
         g_print("gpsd_conn@%p: ready\n", (gpointer)context);
 #endif
-        g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_CONNECTED)));
+        gpsd_post(context, GPSD_MSG_INFO, GINT_TO_POINTER(GPSD_INFO_CONNECTED));
 
         /* Send the init string */
         if(!gpsd_conn_write(context, GPSD_INIT_STRING))
@@ -795,6 +816,8 @@ gpsd_conn_parse(gpsd_conn_t *context,
 
     if(json.data)
     {
+        /* Local time of the fix, comparable with the capture timestamps */
+        json.data->received = g_get_real_time();
 #if DEBUG
         g_print("gpsd_conn@%p: device=%s, mode=%s: time=%" G_GINT64_FORMAT " "
                 "ept=%f lat=%f lon=%f alt=%f epx=%f epy=%f epv=%f "
@@ -818,7 +841,7 @@ gpsd_conn_parse(gpsd_conn_t *context,
                 json.data->eps,
                 json.data->epc);
 #endif
-        g_idle_add(gpsd_cb_msg, gpsd_msg_new(context, GPSD_MSG_DATA, json.data));
+        gpsd_post(context, GPSD_MSG_DATA, json.data);
     }
 
     return TRUE;
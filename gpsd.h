@@ -61,6 +61,7 @@ const gchar* gpsd_conn_get_port(const gpsd_conn_t*);
 const gchar* gpsd_data_get_device(const gpsd_data_t*);
 gpsd_mode_t  gpsd_data_get_mode(const gpsd_data_t*);
 gint64       gpsd_data_get_time(const gpsd_data_t*);
+gint64       gpsd_data_get_received(const gpsd_data_t*);
 gdouble      gpsd_data_get_ept(const gpsd_data_t*);
 gdouble      gpsd_data_get_lat(const gpsd_data_t*);
 gdouble      gpsd_data_get_lon(const gpsd_data_t*);
@@ -24,6 +24,7 @@
 #include "ui.h"
 #include "log.h"
 #include "signals.h"
+#include "stations.h"
 #include "misc.h"
 
 #ifdef G_OS_WIN32
@@ -68,6 +69,7 @@ static const gchar *const keys[] =
     "lat",
     "lon",
     "azi",
+    "src",
     "signals"
 };
 
@@ -95,6 +97,7 @@ enum
     KEY_LATITUDE,
     KEY_LONGITUDE,
     KEY_AZIMUTH,
+    KEY_SOURCE,
     KEY_SIGNALS
 };
 
@@ -116,17 +119,62 @@ enum
     KEY_SIGNALS_AZIMUTH
 };
 
+/* Client stations are stored in a separate root object,
+   older versions skip it as a network with invalid address */
+static const gchar *const key_stations = "stations";
+
+static const gchar *const keys_stations[] =
+{
+    "bssid",
+    "ssid",
+    "s",
+    "first",
+    "last",
+    "src"
+};
+
+enum
+{
+    KEY_STATIONS_BSSID = KEY_UNKNOWN+1,
+    KEY_STATIONS_SSID,
+    KEY_STATIONS_RSSI,
+    KEY_STATIONS_FIRSTSEEN,
+    KEY_STATIONS_LASTSEEN,
+    KEY_STATIONS_SOURCE
+};
+
+/* GPS track is an array of [t, lat, lon, speed, accuracy] points,
+   older versions skip it as a network with invalid address */
+static const gchar *const key_track = "track";
+
+enum
+{
+    KEY_TRACK_TIMESTAMP,
+    KEY_TRACK_LATITUDE,
+    KEY_TRACK_LONGITUDE,
+    KEY_TRACK_SPEED,
+    KEY_TRACK_ACCURACY
+};
+
 typedef struct read_context
 {
     void (*net_cb)(network_t*, gpointer);
+    void (*sta_cb)(station_t*, gpointer);
+    void (*track_cb)(const track_point_t*, gpointer);
     gpointer user_data;
 
     gint level;
     gint key;
     gboolean level_signals;
+    gboolean level_stations;
+    gboolean key_track;
+    gint level_track;
     gboolean strip_samples;
     network_t network;
+    station_t station;
     signals_node_t *signal;
+    track_point_t point;
+    gint point_key;
     gint count;
 } read_ctx_t;
 
@@ -140,8 +188,10 @@ typedef struct save_context
     gboolean strip_azi;
     size_t wrote;
     size_t length;
+    GHashTable *addresses;
 } save_ctx_t;
 
+static gint parse_null(gpointer);
 static gint parse_integer(gpointer, long long int);
 static gint parse_double(gpointer, double);
 static gint parse_string(gpointer, const guchar*, size_t);
@@ -150,12 +200,17 @@ static gint parse_key_start(gpointer);
 static gint parse_key_end(gpointer);
 static gint parse_array_start(gpointer);
 static gint parse_array_end(gpointer);
+static void parse_track_value(read_ctx_t*, gdouble);
 static gboolean log_save_foreach(GtkTreeModel*, GtkTreePath*, GtkTreeIter*, gpointer);
+static void log_save_stations(save_ctx_t*);
+static gboolean log_save_stations_foreach(GtkTreeModel*, GtkTreePath*, GtkTreeIter*, gpointer);
+static void log_save_track(save_ctx_t*);
+static void log_save_track_value(save_ctx_t*, gdouble, const gchar*);
 static gboolean log_save_write(save_ctx_t*);
 
 static yajl_callbacks json_callbacks =
 {
-    NULL,               /* yajl_null        */
+    &parse_null,        /* yajl_null        */
     NULL,               /* yajl_boolean     */
     &parse_integer,     /* yajl_integer     */
     &parse_double,      /* yajl_double      */
@@ -172,6 +227,8 @@ static yajl_callbacks json_callbacks =
 gint
 log_read(const gchar  *filename,
          void        (*net_cb)(network_t*, gpointer),
+         void        (*sta_cb)(station_t*, gpointer),
+         void        (*track_cb)(const track_point_t*, gpointer),
          gpointer     user_data,
          gboolean     strip_samples)
 {
@@ -184,6 +241,8 @@ log_read(const gchar  *filename,
     yajl_status status;
 
     context.net_cb = net_cb;
+    context.sta_cb = sta_cb;
+    context.track_cb = track_cb;
     context.user_data = user_data;
     context.strip_samples = strip_samples;
 
@@ -199,9 +258,13 @@ log_read(const gchar  *filename,
     context.key = KEY_UNKNOWN;
     context.level = LEVEL_ROOT;
     context.level_signals = FALSE;
+    context.level_stations = FALSE;
+    context.key_track = FALSE;
+    context.level_track = 0;
     context.signal = NULL;
     context.count = 0;
     network_init(&context.network);
+    station_init(&context.station);
 
     do
     {
@@ -229,19 +292,45 @@ log_read(const gchar  *filename,
     gzclose(gzfp);
     yajl_free(json);
     network_free(&context.network);
+    station_free(&context.station);
     g_free(context.signal);
 
     return context.count;
 }
 
+static gint
+parse_null(gpointer ptr)
+{
+    read_ctx_t *ctx = (read_ctx_t*)ptr;
+    if(ctx->level == LEVEL_OBJECT &&
+       ctx->level_track == 2)
+        ctx->point_key++;
+    return 1;
+}
+
 static gint
 parse_integer(gpointer ptr,
               long long int value)
 {
     read_ctx_t *ctx = (read_ctx_t*)ptr;
-    if(ctx->level == LEVEL_NETWORK+1 &&
-       ctx->level_signals &&
-       ctx->signal)
+    if(ctx->level == LEVEL_OBJECT &&
+       ctx->level_track == 2)
+    {
+        parse_track_value(ctx, (gdouble)value);
+    }
+    else if(ctx->level == LEVEL_NETWORK+1 &&
+       ctx->level_stations)
+    {
+        if(ctx->key == KEY_STATIONS_RSSI)
+            ctx->station.rssi = value;
+        else if(ctx->key == KEY_STATIONS_FIRSTSEEN)
+            ctx->station.firstseen = value;
+        else if(ctx->key == KEY_STATIONS_LASTSEEN)
+            ctx->station.lastseen = value;
+    }
+    else if(ctx->level == LEVEL_NETWORK+1 &&
+            ctx->level_signals &&
+            ctx->signal)
     {
         if(ctx->key == KEY_SIGNALS_TIMESTAMP)
             ctx->signal->timestamp = value;
@@ -290,7 +379,12 @@ parse_double(gpointer ptr,
              double value)
 {
     read_ctx_t *ctx = (read_ctx_t*)ptr;
-    if(ctx->level == LEVEL_NETWORK+1 &&
+    if(ctx->level == LEVEL_OBJECT &&
+       ctx->level_track == 2)
+    {
+        parse_track_value(ctx, value);
+    }
+    else if(ctx->level == LEVEL_NETWORK+1 &&
        ctx->level_signals &&
        ctx->signal)
     {
@@ -321,7 +415,18 @@ parse_string(gpointer      ptr,
              size_t        length)
 {
     read_ctx_t *ctx = (read_ctx_t*)ptr;
-    if(ctx->level == LEVEL_NETWORK)
+    if(ctx->level == LEVEL_NETWORK+1 &&
+       ctx->level_stations)
+    {
+        if(ctx->key == KEY_STATIONS_BSSID)
+            ctx->station.bssid = str_addr_to_gint64((gchar*)string, length);
+        else if(ctx->key == KEY_STATIONS_SSID)
+            ctx->station.ssid = g_strndup((gchar*)string, length);
+        else if(ctx->key == KEY_STATIONS_SOURCE)
+            ctx->station.source = g_strndup((gchar*)string, length);
+    }
+    else if(ctx->level == LEVEL_NETWORK &&
+            !ctx->level_stations)
     {
         if(ctx->key == KEY_CHANNEL)
             ctx->network.channel = g_strndup((gchar*)string, length);
@@ -336,6 +441,8 @@ parse_string(gpointer      ptr,
             ctx->network.flags.routeros = TRUE;
             ctx->network.routeros_ver = g_strndup((gchar*)string, length);
         }
+        else if(ctx->key == KEY_SOURCE)
+            ctx->network.source = g_strndup((gchar*)string, length);
     }
     return 1;
 }
@@ -364,7 +471,20 @@ parse_key(gpointer      ptr,
     gint i;
     ctx->key = KEY_UNKNOWN;
 
-    if(ctx->level == LEVEL_NETWORK+1)
+    if(ctx->level == LEVEL_NETWORK+1 &&
+       ctx->level_stations)
+    {
+        for(i=KEY_UNKNOWN+1; i<G_N_ELEMENTS(keys_stations); i++)
+        {
+            if(length == strlen(keys_stations[i]) &&
+               !strncmp(keys_stations[i], (gchar*)string, length))
+            {
+                ctx->key = i;
+                break;
+            }
+        }
+    }
+    else if(ctx->level == LEVEL_NETWORK+1)
     {
         for(i=KEY_UNKNOWN+1; i<G_N_ELEMENTS(keys_signals); i++)
         {
@@ -376,6 +496,14 @@ parse_key(gpointer      ptr,
             }
         }
     }
+    else if(ctx->level == LEVEL_NETWORK &&
+            ctx->level_stations)
+    {
+        station_free(&ctx->station);
+        station_init(&ctx->station);
+        if(length == 12)
+            ctx->station.address = str_addr_to_gint64((gchar*)string, length);
+    }
     else if(ctx->level == LEVEL_NETWORK)
     {
         for(i=KEY_UNKNOWN+1; i<G_N_ELEMENTS(keys); i++)
@@ -391,6 +519,12 @@ parse_key(gpointer      ptr,
     else if(ctx->level == LEVEL_OBJECT)
     {
         network_init(&ctx->network);
+        ctx->level_stations = (ctx->sta_cb &&
+                               length == strlen(key_stations) &&
+                               !strncmp(key_stations, (gchar*)string, length));
+        ctx->key_track = (ctx->track_cb &&
+                          length == strlen(key_track) &&
+                          !strncmp(key_track, (gchar*)string, length));
         if(length == 12)
         {
             ctx->network.address = str_addr_to_gint64((gchar*)string, length);
@@ -408,7 +542,16 @@ parse_key_end(gpointer ptr)
     read_ctx_t *ctx = (read_ctx_t*)ptr;
 
     if(ctx->level == LEVEL_NETWORK+1 &&
-       ctx->level_signals == TRUE)
+       ctx->level_stations)
+    {
+        if(ctx->station.address >= 0)
+            ctx->sta_cb(&ctx->station, ctx->user_data);
+
+        station_free(&ctx->station);
+        station_init(&ctx->station);
+    }
+    else if(ctx->level == LEVEL_NETWORK+1 &&
+            ctx->level_signals == TRUE)
     {
         /* Assume that all signal samples are sorted by timestamp */
         if(ctx->signal &&
@@ -421,6 +564,11 @@ parse_key_end(gpointer ptr)
             g_free(ctx->signal);
         ctx->signal = NULL;
     }
+    else if(ctx->level == LEVEL_NETWORK &&
+            ctx->level_stations)
+    {
+        ctx->level_stations = FALSE;
+    }
     else if(ctx->level == LEVEL_NETWORK)
     {
         if(ctx->network.address >= 0)
@@ -441,6 +589,18 @@ parse_array_start(gpointer ptr)
     read_ctx_t *ctx = (read_ctx_t*)ptr;
     if(ctx->level == LEVEL_NETWORK && ctx->key == KEY_SIGNALS)
         ctx->level_signals = TRUE;
+    else if(ctx->level == LEVEL_OBJECT && ctx->key_track)
+    {
+        if(++ctx->level_track == 2)
+        {
+            ctx->point.timestamp = 0;
+            ctx->point.latitude = NAN;
+            ctx->point.longitude = NAN;
+            ctx->point.speed = NAN;
+            ctx->point.accuracy = NAN;
+            ctx->point_key = KEY_TRACK_TIMESTAMP;
+        }
+    }
     return 1;
 }
 
@@ -450,9 +610,50 @@ parse_array_end(gpointer ptr)
     read_ctx_t *ctx = (read_ctx_t*)ptr;
     if(ctx->level == LEVEL_NETWORK && ctx->level_signals)
         ctx->level_signals = FALSE;
+    else if(ctx->level == LEVEL_OBJECT && ctx->level_track)
+    {
+        if(ctx->level_track == 2 &&
+           ctx->point.timestamp &&
+           !isnan(ctx->point.latitude) &&
+           !isnan(ctx->point.longitude))
+        {
+            ctx->track_cb(&ctx->point, ctx->user_data);
+        }
+
+        if(--ctx->level_track == 0)
+            ctx->key_track = FALSE;
+    }
     return 1;
 }
 
+static void
+parse_track_value(read_ctx_t *ctx,
+                  gdouble     value)
+{
+    switch(ctx->point_key++)
+    {
+        case KEY_TRACK_TIMESTAMP:
+            ctx->point.timestamp = (gint64)value;
+            break;
+
+        case KEY_TRACK_LATITUDE:
+            ctx->point.latitude = value;
+            break;
+
+        case KEY_TRACK_LONGITUDE:
+            ctx->point.longitude = value;
+            break;
+
+        case KEY_TRACK_SPEED:
+            ctx->point.speed = value;
+            break;
+
+        case KEY_TRACK_ACCURACY:
+            ctx->point.accuracy = value;
+            break;
+    }
+}
+
 log_save_error_t*
 log_save(gchar       *filename,
          gboolean     strip_signals,
@@ -509,11 +710,14 @@ log_save(gchar       *filename,
     ctx.strip_signals = strip_signals;
     ctx.strip_gps = strip_gps;
     ctx.strip_azi = strip_azi;
+    ctx.addresses = NULL;
     //yajl_gen_config(ctx.gen, yajl_gen_beautify, 1);
     yajl_gen_map_open(ctx.gen);
 
     if(iterlist)
     {
+        /* Keep only the clients of the saved networks */
+        ctx.addresses = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
         for(i=iterlist; i; i=i->next)
             log_save_foreach(GTK_TREE_MODEL(ui.model->store), NULL, (GtkTreeIter*)(i->data), &ctx);
     }
@@ -522,10 +726,16 @@ log_save(gchar       *filename,
         gtk_tree_model_foreach(GTK_TREE_MODEL(ui.model->store), log_save_foreach, &ctx);
     }
 
+    log_save_stations(&ctx);
+    log_save_track(&ctx);
+
     yajl_gen_map_close(ctx.gen);
     log_save_write(&ctx);
     yajl_gen_free(ctx.gen);
 
+    if(ctx.addresses)
+        g_hash_table_destroy(ctx.addresses);
+
     if(ctx.gzfp)
         gzclose(ctx.gzfp);
 #ifdef G_OS_WIN32
@@ -585,9 +795,13 @@ log_save_foreach(GtkTreeModel *store,
                        COL_LATITUDE, &net.latitude,
                        COL_LONGITUDE, &net.longitude,
                        COL_AZIMUTH, &net.azimuth,
+                       COL_SOURCE, &net.source,
                        COL_SIGNALS, &net.signals,
                        -1);
 
+    if(ctx->addresses)
+        g_hash_table_add(ctx->addresses, g_memdup(&net.address, sizeof(gint64)));
+
     address = model_format_address(net.address, FALSE);
     yajl_gen_string(ctx->gen, (guchar*)address, strlen(address));
     yajl_gen_map_open(ctx->gen);
@@ -680,6 +894,12 @@ log_save_foreach(GtkTreeModel *store,
         yajl_gen_number(ctx->gen, buffer, strlen(buffer));
     }
 
+    if(net.source && strlen(net.source))
+    {
+        yajl_gen_string(ctx->gen, (guchar*)keys[KEY_SOURCE], strlen(keys[KEY_SOURCE]));
+        yajl_gen_string(ctx->gen, (guchar*)net.source, strlen(net.source));
+    }
+
     if(net.signals->head && !ctx->strip_signals)
     {
         yajl_gen_string(ctx->gen, (guchar*)keys[KEY_SIGNALS], strlen(keys[KEY_SIGNALS]));
@@ -731,6 +951,132 @@ log_save_foreach(GtkTreeModel *store,
     return !log_save_write(ctx);
 }
 
+static void
+log_save_stations(save_ctx_t *ctx)
+{
+    if(!mtscan_stations_count(ui.stations))
+        return;
+
+    yajl_gen_string(ctx->gen, (guchar*)key_stations, strlen(key_stations));
+    yajl_gen_map_open(ctx->gen);
+    gtk_tree_model_foreach(GTK_TREE_MODEL(ui.stations->store), log_save_stations_foreach, ctx);
+    yajl_gen_map_close(ctx->gen);
+    log_save_write(ctx);
+}
+
+static gboolean
+log_save_stations_foreach(GtkTreeModel *store,
+                          GtkTreePath  *path,
+                          GtkTreeIter  *iter,
+                          gpointer      data)
+{
+    save_ctx_t *ctx = (save_ctx_t*)data;
+    station_t sta;
+    const gchar *address;
+
+    gtk_tree_model_get(store, iter,
+                       STA_COL_ADDRESS, &sta.address,
+                       STA_COL_BSSID, &sta.bssid,
+                       STA_COL_SSID, &sta.ssid,
+                       STA_COL_RSSI, &sta.rssi,
+                       STA_COL_FIRSTLOG, &sta.firstseen,
+                       STA_COL_LASTLOG, &sta.lastseen,
+                       STA_COL_SOURCE, &sta.source,
+                       -1);
+
+    if(ctx->addresses &&
+       (sta.bssid < 0 || !g_hash_table_contains(ctx->addresses, &sta.bssid)))
+    {
+        station_free(&sta);
+        return FALSE;
+    }
+
+    address = model_format_address(sta.address, FALSE);
+    yajl_gen_string(ctx->gen, (guchar*)address, strlen(address));
+    yajl_gen_map_open(ctx->gen);
+
+    if(sta.bssid >= 0)
+    {
+        address = model_format_address(sta.bssid, FALSE);
+        yajl_gen_string(ctx->gen, (guchar*)keys_stations[KEY_STATIONS_BSSID], strlen(keys_stations[KEY_STATIONS_BSSID]));
+        yajl_gen_string(ctx->gen, (guchar*)address, strlen(address));
+    }
+
+    if(sta.ssid && strlen(sta.ssid))
+    {
+        yajl_gen_string(ctx->gen, (guchar*)keys_stations[KEY_STATIONS_SSID], strlen(keys_stations[KEY_STATIONS_SSID]));
+        yajl_gen_string(ctx->gen, (guchar*)sta.ssid, strlen(sta.ssid));
+    }
+
+    if(sta.rssi != MODEL_NO_SIGNAL)
+    {
+        yajl_gen_string(ctx->gen, (guchar*)keys_stations[KEY_STATIONS_RSSI], strlen(keys_stations[KEY_STATIONS_RSSI]));
+        yajl_gen_integer(ctx->gen, sta.rssi);
+    }
+
+    yajl_gen_string(ctx->gen, (guchar*)keys_stations[KEY_STATIONS_FIRSTSEEN], strlen(keys_stations[KEY_STATIONS_FIRSTSEEN]));
+    yajl_gen_integer(ctx->gen, sta.firstseen);
+
+    yajl_gen_string(ctx->gen, (guchar*)keys_stations[KEY_STATIONS_LASTSEEN], strlen(keys_stations[KEY_STATIONS_LASTSEEN]));
+    yajl_gen_integer(ctx->gen, sta.lastseen);
+
+    if(sta.source && strlen(sta.source))
+    {
+        yajl_gen_string(ctx->gen, (guchar*)keys_stations[KEY_STATIONS_SOURCE], strlen(keys_stations[KEY_STATIONS_SOURCE]));
+        yajl_gen_string(ctx->gen, (guchar*)sta.source, strlen(sta.source));
+    }
+
+    yajl_gen_map_close(ctx->gen);
+    station_free(&sta);
+
+    return !log_save_write(ctx);
+}
+
+static void
+log_save_track(save_ctx_t *ctx)
+{
+    const track_point_t *point;
+    guint i;
+
+    if(ctx->strip_gps || !mtscan_track_count(ui.track))
+        return;
+
+    yajl_gen_string(ctx->gen, (guchar*)key_track, strlen(key_track));
+    yajl_gen_array_open(ctx->gen);
+    for(i = 0; (point = mtscan_track_get(ui.track, i)); i++)
+    {
+        yajl_gen_array_open(ctx->gen);
+        yajl_gen_integer(ctx->gen, point->timestamp);
+        log_save_track_value(ctx, point->latitude, "%.6f");
+        log_save_track_value(ctx, point->longitude, "%.6f");
+        log_save_track_value(ctx, point->speed, "%.1f");
+        log_save_track_value(ctx, point->accuracy, "%.1f");
+        yajl_gen_array_close(ctx->gen);
+
+        if(!log_save_write(ctx))
+            break;
+    }
+    yajl_gen_array_close(ctx->gen);
+    log_save_write(ctx);
+}
+
+static void
+log_save_track_value(save_ctx_t  *ctx,
+                     gdouble      value,
+                     const gchar *format)
+{
+    gchar buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+    if(isnan(value))
+    {
+        yajl_gen_null(ctx->gen);
+        return;
+    }
+
+    g_ascii_formatd(buffer, sizeof(buffer), format, value);
+    yajl_gen_number(ctx->gen, buffer, strlen(buffer));
+}
+
 static gboolean
 log_save_write(save_ctx_t *ctx)
 {
@@ -16,6 +16,8 @@
 #ifndef MTSCAN_LOG_H_
 #define MTSCAN_LOG_H_
 #include <gtk/gtk.h>
+#include "station.h"
+#include "track.h"
 
 #define LOG_READ_ERROR_EMPTY  0
 #define LOG_READ_ERROR_OPEN  -1
@@ -30,7 +32,7 @@ typedef struct log_save_error
 } log_save_error_t;
 
 
-gint log_read(const gchar*, void (*)(network_t*, gpointer), gpointer, gboolean);
+gint log_read(const gchar*, void (*)(network_t*, gpointer), void (*)(station_t*, gpointer), void (*)(const track_point_t*, gpointer), gpointer, gboolean);
 log_save_error_t* log_save(gchar*, gboolean, gboolean, gboolean, GList*);
 
 #endif
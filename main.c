@@ -20,8 +20,11 @@
 #include "conf.h"
 #include "ui.h"
 #include "ui-log.h"
+#include "ui-sources.h"
 #include "model.h"
 #include "oui.h"
+#include "blacklist.h"
+#include "gps.h"
 
 #ifdef G_OS_WIN32
 #include "win32.h"
@@ -31,12 +34,14 @@ typedef struct mtscan_arg
 {
     const gchar *config_path;
     gint auto_connect;
+    gchar **auto_connect_sources;
 } mtscan_arg_t;
 
 static mtscan_arg_t args =
 {
     .config_path = NULL,
-    .auto_connect = 0
+    .auto_connect = 0,
+    .auto_connect_sources = NULL
 };
 
 static const gchar *oui_files[] =
@@ -66,6 +71,9 @@ parse_args(gint   argc,
             break;
 
         case 'a':
+            /* Additional profiles scan alongside the first one: -a 1,2,3 */
+            g_strfreev(args.auto_connect_sources);
+            args.auto_connect_sources = g_strsplit(optarg, ",", -1);
             args.auto_connect = atoi(optarg);
             break;
 
@@ -107,6 +115,9 @@ main(gint   argc,
 
     memset(&ui, 0, sizeof(ui));
     ui.model = mtscan_model_new();
+    ui.stations = mtscan_stations_new();
+    ui.track = mtscan_track_new();
+    gps_set_track(ui.track);
     ui_init();
 
     for(i=optind; i<argc; i++)
@@ -120,7 +131,12 @@ main(gint   argc,
     }
 
     if(args.auto_connect > 0)
+    {
         ui_toggle_connection(args.auto_connect);
+        for(i=1; args.auto_connect_sources[i]; i++)
+            ui_sources_connect(atoi(args.auto_connect_sources[i]));
+    }
+    g_strfreev(args.auto_connect_sources);
 
     for(file = oui_files; *file && !oui_init(*file); file++);
 
@@ -128,6 +144,10 @@ main(gint   argc,
 
     oui_destroy();
     mtscan_model_free(ui.model);
+    mtscan_stations_free(ui.stations);
+    gps_set_track(NULL);
+    mtscan_track_free(ui.track);
+    blacklist_free();
 
 #ifdef G_OS_WIN32
     win32_cleanup();
@@ -24,10 +24,12 @@
 #endif
 
 #define MAC_ADDR_HEX_LEN 12
+#define OUI_HEX_LEN       6
 
 static gboolean create_liststore_from_tree_foreach(gpointer, gpointer, gpointer);
 static gboolean fill_tree_from_liststore_foreach(GtkTreeModel*, GtkTreePath*, GtkTreeIter*, gpointer);
 static gboolean create_strv_from_liststore_foreach(GtkTreeModel*, GtkTreePath*, GtkTreeIter*, gpointer);
+static gint64 str_hex_to_gint64(const gchar*, gint);
 
 
 gint
@@ -269,28 +271,43 @@ strv_equal(const gchar* const *v1,
 gint64
 str_addr_to_gint64(const gchar* str,
                    gint         len)
+{
+    if(len == MAC_ADDR_HEX_LEN)
+        return str_hex_to_gint64(str, len);
+    return -1;
+}
+
+gint64
+str_oui_to_gint64(const gchar* str,
+                  gint         len)
+{
+    if(len == OUI_HEX_LEN)
+        return str_hex_to_gint64(str, len);
+    return -1;
+}
+
+static gint64
+str_hex_to_gint64(const gchar* str,
+                  gint         len)
 {
     gchar buffer[MAC_ADDR_HEX_LEN+1];
     gchar *ptr;
     gint64 value;
     gint i;
 
-    if(len == MAC_ADDR_HEX_LEN)
+    for(i=0; i<len; i++)
     {
-        for(i=0; i<len; i++)
-        {
-            if(!((str[i] >= '0' && str[i] <= '9') ||
-                (str[i] >= 'A' && str[i] <= 'F') ||
-                (str[i] >= 'a' && str[i] <= 'f')))
-                return -1;
-        }
-
-        memcpy(buffer, str, MAC_ADDR_HEX_LEN);
-        buffer[MAC_ADDR_HEX_LEN] = '\0';
-        value = g_ascii_strtoll(buffer, &ptr, 16);
-        if(ptr != buffer)
-            return value;
+        if(!((str[i] >= '0' && str[i] <= '9') ||
+            (str[i] >= 'A' && str[i] <= 'F') ||
+            (str[i] >= 'a' && str[i] <= 'f')))
+            return -1;
     }
+
+    memcpy(buffer, str, len);
+    buffer[len] = '\0';
+    value = g_ascii_strtoll(buffer, &ptr, 16);
+    if(ptr != buffer)
+        return value;
     return -1;
 }
 
@@ -30,8 +30,24 @@
 #define MIKROTIK_LOW_SIGNAL_BUGFIX  1
 #define MIKROTIK_HIGH_SIGNAL_BUGFIX 1
 
+typedef struct model_seen
+{
+    gint64 address;
+    gint64 timestamp;
+    gdouble latitude;
+    gdouble longitude;
+} model_seen_t;
+
+typedef struct model_merge
+{
+    const gchar *source;
+    gboolean multiple;
+    gint8 rssi;
+} model_merge_t;
+
 enum
 {
+    MODEL_NETWORK_NONE,
     MODEL_NETWORK_UPDATE,
     MODEL_NETWORK_NEW,
     MODEL_NETWORK_NEW_HIGHLIGHT,
@@ -45,7 +61,10 @@ static gint model_sort_float(GtkTreeModel*, GtkTreeIter*, GtkTreeIter*, gpointer
 static gint model_sort_version(GtkTreeModel*, GtkTreeIter*, GtkTreeIter*, gpointer);
 static void model_free_foreach(gpointer, gpointer, gpointer);
 static gboolean model_clear_active_foreach(gpointer, gpointer, gpointer);
+static GHashTable* model_buffer_merge_new(GSList*);
+static void model_buffer_merge(mtscan_model_t*, GHashTable*);
 static gint model_update_network(mtscan_model_t*, network_t*);
+static gint model_update_seen(mtscan_model_t*, const model_seen_t*);
 
 static void mtscan_model_geoloc_foreach(gpointer, gpointer, gpointer);
 
@@ -84,10 +103,13 @@ mtscan_model_new(void)
                                       G_TYPE_DOUBLE,   /* COL_LONGITUDE */
                                       G_TYPE_FLOAT,    /* COL_AZIMUTH   */
                                       G_TYPE_FLOAT,    /* COL_DISTANCE  */
+                                      G_TYPE_STRING,   /* COL_SOURCE    */
+                                      G_TYPE_INT,      /* COL_CLIENTS   */
                                       G_TYPE_POINTER); /* COL_SIGNALS   */
 
     gtk_tree_sortable_set_sort_func(GTK_TREE_SORTABLE(model->store), COL_SSID, model_sort_ascii_string, GINT_TO_POINTER(COL_SSID), NULL);
     gtk_tree_sortable_set_sort_func(GTK_TREE_SORTABLE(model->store), COL_RADIONAME, model_sort_ascii_string, GINT_TO_POINTER(COL_RADIONAME), NULL);
+    gtk_tree_sortable_set_sort_func(GTK_TREE_SORTABLE(model->store), COL_SOURCE, model_sort_ascii_string, GINT_TO_POINTER(COL_SOURCE), NULL);
     gtk_tree_sortable_set_sort_func(GTK_TREE_SORTABLE(model->store), COL_RSSI, model_sort_rssi, NULL, NULL);
     gtk_tree_sortable_set_sort_func(GTK_TREE_SORTABLE(model->store), COL_LATITUDE, model_sort_double, GINT_TO_POINTER(COL_LATITUDE), NULL);
     gtk_tree_sortable_set_sort_func(GTK_TREE_SORTABLE(model->store), COL_LONGITUDE, model_sort_double, GINT_TO_POINTER(COL_LONGITUDE), NULL);
@@ -101,6 +123,8 @@ mtscan_model_new(void)
     model->new_timeout = MODEL_DEFAULT_NEW_TIMEOUT;
     model->disabled_sorting = FALSE;
     model->buffer = NULL;
+    model->buffer_map = g_hash_table_new(g_int64_hash, g_int64_equal);
+    model->buffer_seen = g_array_new(FALSE, FALSE, sizeof(model_seen_t));
 	model->clear_active_all = FALSE;
     return model;
 }
@@ -285,6 +309,8 @@ mtscan_model_free(mtscan_model_t *model)
     g_hash_table_foreach(model->map, model_free_foreach, model);
     g_hash_table_destroy(model->map);
     g_hash_table_destroy(model->active);
+    g_hash_table_destroy(model->buffer_map);
+    g_array_free(model->buffer_seen, TRUE);
     g_object_unref(model->store);
     g_free(model);
 }
@@ -388,22 +414,18 @@ void
 mtscan_model_buffer_add(mtscan_model_t *model,
                         network_t      *net)
 {
-    if(conf_get_preferences_blacklist_enabled() &&
-       conf_get_preferences_blacklist(net->address))
-    {
-        network_free(net);
-        g_free(net);
-        return;
-    }
-
+    /* Blacklisted networks never get here,
+       they are dropped by the capture threads */
     network_to_utf8(net, conf_get_preferences_fallback_encoding());
     model->buffer = g_slist_prepend(model->buffer, (gpointer)net);
+    g_hash_table_replace(model->buffer_map, &net->address, net);
 }
 
 void
 mtscan_model_buffer_clear(mtscan_model_t *model)
 {
     GSList *current = model->buffer;
+    g_hash_table_remove_all(model->buffer_map);
     while(current)
     {
         network_t *net = (network_t*)(current->data);
@@ -413,18 +435,47 @@ mtscan_model_buffer_clear(mtscan_model_t *model)
     }
     g_slist_free(model->buffer);
     model->buffer = NULL;
+    g_array_set_size(model->buffer_seen, 0);
+}
+
+gboolean
+mtscan_model_buffer_contains(mtscan_model_t *model,
+                             gint64          address)
+{
+    /* Networks waiting for the next update */
+    return g_hash_table_contains(model->buffer_map, &address);
+}
+
+void
+mtscan_model_buffer_seen(mtscan_model_t *model,
+                         gint64          address,
+                         gint64          timestamp,
+                         gdouble         latitude,
+                         gdouble         longitude)
+{
+    model_seen_t seen;
+
+    seen.address = address;
+    seen.timestamp = timestamp;
+    seen.latitude = latitude;
+    seen.longitude = longitude;
+    g_array_append_val(model->buffer_seen, seen);
 }
 
 gint
 mtscan_model_buffer_and_inactive_update(mtscan_model_t *model)
 {
     GSList *current;
+    GHashTable *merge;
     gint state = MODEL_UPDATE_NONE;
     gint status;
+    guint i;
 
     if(model->buffer)
     {
+        g_hash_table_remove_all(model->buffer_map);
         model->buffer = g_slist_reverse(model->buffer);
+        merge = model_buffer_merge_new(model->buffer);
         current = model->buffer;
 
         while(current)
@@ -447,8 +498,18 @@ mtscan_model_buffer_and_inactive_update(mtscan_model_t *model)
         }
         g_slist_free(model->buffer);
         model->buffer = NULL;
+
+        model_buffer_merge(model, merge);
+        g_hash_table_destroy(merge);
     }
 
+    for(i = 0; i < model->buffer_seen->len; i++)
+    {
+        if(model_update_seen(model, &g_array_index(model->buffer_seen, model_seen_t, i)) == MODEL_NETWORK_UPDATE)
+            state |= MODEL_UPDATE;
+    }
+    g_array_set_size(model->buffer_seen, 0);
+
     model->clear_active_changed = FALSE;
 	g_hash_table_foreach_remove(model->active, model_clear_active_foreach, model);
     if(model->clear_active_changed && state == MODEL_UPDATE_NONE)
@@ -457,6 +518,104 @@ mtscan_model_buffer_and_inactive_update(mtscan_model_t *model)
     return state;
 }
 
+static gint
+model_update_seen(mtscan_model_t     *model,
+                  const model_seen_t *seen)
+{
+    GtkTreeIter *iter_ptr;
+    gint64 *address;
+    guint8 state;
+    gint8 rssi;
+    gint64 lastseen;
+    signals_t *signals;
+
+    if(!g_hash_table_lookup_extended(model->map, &seen->address, (gpointer*)&address, (gpointer*)&iter_ptr))
+        return MODEL_NETWORK_NONE;
+
+    gtk_tree_model_get(GTK_TREE_MODEL(model->store), iter_ptr,
+                       COL_STATE, &state,
+                       COL_RSSI, &rssi,
+                       COL_LASTLOG, &lastseen,
+                       COL_SIGNALS, &signals,
+                       -1);
+
+    /* Already updated with full data in this pass */
+    if(lastseen >= seen->timestamp &&
+       g_hash_table_contains(model->active, address))
+        return MODEL_NETWORK_NONE;
+
+    /* Nothing has changed since the last full update,
+       so only mark the network as still seen */
+    if(conf_get_preferences_signals())
+        signals_append(signals, signals_node_new(seen->timestamp, rssi, seen->latitude, seen->longitude, NAN));
+
+    gtk_list_store_set(model->store, iter_ptr,
+                       COL_STATE, (state == MODEL_STATE_INACTIVE ? MODEL_STATE_ACTIVE : state),
+                       COL_LASTLOG, seen->timestamp,
+                       -1);
+
+    g_hash_table_insert(model->active, address, iter_ptr);
+    return MODEL_NETWORK_UPDATE;
+}
+
+static GHashTable*
+model_buffer_merge_new(GSList *buffer)
+{
+    GHashTable *merge;
+    model_merge_t *m;
+    network_t *net;
+
+    /* Find networks reported by more than one source in this update */
+    merge = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, g_free);
+    for(; buffer; buffer = buffer->next)
+    {
+        net = (network_t*)(buffer->data);
+
+        if(!(m = g_hash_table_lookup(merge, &net->address)))
+        {
+            m = g_malloc(sizeof(model_merge_t));
+            m->source = net->source;
+            m->multiple = FALSE;
+            m->rssi = net->rssi;
+            g_hash_table_insert(merge, gint64dup(&net->address), m);
+            continue;
+        }
+
+        if(g_strcmp0(m->source, net->source))
+            m->multiple = TRUE;
+        m->rssi = MAX(m->rssi, net->rssi);
+    }
+    return merge;
+}
+
+static void
+model_buffer_merge(mtscan_model_t *model,
+                   GHashTable     *merge)
+{
+    GHashTableIter iter;
+    GtkTreeIter *iter_ptr;
+    gint64 *address;
+    model_merge_t *m;
+
+    /* Every frame has been applied in order, so the samples, the peak
+       with its position and source and the latest fields are all kept.
+       Only the current signal would flip between the sources, show the
+       strongest one instead. Frames from a single source stay as they are. */
+    g_hash_table_iter_init(&iter, merge);
+    while(g_hash_table_iter_next(&iter, (gpointer*)&address, (gpointer*)&m))
+    {
+        if(!m->multiple)
+            continue;
+
+        if((iter_ptr = g_hash_table_lookup(model->map, address)))
+        {
+            gtk_list_store_set(model->store, iter_ptr,
+                               COL_RSSI, m->rssi,
+                               -1);
+        }
+    }
+}
+
 gint
 model_update_network(mtscan_model_t *model,
                      network_t      *net)
@@ -555,6 +714,7 @@ model_update_network(mtscan_model_t *model,
                                COL_LONGITUDE, net->longitude,
                                COL_AZIMUTH, net->azimuth,
                                COL_DISTANCE, distance,
+                               COL_SOURCE, (net->source ? net->source : ""),
                                -1);
         }
         else
@@ -627,6 +787,7 @@ model_update_network(mtscan_model_t *model,
                                           COL_LONGITUDE, net->longitude,
                                           COL_AZIMUTH, net->azimuth,
                                           COL_DISTANCE, distance,
+                                          COL_SOURCE, (net->source ? net->source : ""),
                                           COL_SIGNALS, net->signals,
                                           -1);
 
@@ -740,6 +901,7 @@ mtscan_model_add(mtscan_model_t *model,
                                COL_LONGITUDE, net->longitude,
                                COL_AZIMUTH, net->azimuth,
                                COL_DISTANCE, NAN,
+                               COL_SOURCE, (net->source ? net->source : ""),
                                -1);
         }
     }
@@ -775,6 +937,7 @@ mtscan_model_add(mtscan_model_t *model,
                                           COL_LONGITUDE, net->longitude,
                                           COL_AZIMUTH, net->azimuth,
                                           COL_DISTANCE, NAN,
+                                          COL_SOURCE, (net->source ? net->source : ""),
                                           COL_SIGNALS, net->signals,
                                           -1);
 
@@ -787,6 +950,30 @@ mtscan_model_add(mtscan_model_t *model,
     }
 }
 
+void
+mtscan_model_set_clients(mtscan_model_t *model,
+                         gint64          addr,
+                         gint            clients)
+{
+    GtkTreeIter *iter;
+    gint current;
+
+    if((iter = g_hash_table_lookup(model->map, &addr)))
+    {
+        gtk_tree_model_get(GTK_TREE_MODEL(model->store), iter,
+                           COL_CLIENTS, &current,
+                           -1);
+
+        /* Avoid a row-changed signal for every station frame */
+        if(current != clients)
+        {
+            gtk_list_store_set(model->store, iter,
+                               COL_CLIENTS, clients,
+                               -1);
+        }
+    }
+}
+
 void
 mtscan_model_geoloc(mtscan_model_t *model,
                     gint64          addr)
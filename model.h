@@ -52,6 +52,8 @@ typedef struct mtscan_model
     gint last_sort_column;
     GtkSortType last_sort_order;
     GSList *buffer;
+    GHashTable *buffer_map;
+    GArray *buffer_seen;
     gboolean clear_active_all;
     gboolean clear_active_changed;
 } mtscan_model_t;
@@ -86,6 +88,8 @@ enum
     COL_LONGITUDE,
     COL_AZIMUTH,
     COL_DISTANCE,
+    COL_SOURCE,
+    COL_CLIENTS,
     COL_SIGNALS,
     COL_COUNT
 };
@@ -97,11 +101,15 @@ void mtscan_model_clear_active(mtscan_model_t*);
 void mtscan_model_remove(mtscan_model_t*, GtkTreeIter*);
 
 void mtscan_model_buffer_add(mtscan_model_t*, network_t*);
+void mtscan_model_buffer_seen(mtscan_model_t*, gint64, gint64, gdouble, gdouble);
 void mtscan_model_buffer_clear(mtscan_model_t*);
+gboolean mtscan_model_buffer_contains(mtscan_model_t*, gint64);
 gint mtscan_model_buffer_and_inactive_update(mtscan_model_t*);
 
 void mtscan_model_add(mtscan_model_t*, network_t*, gboolean);
 
+void mtscan_model_set_clients(mtscan_model_t*, gint64, gint);
+
 void mtscan_model_geoloc(mtscan_model_t*, gint64);
 void mtscan_model_geoloc_all(mtscan_model_t*);
 
@@ -0,0 +1,291 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include "msgbus.h"
+
+#define MSGBUS_FRAME_USEC     (G_USEC_PER_SEC / 50)
+#define MSGBUS_WAIT_MAX_USEC  G_USEC_PER_SEC
+
+typedef struct msgbus_entry
+{
+    GSourceFunc    func;
+    gpointer       data;
+    gconstpointer  key;
+    GDestroyNotify destroy;
+    gint64         timestamp;
+    guint64        sequence;
+} msgbus_entry_t;
+
+typedef struct msgbus_queue_ctx
+{
+    GQueue  entries;
+    guint   capacity;
+    guint   depth_max;
+    guint64 posted;
+    guint64 dispatched;
+    guint64 coalesced;
+    guint64 overflows;
+    gint64  latency_sum;
+    gint64  latency_max;
+} msgbus_queue_ctx_t;
+
+static struct
+{
+    GMutex             lock;
+    GCond              cond;
+    gboolean           scheduled;
+    gint64             last_dispatch;
+    guint64            dispatches;
+    guint64            sequence;
+    msgbus_queue_ctx_t queues[MSGBUS_QUEUE_COUNT];
+} bus =
+{
+    .queues =
+    {
+        [MSGBUS_QUEUE_GPSD]  = { G_QUEUE_INIT,  64 },
+        [MSGBUS_QUEUE_SSH]   = { G_QUEUE_INIT, 256 },
+        [MSGBUS_QUEUE_WIGLE] = { G_QUEUE_INIT, 256 },
+        [MSGBUS_QUEUE_TASK]  = { G_QUEUE_INIT,  16 }
+    }
+};
+
+static const gchar *const msgbus_queue_names[MSGBUS_QUEUE_COUNT] =
+{
+    "gpsd",
+    "ssh",
+    "wigle",
+    "task"
+};
+
+static void msgbus_push(msgbus_queue_t, msgbus_entry_t*);
+static void msgbus_schedule(void);
+static gboolean msgbus_dispatch(gpointer);
+
+
+void
+msgbus_post(msgbus_queue_t  queue,
+            GSourceFunc     func,
+            gpointer        data)
+{
+    msgbus_entry_t *entry = g_new(msgbus_entry_t, 1);
+
+    entry->func = func;
+    entry->data = data;
+    entry->key = NULL;
+    entry->destroy = NULL;
+    msgbus_push(queue, entry);
+}
+
+void
+msgbus_post_latest(msgbus_queue_t  queue,
+                   GSourceFunc     func,
+                   gpointer        data,
+                   gconstpointer   key,
+                   GDestroyNotify  destroy)
+{
+    msgbus_entry_t *entry = g_new(msgbus_entry_t, 1);
+
+    entry->func = func;
+    entry->data = data;
+    entry->key = key;
+    entry->destroy = destroy;
+    msgbus_push(queue, entry);
+}
+
+void
+msgbus_get_stats(msgbus_queue_t  queue,
+                 msgbus_stats_t *stats)
+{
+    msgbus_queue_ctx_t *q = &bus.queues[queue];
+
+    g_mutex_lock(&bus.lock);
+    stats->depth = q->entries.length;
+    stats->depth_max = q->depth_max;
+    stats->capacity = q->capacity;
+    stats->posted = q->posted;
+    stats->dispatched = q->dispatched;
+    stats->coalesced = q->coalesced;
+    stats->overflows = q->overflows;
+    stats->latency_avg = (q->dispatched ? q->latency_sum / (gint64)q->dispatched : 0);
+    stats->latency_max = q->latency_max;
+    g_mutex_unlock(&bus.lock);
+}
+
+guint64
+msgbus_get_dispatches(void)
+{
+    guint64 dispatches;
+
+    g_mutex_lock(&bus.lock);
+    dispatches = bus.dispatches;
+    g_mutex_unlock(&bus.lock);
+    return dispatches;
+}
+
+const gchar*
+msgbus_queue_name(msgbus_queue_t queue)
+{
+    return msgbus_queue_names[queue];
+}
+
+static void
+msgbus_push(msgbus_queue_t  queue,
+            msgbus_entry_t *entry)
+{
+    msgbus_queue_ctx_t *q = &bus.queues[queue];
+    msgbus_entry_t *pending;
+    GList *it;
+    gint64 deadline;
+
+    g_mutex_lock(&bus.lock);
+
+    if(entry->key)
+    {
+        /* Only the latest message of this producer matters,
+         * drop the pending one and queue the new one at the end */
+        for(it = q->entries.tail; it; it = it->prev)
+        {
+            pending = (msgbus_entry_t*)it->data;
+            if(pending->key == entry->key &&
+               pending->func == entry->func)
+            {
+                g_queue_delete_link(&q->entries, it);
+                pending->destroy(pending->data);
+                g_free(pending);
+                q->coalesced++;
+                break;
+            }
+        }
+    }
+
+    if(q->entries.length >= q->capacity &&
+       !g_main_context_is_owner(g_main_context_default()))
+    {
+        /* Backpressure: hold the producer until the main loop catches up,
+         * but never drop a message nor wait forever */
+        deadline = g_get_monotonic_time() + MSGBUS_WAIT_MAX_USEC;
+        while(q->entries.length >= q->capacity)
+        {
+            if(!g_cond_wait_until(&bus.cond, &bus.lock, deadline))
+            {
+                q->overflows++;
+                break;
+            }
+        }
+    }
+
+    entry->timestamp = g_get_monotonic_time();
+    entry->sequence = bus.sequence++;
+    g_queue_push_tail(&q->entries, entry);
+    q->posted++;
+    if(q->entries.length > q->depth_max)
+        q->depth_max = q->entries.length;
+
+    msgbus_schedule();
+    g_mutex_unlock(&bus.lock);
+}
+
+static void
+msgbus_schedule(void)
+{
+    gint64 delay;
+
+    /* Called with the lock held */
+    if(bus.scheduled)
+        return;
+
+    bus.scheduled = TRUE;
+    delay = bus.last_dispatch + MSGBUS_FRAME_USEC - g_get_monotonic_time();
+    if(delay <= 0)
+        g_idle_add(msgbus_dispatch, NULL);
+    else
+        g_timeout_add((guint)(delay / 1000) + 1, msgbus_dispatch, NULL);
+}
+
+static gboolean
+msgbus_dispatch(gpointer user_data)
+{
+    GQueue pending[MSGBUS_QUEUE_COUNT];
+    guint64 count[MSGBUS_QUEUE_COUNT];
+    gint64 latency_sum[MSGBUS_QUEUE_COUNT];
+    gint64 latency_max[MSGBUS_QUEUE_COUNT];
+    msgbus_queue_ctx_t *q;
+    msgbus_entry_t *entry, *head;
+    gint64 latency;
+    gint i, next;
+
+    g_mutex_lock(&bus.lock);
+    bus.scheduled = FALSE;
+    bus.last_dispatch = g_get_monotonic_time();
+    bus.dispatches++;
+    for(i=0; i<MSGBUS_QUEUE_COUNT; i++)
+    {
+        pending[i] = bus.queues[i].entries;
+        g_queue_init(&bus.queues[i].entries);
+        count[i] = 0;
+        latency_sum[i] = 0;
+        latency_max[i] = 0;
+    }
+    g_cond_broadcast(&bus.cond);
+    g_mutex_unlock(&bus.lock);
+
+    /* Callbacks run without the lock, they may post new messages.
+     * Messages from all queues are merged back in the posting order,
+     * so a GPS fix is never applied ahead of older scan results. */
+    while(TRUE)
+    {
+        next = -1;
+        entry = NULL;
+        for(i=0; i<MSGBUS_QUEUE_COUNT; i++)
+        {
+            head = g_queue_peek_head(&pending[i]);
+            if(head && (!entry || head->sequence < entry->sequence))
+            {
+                entry = head;
+                next = i;
+            }
+        }
+
+        if(!entry)
+            break;
+
+        g_queue_pop_head(&pending[next]);
+        latency = g_get_monotonic_time() - entry->timestamp;
+        latency_sum[next] += latency;
+        if(latency > latency_max[next])
+            latency_max[next] = latency;
+        count[next]++;
+
+        entry->func(entry->data);
+        g_free(entry);
+    }
+
+    g_mutex_lock(&bus.lock);
+    for(i=0; i<MSGBUS_QUEUE_COUNT; i++)
+    {
+        if(!count[i])
+            continue;
+
+        q = &bus.queues[i];
+        q->dispatched += count[i];
+        q->latency_sum += latency_sum[i];
+        if(latency_max[i] > q->latency_max)
+            q->latency_max = latency_max[i];
+    }
+    g_mutex_unlock(&bus.lock);
+
+    return FALSE;
+}
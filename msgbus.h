@@ -0,0 +1,51 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_MSGBUS_H_
+#define MTSCAN_MSGBUS_H_
+#include <glib.h>
+
+/* Bounded queues from the worker threads to the main loop.
+ * All queues are drained by a single dispatcher, at most once per frame,
+ * in the order the messages were posted across all queues. */
+typedef enum msgbus_queue
+{
+    MSGBUS_QUEUE_GPSD = 0,
+    MSGBUS_QUEUE_SSH,
+    MSGBUS_QUEUE_WIGLE,
+    MSGBUS_QUEUE_TASK,
+    MSGBUS_QUEUE_COUNT
+} msgbus_queue_t;
+
+typedef struct msgbus_stats
+{
+    guint   depth;
+    guint   depth_max;
+    guint   capacity;
+    guint64 posted;
+    guint64 dispatched;
+    guint64 coalesced;
+    guint64 overflows;
+    gint64  latency_avg;
+    gint64  latency_max;
+} msgbus_stats_t;
+
+void         msgbus_post(msgbus_queue_t, GSourceFunc, gpointer);
+void         msgbus_post_latest(msgbus_queue_t, GSourceFunc, gpointer, gconstpointer, GDestroyNotify);
+void         msgbus_get_stats(msgbus_queue_t, msgbus_stats_t*);
+guint64      msgbus_get_dispatches(void);
+const gchar* msgbus_queue_name(msgbus_queue_t);
+
+#endif
@@ -0,0 +1,674 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include <string.h>
+#include <unistd.h>
+#include "mt-api.h"
+#ifdef G_OS_WIN32
+#include <winsock2.h>
+#include <windows.h>
+#include <ws2tcpip.h>
+#include <Mstcpip.h>
+#include "win32.h"
+#define MSG_NOSIGNAL 0
+typedef SOCKET mt_api_socket_t;
+#else
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <fcntl.h>
+typedef int mt_api_socket_t;
+#endif
+
+#define DEBUG 0
+
+#define MT_API_TCP_KEEPCNT    2
+#define MT_API_TCP_KEEPINTVL 10
+#define MT_API_TCP_KEEPIDLE  30
+
+#define MT_API_CONNECT_SLICE_MSEC 100
+
+#define MT_API_READ_BUFFER  4096
+#define MT_API_WORD_MAX     (1 << 20)
+
+typedef struct mt_api
+{
+    mt_api_socket_t  fd;
+    GByteArray      *buffer;
+} mt_api_t;
+
+typedef struct mt_api_reply
+{
+    mt_api_reply_type_t  type;
+    gchar               *tag;
+    GHashTable          *attributes;
+} mt_api_reply_t;
+
+static gboolean mt_api_set_blocking(mt_api_socket_t, gboolean);
+static gboolean mt_api_connect_wait(mt_api_t*, const struct addrinfo*, gint64, const volatile gboolean*);
+static gint mt_api_parse(mt_api_t*, mt_api_reply_t**);
+static gint mt_api_word_length(const guint8*, gsize, gsize*, guint32*);
+static void mt_api_word_append(GByteArray*, const gchar*);
+static mt_api_reply_t* mt_api_reply_new(GPtrArray*);
+static gboolean mt_api_login_wait(mt_api_t*, gint64, mt_api_reply_t**);
+static gchar* mt_api_login_response(const gchar*, const gchar*);
+static void mt_api_close(mt_api_t*);
+
+
+mt_api_t*
+mt_api_new(void)
+{
+    mt_api_t *context = g_malloc0(sizeof(mt_api_t));
+#ifdef G_OS_WIN32
+    context->fd = INVALID_SOCKET;
+#else
+    context->fd = -1;
+#endif
+    context->buffer = g_byte_array_new();
+    return context;
+}
+
+void
+mt_api_free(mt_api_t *context)
+{
+    if(context)
+    {
+        mt_api_close(context);
+        g_byte_array_free(context->buffer, TRUE);
+        g_free(context);
+    }
+}
+
+gboolean
+mt_api_connect(mt_api_t                *context,
+               const gchar             *hostname,
+               const gchar             *port,
+               gint                     timeout,
+               const volatile gboolean *canceled,
+               gchar                  **error)
+{
+    gint64 deadline = g_get_monotonic_time() + (gint64)timeout * G_USEC_PER_SEC;
+    struct addrinfo hints;
+    struct addrinfo *result;
+    struct addrinfo *rp;
+    gint ret;
+
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if((ret = getaddrinfo(hostname, port, &hints, &result)))
+    {
+        *error = g_strdup_printf("Failed to resolve hostname '%s'", hostname);
+        return FALSE;
+    }
+
+    for(rp = result; rp; rp = rp->ai_next)
+    {
+        if(*canceled)
+            break;
+
+        context->fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+#ifdef G_OS_WIN32
+        if(context->fd == INVALID_SOCKET)
+#else
+        if(context->fd < 0)
+#endif
+            continue;
+
+        /* Connect in the background, so that a dead host
+           can be canceled and does not hang the thread */
+        if(mt_api_set_blocking(context->fd, FALSE) &&
+           mt_api_connect_wait(context, rp, deadline, canceled) &&
+           mt_api_set_blocking(context->fd, TRUE))
+            break;
+
+        mt_api_close(context);
+    }
+    freeaddrinfo(result);
+
+    if(!rp)
+    {
+        if(!*canceled)
+            *error = g_strdup_printf("Unable to connect to %s:%s", hostname, port);
+        return FALSE;
+    }
+
+#ifdef G_OS_WIN32
+    struct tcp_keepalive ka =
+    {
+        .onoff = 1,
+        .keepaliveinterval = MT_API_TCP_KEEPINTVL * MT_API_TCP_KEEPCNT * 1000 / 10,
+        .keepalivetime = MT_API_TCP_KEEPIDLE * 1000
+    };
+    DWORD dummy;
+    WSAIoctl(context->fd, SIO_KEEPALIVE_VALS, &ka, sizeof(ka), NULL, 0, &dummy, NULL, NULL);
+#else
+    gint opt = 1;
+    if(setsockopt(context->fd, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt)) >= 0)
+    {
+        opt = MT_API_TCP_KEEPCNT;
+        setsockopt(context->fd, IPPROTO_TCP, TCP_KEEPCNT, &opt, sizeof(opt));
+
+        opt = MT_API_TCP_KEEPINTVL;
+        setsockopt(context->fd, IPPROTO_TCP, TCP_KEEPINTVL, &opt, sizeof(opt));
+
+        opt = MT_API_TCP_KEEPIDLE;
+        setsockopt(context->fd, IPPROTO_TCP, TCP_KEEPIDLE, &opt, sizeof(opt));
+    }
+#endif
+
+    return TRUE;
+}
+
+gboolean
+mt_api_login(mt_api_t     *context,
+             const gchar  *login,
+             const gchar  *password,
+             gint          timeout,
+             gchar       **error)
+{
+    gint64 deadline = g_get_monotonic_time() + (gint64)timeout * G_USEC_PER_SEC;
+    mt_api_reply_t *reply;
+    const gchar *challenge;
+    gchar *name;
+    gchar *value;
+    gchar *response;
+    gboolean ret;
+
+    /* RouterOS v6.43+ accepts the password in plain text */
+    name = g_strdup_printf("=name=%s", login);
+    value = g_strdup_printf("=password=%s", password);
+    ret = mt_api_send(context, (const gchar*[]){ "/login", name, value, NULL });
+    g_free(value);
+
+    if(!ret || !mt_api_login_wait(context, deadline, &reply))
+    {
+        g_free(name);
+        return FALSE;
+    }
+
+    if(reply->type == MT_API_REPLY_DONE &&
+       (challenge = mt_api_reply_get(reply, "ret")))
+    {
+        /* Older releases reply with a MD5 challenge instead */
+        response = mt_api_login_response(password, challenge);
+        value = g_strdup_printf("=response=00%s", response);
+        g_free(response);
+        mt_api_reply_free(reply);
+
+        ret = mt_api_send(context, (const gchar*[]){ "/login", name, value, NULL });
+        g_free(value);
+
+        if(!ret || !mt_api_login_wait(context, deadline, &reply))
+        {
+            g_free(name);
+            return FALSE;
+        }
+    }
+    g_free(name);
+
+    ret = (reply->type == MT_API_REPLY_DONE);
+    if(!ret && mt_api_reply_get(reply, "message"))
+        *error = g_strdup(mt_api_reply_get(reply, "message"));
+
+    mt_api_reply_free(reply);
+    return ret;
+}
+
+gboolean
+mt_api_send(mt_api_t           *context,
+            const gchar* const *words)
+{
+    GByteArray *sentence = g_byte_array_new();
+    gsize sent = 0;
+    gssize n;
+
+    for(; *words; words++)
+    {
+#if DEBUG
+        g_print("mt_api@%p: >>> %s\n", (gpointer)context, *words);
+#endif
+        mt_api_word_append(sentence, *words);
+    }
+    mt_api_word_append(sentence, "");
+
+    while(sent < sentence->len)
+    {
+        n = send(context->fd, (const gchar*)sentence->data + sent, sentence->len - sent, MSG_NOSIGNAL);
+        if(n < 0)
+        {
+            g_byte_array_free(sentence, TRUE);
+            return FALSE;
+        }
+        sent += n;
+    }
+
+    g_byte_array_free(sentence, TRUE);
+    return TRUE;
+}
+
+gint
+mt_api_read(mt_api_t        *context,
+            gint             timeout,
+            mt_api_reply_t **reply)
+{
+    guint8 buffer[MT_API_READ_BUFFER];
+    struct timeval tv;
+    fd_set input;
+    gssize len;
+    gint ret;
+
+    /* A complete sentence may be already buffered */
+    if((ret = mt_api_parse(context, reply)))
+        return ret;
+
+    FD_ZERO(&input);
+    FD_SET(context->fd, &input);
+    tv.tv_sec = timeout / 1000;
+    tv.tv_usec = (timeout % 1000) * 1000;
+
+    ret = select(context->fd+1, &input, NULL, NULL, &tv);
+    if(ret == 0)
+        return 0;
+    if(ret < 0)
+    {
+#ifndef G_OS_WIN32
+        if(errno == EINTR)
+            return 0;
+#endif
+        return -1;
+    }
+
+    len = recv(context->fd, (gchar*)buffer, sizeof(buffer), 0);
+    if(len <= 0)
+        return -1;
+
+    g_byte_array_append(context->buffer, buffer, (guint)len);
+    return mt_api_parse(context, reply);
+}
+
+mt_api_reply_type_t
+mt_api_reply_get_type(const mt_api_reply_t *reply)
+{
+    return reply->type;
+}
+
+const gchar*
+mt_api_reply_get_tag(const mt_api_reply_t *reply)
+{
+    return reply->tag;
+}
+
+const gchar*
+mt_api_reply_get(const mt_api_reply_t *reply,
+                 const gchar          *key)
+{
+    return g_hash_table_lookup(reply->attributes, key);
+}
+
+gboolean
+mt_api_reply_get_boolean(const mt_api_reply_t *reply,
+                         const gchar          *key)
+{
+    const gchar *value = mt_api_reply_get(reply, key);
+    return (value && (!strcmp(value, "true") || !strcmp(value, "yes")));
+}
+
+void
+mt_api_reply_free(mt_api_reply_t *reply)
+{
+    if(reply)
+    {
+        g_free(reply->tag);
+        g_hash_table_destroy(reply->attributes);
+        g_free(reply);
+    }
+}
+
+static gboolean
+mt_api_set_blocking(mt_api_socket_t fd,
+                    gboolean        blocking)
+{
+#ifdef G_OS_WIN32
+    u_long mode = !blocking;
+    return (ioctlsocket(fd, FIONBIO, &mode) == 0);
+#else
+    gint flags = fcntl(fd, F_GETFL, 0);
+    if(flags < 0)
+        return FALSE;
+    flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    return (fcntl(fd, F_SETFL, flags) == 0);
+#endif
+}
+
+static gboolean
+mt_api_connect_wait(mt_api_t                *context,
+                    const struct addrinfo   *addr,
+                    gint64                   deadline,
+                    const volatile gboolean *canceled)
+{
+    struct timeval tv;
+    fd_set output;
+    fd_set except;
+    gint64 left;
+    gint err = 0;
+    socklen_t len = sizeof(err);
+    gint ret;
+
+    if(connect(context->fd, addr->ai_addr, addr->ai_addrlen) == 0)
+        return TRUE;
+#ifdef G_OS_WIN32
+    if(WSAGetLastError() != WSAEWOULDBLOCK)
+        return FALSE;
+#else
+    if(errno != EINPROGRESS)
+        return FALSE;
+#endif
+
+    /* Wait in the same short steps as mt_api_read */
+    while(!*canceled)
+    {
+        left = deadline - g_get_monotonic_time();
+        if(left <= 0)
+            return FALSE;
+        left = MIN(left, MT_API_CONNECT_SLICE_MSEC * 1000);
+
+        FD_ZERO(&output);
+        FD_SET(context->fd, &output);
+        FD_ZERO(&except);
+        FD_SET(context->fd, &except);
+        tv.tv_sec = left / G_USEC_PER_SEC;
+        tv.tv_usec = left % G_USEC_PER_SEC;
+
+        ret = select(context->fd+1, NULL, &output, &except, &tv);
+        if(ret == 0)
+            continue;
+        if(ret < 0)
+        {
+#ifndef G_OS_WIN32
+            if(errno == EINTR)
+                continue;
+#endif
+            return FALSE;
+        }
+
+        if(getsockopt(context->fd, SOL_SOCKET, SO_ERROR, (gchar*)&err, &len) < 0)
+            return FALSE;
+        return (err == 0);
+    }
+    return FALSE;
+}
+
+static gint
+mt_api_parse(mt_api_t        *context,
+             mt_api_reply_t **reply)
+{
+    const guint8 *data = context->buffer->data;
+    gsize avail = context->buffer->len;
+    gsize offset = 0;
+    gsize header;
+    guint32 length;
+    GPtrArray *words;
+    gint ret;
+
+    words = g_ptr_array_new_with_free_func(g_free);
+    while(TRUE)
+    {
+        ret = mt_api_word_length(data + offset, avail - offset, &header, &length);
+        if(ret <= 0 || offset + header + length > avail)
+        {
+            /* Incomplete sentence or a protocol error */
+            g_ptr_array_free(words, TRUE);
+            return ret < 0 ? -1 : 0;
+        }
+        offset += header;
+
+        if(!length)
+            break;
+
+        g_ptr_array_add(words, g_strndup((const gchar*)data + offset, length));
+        offset += length;
+    }
+
+    g_byte_array_remove_range(context->buffer, 0, (guint)offset);
+
+    if(!words->len)
+    {
+        /* Empty sentences carry no reply */
+        g_ptr_array_free(words, TRUE);
+        return mt_api_parse(context, reply);
+    }
+
+    *reply = mt_api_reply_new(words);
+    g_ptr_array_free(words, TRUE);
+
+#if DEBUG
+    g_print("mt_api@%p: <<< reply type %d, tag %s\n", (gpointer)context, (*reply)->type, (*reply)->tag);
+#endif
+    return 1;
+}
+
+static gint
+mt_api_word_length(const guint8 *data,
+                   gsize         avail,
+                   gsize        *header,
+                   guint32      *length)
+{
+    gsize i;
+
+    if(!avail)
+        return 0;
+
+    if(!(data[0] & 0x80))
+        *header = 1;
+    else if((data[0] & 0xC0) == 0x80)
+        *header = 2;
+    else if((data[0] & 0xE0) == 0xC0)
+        *header = 3;
+    else if((data[0] & 0xF0) == 0xE0)
+        *header = 4;
+    else if(data[0] == 0xF0)
+        *header = 5;
+    else
+        return -1; /* Control byte, not used by RouterOS */
+
+    if(avail < *header)
+        return 0;
+
+    if(*header == 5)
+    {
+        *length = 0;
+        for(i=1; i<5; i++)
+            *length = (*length << 8) | data[i];
+    }
+    else
+    {
+        /* The length prefix bits are masked out of the first byte */
+        *length = data[0] & (0xFF >> *header);
+        for(i=1; i<*header; i++)
+            *length = (*length << 8) | data[i];
+    }
+
+    return (*length > MT_API_WORD_MAX) ? -1 : 1;
+}
+
+static void
+mt_api_word_append(GByteArray  *sentence,
+                   const gchar *word)
+{
+    guint32 length = (guint32)strlen(word);
+    guint8 header[5];
+    guint size;
+
+    if(length < 0x80)
+    {
+        header[0] = (guint8)length;
+        size = 1;
+    }
+    else if(length < 0x4000)
+    {
+        header[0] = (guint8)(length >> 8) | 0x80;
+        header[1] = (guint8)length;
+        size = 2;
+    }
+    else if(length < 0x200000)
+    {
+        header[0] = (guint8)(length >> 16) | 0xC0;
+        header[1] = (guint8)(length >> 8);
+        header[2] = (guint8)length;
+        size = 3;
+    }
+    else if(length < 0x10000000)
+    {
+        header[0] = (guint8)(length >> 24) | 0xE0;
+        header[1] = (guint8)(length >> 16);
+        header[2] = (guint8)(length >> 8);
+        header[3] = (guint8)length;
+        size = 4;
+    }
+    else
+    {
+        header[0] = 0xF0;
+        header[1] = (guint8)(length >> 24);
+        header[2] = (guint8)(length >> 16);
+        header[3] = (guint8)(length >> 8);
+        header[4] = (guint8)length;
+        size = 5;
+    }
+
+    g_byte_array_append(sentence, header, size);
+    g_byte_array_append(sentence, (const guint8*)word, length);
+}
+
+static mt_api_reply_t*
+mt_api_reply_new(GPtrArray *words)
+{
+    mt_api_reply_t *reply = g_malloc0(sizeof(mt_api_reply_t));
+    const gchar *word;
+    const gchar *value;
+    guint i;
+
+    word = g_ptr_array_index(words, 0);
+    if(!strcmp(word, "!re"))
+        reply->type = MT_API_REPLY_RE;
+    else if(!strcmp(word, "!done"))
+        reply->type = MT_API_REPLY_DONE;
+    else if(!strcmp(word, "!trap"))
+        reply->type = MT_API_REPLY_TRAP;
+    else if(!strcmp(word, "!fatal"))
+        reply->type = MT_API_REPLY_FATAL;
+    else
+        reply->type = MT_API_REPLY_UNKNOWN;
+
+    reply->attributes = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+    for(i=1; i<words->len; i++)
+    {
+        word = g_ptr_array_index(words, i);
+
+        if(!strncmp(word, ".tag=", 5))
+        {
+            g_free(reply->tag);
+            reply->tag = g_strdup(word + 5);
+        }
+        else if(word[0] == '=' && (value = strchr(word + 1, '=')))
+        {
+            g_hash_table_replace(reply->attributes,
+                                 g_strndup(word + 1, value - word - 1),
+                                 g_strdup(value + 1));
+        }
+        else if(reply->type == MT_API_REPLY_FATAL)
+        {
+            /* The reason follows as a bare word */
+            g_hash_table_replace(reply->attributes, g_strdup("message"), g_strdup(word));
+        }
+    }
+
+    return reply;
+}
+
+static gboolean
+mt_api_login_wait(mt_api_t        *context,
+                  gint64           deadline,
+                  mt_api_reply_t **reply)
+{
+    gint64 remaining;
+    gint ret;
+
+    while((remaining = deadline - g_get_monotonic_time()) > 0)
+    {
+        ret = mt_api_read(context, (gint)MIN(remaining / 1000 + 1, 1000), reply);
+        if(ret < 0)
+            return FALSE;
+        if(ret == 0)
+            continue;
+
+        if((*reply)->type == MT_API_REPLY_DONE ||
+           (*reply)->type == MT_API_REPLY_TRAP ||
+           (*reply)->type == MT_API_REPLY_FATAL)
+            return TRUE;
+
+        mt_api_reply_free(*reply);
+    }
+    return FALSE;
+}
+
+static gchar*
+mt_api_login_response(const gchar *password,
+                      const gchar *challenge)
+{
+    GChecksum *checksum = g_checksum_new(G_CHECKSUM_MD5);
+    guint8 zero = 0;
+    guint8 byte;
+    gchar *response;
+    gsize i;
+
+    g_checksum_update(checksum, &zero, 1);
+    g_checksum_update(checksum, (const guchar*)password, strlen(password));
+
+    for(i=0; challenge[i] && challenge[i+1]; i+=2)
+    {
+        if(!g_ascii_isxdigit(challenge[i]) || !g_ascii_isxdigit(challenge[i+1]))
+            break;
+        byte = (guint8)(g_ascii_xdigit_value(challenge[i]) << 4 | g_ascii_xdigit_value(challenge[i+1]));
+        g_checksum_update(checksum, &byte, 1);
+    }
+
+    response = g_strdup(g_checksum_get_string(checksum));
+    g_checksum_free(checksum);
+    return response;
+}
+
+static void
+mt_api_close(mt_api_t *context)
+{
+#ifdef G_OS_WIN32
+    if(context->fd == INVALID_SOCKET)
+        return;
+    shutdown(context->fd, SD_BOTH);
+    closesocket(context->fd);
+    context->fd = INVALID_SOCKET;
+#else
+    if(context->fd < 0)
+        return;
+    shutdown(context->fd, SHUT_RDWR);
+    close(context->fd);
+    context->fd = -1;
+#endif
+}
@@ -0,0 +1,45 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_MT_API_H_
+#define MTSCAN_MT_API_H_
+#include <glib.h>
+
+typedef struct mt_api       mt_api_t;
+typedef struct mt_api_reply mt_api_reply_t;
+
+typedef enum mt_api_reply_type
+{
+    MT_API_REPLY_UNKNOWN,
+    MT_API_REPLY_RE,
+    MT_API_REPLY_DONE,
+    MT_API_REPLY_TRAP,
+    MT_API_REPLY_FATAL
+} mt_api_reply_type_t;
+
+mt_api_t*           mt_api_new(void);
+void                mt_api_free(mt_api_t*);
+gboolean            mt_api_connect(mt_api_t*, const gchar*, const gchar*, gint, const volatile gboolean*, gchar**);
+gboolean            mt_api_login(mt_api_t*, const gchar*, const gchar*, gint, gchar**);
+gboolean            mt_api_send(mt_api_t*, const gchar* const*);
+gint                mt_api_read(mt_api_t*, gint, mt_api_reply_t**);
+
+mt_api_reply_type_t mt_api_reply_get_type(const mt_api_reply_t*);
+const gchar*        mt_api_reply_get_tag(const mt_api_reply_t*);
+const gchar*        mt_api_reply_get(const mt_api_reply_t*, const gchar*);
+gboolean            mt_api_reply_get_boolean(const mt_api_reply_t*, const gchar*);
+void                mt_api_reply_free(mt_api_reply_t*);
+
+#endif
@@ -19,8 +19,12 @@
 #include <ctype.h>
 #include <math.h>
 #include <errno.h>
+#include <stdarg.h>
 #include <libssh/libssh.h>
 #include "mt-ssh.h"
+#include "mt-api.h"
+#include "blacklist.h"
+#include "msgbus.h"
 #ifdef G_OS_WIN32
 #include "win32.h"
 #else
@@ -41,12 +45,21 @@
    due to included ROS version.
    --------------------------------------- */
 #define PTY_COLS               190
-#define PTY_ROWS               300
+#define PTY_ROWS              2000
 #define SOCKET_BUFFER  PTY_COLS*20
 #define READ_TIMEOUT_MSEC      100
 
+/* ---------------------------------------
+   The scan table is cut at the bottom of
+   the virtual terminal. Restart only when
+   it gets close to that, or when inactive
+   entries start to pile up.
+   --------------------------------------- */
+#define SCAN_ROWS_MAX       (PTY_ROWS-10)
+#define SCAN_INACTIVE_MAX      150
+
 #define DEBUG    0
-#define DUMP_PTY 0
+#define DUMP_PTY 0 /* raw PTY stream goes to mtscan-<host>.pty, see mtscan-replay */
 
 #define SSID_LEN        32
 #define RADIO_NAME_LEN  16
@@ -54,6 +67,10 @@
 
 #define MAC_ADDR_HEX_LEN 12
 
+#define API_CONNECT_TIMEOUT_SEC 30
+#define API_LOGIN_TIMEOUT_SEC   30
+#define API_HEARTBEAT_USEC      G_USEC_PER_SEC
+
 typedef struct mt_ssh_shdr
 {
     guint address;
@@ -114,10 +131,18 @@ typedef struct mt_ssh_snf
     gint real_memory_limit;
 } mt_ssh_snf_t;
 
+typedef struct mt_ssh_frame
+{
+    gint64     timestamp;
+    GPtrArray *networks;
+    GArray    *seen;
+} mt_ssh_frame_t;
+
 typedef struct mt_ssh
 {
     /* Configuration */
     mt_ssh_mode_t mode_default;
+    mt_ssh_protocol_t protocol;
     gchar        *hostname;
     gchar        *port;
     gchar        *login;
@@ -129,7 +154,7 @@ typedef struct mt_ssh
 
     /* Callback pointers */
     void (*cb)    (mt_ssh_t*, mt_ssh_ret_t, const gchar*);
-    void (*cb_msg)(const mt_ssh_t*, mt_ssh_msg_type_t, gconstpointer);
+    void (*cb_msg)(const mt_ssh_t*, mt_ssh_msg_type_t, gpointer);
 
     /* Command queue */
     GAsyncQueue *queue;
@@ -143,6 +168,11 @@ typedef struct mt_ssh
 
     /* Private data */
     ssh_channel    channel;
+    GMappedFile   *replay;
+    gsize          replay_offset;
+#if DUMP_PTY
+    FILE          *dump;
+#endif
     gboolean       verify_auth;
     gchar         *identity;
     gint64         hwaddr;
@@ -156,8 +186,18 @@ typedef struct mt_ssh
     GString       *scanlist;
     mt_ssh_shdr_t *scan_header;
     gint           scan_line;
+    gint           scan_inactive;
     gboolean       scan_too_long;
+    mt_ssh_frame_t *scan_frame;
+    GHashTable    *scan_cache;
     mt_ssh_snf_t  *sniffer;
+    blacklist_t   *blacklist;
+
+    /* RouterOS API */
+    mt_api_t      *api;
+    guint          api_tag;
+    guint          api_tag_last;
+    gint64         api_heartbeat;
 } mt_ssh_t;
 
 
@@ -206,10 +246,14 @@ static mt_ssh_cmd_t*  mt_ssh_cmd_new(mt_ssh_cmd_type_t, gchar*);
 static void           mt_ssh_cmd_free(mt_ssh_cmd_t*);
 static mt_ssh_msg_t*  mt_ssh_msg_new(const mt_ssh_t*, mt_ssh_msg_type_t, gpointer);
 static void           mt_ssh_msg_free(mt_ssh_msg_t*);
+static void           mt_ssh_post(mt_ssh_t*, mt_ssh_msg_type_t, gpointer);
 static mt_ssh_info_t* mt_ssh_info_new(mt_ssh_info_type_t, gchar*);
 static void           mt_ssh_info_free(mt_ssh_info_t*);
 static mt_ssh_net_t*  mt_ssh_net_new();
 static void           mt_ssh_net_free(mt_ssh_net_t*);
+static mt_ssh_frame_t* mt_ssh_frame_new();
+static void           mt_ssh_frame_free(mt_ssh_frame_t*);
+static void           mt_ssh_frame_flush(mt_ssh_t*);
 static mt_ssh_snf_t*  mt_ssh_snf_new();
 static void           mt_ssh_snf_free(mt_ssh_snf_t*);
 
@@ -217,9 +261,13 @@ gboolean mt_ssh_cb(gpointer user_data);
 gboolean mt_ssh_cb_msg(gpointer user_data);
 
 static gpointer mt_ssh_thread(gpointer);
+static gpointer mt_ssh_api_thread(gpointer);
+static gpointer mt_ssh_replay_thread(gpointer);
 static gboolean mt_ssh_verify(mt_ssh_t*, ssh_session);
 static void mt_ssh_conf_keepalive(ssh_session);
 
+static gint mt_ssh_read(mt_ssh_t*, gchar*, gsize);
+static void mt_ssh_write(mt_ssh_t*, const gchar*, uint32_t);
 static void mt_ssh(mt_ssh_t*);
 static void mt_ssh_request(mt_ssh_t*, const gchar*);
 static void mt_ssh_set_state(mt_ssh_t*, gint);
@@ -236,6 +284,15 @@ static void mt_ssh_stop(mt_ssh_t*, gboolean);
 static void mt_ssh_scanlist_get(mt_ssh_t*);
 static void mt_ssh_scanlist_set(mt_ssh_t*, const gchar*);
 
+static void mt_ssh_api(mt_ssh_t*);
+static guint mt_ssh_api_request(mt_ssh_t*, const gchar*, ...) G_GNUC_NULL_TERMINATED;
+static void mt_ssh_api_reply(mt_ssh_t*, const mt_api_reply_t*);
+static void mt_ssh_api_trap(mt_ssh_t*, const mt_api_reply_t*);
+static void mt_ssh_api_interface(mt_ssh_t*, const mt_api_reply_t*);
+static void mt_ssh_api_scanning(mt_ssh_t*, const mt_api_reply_t*);
+static void mt_ssh_api_sniffing(mt_ssh_t*, const mt_api_reply_t*);
+static void mt_ssh_api_heartbeat(mt_ssh_t*);
+
 static gint str_count_lines(const gchar*);
 static void str_remove_char(gchar*, gchar);
 
@@ -246,25 +303,28 @@ static gint           parse_scan_channel(const gchar*, guint, gchar**, gchar**);
 static gint           parse_scan_int(const gchar*, guint, guint);
 static gchar*         parse_scan_string(const gchar*, guint, gint);
 static gchar*         parse_scanlist(const gchar*);
+static gint           parse_api_channel(const gchar*, gchar**, gchar**);
 
 
 mt_ssh_t*
-mt_ssh_new(void         (*cb)(mt_ssh_t*, mt_ssh_ret_t, const gchar*),
-           void         (*cb_msg)(const mt_ssh_t*, mt_ssh_msg_type_t, gconstpointer),
-           mt_ssh_mode_t  mode_default,
-           const gchar   *hostname,
-           gint           port,
-           const gchar   *login,
-           const gchar   *password,
-           const gchar   *iface,
-           gint           duration,
-           gboolean       remote,
-           gboolean       background)
+mt_ssh_new(void             (*cb)(mt_ssh_t*, mt_ssh_ret_t, const gchar*),
+           void             (*cb_msg)(const mt_ssh_t*, mt_ssh_msg_type_t, gpointer),
+           mt_ssh_mode_t      mode_default,
+           mt_ssh_protocol_t  protocol,
+           const gchar       *hostname,
+           gint               port,
+           const gchar       *login,
+           const gchar       *password,
+           const gchar       *iface,
+           gint               duration,
+           gboolean           remote,
+           gboolean           background)
 {
     mt_ssh_t *context;
     context = g_malloc0(sizeof(mt_ssh_t));
 
     /* Configuration */
+    context->protocol = protocol;
     context->hostname = g_strdup(hostname);
     context->port = g_strdup_printf("%d", port);
     context->login = g_strdup(login);
@@ -281,6 +341,8 @@ mt_ssh_new(void         (*cb)(mt_ssh_t*, mt_ssh_ret_t, const gchar*),
 
     /* Command queue */
     context->queue = g_async_queue_new_full((GDestroyNotify)mt_ssh_cmd_free);
+    context->scan_frame = mt_ssh_frame_new();
+    context->scan_cache = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
 
     /* Thread cancelation flag */
     context->canceled = FALSE;
@@ -296,7 +358,12 @@ mt_ssh_new(void         (*cb)(mt_ssh_t*, mt_ssh_ret_t, const gchar*),
     context->dispatch_mode = mode_default;
     context->dispatch_interface_check = TRUE;
 
-    g_thread_unref(g_thread_new("mt_ssh_thread", mt_ssh_thread, context));
+    if(protocol == MT_SSH_PROTOCOL_API)
+        g_thread_unref(g_thread_new("mt_ssh_thread", mt_ssh_api_thread, context));
+    else if(protocol == MT_SSH_PROTOCOL_REPLAY)
+        g_thread_unref(g_thread_new("mt_ssh_thread", mt_ssh_replay_thread, context));
+    else
+        g_thread_unref(g_thread_new("mt_ssh_thread", mt_ssh_thread, context));
     return context;
 }
 
@@ -326,6 +393,10 @@ mt_ssh_free(mt_ssh_t *context)
         g_free(context->identity);
         g_free(context->scan_header);
         mt_ssh_snf_free(context->sniffer);
+        mt_ssh_frame_free(context->scan_frame);
+        g_hash_table_destroy(context->scan_cache);
+        if(context->blacklist)
+            blacklist_unref(context->blacklist);
 
         g_free(context);
     }
@@ -347,6 +418,12 @@ mt_ssh_cmd(mt_ssh_t          *context,
         g_async_queue_push(context->queue, mt_ssh_cmd_new(type, g_strdup(data)));
 }
 
+mt_ssh_protocol_t
+mt_ssh_get_protocol(const mt_ssh_t *context)
+{
+    return context->protocol;
+}
+
 const gchar*
 mt_ssh_get_hostname(const mt_ssh_t *context)
 {
@@ -440,7 +517,7 @@ mt_ssh_msg_free(mt_ssh_msg_t *msg)
             break;
 
         case MT_SSH_MSG_NET:
-            mt_ssh_net_free(msg->data);
+            mt_ssh_frame_free(msg->data);
             break;
 
         case MT_SSH_MSG_SNF:
@@ -450,6 +527,20 @@ mt_ssh_msg_free(mt_ssh_msg_t *msg)
     g_free(msg);
 }
 
+static void
+mt_ssh_post(mt_ssh_t          *context,
+            mt_ssh_msg_type_t  type,
+            gpointer           data)
+{
+    mt_ssh_msg_t *msg = mt_ssh_msg_new(context, type, data);
+
+    /* Sniffer statistics are cumulative, only the latest ones are worth showing */
+    if(type == MT_SSH_MSG_SNF)
+        msgbus_post_latest(MSGBUS_QUEUE_SSH, mt_ssh_cb_msg, msg, &context->sniffer, (GDestroyNotify)mt_ssh_msg_free);
+    else
+        msgbus_post(MSGBUS_QUEUE_SSH, mt_ssh_cb_msg, msg);
+}
+
 static mt_ssh_info_t*
 mt_ssh_info_new(mt_ssh_info_type_t  type,
                 gchar              *data)
@@ -499,6 +590,65 @@ mt_ssh_net_free(mt_ssh_net_t *net)
     g_free(net);
 }
 
+static mt_ssh_frame_t*
+mt_ssh_frame_new()
+{
+    mt_ssh_frame_t *frame = g_malloc(sizeof(mt_ssh_frame_t));
+    frame->timestamp = 0;
+    frame->networks = g_ptr_array_new_with_free_func((GDestroyNotify)mt_ssh_net_free);
+    frame->seen = g_array_new(FALSE, FALSE, sizeof(gint64));
+    return frame;
+}
+
+static void
+mt_ssh_frame_free(mt_ssh_frame_t *frame)
+{
+    g_ptr_array_free(frame->networks, TRUE);
+    g_array_free(frame->seen, TRUE);
+    g_free(frame);
+}
+
+static void
+mt_ssh_frame_flush(mt_ssh_t *context)
+{
+    /* Whole frame goes in a single message, the ownership is moved */
+    context->scan_frame->timestamp = g_get_real_time();
+    mt_ssh_post(context, MT_SSH_MSG_NET, context->scan_frame);
+    context->scan_frame = mt_ssh_frame_new();
+}
+
+gint64
+mt_ssh_frame_get_timestamp(const mt_ssh_frame_t *frame)
+{
+    return frame->timestamp;
+}
+
+guint
+mt_ssh_frame_get_count(const mt_ssh_frame_t *frame)
+{
+    return frame->networks->len;
+}
+
+mt_ssh_net_t*
+mt_ssh_frame_get_net(mt_ssh_frame_t *frame,
+                     guint           i)
+{
+    return g_ptr_array_index(frame->networks, i);
+}
+
+guint
+mt_ssh_frame_get_seen_count(const mt_ssh_frame_t *frame)
+{
+    return frame->seen->len;
+}
+
+gint64
+mt_ssh_frame_get_seen(const mt_ssh_frame_t *frame,
+                      guint                 i)
+{
+    return g_array_index(frame->seen, gint64, i);
+}
+
 gint64
 mt_ssh_net_get_timestamp(const mt_ssh_net_t *net)
 {
@@ -559,6 +709,46 @@ mt_ssh_net_get_routeros_ver(const mt_ssh_net_t *net)
     return net->routeros_ver;
 }
 
+gchar*
+mt_ssh_net_steal_channel(mt_ssh_net_t *net)
+{
+    gchar *ret = net->channel;
+    net->channel = NULL;
+    return ret;
+}
+
+gchar*
+mt_ssh_net_steal_mode(mt_ssh_net_t *net)
+{
+    gchar *ret = net->mode;
+    net->mode = NULL;
+    return ret;
+}
+
+gchar*
+mt_ssh_net_steal_ssid(mt_ssh_net_t *net)
+{
+    gchar *ret = net->ssid;
+    net->ssid = NULL;
+    return ret;
+}
+
+gchar*
+mt_ssh_net_steal_radioname(mt_ssh_net_t *net)
+{
+    gchar *ret = net->radioname;
+    net->radioname = NULL;
+    return ret;
+}
+
+gchar*
+mt_ssh_net_steal_routeros_ver(mt_ssh_net_t *net)
+{
+    gchar *ret = net->routeros_ver;
+    net->routeros_ver = NULL;
+    return ret;
+}
+
 gboolean
 mt_ssh_net_get_privacy(const mt_ssh_net_t *net)
 {
@@ -699,6 +889,9 @@ mt_ssh_thread(gpointer data)
     ssh_session session;
     ssh_channel channel;
     gchar *login;
+#if DUMP_PTY
+    gchar *str;
+#endif
     gint verbosity = (DEBUG ? SSH_LOG_PROTOCOL : SSH_LOG_WARNING);
     glong timeout = 30;
 
@@ -724,7 +917,7 @@ mt_ssh_thread(gpointer data)
     if(context->canceled)
         goto cleanup_free_ssh;
 
-    g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_CONNECTING, NULL)));
+    mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_CONNECTING, NULL));
 
     if(ssh_connect(session) != SSH_OK)
     {
@@ -747,7 +940,7 @@ mt_ssh_thread(gpointer data)
     if(context->canceled)
         goto cleanup_disconnect;
 
-    g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_AUTHENTICATING, NULL)));
+    mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_AUTHENTICATING, NULL));
 
     /* Disable console colors with extra SSH login parameter:
      * https://forum.mikrotik.com/viewtopic.php?t=21234#p101304 */
@@ -790,10 +983,19 @@ mt_ssh_thread(gpointer data)
     if(context->canceled)
         goto cleanup_full;
 
-    g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_CONNECTED, NULL)));
+    mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_CONNECTED, NULL));
 
     context->channel = channel;
+#if DUMP_PTY
+    str = g_strdup_printf("mtscan-%s.pty", context->hostname);
+    context->dump = fopen(str, "wb");
+    g_free(str);
+#endif
     mt_ssh(context);
+#if DUMP_PTY
+    if(context->dump)
+        fclose(context->dump);
+#endif
 
     if(!context->canceled)
         context->return_state = MT_SSH_CLOSED;
@@ -811,7 +1013,94 @@ cleanup_callback:
 #if DEBUG
     printf("mt-ssh thread stop %p\n", (void*)context);
 #endif
-    g_idle_add(mt_ssh_cb, context);
+    msgbus_post(MSGBUS_QUEUE_SSH, mt_ssh_cb, context);
+    return NULL;
+}
+
+static gpointer
+mt_ssh_replay_thread(gpointer data)
+{
+    mt_ssh_t *context = (mt_ssh_t*)data;
+    GError *err = NULL;
+
+    if(!(context->replay = g_mapped_file_new(context->hostname, FALSE, &err)))
+    {
+        context->return_state = MT_SSH_ERR_CONNECT;
+        context->return_error = g_strdup(err->message);
+        g_error_free(err);
+        msgbus_post(MSGBUS_QUEUE_SSH, mt_ssh_cb, context);
+        return NULL;
+    }
+
+    mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_CONNECTED, NULL));
+
+    context->replay_offset = 0;
+    mt_ssh(context);
+
+    /* Deliver networks of the last incomplete frame */
+    if(context->scan_frame->networks->len || context->scan_frame->seen->len)
+        mt_ssh_frame_flush(context);
+
+    g_mapped_file_unref(context->replay);
+    context->replay = NULL;
+
+    if(!context->canceled)
+        context->return_state = MT_SSH_CLOSED;
+
+    msgbus_post(MSGBUS_QUEUE_SSH, mt_ssh_cb, context);
+    return NULL;
+}
+
+static gpointer
+mt_ssh_api_thread(gpointer data)
+{
+    mt_ssh_t *context = (mt_ssh_t*)data;
+    mt_api_t *api = mt_api_new();
+
+#if DEBUG
+    printf("mt-ssh api thread start: %p\n", (void*)context);
+#endif
+
+    if(context->canceled)
+        goto cleanup;
+
+    mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_CONNECTING, NULL));
+
+    if(!mt_api_connect(api, context->hostname, context->port, API_CONNECT_TIMEOUT_SEC, &context->canceled, &context->return_error))
+    {
+        context->return_state = MT_SSH_ERR_CONNECT;
+        goto cleanup;
+    }
+
+    if(context->canceled)
+        goto cleanup;
+
+    mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_AUTHENTICATING, NULL));
+
+    if(!mt_api_login(api, context->login, context->password, API_LOGIN_TIMEOUT_SEC, &context->return_error))
+    {
+        context->return_state = MT_SSH_ERR_AUTH;
+        goto cleanup;
+    }
+
+    if(context->canceled)
+        goto cleanup;
+
+    mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_CONNECTED, NULL));
+
+    context->api = api;
+    mt_ssh_api(context);
+    context->api = NULL;
+
+    if(!context->canceled)
+        context->return_state = MT_SSH_CLOSED;
+
+cleanup:
+    mt_api_free(api);
+#if DEBUG
+    printf("mt-ssh api thread stop %p\n", (void*)context);
+#endif
+    msgbus_post(MSGBUS_QUEUE_SSH, mt_ssh_cb, context);
     return NULL;
 }
 
@@ -870,7 +1159,7 @@ mt_ssh_verify(mt_ssh_t    *context,
                                   "Are you sure you want to continue connecting?",
                                   context->hostname, hexa);
 
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_AUTH_VERIFY, message)));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_AUTH_VERIFY, message));
         ssh_string_free_char(hexa);
 
         while(!context->verify_auth)
@@ -935,6 +1224,66 @@ mt_ssh_conf_keepalive(ssh_session session)
 }
 
 
+static gint
+mt_ssh_read(mt_ssh_t *context,
+            gchar    *buffer,
+            gsize     size)
+{
+    struct timeval timeout;
+    ssh_channel in_channels[2];
+    gint n;
+
+    if(context->replay)
+    {
+        /* Recorded transcript is consumed at full speed */
+        n = (gint)MIN(size, g_mapped_file_get_length(context->replay) - context->replay_offset);
+        if(n == 0)
+            return -1;
+        memcpy(buffer, g_mapped_file_get_contents(context->replay) + context->replay_offset, n);
+        context->replay_offset += n;
+        return n;
+    }
+
+    if(!ssh_channel_is_open(context->channel) ||
+       ssh_channel_is_eof(context->channel))
+        return -1;
+
+    timeout.tv_sec = 0;
+    timeout.tv_usec = READ_TIMEOUT_MSEC * 1000;
+    in_channels[0] = context->channel;
+    in_channels[1] = NULL;
+    if(ssh_channel_select(in_channels, NULL, NULL, &timeout) == SSH_EINTR)
+        return 0;
+    if(ssh_channel_is_eof(context->channel))
+        return -1;
+    if(in_channels[0] == NULL)
+        return 0;
+
+    n = ssh_channel_poll(context->channel, 0);
+    if(n <= 0)
+        return n;
+
+    n = ssh_channel_read(context->channel, buffer, size, 0);
+#if DUMP_PTY
+    if(n > 0 && context->dump)
+    {
+        fwrite(buffer, 1, n, context->dump);
+        fflush(context->dump);
+    }
+#endif
+    return n;
+}
+
+static void
+mt_ssh_write(mt_ssh_t    *context,
+             const gchar *data,
+             uint32_t     len)
+{
+    /* Nothing to talk to during a replay */
+    if(context->channel)
+        ssh_channel_write(context->channel, data, len);
+}
+
 static void
 mt_ssh(mt_ssh_t *context)
 {
@@ -942,11 +1291,8 @@ mt_ssh(mt_ssh_t *context)
     gchar *line, *ptr;
     gint n, i, lines;
     size_t length, offset = 0;
-    struct timeval timeout;
-    ssh_channel in_channels[2];
 
-    while(ssh_channel_is_open(context->channel) &&
-          !ssh_channel_is_eof(context->channel))
+    while(TRUE)
     {
         /* Handle commands from the queue */
         mt_ssh_commands(context, 0);
@@ -955,24 +1301,7 @@ mt_ssh(mt_ssh_t *context)
         if(context->canceled)
             return;
 
-        timeout.tv_sec = 0;
-        timeout.tv_usec = READ_TIMEOUT_MSEC * 1000;
-        in_channels[0] = context->channel;
-        in_channels[1] = NULL;
-        if(ssh_channel_select(in_channels, NULL, NULL, &timeout) == SSH_EINTR)
-            continue;
-        if(ssh_channel_is_eof(context->channel))
-            return;
-        if(in_channels[0] == NULL)
-            continue;
-
-        n = ssh_channel_poll(context->channel, 0);
-        if(n < 0)
-            return;
-        if(n == 0)
-            continue;
-
-        n = ssh_channel_read(context->channel, buffer+offset, sizeof(buffer)-1-offset, 0);
+        n = mt_ssh_read(context, buffer+offset, sizeof(buffer)-1-offset);
         if(n < 0)
             return;
         if(n == 0)
@@ -980,10 +1309,6 @@ mt_ssh(mt_ssh_t *context)
 
         n += offset;
         buffer[n] = 0;
-#if DUMP_PTY
-        fprintf(stderr, "%s", buffer+offset);
-        fflush(stderr);
-#endif
         str_remove_char(buffer+offset, '\n');
         lines = str_count_lines(buffer);
 
@@ -1006,7 +1331,7 @@ mt_ssh(mt_ssh_t *context)
 #endif
                 g_free(context->str_prompt);
                 context->str_prompt = g_strdup_printf("%s%s@%s%s", str_prompt_start, context->login, context->identity, str_prompt_end);
-                g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_IDENTITY, g_strdup(context->identity))));
+                mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_IDENTITY, g_strdup(context->identity)));
             }
 
             if(context->identity &&
@@ -1022,7 +1347,7 @@ mt_ssh(mt_ssh_t *context)
                 else
                 {
                     mt_ssh_set_state(context, MT_SSH_STATE_WAITING_FOR_PROMPT);
-                    ssh_channel_write(context->channel, "\03", 1); /* CTRL+C */
+                    mt_ssh_write(context, "\03", 1); /* CTRL+C */
                 }
                 offset = 0;
 #if DEBUG
@@ -1090,7 +1415,7 @@ mt_ssh_request(mt_ssh_t    *context,
                const gchar *req)
 {
     uint32_t len = (uint32_t)strlen(req);
-    ssh_channel_write(context->channel, req, len);
+    mt_ssh_write(context, req, len);
     context->sent_command = TRUE;
 }
 
@@ -1121,32 +1446,39 @@ mt_ssh_set_state(mt_ssh_t *context,
     {
         buffered = g_string_free(context->scanlist, FALSE);
         context->scanlist = NULL;
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SCANLIST, parse_scanlist(buffered))));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SCANLIST, parse_scanlist(buffered)));
         g_free(buffered);
     }
 
     if(state == MT_SSH_STATE_SCANNING)
     {
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SCANNER_START, NULL)));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SCANNER_START, NULL));
+    }
+
+    if(context->state == MT_SSH_STATE_SCANNING &&
+       (context->scan_frame->networks->len || context->scan_frame->seen->len))
+    {
+        /* Deliver networks of an interrupted scan frame */
+        mt_ssh_frame_flush(context);
     }
 
     if(context->state == MT_SSH_STATE_SCANNING &&
        !context->remote_mode)
     {
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SCANNER_STOP, NULL)));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SCANNER_STOP, NULL));
     }
 
     if(state == MT_SSH_STATE_SNIFFING)
     {
         context->sniffer = mt_ssh_snf_new();
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SNIFFER_START, NULL)));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SNIFFER_START, NULL));
     }
 
     if(context->state == MT_SSH_STATE_SNIFFING)
     {
         g_free(context->sniffer);
         context->sniffer = NULL;
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SNIFFER_STOP, NULL)));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_SNIFFER_STOP, NULL));
     }
 
     context->state = state;
@@ -1161,7 +1493,7 @@ mt_ssh_interface(mt_ssh_t *context,
     if((context->hwaddr = parse_scan_address(line, 0)) >= 0)
     {
         data = g_strdup_printf("%012" G_GINT64_MODIFIER "X", context->hwaddr);
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_INTERFACE, data)));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_INTERFACE, data));
         mt_ssh_set_state(context, MT_SSH_STATE_WAITING_FOR_PROMPT);
     }
 }
@@ -1176,11 +1508,14 @@ mt_ssh_scanning(mt_ssh_t *context,
     static const gchar str_scanlistempty[]  = "scanlist empty";
     static const gchar str_scannotrunning[] = "scan not running";
     static const gchar str_scanstart[]      = "Flags: ";
+    static const gchar str_scancolumns[]    = "Columns: ";
     static const gchar str_scanend[]        = "-- ";
 
     mt_ssh_net_t *net;
     guchar flags;
     gint64 address;
+    gpointer cached;
+    guint hash;
     gchar *ptr;
 
     if(context->state == MT_SSH_STATE_WAITING_FOR_SCAN &&
@@ -1190,7 +1525,7 @@ mt_ssh_scanning(mt_ssh_t *context,
     {
         /* Handle possible failures */
         mt_ssh_set_state(context, MT_SSH_STATE_WAITING_FOR_PROMPT_DIRTY);
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_FAILURE, g_strdup(line))));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_FAILURE, g_strdup(line)));
         return;
     }
 
@@ -1201,7 +1536,7 @@ mt_ssh_scanning(mt_ssh_t *context,
         mt_ssh_set_state(context, MT_SSH_STATE_WAITING_FOR_PROMPT_DIRTY);
         ptr = g_strdup("Scan-list is empty, reverting to default.\n" \
                        "You may need to reboot your device before starting the scan again (bug in RouterOS).");
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_FAILURE, ptr)));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_FAILURE, ptr));
         return;
     }
 
@@ -1218,7 +1553,8 @@ mt_ssh_scanning(mt_ssh_t *context,
        !strncmp(line, str_scanend, strlen(str_scanend)))
     {
         /* This is the last line of scan results */
-        if(context->scan_line > PTY_ROWS/2)
+        if(context->scan_line >= SCAN_ROWS_MAX ||
+           context->scan_inactive > SCAN_INACTIVE_MAX)
         {
             context->scan_too_long = TRUE;
 #if DEBUG
@@ -1226,7 +1562,7 @@ mt_ssh_scanning(mt_ssh_t *context,
 #endif
         }
         context->scan_line = -1;
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_HEARTBEAT, NULL)));
+        mt_ssh_frame_flush(context);
 #if DEBUG
         printf("<!> Found END of a scan frame\n");
 #endif
@@ -1239,6 +1575,9 @@ mt_ssh_scanning(mt_ssh_t *context,
         {
             /* This is the first line of scan results */
             context->scan_line = 0;
+            context->scan_inactive = 0;
+            g_ptr_array_set_size(context->scan_frame->networks, 0);
+            g_array_set_size(context->scan_frame->seen, 0);
             mt_ssh_set_state(context, MT_SSH_STATE_SCANNING);
 #if DEBUG
             printf("<!> Found START of a scan frame\n");
@@ -1247,6 +1586,13 @@ mt_ssh_scanning(mt_ssh_t *context,
         return;
     }
 
+    if(context->scan_line == 0 &&
+       !strncmp(line, str_scancolumns, strlen(str_scancolumns)))
+    {
+        /* RouterOS v7 lists the column names before the header */
+        return;
+    }
+
     if(++context->scan_line == 1)
     {
         /* Second line of scan results should contain a header */
@@ -1280,6 +1626,7 @@ mt_ssh_scanning(mt_ssh_t *context,
     if(!(flags & MT_SSH_NET_FLAG_ACTIVE))
     {
         /* This network is not active at the moment, ignore it */
+        context->scan_inactive++;
         return;
     }
 
@@ -1292,8 +1639,23 @@ mt_ssh_scanning(mt_ssh_t *context,
         return;
     }
 
+    /* Skip blacklisted networks right away */
+    context->blacklist = blacklist_refresh(context->blacklist);
+    if(blacklist_match(context->blacklist, address))
+        return;
+
+    /* RouterOS redraws the whole table, skip parsing of unchanged lines */
+    hash = g_str_hash(line);
+    if(g_hash_table_lookup_extended(context->scan_cache, &address, NULL, &cached) &&
+       GPOINTER_TO_UINT(cached) == hash)
+    {
+        g_array_append_val(context->scan_frame->seen, address);
+        return;
+    }
+    g_hash_table_insert(context->scan_cache, g_memdup(&address, sizeof(gint64)), GUINT_TO_POINTER(hash));
+
     net = mt_ssh_net_new();
-    net->timestamp = g_get_real_time() / 1000000;
+    net->timestamp = g_get_real_time();
     net->address = address;
     net->flags = flags;
 
@@ -1318,7 +1680,7 @@ mt_ssh_scanning(mt_ssh_t *context,
     if(context->scan_header->ros_version)
         net->routeros_ver = parse_scan_string(line, context->scan_header->ros_version, ROS_VERSION_LEN);
 
-    g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_NET, net));
+    g_ptr_array_add(context->scan_frame->networks, net);
 }
 
 static void
@@ -1348,7 +1710,7 @@ mt_ssh_sniffing(mt_ssh_t *context,
     {
         /* Handle possible failures */
         mt_ssh_set_state(context, MT_SSH_STATE_WAITING_FOR_PROMPT_DIRTY);
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_FAILURE, g_strdup(line))));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_FAILURE, g_strdup(line)));
         return;
     }
 
@@ -1363,9 +1725,9 @@ mt_ssh_sniffing(mt_ssh_t *context,
 
     if(!strncmp(line, str_sniffend, strlen(str_sniffend)))
     {
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_SNF, context->sniffer));
+        mt_ssh_post(context, MT_SSH_MSG_SNF, context->sniffer);
         context->sniffer = mt_ssh_snf_new();
-        g_idle_add(mt_ssh_cb_msg, mt_ssh_msg_new(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_HEARTBEAT, NULL)));
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_HEARTBEAT, NULL));
 #if DEBUG
         printf("<!> Found END of a sniffer frame\n");
 #endif
@@ -1427,6 +1789,11 @@ mt_ssh_commands(mt_ssh_t *context,
             case MT_SSH_CMD_SNIFF:
                 context->dispatch_mode = MT_SSH_MODE_SNIFFER;
                 break;
+
+            case MT_SSH_CMD_REFRESH:
+                /* Receiver has lost some networks, parse everything again */
+                g_hash_table_remove_all(context->scan_cache);
+                break;
         }
         mt_ssh_cmd_free(cmd);
     }
@@ -1471,9 +1838,19 @@ mt_ssh_interface_check(mt_ssh_t *context)
 {
     gchar *str;
 
-    str = g_strdup_printf(" :put [/interface wireless get \"%s\" mac-address ]\r", context->iface);
-    mt_ssh_request(context, str);
-    g_free(str);
+    if(context->api)
+    {
+        str = g_strdup_printf("?name=%s", context->iface);
+        context->hwaddr = -1;
+        context->api_tag = mt_ssh_api_request(context, "/interface/wireless/print", str, "=.proplist=mac-address", NULL);
+        g_free(str);
+    }
+    else
+    {
+        str = g_strdup_printf(" :put [/interface wireless get \"%s\" mac-address ]\r", context->iface);
+        mt_ssh_request(context, str);
+        g_free(str);
+    }
 
     mt_ssh_set_state(context, MT_SSH_STATE_INTERFACE);
 }
@@ -1482,6 +1859,24 @@ static void
 mt_ssh_scan(mt_ssh_t *context)
 {
     gchar *str_scan;
+    gchar *str_duration;
+
+    if(context->api)
+    {
+        /* The duration is optional, so it goes last */
+        str_scan = g_strdup_printf("=number=%s", context->iface);
+        str_duration = (context->duration ? g_strdup_printf("=duration=%d", context->duration) : NULL);
+        if(context->background)
+            context->api_tag = mt_ssh_api_request(context, "/interface/wireless/scan", str_scan, "=background=yes", str_duration, NULL);
+        else
+            context->api_tag = mt_ssh_api_request(context, "/interface/wireless/scan", str_scan, str_duration, NULL);
+        g_free(str_scan);
+        g_free(str_duration);
+
+        context->scan_line = -1;
+        mt_ssh_set_state(context, MT_SSH_STATE_WAITING_FOR_SCAN);
+        return;
+    }
 
     if(context->background && context->duration)
         str_scan = g_strdup_printf(":delay 250ms; /interface wireless scan \"%s\" background=yes duration=%d\r", context->iface, context->duration);
@@ -1503,8 +1898,17 @@ static void
 mt_ssh_sniff(mt_ssh_t *context)
 {
     gchar *str_sniff;
-    str_sniff = g_strdup_printf("/interface wireless sniffer sniff \"%s\"\r", context->iface);
-    mt_ssh_request(context, str_sniff);
+
+    if(context->api)
+    {
+        str_sniff = g_strdup_printf("=interface=%s", context->iface);
+        context->api_tag = mt_ssh_api_request(context, "/interface/wireless/sniffer/sniff", str_sniff, NULL);
+    }
+    else
+    {
+        str_sniff = g_strdup_printf("/interface wireless sniffer sniff \"%s\"\r", context->iface);
+        mt_ssh_request(context, str_sniff);
+    }
     g_free(str_sniff);
 
     mt_ssh_set_state(context, MT_SSH_STATE_SNIFFING);
@@ -1514,13 +1918,25 @@ static void
 mt_ssh_stop(mt_ssh_t *context,
             gboolean  restart)
 {
+    gchar *str_cancel;
+
     if(context->state != MT_SSH_STATE_WAITING_FOR_SCAN &&
        context->state != MT_SSH_STATE_SCANNING &&
        context->state != MT_SSH_STATE_SNIFFING)
         return;
 
-    /* Do not use mt_ssh_request, as the 'Q' is not echoed back */
-    ssh_channel_write(context->channel, "Q", 1);
+    if(context->api)
+    {
+        /* The canceled command still completes with its own tag */
+        str_cancel = g_strdup_printf("=tag=%u", context->api_tag);
+        mt_ssh_api_request(context, "/cancel", str_cancel, NULL);
+        g_free(str_cancel);
+    }
+    else
+    {
+        /* Do not use mt_ssh_request, as the 'Q' is not echoed back */
+        mt_ssh_write(context, "Q", 1);
+    }
 
     if(restart)
     {
@@ -1538,10 +1954,20 @@ mt_ssh_scanlist_get(mt_ssh_t *context)
 {
     gchar *str_scanlist_get;
 
-    str_scanlist_get = g_strdup_printf("/interface wireless info scan-list \"%s\"\r", context->iface);
-    mt_ssh_request(context, str_scanlist_get);
+    if(context->api)
+    {
+        /* Buffer the channels in the same format as in the terminal */
+        str_scanlist_get = g_strdup_printf("=numbers=%s", context->iface);
+        context->api_tag = mt_ssh_api_request(context, "/interface/wireless/info/scan-list", str_scanlist_get, NULL);
+        context->scanlist = g_string_new("channels: ");
+    }
+    else
+    {
+        str_scanlist_get = g_strdup_printf("/interface wireless info scan-list \"%s\"\r", context->iface);
+        mt_ssh_request(context, str_scanlist_get);
+        context->scanlist = g_string_new(NULL);
+    }
     g_free(str_scanlist_get);
-    context->scanlist = g_string_new(NULL);
     mt_ssh_set_state(context, MT_SSH_STATE_SCANLIST);
 }
 
@@ -1550,13 +1976,309 @@ mt_ssh_scanlist_set(mt_ssh_t    *context,
                     const gchar *scanlist)
 {
     gchar *str_scanlist_set;
+    gchar *str_iface;
 
-    str_scanlist_set = g_strdup_printf("/interface wireless set \"%s\" scan-list=\"%s\"\r", context->iface, scanlist);
-    mt_ssh_request(context, str_scanlist_set);
+    if(context->api)
+    {
+        str_iface = g_strdup_printf("=numbers=%s", context->iface);
+        str_scanlist_set = g_strdup_printf("=scan-list=%s", scanlist);
+        context->api_tag = mt_ssh_api_request(context, "/interface/wireless/set", str_iface, str_scanlist_set, NULL);
+        g_free(str_iface);
+    }
+    else
+    {
+        str_scanlist_set = g_strdup_printf("/interface wireless set \"%s\" scan-list=\"%s\"\r", context->iface, scanlist);
+        mt_ssh_request(context, str_scanlist_set);
+    }
     g_free(str_scanlist_set);
     mt_ssh_set_state(context, MT_SSH_STATE_WAITING_FOR_PROMPT);
 }
 
+static void
+mt_ssh_api(mt_ssh_t *context)
+{
+    mt_api_reply_t *reply;
+    gboolean fatal;
+    gint ret;
+
+    /* There is no prompt to take the identity from */
+    context->api_tag = mt_ssh_api_request(context, "/system/identity/print", NULL);
+
+    while(TRUE)
+    {
+        /* Handle commands from the queue */
+        mt_ssh_commands(context, 0);
+        mt_ssh_dispatch(context);
+
+        if(context->canceled)
+            return;
+
+        ret = mt_api_read(context->api, READ_TIMEOUT_MSEC, &reply);
+        if(ret < 0)
+            return;
+        if(ret == 0)
+            continue;
+
+        mt_ssh_api_reply(context, reply);
+        fatal = (mt_api_reply_get_type(reply) == MT_API_REPLY_FATAL);
+        mt_api_reply_free(reply);
+
+        if(fatal)
+            return;
+    }
+}
+
+static guint
+mt_ssh_api_request(mt_ssh_t    *context,
+                   const gchar *command,
+                   ...)
+{
+    GPtrArray *words = g_ptr_array_new_with_free_func(g_free);
+    const gchar *word;
+    va_list args;
+    guint tag = ++context->api_tag_last;
+
+    g_ptr_array_add(words, g_strdup(command));
+
+    va_start(args, command);
+    while((word = va_arg(args, const gchar*)))
+        g_ptr_array_add(words, g_strdup(word));
+    va_end(args);
+
+    g_ptr_array_add(words, g_strdup_printf(".tag=%u", tag));
+    g_ptr_array_add(words, NULL);
+
+    mt_api_send(context->api, (const gchar* const*)words->pdata);
+    g_ptr_array_free(words, TRUE);
+    return tag;
+}
+
+static void
+mt_ssh_api_reply(mt_ssh_t             *context,
+                 const mt_api_reply_t *reply)
+{
+    const gchar *tag = mt_api_reply_get_tag(reply);
+    const gchar *value;
+
+#if DEBUG
+    if(mt_api_reply_get_type(reply) == MT_API_REPLY_FATAL)
+        printf("<!> Fatal: %s\n", mt_api_reply_get(reply, "message"));
+#endif
+
+    /* Skip replies of /cancel and of the previous commands */
+    if(!tag || strtoul(tag, NULL, 10) != context->api_tag)
+        return;
+
+    switch(mt_api_reply_get_type(reply))
+    {
+        case MT_API_REPLY_RE:
+            if(context->state == MT_SSH_STATE_WAITING_FOR_PROMPT &&
+               !context->identity &&
+               (value = mt_api_reply_get(reply, "name")))
+            {
+                context->identity = g_strdup(value);
+                mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_IDENTITY, g_strdup(context->identity)));
+            }
+            else if(context->state == MT_SSH_STATE_INTERFACE)
+            {
+                mt_ssh_api_interface(context, reply);
+            }
+            else if(context->state == MT_SSH_STATE_SCANLIST)
+            {
+                if((value = mt_api_reply_get(reply, "channels")) ||
+                   (value = mt_api_reply_get(reply, "channel")))
+                    g_string_append_printf(context->scanlist, "%s,", value);
+            }
+            else if(context->state == MT_SSH_STATE_WAITING_FOR_SCAN ||
+                    context->state == MT_SSH_STATE_SCANNING)
+            {
+                mt_ssh_api_scanning(context, reply);
+            }
+            else if(context->state == MT_SSH_STATE_SNIFFING)
+            {
+                mt_ssh_api_sniffing(context, reply);
+            }
+            break;
+
+        case MT_API_REPLY_TRAP:
+            mt_ssh_api_trap(context, reply);
+            break;
+
+        case MT_API_REPLY_DONE:
+            /* The command is finished, ready for the next one */
+            mt_ssh_set_state(context, MT_SSH_STATE_PROMPT);
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void
+mt_ssh_api_trap(mt_ssh_t             *context,
+                const mt_api_reply_t *reply)
+{
+    static const gchar str_scanlistempty[] = "scanlist empty";
+    static const gchar str_notrunning[]    = "not running";
+    const gchar *message = mt_api_reply_get(reply, "message");
+    gchar *ptr;
+
+    if(!message)
+        message = "unknown failure";
+
+    if(context->state == MT_SSH_STATE_WAITING_FOR_SCAN ||
+       context->state == MT_SSH_STATE_SCANNING ||
+       context->state == MT_SSH_STATE_SNIFFING)
+    {
+        if(strstr(message, str_notrunning))
+        {
+            /* Scanning stops when the connection is interrupted for a while */
+            if(context->dispatch_mode == MT_SSH_MODE_NONE)
+                context->dispatch_mode = (context->state == MT_SSH_STATE_SNIFFING ? MT_SSH_MODE_SNIFFER : MT_SSH_MODE_SCANNER);
+        }
+        else if(strstr(message, str_scanlistempty))
+        {
+            g_free(context->dispatch_scanlist_set);
+            context->dispatch_scanlist_set = g_strdup("default");
+            ptr = g_strdup("Scan-list is empty, reverting to default.\n" \
+                           "You may need to reboot your device before starting the scan again (bug in RouterOS).");
+            mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_FAILURE, ptr));
+        }
+        else
+        {
+            mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_FAILURE, g_strdup(message)));
+        }
+        mt_ssh_set_state(context, MT_SSH_STATE_WAITING_FOR_PROMPT_DIRTY);
+    }
+    else if(context->state == MT_SSH_STATE_WAITING_FOR_PROMPT)
+    {
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_FAILURE, g_strdup(message)));
+    }
+}
+
+static void
+mt_ssh_api_interface(mt_ssh_t             *context,
+                     const mt_api_reply_t *reply)
+{
+    const gchar *value = mt_api_reply_get(reply, "mac-address");
+    gchar *data;
+
+    if(value && (context->hwaddr = parse_scan_address(value, 0)) >= 0)
+    {
+        data = g_strdup_printf("%012" G_GINT64_MODIFIER "X", context->hwaddr);
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_INTERFACE, data));
+    }
+}
+
+static void
+mt_ssh_api_scanning(mt_ssh_t             *context,
+                    const mt_api_reply_t *reply)
+{
+    mt_ssh_net_t *net;
+    const gchar *value;
+    gint64 address;
+
+    if(context->state == MT_SSH_STATE_WAITING_FOR_SCAN)
+        mt_ssh_set_state(context, MT_SSH_STATE_SCANNING);
+
+    mt_ssh_api_heartbeat(context);
+
+    if(mt_api_reply_get(reply, "active") &&
+       !mt_api_reply_get_boolean(reply, "active"))
+    {
+        /* This network is not active at the moment, ignore it */
+        return;
+    }
+
+    if(!(value = mt_api_reply_get(reply, "address")) ||
+       (address = parse_scan_address(value, 0)) < 0)
+        return;
+
+    /* Skip blacklisted networks right away */
+    context->blacklist = blacklist_refresh(context->blacklist);
+    if(blacklist_match(context->blacklist, address))
+        return;
+
+    net = mt_ssh_net_new();
+    net->timestamp = g_get_real_time();
+    net->address = address;
+    net->flags = MT_SSH_NET_FLAG_ACTIVE;
+
+    if(mt_api_reply_get_boolean(reply, "privacy"))
+        net->flags |= MT_SSH_NET_FLAG_PRIVACY;
+    if(mt_api_reply_get_boolean(reply, "routeros"))
+        net->flags |= MT_SSH_NET_FLAG_ROUTEROS;
+    if(mt_api_reply_get_boolean(reply, "nstreme"))
+        net->flags |= MT_SSH_NET_FLAG_NSTREME;
+    if(mt_api_reply_get_boolean(reply, "tdma"))
+        net->flags |= MT_SSH_NET_FLAG_TDMA;
+    if(mt_api_reply_get_boolean(reply, "wds"))
+        net->flags |= MT_SSH_NET_FLAG_WDS;
+    if(mt_api_reply_get_boolean(reply, "bridge"))
+        net->flags |= MT_SSH_NET_FLAG_BRIDGE;
+
+    /* Values are not truncated to the terminal column width */
+    net->ssid = g_strdup(mt_api_reply_get(reply, "ssid"));
+    net->radioname = g_strdup(mt_api_reply_get(reply, "radio-name"));
+    net->routeros_ver = g_strdup(mt_api_reply_get(reply, "routeros-version"));
+
+    if((value = mt_api_reply_get(reply, "channel")))
+        net->frequency = parse_api_channel(value, &net->channel, &net->mode);
+
+    if((value = mt_api_reply_get(reply, "sig")))
+        net->rssi = (gint8)atoi(value);
+
+    if((value = mt_api_reply_get(reply, "nf")))
+        net->noise = (gint8)atoi(value);
+
+    g_ptr_array_add(context->scan_frame->networks, net);
+}
+
+static void
+mt_ssh_api_sniffing(mt_ssh_t             *context,
+                    const mt_api_reply_t *reply)
+{
+    const gchar *value;
+
+    if((value = mt_api_reply_get(reply, "processed-packets")))
+        context->sniffer->processed_packets = atoi(value);
+    if((value = mt_api_reply_get(reply, "memory-size")))
+        context->sniffer->memory_size = atoi(value);
+    if((value = mt_api_reply_get(reply, "memory-saved-packets")))
+        context->sniffer->memory_saved_packets = atoi(value);
+    if((value = mt_api_reply_get(reply, "memory-over-limit-packets")))
+        context->sniffer->memory_over_limit_packets = atoi(value);
+    if((value = mt_api_reply_get(reply, "stream-dropped-packets")))
+        context->sniffer->stream_dropped_packets = atoi(value);
+    if((value = mt_api_reply_get(reply, "stream-sent-packets")))
+        context->sniffer->stream_sent_packets = atoi(value);
+    if((value = mt_api_reply_get(reply, "real-file-limit")))
+        context->sniffer->real_file_limit = atoi(value);
+    if((value = mt_api_reply_get(reply, "real-memory-limit")))
+        context->sniffer->real_memory_limit = atoi(value);
+
+    /* Each reply is a complete status frame */
+    mt_ssh_post(context, MT_SSH_MSG_SNF, context->sniffer);
+    context->sniffer = mt_ssh_snf_new();
+    mt_ssh_api_heartbeat(context);
+}
+
+static void
+mt_ssh_api_heartbeat(mt_ssh_t *context)
+{
+    gint64 now = g_get_monotonic_time();
+
+    /* Results are streamed, there is no end of a scan frame */
+    if(now - context->api_heartbeat < API_HEARTBEAT_USEC)
+        return;
+
+    context->api_heartbeat = now;
+    if(context->state == MT_SSH_STATE_SCANNING)
+        mt_ssh_frame_flush(context);
+    else
+        mt_ssh_post(context, MT_SSH_MSG_INFO, mt_ssh_info_new(MT_SSH_INFO_HEARTBEAT, NULL));
+}
+
 static gint
 str_count_lines(const gchar *ptr)
 {
@@ -1830,4 +2552,27 @@ parse_scanlist(const gchar *buff)
     }
 
     return (output ? g_string_free(output, FALSE) : NULL);
-}
\ No newline at end of file
+}
+
+static gint
+parse_api_channel(const gchar  *buff,
+                  gchar       **channel_width,
+                  gchar       **mode)
+{
+    gchar **parts = g_strsplit(buff, "/", 4);
+    gdouble frequency = 0.0;
+
+    /* 5180/20-Ce/ac/P: frequency, width with extension channel, mode */
+    if(parts[0])
+    {
+        frequency = g_ascii_strtod(parts[0], NULL);
+        if(parts[1] && parts[2])
+        {
+            *channel_width = g_strdup(parts[1]);
+            *mode = g_strdup(parts[2]);
+        }
+    }
+
+    g_strfreev(parts);
+    return (gint)round(frequency*1000.0);
+}
@@ -21,6 +21,7 @@ typedef struct mt_ssh      mt_ssh_t;
 typedef struct mt_ssh_info mt_ssh_info_t;
 typedef struct mt_ssh_net  mt_ssh_net_t;
 typedef struct mt_ssh_snf  mt_ssh_snf_t;
+typedef struct mt_ssh_frame mt_ssh_frame_t;
 
 typedef enum mt_ssh_ret
 {
@@ -69,9 +70,17 @@ typedef enum mt_ssh_cmd_type
     MT_SSH_CMD_SCANLIST,
     MT_SSH_CMD_STOP,
     MT_SSH_CMD_SCAN,
-    MT_SSH_CMD_SNIFF
+    MT_SSH_CMD_SNIFF,
+    MT_SSH_CMD_REFRESH
 } mt_ssh_cmd_type_t;
 
+typedef enum mt_ssh_protocol
+{
+    MT_SSH_PROTOCOL_SSH,
+    MT_SSH_PROTOCOL_API,
+    MT_SSH_PROTOCOL_REPLAY  /* hostname is a recorded PTY transcript */
+} mt_ssh_protocol_t;
+
 typedef enum mt_ssh_mode
 {
     MT_SSH_MODE_NONE,
@@ -79,20 +88,22 @@ typedef enum mt_ssh_mode
     MT_SSH_MODE_SNIFFER
 } mt_ssh_mode_t;
 
-mt_ssh_t*          mt_ssh_new(void         (*cb)(mt_ssh_t*, mt_ssh_ret_t, const gchar*),
-                              void         (*cb_msg)(const mt_ssh_t*, mt_ssh_msg_type_t, gconstpointer),
-                              mt_ssh_mode_t  mode_default,
-                              const gchar   *hostname,
-                              gint           port,
-                              const gchar   *login,
-                              const gchar   *password,
-                              const gchar   *iface,
-                              gint           duration,
-                              gboolean       remote,
-                              gboolean       background);
+mt_ssh_t*          mt_ssh_new(void             (*cb)(mt_ssh_t*, mt_ssh_ret_t, const gchar*),
+                              void             (*cb_msg)(const mt_ssh_t*, mt_ssh_msg_type_t, gpointer),
+                              mt_ssh_mode_t      mode_default,
+                              mt_ssh_protocol_t  protocol,
+                              const gchar       *hostname,
+                              gint               port,
+                              const gchar       *login,
+                              const gchar       *password,
+                              const gchar       *iface,
+                              gint               duration,
+                              gboolean           remote,
+                              gboolean           background);
 void               mt_ssh_free(mt_ssh_t*);
 void               mt_ssh_cancel(mt_ssh_t*);
 void               mt_ssh_cmd(mt_ssh_t*, mt_ssh_cmd_type_t, const gchar*);
+mt_ssh_protocol_t  mt_ssh_get_protocol(const mt_ssh_t*);
 const gchar*       mt_ssh_get_hostname(const mt_ssh_t*);
 const gchar*       mt_ssh_get_port(const mt_ssh_t*);
 const gchar*       mt_ssh_get_login(const mt_ssh_t*);
@@ -105,6 +116,17 @@ gboolean           mt_ssh_get_background(const mt_ssh_t*);
 mt_ssh_info_type_t mt_ssh_info_get_type(const mt_ssh_info_t*);
 const gchar*       mt_ssh_info_get_data(const mt_ssh_info_t*);
 
+/* MT_SSH_MSG_NET carries all networks of a single scan frame,
+   it also replaces MT_SSH_INFO_HEARTBEAT during scanning */
+gint64             mt_ssh_frame_get_timestamp(const mt_ssh_frame_t*);
+guint              mt_ssh_frame_get_count(const mt_ssh_frame_t*);
+mt_ssh_net_t*      mt_ssh_frame_get_net(mt_ssh_frame_t*, guint);
+/* Networks with scan lines unchanged since the previous frame,
+   the MT_SSH_CMD_REFRESH reports them again in full */
+guint              mt_ssh_frame_get_seen_count(const mt_ssh_frame_t*);
+gint64             mt_ssh_frame_get_seen(const mt_ssh_frame_t*, guint);
+
+
 gint64             mt_ssh_net_get_timestamp(const mt_ssh_net_t*);
 gint64             mt_ssh_net_get_address(const mt_ssh_net_t*);
 gint               mt_ssh_net_get_frequency(const mt_ssh_net_t*);
@@ -115,6 +137,11 @@ const gchar*       mt_ssh_net_get_radioname(const mt_ssh_net_t*);
 gint8              mt_ssh_net_get_rssi(const mt_ssh_net_t*);
 gint8              mt_ssh_net_get_noise(const mt_ssh_net_t*);
 const gchar*       mt_ssh_net_get_routeros_ver(const mt_ssh_net_t*);
+gchar*             mt_ssh_net_steal_channel(mt_ssh_net_t*);
+gchar*             mt_ssh_net_steal_mode(mt_ssh_net_t*);
+gchar*             mt_ssh_net_steal_ssid(mt_ssh_net_t*);
+gchar*             mt_ssh_net_steal_radioname(mt_ssh_net_t*);
+gchar*             mt_ssh_net_steal_routeros_ver(mt_ssh_net_t*);
 gboolean           mt_ssh_net_get_privacy(const mt_ssh_net_t*);
 gboolean           mt_ssh_net_get_routeros(const mt_ssh_net_t*);
 gboolean           mt_ssh_net_get_nstreme(const mt_ssh_net_t*);
@@ -0,0 +1,314 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+/* Replay of recorded PTY transcripts through the mt-ssh parser,
+   build mtscan with DUMP_PTY enabled in mt-ssh.c to record one */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <glib.h>
+#include "mt-ssh.h"
+#include "msgbus.h"
+
+#define REPLAY_DEFAULT_LOGIN     "admin"
+#define REPLAY_DEFAULT_INTERFACE "wlan1"
+
+typedef struct replay
+{
+    GMainLoop *loop;
+    mt_ssh_ret_t ret;
+    guint frames;
+    guint networks;
+    guint seen;
+    guint failures;
+    GHashTable *addresses;
+} replay_t;
+
+static replay_t replay;
+
+static void
+show_usage(FILE       *fp,
+           const char *arg)
+{
+    fprintf(fp, "usage: %s [ -l <login> ] [ -i <interface> ] [ -r <repeat> ] [ -n <networks> ] [ -d ] [ -e <expected> ] <transcript>\n", arg);
+    fprintf(fp, "  -l  login used in the recorded session (default: %s)\n", REPLAY_DEFAULT_LOGIN);
+    fprintf(fp, "  -i  wireless interface of the recorded session (default: %s)\n", REPLAY_DEFAULT_INTERFACE);
+    fprintf(fp, "  -r  replay the transcript several times\n");
+    fprintf(fp, "  -n  fail unless at least that many distinct networks are found\n");
+    fprintf(fp, "  -d  print the last parsed values of every network\n");
+    fprintf(fp, "  -e  fail unless the printed values match the given file\n");
+}
+
+static gchar*
+format_net(const mt_ssh_net_t *net)
+{
+    const gchar *ssid = mt_ssh_net_get_ssid(net);
+    const gchar *channel = mt_ssh_net_get_channel(net);
+    const gchar *mode = mt_ssh_net_get_mode(net);
+    const gchar *radioname = mt_ssh_net_get_radioname(net);
+    const gchar *version = mt_ssh_net_get_routeros_ver(net);
+
+    return g_strdup_printf("%012" G_GINT64_MODIFIER "X %c%c%c%c%c%c %d %s %s %d %d \"%s\" \"%s\" %s",
+                           mt_ssh_net_get_address(net),
+                           (mt_ssh_net_get_privacy(net) ? 'P' : '-'),
+                           (mt_ssh_net_get_routeros(net) ? 'R' : '-'),
+                           (mt_ssh_net_get_nstreme(net) ? 'N' : '-'),
+                           (mt_ssh_net_get_tdma(net) ? 'T' : '-'),
+                           (mt_ssh_net_get_wds(net) ? 'W' : '-'),
+                           (mt_ssh_net_get_bridge(net) ? 'B' : '-'),
+                           mt_ssh_net_get_frequency(net),
+                           (channel ? channel : "-"),
+                           (mode ? mode : "-"),
+                           mt_ssh_net_get_rssi(net),
+                           mt_ssh_net_get_noise(net),
+                           (ssid ? ssid : ""),
+                           (radioname ? radioname : ""),
+                           (version ? version : "-"));
+}
+
+static gint
+compare_address(gconstpointer a,
+                gconstpointer b)
+{
+    gint64 x = **(const gint64**)a;
+    gint64 y = **(const gint64**)b;
+    return (x > y) - (x < y);
+}
+
+static gchar*
+format_networks(void)
+{
+    GPtrArray *keys = g_ptr_array_new();
+    GString *string = g_string_new(NULL);
+    GHashTableIter iter;
+    gpointer key;
+    guint i;
+
+    g_hash_table_iter_init(&iter, replay.addresses);
+    while(g_hash_table_iter_next(&iter, &key, NULL))
+        g_ptr_array_add(keys, key);
+    g_ptr_array_sort(keys, compare_address);
+
+    for(i = 0; i < keys->len; i++)
+        g_string_append_printf(string, "%s\n", (gchar*)g_hash_table_lookup(replay.addresses, g_ptr_array_index(keys, i)));
+
+    g_ptr_array_free(keys, TRUE);
+    return g_string_free(string, FALSE);
+}
+
+static gboolean
+compare_networks(const gchar *parsed,
+                 const gchar *filename)
+{
+    gchar *expected;
+    gboolean ret;
+
+    if(!g_file_get_contents(filename, &expected, NULL, NULL))
+    {
+        fprintf(stderr, "Failed to read %s\n", filename);
+        return FALSE;
+    }
+
+    if(!(ret = !strcmp(parsed, expected)))
+        fprintf(stderr, "Parsed networks differ from %s, expected:\n%s\nparsed:\n%s", filename, expected, parsed);
+
+    g_free(expected);
+    return ret;
+}
+
+static void
+replay_cb(mt_ssh_t    *context,
+          mt_ssh_ret_t return_state,
+          const gchar *return_error)
+{
+    replay.ret = return_state;
+    if(return_error)
+        fprintf(stderr, "%s\n", return_error);
+
+    mt_ssh_free(context);
+    g_main_loop_quit(replay.loop);
+}
+
+static void
+replay_cb_msg(const mt_ssh_t    *context,
+              mt_ssh_msg_type_t  type,
+              gpointer           data)
+{
+    mt_ssh_frame_t *frame;
+    mt_ssh_net_t *net;
+    gint64 address;
+    guint i;
+
+    if(type == MT_SSH_MSG_INFO &&
+       mt_ssh_info_get_type(data) == MT_SSH_INFO_FAILURE)
+    {
+        fprintf(stderr, "failure: %s\n", mt_ssh_info_get_data(data));
+        replay.failures++;
+        return;
+    }
+
+    if(type != MT_SSH_MSG_NET)
+        return;
+
+    frame = (mt_ssh_frame_t*)data;
+    replay.frames++;
+    replay.networks += mt_ssh_frame_get_count(frame);
+    replay.seen += mt_ssh_frame_get_seen_count(frame);
+
+    for(i = 0; i < mt_ssh_frame_get_count(frame); i++)
+    {
+        /* Keep the last parsed values of each network */
+        net = mt_ssh_frame_get_net(frame, i);
+        address = mt_ssh_net_get_address(net);
+        g_hash_table_replace(replay.addresses, g_memdup(&address, sizeof(gint64)), format_net(net));
+    }
+}
+
+static guint
+count_lines(const gchar *filename)
+{
+    gchar *contents;
+    gsize length, i;
+    guint lines = 0;
+
+    if(!g_file_get_contents(filename, &contents, &length, NULL))
+        return 0;
+
+    /* The parser splits the stream at carriage returns */
+    for(i = 0; i < length; i++)
+        if(contents[i] == '\r')
+            lines++;
+
+    g_free(contents);
+    return lines;
+}
+
+int
+main(int   argc,
+     char *argv[])
+{
+    const gchar *login = REPLAY_DEFAULT_LOGIN;
+    const gchar *iface = REPLAY_DEFAULT_INTERFACE;
+    const gchar *filename;
+    const gchar *expected_file = NULL;
+    gboolean dump = FALSE;
+    gchar *parsed;
+    gboolean ret = TRUE;
+    guint repeat = 1;
+    guint expected = 0;
+    guint lines, i;
+    gint64 elapsed;
+    gdouble seconds;
+    msgbus_stats_t stats;
+    int c;
+
+    while((c = getopt(argc, argv, "hl:i:r:n:de:")) != -1)
+    {
+        switch(c)
+        {
+            case 'h':
+                show_usage(stdout, argv[0]);
+                exit(EXIT_SUCCESS);
+
+            case 'l':
+                login = optarg;
+                break;
+
+            case 'i':
+                iface = optarg;
+                break;
+
+            case 'r':
+                repeat = (guint)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'n':
+                expected = (guint)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'd':
+                dump = TRUE;
+                break;
+
+            case 'e':
+                expected_file = optarg;
+                break;
+
+            case ':':
+            case '?':
+                show_usage(stderr, argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if(optind != argc-1 || !repeat)
+    {
+        show_usage(stderr, argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    filename = argv[optind];
+    lines = count_lines(filename);
+
+    memset(&replay, 0, sizeof(replay));
+    replay.loop = g_main_loop_new(NULL, FALSE);
+    replay.addresses = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, g_free);
+
+    elapsed = g_get_monotonic_time();
+    for(i = 0; i < repeat; i++)
+    {
+        /* Same dispatch sequence as the recorded scanner session */
+        mt_ssh_new(replay_cb, replay_cb_msg,
+                   MT_SSH_MODE_SCANNER, MT_SSH_PROTOCOL_REPLAY,
+                   filename, 0, login, "", iface,
+                   0, FALSE, FALSE);
+        g_main_loop_run(replay.loop);
+
+        if(replay.ret != MT_SSH_CLOSED)
+            exit(EXIT_FAILURE);
+    }
+    elapsed = g_get_monotonic_time() - elapsed;
+    seconds = (gdouble)MAX(elapsed, 1) / G_USEC_PER_SEC;
+
+    printf("%u lines, %u frames, %u networks (%u unchanged), %u distinct, %u failures\n",
+           lines * repeat, replay.frames, replay.networks + replay.seen, replay.seen,
+           g_hash_table_size(replay.addresses), replay.failures);
+    printf("%.3f s, %.0f lines/s, %.0f networks/s\n",
+           seconds, lines * repeat / seconds, (replay.networks + replay.seen) / seconds);
+
+    msgbus_get_stats(MSGBUS_QUEUE_SSH, &stats);
+    printf("%" G_GUINT64_FORMAT " messages in %" G_GUINT64_FORMAT " dispatches, depth %u/%u, latency avg %" G_GINT64_FORMAT " us, max %" G_GINT64_FORMAT " us, %" G_GUINT64_FORMAT " overflows\n",
+           stats.dispatched, msgbus_get_dispatches(), stats.depth_max, stats.capacity,
+           stats.latency_avg, stats.latency_max, stats.overflows);
+
+    if(g_hash_table_size(replay.addresses) < expected)
+    {
+        fprintf(stderr, "Expected at least %u distinct networks\n", expected);
+        ret = FALSE;
+    }
+
+    parsed = format_networks();
+    if(dump)
+        printf("%s", parsed);
+    if(expected_file && !compare_networks(parsed, expected_file))
+        ret = FALSE;
+    g_free(parsed);
+
+    g_hash_table_destroy(replay.addresses);
+    g_main_loop_unref(replay.loop);
+    return (ret ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -44,12 +44,31 @@ network_init(network_t *net)
     net->ubnt_mixed = FALSE;
     net->firstseen = 0;
     net->lastseen = 0;
+    net->captured = 0;
     net->latitude = NAN;
     net->longitude = NAN;
     net->azimuth = NAN;
+    net->source = NULL;
     net->signals = NULL;
 }
 
+network_t*
+network_dup(const network_t *net)
+{
+    network_t *copy = g_malloc(sizeof(network_t));
+
+    *copy = *net;
+    copy->channel = g_strdup(net->channel);
+    copy->mode = g_strdup(net->mode);
+    copy->ssid = g_strdup(net->ssid);
+    copy->radioname = g_strdup(net->radioname);
+    copy->routeros_ver = g_strdup(net->routeros_ver);
+    copy->source = g_strdup(net->source);
+    /* Signal samples are not duplicated */
+    copy->signals = NULL;
+    return copy;
+}
+
 void
 network_to_utf8(network_t   *net,
                 const gchar *charset)
@@ -100,6 +119,7 @@ network_free(network_t *net)
         g_free(net->ssid);
         g_free(net->radioname);
         g_free(net->routeros_ver);
+        g_free(net->source);
         if (net->signals)
             signals_free(net->signals);
     }
@@ -114,5 +134,6 @@ network_free_null(network_t *net)
     net->ssid = NULL;
     net->radioname = NULL;
     net->routeros_ver = NULL;
+    net->source = NULL;
     net->signals = NULL;
 }
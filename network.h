@@ -47,13 +47,16 @@ typedef struct network
     gboolean ubnt_mixed;
     gint64 firstseen;
     gint64 lastseen;
+    gint64 captured;
     gdouble latitude;
     gdouble longitude;
     gfloat azimuth;
+    gchar *source;
     signals_t *signals;
 } network_t;
 
 void network_init(network_t*);
+network_t* network_dup(const network_t*);
 void network_to_utf8(network_t*, const gchar*);
 void network_free(network_t*);
 void network_free_null(network_t*);
@@ -4,6 +4,7 @@
 #include "win32.h"
 #endif
 #include <string.h>
+#include "task.h"
 
 #define OUI_MAX_LINE_LEN 256
 
@@ -15,8 +16,8 @@ typedef struct oui_context
 
 static GHashTable *oui = NULL;
 
-static gpointer oui_thread(gpointer);
-static gboolean oui_thread_callback(gpointer);
+static void oui_task(task_t*, gpointer);
+static void oui_task_done(task_t*, gpointer);
 
 
 gboolean
@@ -33,7 +34,7 @@ oui_init(const gchar *filename)
     context->table = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
     context->fp = fp;
 
-    g_thread_unref(g_thread_new("oui_thread", oui_thread, context));
+    task_run(TASK_PRIORITY_UI, oui_task, oui_task_done, context);
     return TRUE;
 }
 
@@ -63,8 +64,9 @@ oui_destroy()
 }
 
 
-static gpointer
-oui_thread(gpointer user_data)
+static void
+oui_task(task_t   *task,
+         gpointer  user_data)
 {
     oui_context_t *context = (oui_context_t*)user_data;
     guint o1, o2, o3, oui;
@@ -106,12 +108,11 @@ oui_thread(gpointer user_data)
     }
 
     fclose(context->fp);
-    g_idle_add(oui_thread_callback, context);
-    return NULL;
 }
 
-static gboolean
-oui_thread_callback(gpointer user_data)
+static void
+oui_task_done(task_t   *task,
+              gpointer  user_data)
 {
     oui_context_t *context = (oui_context_t*)user_data;
 
@@ -120,6 +121,4 @@ oui_thread_callback(gpointer user_data)
 
     oui = context->table;
     g_free(context);
-
-    return G_SOURCE_REMOVE;
 }
@@ -0,0 +1,230 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <math.h>
+#include "tzsp/tzsp-sniffer.h"
+#include "tzsp/mac80211.h"
+#include "network.h"
+#include "station.h"
+#include "model.h"
+#include "conf.h"
+#include "tzsp-receiver.h"
+#include "blacklist.h"
+#include "pcap-import.h"
+
+#define PCAP_MAGIC       0xA1B2C3D4
+#define PCAP_MAGIC_NSEC  0xA1B23C4D
+#define PCAPNG_MAGIC     0x0A0D0D0A
+
+#define PCAP_IMPORT_SRC_OFFSET 10
+
+typedef struct pcap_import_context
+{
+    tzsp_sniffer_t *sniffer;
+    GHashTable *networks;
+    blacklist_t *blacklist;
+    gint channel_width;
+    gint frequency_base;
+    gboolean strip_samples;
+} pcap_import_context_t;
+
+static void pcap_import_packet(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, uint32_t, gpointer);
+static void pcap_import_update(network_t*, network_t*);
+static void pcap_import_free(gpointer);
+
+
+gboolean
+pcap_import_check(const gchar *filename)
+{
+    guint8 buffer[4];
+    guint32 magic;
+    FILE *fp;
+
+    if(!(fp = g_fopen(filename, "rb")))
+        return FALSE;
+
+    if(fread(buffer, sizeof(buffer), 1, fp) != 1)
+    {
+        fclose(fp);
+        return FALSE;
+    }
+    fclose(fp);
+
+    /* Both byte orders are valid */
+    magic = buffer[0] << 24 | buffer[1] << 16 | buffer[2] << 8 | buffer[3];
+    if(magic == PCAP_MAGIC || GUINT32_SWAP_LE_BE(magic) == PCAP_MAGIC ||
+       magic == PCAP_MAGIC_NSEC || GUINT32_SWAP_LE_BE(magic) == PCAP_MAGIC_NSEC)
+        return TRUE;
+
+    return (magic == PCAPNG_MAGIC);
+}
+
+gint
+pcap_import(const gchar  *filename,
+            void        (*net_cb)(network_t*, gpointer),
+            gpointer      user_data,
+            gboolean      strip_samples)
+{
+    pcap_import_context_t context;
+    GHashTableIter iter;
+    network_t *network;
+    gint count = 0;
+    gint ret;
+
+    context.sniffer = tzsp_sniffer_new();
+    if(!context.sniffer)
+        return PCAP_IMPORT_ERROR_OPEN;
+
+    ret = tzsp_sniffer_init_offline(context.sniffer, (guint16)conf_get_preferences_tzsp_udp_port(), filename);
+    if(ret != TZSP_SNIFFER_OK)
+    {
+        tzsp_sniffer_free(context.sniffer);
+        return (ret == TZSP_SNIFFER_ERROR_CAPTURE ? PCAP_IMPORT_ERROR_OPEN : PCAP_IMPORT_ERROR_PARSE);
+    }
+
+    context.networks = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, pcap_import_free);
+    context.blacklist = blacklist_get();
+    context.channel_width = conf_get_preferences_tzsp_channel_width();
+    context.frequency_base = (conf_get_preferences_tzsp_band() == MTSCAN_CONF_TZSP_BAND_2GHZ) ? 2407 : 5000;
+    context.strip_samples = strip_samples;
+
+    /* Replay the whole file at once, the loop ends with the last packet */
+    tzsp_sniffer_set_func(context.sniffer, pcap_import_packet, &context);
+    tzsp_sniffer_enable(context.sniffer);
+    tzsp_sniffer_loop(context.sniffer);
+    tzsp_sniffer_free(context.sniffer);
+
+    if(context.blacklist)
+        blacklist_unref(context.blacklist);
+
+    /* Release the airMAX AC keys of this thread */
+    ie_airmax_ac_cache_clear();
+
+    g_hash_table_iter_init(&iter, context.networks);
+    while(g_hash_table_iter_next(&iter, NULL, (gpointer*)&network))
+    {
+        net_cb(network, user_data);
+        count++;
+    }
+
+    g_hash_table_destroy(context.networks);
+    return count;
+}
+
+static void
+pcap_import_packet(const uint8_t *packet,
+                   uint32_t       len,
+                   const int8_t  *rssi,
+                   const uint8_t *channel,
+                   const uint8_t *sensor_mac,
+                   uint32_t       sensor_ip,
+                   gpointer       user_data)
+{
+    pcap_import_context_t *context = (pcap_import_context_t*)user_data;
+    network_t *network;
+    network_t *current;
+    gint64 timestamp;
+    gint64 address;
+
+    /* Skip blacklisted networks before parsing */
+    if(len >= PCAP_IMPORT_SRC_OFFSET + 6)
+    {
+        address = tzsp_receiver_address(packet + PCAP_IMPORT_SRC_OFFSET);
+        if(blacklist_match(context->blacklist, address))
+            return;
+    }
+
+    network = tzsp_receiver_network(packet, len, channel, context->channel_width, context->frequency_base);
+    if(!network)
+        return;
+
+    network_to_utf8(network, conf_get_preferences_fallback_encoding());
+
+    /* Use the capture time instead of the current one */
+    timestamp = tzsp_sniffer_get_timestamp(context->sniffer);
+    network->firstseen = timestamp;
+    network->lastseen = timestamp;
+
+    if(rssi)
+        network->rssi = *rssi;
+
+    if(sensor_mac)
+        network->source = g_strdup_printf("%02X:%02X:%02X:%02X:%02X:%02X",
+                                          sensor_mac[0], sensor_mac[1], sensor_mac[2],
+                                          sensor_mac[3], sensor_mac[4], sensor_mac[5]);
+
+    current = g_hash_table_lookup(context->networks, &network->address);
+    if(current)
+        pcap_import_update(network, current);
+    else
+        network->signals = signals_new();
+
+    /* One signal sample per second is enough */
+    if(rssi && !context->strip_samples &&
+       (!network->signals->tail || network->signals->tail->timestamp != timestamp))
+        signals_append(network->signals, signals_node_new(timestamp, *rssi, NAN, NAN, NAN));
+
+    /* The key is a part of the network, replace it as well */
+    g_hash_table_replace(context->networks, &network->address, network);
+}
+
+static void
+pcap_import_update(network_t *network,
+                   network_t *current)
+{
+    gchar *tmp;
+
+    /* Preserve hidden SSIDs */
+    if(!network->ssid || !network->ssid[0])
+    {
+        tmp = network->ssid;
+        network->ssid = current->ssid;
+        current->ssid = tmp;
+    }
+
+    /* ... and Radio Names */
+    if(!network->radioname || !network->radioname[0])
+    {
+        tmp = network->radioname;
+        network->radioname = current->radioname;
+        current->radioname = tmp;
+    }
+
+    /* Keep the signal peak along with its source */
+    if(current->rssi > network->rssi)
+    {
+        network->rssi = current->rssi;
+        tmp = network->source;
+        network->source = current->source;
+        current->source = tmp;
+    }
+
+    network->firstseen = MIN(network->firstseen, current->firstseen);
+    network->lastseen = MAX(network->lastseen, current->lastseen);
+
+    network->signals = current->signals;
+    current->signals = NULL;
+}
+
+static void
+pcap_import_free(gpointer data)
+{
+    network_t *network = (network_t*)data;
+
+    network_free(network);
+    g_free(network);
+}
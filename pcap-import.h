@@ -0,0 +1,29 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_PCAP_IMPORT_H_
+#define MTSCAN_PCAP_IMPORT_H_
+#include <glib.h>
+#include "network.h"
+
+/* Same values as the log_read() errors */
+#define PCAP_IMPORT_ERROR_EMPTY  0
+#define PCAP_IMPORT_ERROR_OPEN  -1
+#define PCAP_IMPORT_ERROR_PARSE -3
+
+gboolean pcap_import_check(const gchar*);
+gint pcap_import(const gchar*, void (*)(network_t*, gpointer), gpointer, gboolean);
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include "ring.h"
+
+#define RING_CACHE_LINE 64
+
+typedef struct ring
+{
+    gpointer *buffer;
+    guint mask;
+    /* Written only by the producer */
+    volatile gint head;
+    gchar pad[RING_CACHE_LINE];
+    /* Written only by the consumer */
+    volatile gint tail;
+} ring_t;
+
+ring_t*
+ring_new(guint capacity)
+{
+    ring_t *ring;
+    guint size = 1;
+
+    /* Round the capacity up to the power of two */
+    while(size < capacity)
+        size <<= 1;
+
+    ring = g_malloc0(sizeof(ring_t));
+    ring->buffer = g_new0(gpointer, size);
+    ring->mask = size - 1;
+    return ring;
+}
+
+void
+ring_free(ring_t *ring)
+{
+    if(ring)
+    {
+        g_free(ring->buffer);
+        g_free(ring);
+    }
+}
+
+gboolean
+ring_push(ring_t   *ring,
+          gpointer  data)
+{
+    guint head = (guint)g_atomic_int_get(&ring->head);
+    guint tail = (guint)g_atomic_int_get(&ring->tail);
+
+    if(head - tail > ring->mask)
+        return FALSE;
+
+    ring->buffer[head & ring->mask] = data;
+
+    /* Publish the element after it has been stored */
+    g_atomic_int_set(&ring->head, (gint)(head + 1));
+    return TRUE;
+}
+
+gpointer
+ring_pop(ring_t *ring)
+{
+    guint tail = (guint)g_atomic_int_get(&ring->tail);
+    guint head = (guint)g_atomic_int_get(&ring->head);
+    gpointer data;
+
+    if(head == tail)
+        return NULL;
+
+    data = ring->buffer[tail & ring->mask];
+
+    /* Release the slot after it has been read */
+    g_atomic_int_set(&ring->tail, (gint)(tail + 1));
+    return data;
+}
+
+guint
+ring_length(ring_t *ring)
+{
+    return (guint)g_atomic_int_get(&ring->head) - (guint)g_atomic_int_get(&ring->tail);
+}
+
+guint
+ring_capacity(const ring_t *ring)
+{
+    return ring->mask + 1;
+}
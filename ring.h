@@ -0,0 +1,30 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_RING_H_
+#define MTSCAN_RING_H_
+#include <glib.h>
+
+/* Bounded single-producer, single-consumer pointer queue */
+typedef struct ring ring_t;
+
+ring_t*  ring_new(guint);
+void     ring_free(ring_t*);
+gboolean ring_push(ring_t*, gpointer);
+gpointer ring_pop(ring_t*);
+guint    ring_length(ring_t*);
+guint    ring_capacity(const ring_t*);
+
+#endif
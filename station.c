@@ -0,0 +1,53 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include "station.h"
+#include "model.h"
+
+void
+station_init(station_t *sta)
+{
+    sta->address = -1;
+    sta->bssid = -1;
+    sta->ssid = NULL;
+    sta->rssi = MODEL_NO_SIGNAL;
+    sta->firstseen = 0;
+    sta->lastseen = 0;
+    sta->source = NULL;
+}
+
+void
+station_to_utf8(station_t   *sta,
+                const gchar *charset)
+{
+    gchar *output;
+
+    if(sta->ssid && !g_utf8_validate(sta->ssid, -1, NULL))
+    {
+        output = g_convert(sta->ssid, -1, "UTF-8", charset, NULL, NULL, NULL);
+        g_free(sta->ssid);
+        sta->ssid = output;
+    }
+}
+
+void
+station_free(station_t *sta)
+{
+    if(sta)
+    {
+        g_free(sta->ssid);
+        g_free(sta->source);
+    }
+}
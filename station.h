@@ -0,0 +1,35 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_STATION_H_
+#define MTSCAN_STATION_H_
+#include <glib.h>
+
+typedef struct station
+{
+    gint64 address;
+    gint64 bssid;
+    gchar *ssid;
+    gint8 rssi;
+    gint64 firstseen;
+    gint64 lastseen;
+    gchar *source;
+} station_t;
+
+void station_init(station_t*);
+void station_to_utf8(station_t*, const gchar*);
+void station_free(station_t*);
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include "stations.h"
+
+static void stations_clients_change(mtscan_stations_t*, gint64, gint);
+
+mtscan_stations_t*
+mtscan_stations_new(void)
+{
+    mtscan_stations_t *stations = g_malloc(sizeof(mtscan_stations_t));
+    stations->store = gtk_list_store_new(STA_COL_COUNT,
+                                         G_TYPE_INT64,   /* STA_COL_ADDRESS  */
+                                         G_TYPE_INT64,   /* STA_COL_BSSID    */
+                                         G_TYPE_STRING,  /* STA_COL_SSID     */
+                                         G_TYPE_CHAR,    /* STA_COL_RSSI     */
+                                         G_TYPE_INT64,   /* STA_COL_FIRSTLOG */
+                                         G_TYPE_INT64,   /* STA_COL_LASTLOG  */
+                                         G_TYPE_STRING); /* STA_COL_SOURCE   */
+
+    stations->map = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, (GDestroyNotify)gtk_tree_iter_free);
+    stations->clients = g_hash_table_new_full(g_int64_hash, g_int64_equal, g_free, NULL);
+    return stations;
+}
+
+void
+mtscan_stations_free(mtscan_stations_t *stations)
+{
+    g_hash_table_destroy(stations->map);
+    g_hash_table_destroy(stations->clients);
+    g_object_unref(stations->store);
+    g_free(stations);
+}
+
+void
+mtscan_stations_clear(mtscan_stations_t *stations)
+{
+    gtk_list_store_clear(stations->store);
+    g_hash_table_remove_all(stations->map);
+    g_hash_table_remove_all(stations->clients);
+}
+
+gboolean
+mtscan_stations_add(mtscan_stations_t *stations,
+                    const station_t   *sta,
+                    gint64            *previous)
+{
+    GtkTreeIter iter;
+    GtkTreeIter *iter_ptr;
+    gint64 *address;
+    gint64 bssid;
+    gint64 firstseen;
+    gint64 lastseen;
+    gboolean newer;
+
+    *previous = -1;
+
+    if(!(iter_ptr = g_hash_table_lookup(stations->map, &sta->address)))
+    {
+        gtk_list_store_insert_with_values(stations->store, &iter, -1,
+                                          STA_COL_ADDRESS, sta->address,
+                                          STA_COL_BSSID, sta->bssid,
+                                          STA_COL_SSID, (sta->ssid ? sta->ssid : ""),
+                                          STA_COL_RSSI, sta->rssi,
+                                          STA_COL_FIRSTLOG, sta->firstseen,
+                                          STA_COL_LASTLOG, sta->lastseen,
+                                          STA_COL_SOURCE, (sta->source ? sta->source : ""),
+                                          -1);
+
+        address = g_malloc(sizeof(gint64));
+        *address = sta->address;
+        g_hash_table_insert(stations->map, address, gtk_tree_iter_copy(&iter));
+
+        if(sta->bssid < 0)
+            return FALSE;
+
+        stations_clients_change(stations, sta->bssid, 1);
+        return TRUE;
+    }
+
+    gtk_tree_model_get(GTK_TREE_MODEL(stations->store), iter_ptr,
+                       STA_COL_BSSID, &bssid,
+                       STA_COL_FIRSTLOG, &firstseen,
+                       STA_COL_LASTLOG, &lastseen,
+                       -1);
+
+    /* Merged logs may deliver older observations */
+    newer = (sta->lastseen >= lastseen);
+
+    gtk_list_store_set(stations->store, iter_ptr,
+                       STA_COL_FIRSTLOG, MIN(firstseen, sta->firstseen),
+                       STA_COL_LASTLOG, MAX(lastseen, sta->lastseen),
+                       -1);
+
+    if(newer)
+    {
+        gtk_list_store_set(stations->store, iter_ptr,
+                           STA_COL_RSSI, sta->rssi,
+                           STA_COL_SOURCE, (sta->source ? sta->source : ""),
+                           -1);
+    }
+
+    if(sta->ssid && sta->ssid[0])
+    {
+        gtk_list_store_set(stations->store, iter_ptr,
+                           STA_COL_SSID, sta->ssid,
+                           -1);
+    }
+
+    /* Probe requests do not tell anything about the association,
+       keep the last known AP until the station shows up elsewhere */
+    if(!newer || sta->bssid < 0 || sta->bssid == bssid)
+        return FALSE;
+
+    gtk_list_store_set(stations->store, iter_ptr,
+                       STA_COL_BSSID, sta->bssid,
+                       -1);
+
+    if(bssid >= 0)
+        stations_clients_change(stations, bssid, -1);
+    stations_clients_change(stations, sta->bssid, 1);
+
+    *previous = bssid;
+    return TRUE;
+}
+
+gint
+mtscan_stations_get_clients(mtscan_stations_t *stations,
+                            gint64             bssid)
+{
+    return GPOINTER_TO_INT(g_hash_table_lookup(stations->clients, &bssid));
+}
+
+guint
+mtscan_stations_count(mtscan_stations_t *stations)
+{
+    return g_hash_table_size(stations->map);
+}
+
+static void
+stations_clients_change(mtscan_stations_t *stations,
+                        gint64             bssid,
+                        gint               diff)
+{
+    gint64 *key;
+    gint count;
+
+    count = mtscan_stations_get_clients(stations, bssid) + diff;
+
+    if(count <= 0)
+    {
+        g_hash_table_remove(stations->clients, &bssid);
+        return;
+    }
+
+    key = g_malloc(sizeof(gint64));
+    *key = bssid;
+    g_hash_table_replace(stations->clients, key, GINT_TO_POINTER(count));
+}
@@ -0,0 +1,47 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_STATIONS_H_
+#define MTSCAN_STATIONS_H_
+#include <gtk/gtk.h>
+#include "station.h"
+
+typedef struct mtscan_stations
+{
+    GtkListStore *store;
+    GHashTable *map;
+    GHashTable *clients;
+} mtscan_stations_t;
+
+enum
+{
+    STA_COL_ADDRESS,
+    STA_COL_BSSID,
+    STA_COL_SSID,
+    STA_COL_RSSI,
+    STA_COL_FIRSTLOG,
+    STA_COL_LASTLOG,
+    STA_COL_SOURCE,
+    STA_COL_COUNT
+};
+
+mtscan_stations_t* mtscan_stations_new(void);
+void mtscan_stations_free(mtscan_stations_t*);
+void mtscan_stations_clear(mtscan_stations_t*);
+gboolean mtscan_stations_add(mtscan_stations_t*, const station_t*, gint64*);
+gint mtscan_stations_get_clients(mtscan_stations_t*, gint64);
+guint mtscan_stations_count(mtscan_stations_t*);
+
+#endif
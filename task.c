@@ -0,0 +1,126 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <glib.h>
+#include "task.h"
+#include "msgbus.h"
+
+#define TASK_WORKERS_MAX 4
+
+typedef struct task
+{
+    task_priority_t priority;
+    guint64 sequence;
+    void (*func)(task_t*, gpointer);
+    void (*done)(task_t*, gpointer);
+    gpointer user_data;
+    volatile gint canceled;
+} task_t;
+
+static GThreadPool *pool = NULL;
+static guint64 sequence = 0;
+
+static void task_worker(gpointer, gpointer);
+static gint task_compare(gconstpointer, gconstpointer, gpointer);
+static gboolean task_done(gpointer);
+
+
+task_t*
+task_run(task_priority_t   priority,
+         void            (*func)(task_t*, gpointer),
+         void            (*done)(task_t*, gpointer),
+         gpointer          user_data)
+{
+    task_t *task;
+
+    /* Tasks are always submitted from the main loop */
+    if(!pool)
+    {
+        pool = g_thread_pool_new(task_worker, NULL, (gint)task_get_workers(), FALSE, NULL);
+        g_thread_pool_set_sort_function(pool, task_compare, NULL);
+    }
+
+    task = g_malloc(sizeof(task_t));
+    task->priority = priority;
+    task->sequence = sequence++;
+    task->func = func;
+    task->done = done;
+    task->user_data = user_data;
+    task->canceled = FALSE;
+
+    g_thread_pool_push(pool, task, NULL);
+    return task;
+}
+
+void
+task_cancel(task_t *task)
+{
+    /* The task stays valid until its done callback returns */
+    g_atomic_int_set(&task->canceled, TRUE);
+}
+
+gboolean
+task_is_canceled(const task_t *task)
+{
+    return g_atomic_int_get(&task->canceled);
+}
+
+guint
+task_get_workers(void)
+{
+    gint count = (gint)g_get_num_processors() - 1;
+
+    /* Leave one core for the main loop */
+    return (guint)CLAMP(count, 1, TASK_WORKERS_MAX);
+}
+
+static void
+task_worker(gpointer data,
+            gpointer user_data)
+{
+    task_t *task = (task_t*)data;
+
+    if(!task_is_canceled(task))
+        task->func(task, task->user_data);
+
+    msgbus_post(MSGBUS_QUEUE_TASK, task_done, task);
+}
+
+static gint
+task_compare(gconstpointer a,
+             gconstpointer b,
+             gpointer      user_data)
+{
+    const task_t *task_a = (const task_t*)a;
+    const task_t *task_b = (const task_t*)b;
+
+    /* Higher priority first, then in order of submission */
+    if(task_a->priority != task_b->priority)
+        return (task_a->priority < task_b->priority ? -1 : 1);
+
+    return (task_a->sequence < task_b->sequence ? -1 : (task_a->sequence > task_b->sequence));
+}
+
+static gboolean
+task_done(gpointer user_data)
+{
+    task_t *task = (task_t*)user_data;
+
+    if(task->done)
+        task->done(task, task->user_data);
+
+    g_free(task);
+    return G_SOURCE_REMOVE;
+}
@@ -0,0 +1,38 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_TASK_H_
+#define MTSCAN_TASK_H_
+#include <glib.h>
+
+/* Finite background jobs on a shared pool of worker threads.
+ * Long-lived connections (SSH, gpsd, TZSP, WiGLE) keep their own threads. */
+typedef enum task_priority
+{
+    TASK_PRIORITY_CAPTURE = 0,
+    TASK_PRIORITY_UI,
+    TASK_PRIORITY_BATCH
+} task_priority_t;
+
+typedef struct task task_t;
+
+/* func runs on a worker thread, done runs in the main loop afterwards
+   (also for canceled tasks, so the user data can be released there) */
+task_t*  task_run(task_priority_t, void (*func)(task_t*, gpointer), void (*done)(task_t*, gpointer), gpointer);
+void     task_cancel(task_t*);
+gboolean task_is_canceled(const task_t*);
+guint    task_get_workers(void);
+
+#endif
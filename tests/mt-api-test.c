@@ -0,0 +1,527 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+/* Tests mt-api against a mock RouterOS API server
+   speaking the length-prefixed word protocol */
+
+#include <glib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../mt-api.h"
+
+#define TEST_TIMEOUT_MSEC 5000
+#define TEST_READ_MSEC     100
+
+#define TEST_LOGIN     "admin"
+#define TEST_PASSWORD  "secret"
+#define TEST_CHALLENGE "ebddd18303a54111e2dea05a92ab46b4"
+#define TEST_RESPONSE  "007319531c22b6b85e160d6ac355c1df2e"
+
+typedef void (*mock_script_t)(gint);
+
+typedef struct mock
+{
+    gint           listen_fd;
+    gchar         *port;
+    mock_script_t  script;
+    GThread       *thread;
+} mock_t;
+
+static volatile gboolean canceled = FALSE;
+
+static gpointer mock_thread(gpointer);
+static mock_t* mock_start(mock_script_t);
+static void mock_finish(mock_t*);
+static void mock_recv(gint, guint8*, gsize);
+static gchar** mock_read(gint);
+static void mock_word(GByteArray*, const gchar*, gsize);
+static void mock_send(gint, GByteArray*, gboolean);
+static void mock_sentence(gint, const gchar* const*);
+static mt_api_t* test_connect(mock_t*);
+static mt_api_reply_t* test_read(mt_api_t*);
+
+
+static gpointer
+mock_thread(gpointer data)
+{
+    mock_t *mock = (mock_t*)data;
+    gint fd;
+
+    fd = accept(mock->listen_fd, NULL, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    mock->script(fd);
+    close(fd);
+    return NULL;
+}
+
+static mock_t*
+mock_start(mock_script_t script)
+{
+    mock_t *mock = g_malloc0(sizeof(mock_t));
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    mock->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    g_assert_cmpint(mock->listen_fd, >=, 0);
+    g_assert_cmpint(bind(mock->listen_fd, (struct sockaddr*)&addr, sizeof(addr)), ==, 0);
+    g_assert_cmpint(listen(mock->listen_fd, 1), ==, 0);
+    g_assert_cmpint(getsockname(mock->listen_fd, (struct sockaddr*)&addr, &len), ==, 0);
+
+    mock->port = g_strdup_printf("%u", ntohs(addr.sin_port));
+    mock->script = script;
+    mock->thread = g_thread_new("mock", mock_thread, mock);
+    return mock;
+}
+
+static void
+mock_finish(mock_t *mock)
+{
+    g_thread_join(mock->thread);
+    close(mock->listen_fd);
+    g_free(mock->port);
+    g_free(mock);
+}
+
+static void
+mock_recv(gint    fd,
+          guint8 *buffer,
+          gsize   length)
+{
+    gssize n;
+
+    while(length)
+    {
+        n = recv(fd, buffer, length, 0);
+        g_assert_cmpint(n, >, 0);
+        buffer += n;
+        length -= n;
+    }
+}
+
+static gchar**
+mock_read(gint fd)
+{
+    GPtrArray *words = g_ptr_array_new();
+    guint8 header[5];
+    guint32 length;
+    gchar *word;
+    gint size;
+    gint i;
+
+    while(TRUE)
+    {
+        mock_recv(fd, header, 1);
+        if(!(header[0] & 0x80))
+            size = 1;
+        else if((header[0] & 0xC0) == 0x80)
+            size = 2;
+        else if((header[0] & 0xE0) == 0xC0)
+            size = 3;
+        else if((header[0] & 0xF0) == 0xE0)
+            size = 4;
+        else
+            size = 5;
+
+        mock_recv(fd, header + 1, size - 1);
+        length = (size == 5) ? 0 : header[0] & (0xFF >> size);
+        for(i=1; i<size; i++)
+            length = (length << 8) | header[i];
+
+        if(!length)
+            break;
+
+        word = g_malloc(length + 1);
+        mock_recv(fd, (guint8*)word, length);
+        word[length] = '\0';
+        g_ptr_array_add(words, word);
+    }
+
+    g_ptr_array_add(words, NULL);
+    return (gchar**)g_ptr_array_free(words, FALSE);
+}
+
+static void
+mock_word(GByteArray  *sentence,
+          const gchar *word,
+          gsize        size)
+{
+    guint32 length = (guint32)strlen(word);
+    guint8 header[5];
+    gsize i;
+
+    /* RouterOS accepts any prefix wide enough for the length,
+       so the shorter words are encoded with a wider one too */
+    for(i=0; i<size; i++)
+        header[size-1-i] = (i < 4) ? (guint8)(length >> (8*i)) : 0;
+
+    if(size == 2)
+        header[0] |= 0x80;
+    else if(size == 3)
+        header[0] |= 0xC0;
+    else if(size == 4)
+        header[0] |= 0xE0;
+    else if(size == 5)
+        header[0] = 0xF0;
+
+    g_byte_array_append(sentence, header, (guint)size);
+    g_byte_array_append(sentence, (const guint8*)word, length);
+}
+
+static void
+mock_send(gint        fd,
+          GByteArray *data,
+          gboolean    slow)
+{
+    gsize sent = 0;
+    gssize n;
+
+    while(sent < data->len)
+    {
+        /* The slow mode splits words and length prefixes across reads */
+        n = send(fd, data->data + sent, slow ? 1 : data->len - sent, 0);
+        g_assert_cmpint(n, >, 0);
+        sent += n;
+        if(slow)
+            g_usleep(200);
+    }
+    g_byte_array_free(data, TRUE);
+}
+
+static void
+mock_sentence(gint                fd,
+              const gchar* const *words)
+{
+    GByteArray *data = g_byte_array_new();
+
+    for(; *words; words++)
+        mock_word(data, *words, 1);
+    mock_word(data, "", 1);
+    mock_send(fd, data, FALSE);
+}
+
+static mt_api_t*
+test_connect(mock_t *mock)
+{
+    mt_api_t *api = mt_api_new();
+    gchar *error = NULL;
+
+    g_assert_true(mt_api_connect(api, "127.0.0.1", mock->port, TEST_TIMEOUT_MSEC / 1000, &canceled, &error));
+    g_assert_null(error);
+    return api;
+}
+
+static mt_api_reply_t*
+test_read(mt_api_t *api)
+{
+    gint64 deadline = g_get_monotonic_time() + TEST_TIMEOUT_MSEC * 1000;
+    mt_api_reply_t *reply = NULL;
+    gint ret;
+
+    while(!(ret = mt_api_read(api, TEST_READ_MSEC, &reply)))
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+
+    g_assert_cmpint(ret, ==, 1);
+    return reply;
+}
+
+static void
+script_login_plain(gint fd)
+{
+    gchar **words = mock_read(fd);
+
+    g_assert_cmpuint(g_strv_length(words), ==, 3);
+    g_assert_cmpstr(words[0], ==, "/login");
+    g_assert_cmpstr(words[1], ==, "=name=" TEST_LOGIN);
+    g_assert_cmpstr(words[2], ==, "=password=" TEST_PASSWORD);
+    g_strfreev(words);
+
+    mock_sentence(fd, (const gchar*[]){ "!done", NULL });
+}
+
+static void
+test_login_plain(void)
+{
+    mock_t *mock = mock_start(script_login_plain);
+    mt_api_t *api = test_connect(mock);
+    gchar *error = NULL;
+
+    g_assert_true(mt_api_login(api, TEST_LOGIN, TEST_PASSWORD, TEST_TIMEOUT_MSEC / 1000, &error));
+    g_assert_null(error);
+
+    mt_api_free(api);
+    mock_finish(mock);
+}
+
+static void
+script_login_md5(gint fd)
+{
+    gchar **words = mock_read(fd);
+
+    g_assert_cmpstr(words[0], ==, "/login");
+    g_strfreev(words);
+
+    /* Pre-v6.43 releases answer with a challenge */
+    mock_sentence(fd, (const gchar*[]){ "!done", "=ret=" TEST_CHALLENGE, NULL });
+
+    words = mock_read(fd);
+    g_assert_cmpuint(g_strv_length(words), ==, 3);
+    g_assert_cmpstr(words[0], ==, "/login");
+    g_assert_cmpstr(words[1], ==, "=name=" TEST_LOGIN);
+    g_assert_cmpstr(words[2], ==, "=response=" TEST_RESPONSE);
+    g_strfreev(words);
+
+    mock_sentence(fd, (const gchar*[]){ "!done", NULL });
+}
+
+static void
+test_login_md5(void)
+{
+    mock_t *mock = mock_start(script_login_md5);
+    mt_api_t *api = test_connect(mock);
+    gchar *error = NULL;
+
+    g_assert_true(mt_api_login(api, TEST_LOGIN, TEST_PASSWORD, TEST_TIMEOUT_MSEC / 1000, &error));
+    g_assert_null(error);
+
+    mt_api_free(api);
+    mock_finish(mock);
+}
+
+static void
+script_login_trap(gint fd)
+{
+    g_strfreev(mock_read(fd));
+    mock_sentence(fd, (const gchar*[]){ "!trap", "=message=invalid user name or password (6)", NULL });
+}
+
+static void
+test_login_trap(void)
+{
+    mock_t *mock = mock_start(script_login_trap);
+    mt_api_t *api = test_connect(mock);
+    gchar *error = NULL;
+
+    g_assert_false(mt_api_login(api, TEST_LOGIN, TEST_PASSWORD, TEST_TIMEOUT_MSEC / 1000, &error));
+    g_assert_cmpstr(error, ==, "invalid user name or password (6)");
+    g_free(error);
+
+    mt_api_free(api);
+    mock_finish(mock);
+}
+
+static void
+script_login_fatal(gint fd)
+{
+    g_strfreev(mock_read(fd));
+    mock_sentence(fd, (const gchar*[]){ "!fatal", "too many commands before login", NULL });
+}
+
+static void
+test_login_fatal(void)
+{
+    mock_t *mock = mock_start(script_login_fatal);
+    mt_api_t *api = test_connect(mock);
+    gchar *error = NULL;
+
+    g_assert_false(mt_api_login(api, TEST_LOGIN, TEST_PASSWORD, TEST_TIMEOUT_MSEC / 1000, &error));
+    g_assert_cmpstr(error, ==, "too many commands before login");
+    g_free(error);
+
+    mt_api_free(api);
+    mock_finish(mock);
+}
+
+static void
+script_replies(gint fd)
+{
+    GByteArray *data = g_byte_array_new();
+    gchar **words = mock_read(fd);
+    gchar *ssid;
+
+    g_assert_cmpuint(g_strv_length(words), ==, 3);
+    g_assert_cmpstr(words[0], ==, "/interface/wireless/scan");
+    g_assert_cmpstr(words[1], ==, "=.id=wlan1");
+    g_assert_cmpstr(words[2], ==, ".tag=7");
+    g_strfreev(words);
+
+    /* Every prefix width, sent one byte at a time */
+    mock_word(data, "!re", 1);
+    mock_word(data, "=address=4C:5E:0C:11:22:33", 2);
+    mock_word(data, "=privacy=yes", 3);
+    mock_word(data, ".tag=7", 4);
+    mock_word(data, "=sig=-71", 5);
+    ssid = g_strnfill(200, 'a');
+    memcpy(ssid, "=ssid=", 6);
+    mock_word(data, ssid, 2);
+    g_free(ssid);
+    mock_word(data, "", 1);
+    mock_send(fd, data, TRUE);
+
+    /* Replies to the other tags are interleaved */
+    mock_sentence(fd, (const gchar*[]){ "!re", ".tag=8", "=address=00:00:00:00:00:01", NULL });
+    mock_sentence(fd, (const gchar*[]){ "!trap", ".tag=7", "=category=2", "=message=interrupted", NULL });
+    mock_sentence(fd, (const gchar*[]){ "!done", ".tag=7", NULL });
+    mock_sentence(fd, (const gchar*[]){ "!fatal", "session terminated on request", NULL });
+}
+
+static void
+test_replies(void)
+{
+    mock_t *mock = mock_start(script_replies);
+    mt_api_t *api = test_connect(mock);
+    mt_api_reply_t *reply;
+    const gchar *ssid;
+    guint i;
+
+    g_assert_true(mt_api_send(api, (const gchar*[]){ "/interface/wireless/scan", "=.id=wlan1", ".tag=7", NULL }));
+
+    reply = test_read(api);
+    g_assert_cmpint(mt_api_reply_get_type(reply), ==, MT_API_REPLY_RE);
+    g_assert_cmpstr(mt_api_reply_get_tag(reply), ==, "7");
+    g_assert_cmpstr(mt_api_reply_get(reply, "address"), ==, "4C:5E:0C:11:22:33");
+    g_assert_cmpstr(mt_api_reply_get(reply, "sig"), ==, "-71");
+    g_assert_true(mt_api_reply_get_boolean(reply, "privacy"));
+    g_assert_false(mt_api_reply_get_boolean(reply, "missing"));
+    ssid = mt_api_reply_get(reply, "ssid");
+    g_assert_cmpuint(strlen(ssid), ==, 194);
+    for(i=0; ssid[i]; i++)
+        g_assert_cmpint(ssid[i], ==, 'a');
+    mt_api_reply_free(reply);
+
+    reply = test_read(api);
+    g_assert_cmpint(mt_api_reply_get_type(reply), ==, MT_API_REPLY_RE);
+    g_assert_cmpstr(mt_api_reply_get_tag(reply), ==, "8");
+    mt_api_reply_free(reply);
+
+    reply = test_read(api);
+    g_assert_cmpint(mt_api_reply_get_type(reply), ==, MT_API_REPLY_TRAP);
+    g_assert_cmpstr(mt_api_reply_get_tag(reply), ==, "7");
+    g_assert_cmpstr(mt_api_reply_get(reply, "message"), ==, "interrupted");
+    mt_api_reply_free(reply);
+
+    reply = test_read(api);
+    g_assert_cmpint(mt_api_reply_get_type(reply), ==, MT_API_REPLY_DONE);
+    g_assert_cmpstr(mt_api_reply_get_tag(reply), ==, "7");
+    mt_api_reply_free(reply);
+
+    reply = test_read(api);
+    g_assert_cmpint(mt_api_reply_get_type(reply), ==, MT_API_REPLY_FATAL);
+    g_assert_null(mt_api_reply_get_tag(reply));
+    g_assert_cmpstr(mt_api_reply_get(reply, "message"), ==, "session terminated on request");
+    mt_api_reply_free(reply);
+
+    mock_finish(mock);
+
+    /* The connection is closed after !fatal */
+    reply = NULL;
+    while(mt_api_read(api, TEST_READ_MSEC, &reply) == 0);
+    g_assert_null(reply);
+
+    mt_api_free(api);
+}
+
+static void
+script_long_words(gint fd)
+{
+    gchar **words = mock_read(fd);
+    gchar *length;
+    gsize i;
+
+    /* 0x4000 and more needs a 3-byte prefix */
+    g_assert_cmpuint(g_strv_length(words), ==, 3);
+    g_assert_cmpstr(words[0], ==, "/test");
+    g_assert_cmpuint(strlen(words[1]), ==, 0x80);
+    g_assert_cmpuint(strlen(words[2]), ==, 0x4000);
+    for(i=0; i<0x4000; i++)
+        g_assert_cmpint(words[2][i], ==, 'x');
+
+    length = g_strdup_printf("=length=%zu", strlen(words[1]) + strlen(words[2]));
+    mock_sentence(fd, (const gchar*[]){ "!done", length, NULL });
+    g_free(length);
+    g_strfreev(words);
+}
+
+static void
+test_long_words(void)
+{
+    mock_t *mock = mock_start(script_long_words);
+    mt_api_t *api = test_connect(mock);
+    mt_api_reply_t *reply;
+    gchar *medium = g_strnfill(0x80, 'm');
+    gchar *large = g_strnfill(0x4000, 'x');
+
+    g_assert_true(mt_api_send(api, (const gchar*[]){ "/test", medium, large, NULL }));
+    g_free(medium);
+    g_free(large);
+
+    reply = test_read(api);
+    g_assert_cmpint(mt_api_reply_get_type(reply), ==, MT_API_REPLY_DONE);
+    g_assert_cmpstr(mt_api_reply_get(reply, "length"), ==, "16512");
+    mt_api_reply_free(reply);
+
+    mt_api_free(api);
+    mock_finish(mock);
+}
+
+static void
+script_oversized(gint fd)
+{
+    GByteArray *data = g_byte_array_new();
+    const guint8 header[] = { 0xE0, 0x20, 0x00, 0x00 };
+
+    g_strfreev(mock_read(fd));
+
+    /* A 2 MiB word is over the limit, the client must give up */
+    g_byte_array_append(data, header, sizeof(header));
+    mock_send(fd, data, FALSE);
+}
+
+static void
+test_oversized(void)
+{
+    mock_t *mock = mock_start(script_oversized);
+    mt_api_t *api = test_connect(mock);
+    mt_api_reply_t *reply = NULL;
+    gint ret;
+
+    g_assert_true(mt_api_send(api, (const gchar*[]){ "/test", NULL }));
+    while(!(ret = mt_api_read(api, TEST_READ_MSEC, &reply)));
+    g_assert_cmpint(ret, ==, -1);
+
+    mt_api_free(api);
+    mock_finish(mock);
+}
+
+gint
+main(gint   argc,
+     gchar *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/mt-api/login-plain", test_login_plain);
+    g_test_add_func("/mt-api/login-md5", test_login_md5);
+    g_test_add_func("/mt-api/login-trap", test_login_trap);
+    g_test_add_func("/mt-api/login-fatal", test_login_fatal);
+    g_test_add_func("/mt-api/replies", test_replies);
+    g_test_add_func("/mt-api/long-words", test_long_words);
+    g_test_add_func("/mt-api/oversized", test_oversized);
+    return g_test_run();
+}
@@ -0,0 +1,152 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include "track.h"
+
+/* Points outside of the track are accepted only this close to its ends */
+#define TRACK_LOOKUP_MARGIN 5
+
+static guint mtscan_track_search(const mtscan_track_t*, gint64);
+
+mtscan_track_t*
+mtscan_track_new(void)
+{
+    mtscan_track_t *track = g_malloc(sizeof(mtscan_track_t));
+    track->points = g_array_new(FALSE, FALSE, sizeof(track_point_t));
+    return track;
+}
+
+void
+mtscan_track_free(mtscan_track_t *track)
+{
+    g_array_free(track->points, TRUE);
+    g_free(track);
+}
+
+void
+mtscan_track_clear(mtscan_track_t *track)
+{
+    g_array_set_size(track->points, 0);
+}
+
+void
+mtscan_track_add(mtscan_track_t      *track,
+                 const track_point_t *point)
+{
+    const track_point_t *last;
+    guint index;
+
+    last = mtscan_track_last(track);
+    if(!last || last->timestamp < point->timestamp)
+    {
+        /* Recorded points always come in order */
+        g_array_append_vals(track->points, point, 1);
+        return;
+    }
+
+    /* Merged tracks are kept sorted, one point per second */
+    index = mtscan_track_search(track, point->timestamp);
+    if(index < track->points->len &&
+       g_array_index(track->points, track_point_t, index).timestamp == point->timestamp)
+        return;
+
+    g_array_insert_vals(track->points, index, point, 1);
+}
+
+guint
+mtscan_track_count(const mtscan_track_t *track)
+{
+    return track->points->len;
+}
+
+const track_point_t*
+mtscan_track_get(const mtscan_track_t *track,
+                 guint                 index)
+{
+    if(index >= track->points->len)
+        return NULL;
+    return &g_array_index(track->points, track_point_t, index);
+}
+
+const track_point_t*
+mtscan_track_last(const mtscan_track_t *track)
+{
+    if(!track->points->len)
+        return NULL;
+    return &g_array_index(track->points, track_point_t, track->points->len - 1);
+}
+
+gboolean
+mtscan_track_lookup(const mtscan_track_t *track,
+                    gint64                timestamp,
+                    gdouble              *lat,
+                    gdouble              *lon)
+{
+    const track_point_t *prev;
+    const track_point_t *next;
+    gdouble ratio;
+    guint index;
+
+    if(!track->points->len)
+        return FALSE;
+
+    index = mtscan_track_search(track, timestamp);
+    next = mtscan_track_get(track, index);
+    prev = (index ? mtscan_track_get(track, index - 1) : NULL);
+
+    if(next && next->timestamp == timestamp)
+        prev = next;
+    else if(!prev)
+        prev = (next->timestamp - timestamp <= TRACK_LOOKUP_MARGIN ? next : NULL);
+    else if(!next)
+        prev = (timestamp - prev->timestamp <= TRACK_LOOKUP_MARGIN ? prev : NULL);
+    else if(next->timestamp - prev->timestamp > 2 * MTSCAN_TRACK_INTERVAL_MAX)
+        prev = NULL; /* The position was lost in between */
+
+    if(!prev)
+        return FALSE;
+
+    if(!next || prev == next)
+    {
+        *lat = prev->latitude;
+        *lon = prev->longitude;
+        return TRUE;
+    }
+
+    ratio = (gdouble)(timestamp - prev->timestamp) / (gdouble)(next->timestamp - prev->timestamp);
+    *lat = prev->latitude + ratio * (next->latitude - prev->latitude);
+    *lon = prev->longitude + ratio * (next->longitude - prev->longitude);
+    return TRUE;
+}
+
+static guint
+mtscan_track_search(const mtscan_track_t *track,
+                    gint64                timestamp)
+{
+    guint low = 0;
+    guint high = track->points->len;
+    guint mid;
+
+    /* Index of the first point not older than the timestamp */
+    while(low < high)
+    {
+        mid = low + (high - low) / 2;
+        if(g_array_index(track->points, track_point_t, mid).timestamp < timestamp)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
@@ -0,0 +1,46 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_TRACK_H_
+#define MTSCAN_TRACK_H_
+#include <glib.h>
+
+/* Longest interval between two recorded points */
+#define MTSCAN_TRACK_INTERVAL_MAX 30
+
+typedef struct track_point
+{
+    gint64 timestamp;
+    gdouble latitude;
+    gdouble longitude;
+    gdouble speed;
+    gdouble accuracy;
+} track_point_t;
+
+typedef struct mtscan_track
+{
+    GArray *points;
+} mtscan_track_t;
+
+mtscan_track_t* mtscan_track_new(void);
+void mtscan_track_free(mtscan_track_t*);
+void mtscan_track_clear(mtscan_track_t*);
+void mtscan_track_add(mtscan_track_t*, const track_point_t*);
+guint mtscan_track_count(const mtscan_track_t*);
+const track_point_t* mtscan_track_get(const mtscan_track_t*, guint);
+const track_point_t* mtscan_track_last(const mtscan_track_t*);
+gboolean mtscan_track_lookup(const mtscan_track_t*, gint64, gdouble*, gdouble*);
+
+#endif
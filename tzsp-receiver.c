@@ -4,8 +4,51 @@
 #include "tzsp/tzsp-sniffer.h"
 #include "tzsp/mac80211.h"
 #include "network.h"
+#include "station.h"
+#include "ring.h"
+#include "blacklist.h"
+#include "msgbus.h"
 #include "tzsp-receiver.h"
 
+#define TZSP_RECEIVER_MAX_WORKERS      8
+#define TZSP_RECEIVER_QUEUE_LIMIT   4096
+#define TZSP_RECEIVER_RING_SIZE     8192
+#define TZSP_RECEIVER_RING_WAIT_US  1000
+#define TZSP_RECEIVER_RING_WAIT_MAX  100
+#define TZSP_RECEIVER_DRAIN_MS       100
+#define TZSP_RECEIVER_CACHE_LIMIT   4096
+
+/* Client stations are reported once a second at most,
+   unless they move to another access point */
+#define TZSP_RECEIVER_STATION_RING_SIZE  4096
+#define TZSP_RECEIVER_STATION_INTERVAL_US G_USEC_PER_SEC
+#define TZSP_RECEIVER_STATION_LIMIT      4096
+
+/* Beacon and probe response fields that change in every frame */
+#define TZSP_RECEIVER_FRAME_SEQ_OFFSET  22
+#define TZSP_RECEIVER_FRAME_BODY_OFFSET 32
+#define TZSP_RECEIVER_FRAME_SRC_OFFSET  10
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME        16777619U
+
+typedef struct tzsp_receiver_sensor
+{
+    guint8 hw_addr[6];
+    gchar *name;
+    guint32 src;
+    GAsyncQueue *queue;
+} tzsp_receiver_sensor_t;
+
+typedef struct tzsp_receiver_worker
+{
+    tzsp_receiver_t *context;
+    GAsyncQueue *queue;
+    ring_t *ring;
+    GHashTable *cache;
+    GThread *thread;
+} tzsp_receiver_worker_t;
+
 typedef struct tzsp_receiver
 {
     tzsp_socket_t *tzsp_socket;
@@ -14,32 +57,93 @@ typedef struct tzsp_receiver
     gint frequency_base;
     void (*cb_final)(tzsp_receiver_t*);
     void (*cb_network)(const tzsp_receiver_t*, network_t*);
-    uint8_t hw_addr[6];
+    void (*cb_station)(const tzsp_receiver_t*, station_t*);
+    tzsp_receiver_sensor_t *sensors;
+    guint sensors_count;
+    tzsp_receiver_worker_t workers[TZSP_RECEIVER_MAX_WORKERS];
+    guint workers_count;
+    guint drain_source;
+    ring_t *station_ring;
+    GHashTable *station_rate;
+    blacklist_t *blacklist;
+    volatile gint unknown_sensor;
+    volatile gint filtered;
+    volatile gint blacklisted;
+    volatile gint dropped_frames;
+    volatile gint parse_errors;
+    volatile gint dropped_networks;
+    volatile gint dropped_stations;
+    gint networks;
+    gint stations;
 } tzsp_receiver_t;
 
-typedef struct tzsp_receiver_net
+typedef struct tzsp_receiver_frame
 {
-    tzsp_receiver_t *context;
+    const tzsp_receiver_sensor_t *sensor;
+    gint64 timestamp;
+    gboolean rssi_valid;
+    gint8 rssi;
+    gboolean channel_valid;
+    guint8 channel;
+    guint32 len;
+    guint8 data[];
+} tzsp_receiver_frame_t;
+
+typedef struct tzsp_receiver_cache
+{
+    gint64 address;
+    guint32 hash;
+    gboolean channel_valid;
+    guint8 channel;
     network_t *network;
-} tzsp_receiver_net_t;
+    guint32 len;
+    guint8 data[];
+} tzsp_receiver_cache_t;
+
+typedef struct tzsp_receiver_station_rate
+{
+    gint64 address;
+    gint64 bssid;
+    gint64 next;
+} tzsp_receiver_station_rate_t;
 
 static gpointer tzsp_receiver_thread(gpointer);
-static void tzsp_receiver_packet(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, gpointer);
-static gboolean tzsp_receiver_callback_network(gpointer);
+static gpointer tzsp_receiver_worker(gpointer);
+static void tzsp_receiver_packet(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, uint32_t, gpointer);
+static tzsp_receiver_sensor_t* tzsp_receiver_sensor_lookup(tzsp_receiver_t*, const uint8_t*, uint32_t);
+static gboolean tzsp_receiver_station(tzsp_receiver_t*, const tzsp_receiver_sensor_t*, const uint8_t*, uint32_t, const int8_t*);
+static network_t* tzsp_receiver_parse(const tzsp_receiver_t*, const tzsp_receiver_frame_t*);
+static guint32 tzsp_receiver_cache_hash(const tzsp_receiver_frame_t*);
+static gboolean tzsp_receiver_cache_match(const tzsp_receiver_cache_t*, const tzsp_receiver_frame_t*, guint32);
+static gint64 tzsp_receiver_cache_address(const tzsp_receiver_frame_t*);
+static network_t* tzsp_receiver_cache_lookup(tzsp_receiver_worker_t*, const tzsp_receiver_frame_t*);
+static void tzsp_receiver_cache_store(tzsp_receiver_worker_t*, const tzsp_receiver_frame_t*, const network_t*);
+static void tzsp_receiver_cache_free(gpointer);
+static gboolean tzsp_receiver_drain(gpointer);
 static gboolean tzsp_receiver_callback_final(gpointer);
 
+/* Marks the end of the work for a parser thread */
+static tzsp_receiver_frame_t tzsp_receiver_frame_quit;
+
 tzsp_receiver_t*
 tzsp_receiver_new(guint16       udp_port,
                   const gchar  *pcap_dev_if,
-                  guint8        hw_addr[6],
+                  const guint8 *hw_addr,
+                  guint         hw_addr_count,
                   gint          channel_width,
                   gint          frequency_base,
                   void        (*cb_final) (tzsp_receiver_t*),
-                  void        (*cb_network)(const tzsp_receiver_t*, network_t*))
+                  void        (*cb_network)(const tzsp_receiver_t*, network_t*),
+                  void        (*cb_station)(const tzsp_receiver_t*, station_t*))
 {
     tzsp_socket_t *socket = NULL;
     tzsp_sniffer_t *sniffer = NULL;
     tzsp_receiver_t *context;
+    tzsp_receiver_sensor_t *sensor;
+    guint i;
+
+    if(!hw_addr_count)
+        return NULL;
 
     if(pcap_dev_if)
     {
@@ -47,7 +151,7 @@ tzsp_receiver_new(guint16       udp_port,
         sniffer = tzsp_sniffer_new();
         printf("tzsp_sniffer_new failed\n");
         if(sniffer == NULL ||
-           tzsp_sniffer_init(sniffer, udp_port, NULL, NULL, pcap_dev_if, 0) != TZSP_SNIFFER_OK)
+           tzsp_sniffer_init(sniffer, udp_port, NULL, pcap_dev_if, 0) != TZSP_SNIFFER_OK)
         {
             printf("tzsp_sniffer_init failed: %s\n", tzsp_sniffer_get_error(sniffer));
             tzsp_sniffer_free(sniffer);
@@ -58,7 +162,7 @@ tzsp_receiver_new(guint16       udp_port,
     {
         socket = tzsp_socket_new();
         if(socket == NULL ||
-           tzsp_socket_init(socket, udp_port, NULL, NULL) != TZSP_SOCKET_OK)
+           tzsp_socket_init(socket, udp_port, NULL) != TZSP_SOCKET_OK)
         {
             tzsp_socket_free(socket);
             return NULL;
@@ -78,11 +182,47 @@ tzsp_receiver_new(guint16       udp_port,
         tzsp_socket_set_func(socket, tzsp_receiver_packet, context);
     }
 
-    memcpy(context->hw_addr, hw_addr, 6);
     context->channel_width = channel_width;
     context->frequency_base = frequency_base;
     context->cb_final = cb_final;
     context->cb_network = cb_network;
+    context->cb_station = cb_station;
+
+    /* Station table is optional, the frames are filtered out otherwise */
+    if(cb_station)
+    {
+        context->station_ring = ring_new(TZSP_RECEIVER_STATION_RING_SIZE);
+        context->station_rate = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, g_free);
+    }
+
+    /* Parse frames on a worker pool, one worker per sensor at most */
+    context->workers_count = MIN(hw_addr_count, MIN(g_get_num_processors(), TZSP_RECEIVER_MAX_WORKERS));
+    context->workers_count = MAX(context->workers_count, 1);
+    for(i=0; i<context->workers_count; i++)
+    {
+        context->workers[i].context = context;
+        context->workers[i].queue = g_async_queue_new();
+        context->workers[i].ring = ring_new(TZSP_RECEIVER_RING_SIZE);
+        context->workers[i].cache = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, tzsp_receiver_cache_free);
+        context->workers[i].thread = g_thread_new("tzsp_receiver_worker", tzsp_receiver_worker, &context->workers[i]);
+    }
+
+    /* Frames from one sensor are always handled by the same worker */
+    context->sensors = g_new0(tzsp_receiver_sensor_t, hw_addr_count);
+    context->sensors_count = hw_addr_count;
+    for(i=0; i<hw_addr_count; i++)
+    {
+        sensor = &context->sensors[i];
+        memcpy(sensor->hw_addr, hw_addr + i*6, 6);
+        sensor->name = g_strdup_printf("%02X:%02X:%02X:%02X:%02X:%02X",
+                                       sensor->hw_addr[0], sensor->hw_addr[1], sensor->hw_addr[2],
+                                       sensor->hw_addr[3], sensor->hw_addr[4], sensor->hw_addr[5]);
+        sensor->src = 0;
+        sensor->queue = context->workers[i % context->workers_count].queue;
+    }
+
+    /* Parsed networks are collected by the main loop at a fixed cadence */
+    context->drain_source = g_timeout_add(TZSP_RECEIVER_DRAIN_MS, tzsp_receiver_drain, context);
 
     g_thread_unref(g_thread_new("tzsp_receiver_thread", tzsp_receiver_thread, context));
     return context;
@@ -91,6 +231,34 @@ tzsp_receiver_new(guint16       udp_port,
 void
 tzsp_receiver_free(tzsp_receiver_t *context)
 {
+    station_t *station;
+    guint i;
+
+    for(i=0; i<context->sensors_count; i++)
+        g_free(context->sensors[i].name);
+    g_free(context->sensors);
+
+    for(i=0; i<context->workers_count; i++)
+    {
+        g_async_queue_unref(context->workers[i].queue);
+        ring_free(context->workers[i].ring);
+        g_hash_table_destroy(context->workers[i].cache);
+    }
+
+    if(context->station_ring)
+    {
+        while((station = ring_pop(context->station_ring)))
+        {
+            station_free(station);
+            g_free(station);
+        }
+        ring_free(context->station_ring);
+        g_hash_table_destroy(context->station_rate);
+    }
+
+    if(context->blacklist)
+        blacklist_unref(context->blacklist);
+
     g_free(context);
 }
 
@@ -98,13 +266,78 @@ static gpointer
 tzsp_receiver_thread(gpointer user_data)
 {
     tzsp_receiver_t *context = (tzsp_receiver_t*)user_data;
+    guint i;
 
     if(context->tzsp_sniffer)
         tzsp_sniffer_loop(context->tzsp_sniffer);
     else if(context->tzsp_socket)
         tzsp_socket_loop(context->tzsp_socket);
 
-    g_idle_add(tzsp_receiver_callback_final, context);
+    /* Let the workers finish already queued frames */
+    for(i=0; i<context->workers_count; i++)
+        g_async_queue_push(context->workers[i].queue, &tzsp_receiver_frame_quit);
+    for(i=0; i<context->workers_count; i++)
+        g_thread_join(context->workers[i].thread);
+
+    msgbus_post(MSGBUS_QUEUE_TASK, tzsp_receiver_callback_final, context);
+    return NULL;
+}
+
+static gpointer
+tzsp_receiver_worker(gpointer user_data)
+{
+    tzsp_receiver_worker_t *worker = (tzsp_receiver_worker_t*)user_data;
+    tzsp_receiver_frame_t *frame;
+    network_t *network;
+    gint wait;
+
+    while((frame = g_async_queue_pop(worker->queue)) != &tzsp_receiver_frame_quit)
+    {
+        /* Unchanged beacons are not parsed again */
+        network = tzsp_receiver_cache_lookup(worker, frame);
+        if(!network)
+        {
+            network = tzsp_receiver_parse(worker->context, frame);
+            if(network)
+                tzsp_receiver_cache_store(worker, frame, network);
+        }
+
+        if(!network)
+        {
+            g_atomic_int_inc(&worker->context->parse_errors);
+            g_free(frame);
+            continue;
+        }
+
+        /* Fill the signal level value */
+        if(frame->rssi_valid)
+            network->rssi = frame->rssi;
+
+        network->captured = frame->timestamp;
+        network->firstseen = frame->timestamp / G_USEC_PER_SEC;
+        network->lastseen = network->firstseen;
+
+        /* Tag the network with the sensor that heard it */
+        network->source = g_strdup(frame->sensor->name);
+        g_free(frame);
+
+        /* Network must be added from main thread, hold on
+           for a while if the main loop falls behind */
+        for(wait=0; !ring_push(worker->ring, network); wait++)
+        {
+            if(wait == TZSP_RECEIVER_RING_WAIT_MAX)
+            {
+                g_atomic_int_inc(&worker->context->dropped_networks);
+                network_free(network);
+                g_free(network);
+                break;
+            }
+            g_usleep(TZSP_RECEIVER_RING_WAIT_US);
+        }
+    }
+
+    /* Release the airMAX AC keys of this thread */
+    ie_airmax_ac_cache_clear();
     return NULL;
 }
 
@@ -114,201 +347,487 @@ tzsp_receiver_packet(const uint8_t *packet,
                      const int8_t  *rssi,
                      const uint8_t *channel,
                      const uint8_t *sensor_mac,
+                     uint32_t       sensor_ip,
                      gpointer       user_data)
 {
     /* Function called from the TZSP thread */
     tzsp_receiver_t *context = (tzsp_receiver_t*)user_data;
-    mac80211_net_t *net_80211 = NULL;
-    nv2_net_t *net_nv2 = NULL;
-    const uint8_t *src;
-    tzsp_receiver_net_t *data;
+    tzsp_receiver_sensor_t *sensor;
+    tzsp_receiver_frame_t *frame;
+
+    /* Make sure that the packet comes from one of the desired sensors */
+    sensor = tzsp_receiver_sensor_lookup(context, sensor_mac, sensor_ip);
+    if(!sensor)
+    {
+        g_atomic_int_inc(&context->unknown_sensor);
+        return;
+    }
+
+    /* Client stations need the header only, handle them right here */
+    if(context->cb_station &&
+       tzsp_receiver_station(context, sensor, packet, len, rssi))
+        return;
+
+    /* Only beacons, probe responses and nv2 frames are parsed,
+       do not bother the workers with anything else */
+    if(len < 2 ||
+       (packet[0] != 0x80 && packet[0] != 0x50 &&
+        (packet[0] != 0x08 || packet[1] != 0x90)))
+    {
+        g_atomic_int_inc(&context->filtered);
+        return;
+    }
 
-    /* Ignore pre-6.41 TZSP packets with no sensor address included */
-    if(sensor_mac == NULL)
+    /* Drop blacklisted networks before anything gets allocated,
+       the snapshot is fetched again only when it was replaced */
+    context->blacklist = blacklist_refresh(context->blacklist);
+    if(len >= TZSP_RECEIVER_FRAME_SRC_OFFSET + 6 &&
+       blacklist_match(context->blacklist, tzsp_receiver_address(packet + TZSP_RECEIVER_FRAME_SRC_OFFSET)))
+    {
+        g_atomic_int_inc(&context->blacklisted);
         return;
+    }
 
-    /* Make sure that sensor address matches the desired one */
-    if(memcmp(sensor_mac, context->hw_addr, 6) != 0)
+    /* The workers fall behind, drop the frame instead of queuing it */
+    if(g_async_queue_length(sensor->queue) >= TZSP_RECEIVER_QUEUE_LIMIT)
+    {
+        g_atomic_int_inc(&context->dropped_frames);
         return;
+    }
+
+    frame = g_malloc(sizeof(tzsp_receiver_frame_t) + len);
+    frame->sensor = sensor;
+    frame->timestamp = g_get_real_time();
+    frame->rssi_valid = (rssi != NULL);
+    frame->rssi = (rssi ? *rssi : 0);
+    frame->channel_valid = (channel != NULL);
+    frame->channel = (channel ? *channel : 0);
+    frame->len = len;
+    memcpy(frame->data, packet, len);
+
+    /* Parse the frame on a worker thread */
+    g_async_queue_push(sensor->queue, frame);
+}
+
+static tzsp_receiver_sensor_t*
+tzsp_receiver_sensor_lookup(tzsp_receiver_t *context,
+                            const uint8_t   *sensor_mac,
+                            uint32_t         sensor_ip)
+{
+    tzsp_receiver_sensor_t *sensor;
+    guint i;
+
+    for(i=0; i<context->sensors_count; i++)
+    {
+        sensor = &context->sensors[i];
+        if(sensor_mac)
+        {
+            if(memcmp(sensor_mac, sensor->hw_addr, 6) == 0)
+            {
+                /* Remember the UDP source of the sensor */
+                if(sensor_ip)
+                    sensor->src = sensor_ip;
+                return sensor;
+            }
+        }
+        else if(sensor_ip && sensor->src == sensor_ip)
+        {
+            /* Pre-6.41 TZSP packets with no sensor address included,
+               match them by UDP source of a previously identified sensor */
+            return sensor;
+        }
+    }
+    return NULL;
+}
+
+static gboolean
+tzsp_receiver_station(tzsp_receiver_t              *context,
+                      const tzsp_receiver_sensor_t *sensor,
+                      const uint8_t                *packet,
+                      uint32_t                      len,
+                      const int8_t                 *rssi)
+{
+    /* Function called from the TZSP thread */
+    tzsp_receiver_station_rate_t *rate;
+    mac80211_sta_t sta;
+    station_t *station;
+    gint64 address;
+    gint64 bssid;
+    gint64 now;
+
+    if(!mac80211_station(&sta, packet, len))
+        return FALSE;
+
+    address = tzsp_receiver_address(sta.address);
+    bssid = (sta.bssid_valid ? tzsp_receiver_address(sta.bssid) : -1);
+    now = g_get_monotonic_time();
+
+    rate = g_hash_table_lookup(context->station_rate, &address);
+    if(rate &&
+       now < rate->next &&
+       (bssid < 0 || bssid == rate->bssid))
+    {
+        /* Nothing new about this station yet */
+        return TRUE;
+    }
+
+    if(!rate)
+    {
+        if(g_hash_table_size(context->station_rate) >= TZSP_RECEIVER_STATION_LIMIT)
+            g_hash_table_remove_all(context->station_rate);
+
+        rate = g_malloc(sizeof(tzsp_receiver_station_rate_t));
+        rate->address = address;
+        rate->bssid = -1;
+        g_hash_table_insert(context->station_rate, &rate->address, rate);
+    }
+
+    if(bssid >= 0)
+        rate->bssid = bssid;
+    rate->next = now + TZSP_RECEIVER_STATION_INTERVAL_US;
+
+    station = g_malloc(sizeof(station_t));
+    station_init(station);
+    station->address = address;
+    station->bssid = bssid;
+    station->ssid = (sta.ssid[0] ? g_strdup(sta.ssid) : NULL);
+    if(rssi)
+        station->rssi = *rssi;
+    station->firstseen = g_get_real_time() / 1000000;
+    station->lastseen = station->firstseen;
+    station->source = g_strdup(sensor->name);
+
+    if(!ring_push(context->station_ring, station))
+    {
+        /* Allow the next frame through, the main loop is busy */
+        rate->next = now;
+        g_atomic_int_inc(&context->dropped_stations);
+        station_free(station);
+        g_free(station);
+    }
+    return TRUE;
+}
+
+gint64
+tzsp_receiver_address(const guint8 *addr)
+{
+    return ((gint64)addr[0] << 40) | ((gint64)addr[1] << 32) | ((gint64)addr[2] << 24) |
+           ((gint64)addr[3] << 16) | ((gint64)addr[4] << 8) | (gint64)addr[5];
+}
+
+static network_t*
+tzsp_receiver_parse(const tzsp_receiver_t       *context,
+                    const tzsp_receiver_frame_t *frame)
+{
+    /* Function called from a worker thread */
+    return tzsp_receiver_network(frame->data,
+                                 frame->len,
+                                 (frame->channel_valid ? &frame->channel : NULL),
+                                 context->channel_width,
+                                 context->frequency_base);
+}
+
+network_t*
+tzsp_receiver_network(const guint8 *data,
+                      guint32       len,
+                      const guint8 *channel,
+                      gint          channel_width,
+                      gint          frequency_base)
+{
+    mac80211_net_t net_80211_data;
+    nv2_net_t net_nv2_data;
+    mac80211_net_t *net_80211 = NULL;
+    nv2_net_t *net_nv2 = NULL;
+    const uint8_t *src;
+    network_t *network;
 
     /* Try nv2 parser */
-    net_nv2 = nv2_network(packet, len, &src);
-    if(!net_nv2)
+    if(nv2_network(&net_nv2_data, data, len, &src))
+        net_nv2 = &net_nv2_data;
+    else
     {
         /* Try mac80211 parser */
-        net_80211 = mac80211_network(packet, len, &src);
-        if(!net_80211)
+        if(!mac80211_network(&net_80211_data, data, len, &src))
         {
-            /* This is not a IEEE 802.11 frame at all */
-            return;
+            /* This is not a IEEE 802.11 beacon or probe response */
+            return NULL;
         }
+        net_80211 = &net_80211_data;
 
         if(net_80211->source != MAC80211_FRAME_BEACON &&
            net_80211->source != MAC80211_FRAME_PROBE_RESPONSE)
         {
             /* This is other IEEE 802.11 frame */
-            mac80211_net_free(net_80211);
-            return;
+            return NULL;
         }
     }
 
-    data = g_malloc(sizeof(tzsp_receiver_net_t));
-    data->context = context;
-    data->network = g_malloc(sizeof(network_t));
-    network_init(data->network);
+    network = g_malloc(sizeof(network_t));
+    network_init(network);
 
     /* Fill the BSSID address */
-    data->network->address  = (gint64) src[0] << 40;
-    data->network->address |= (gint64) src[1] << 32;
-    data->network->address |= (gint64) src[2] << 24;
-    data->network->address |= (gint64) src[3] << 16;
-    data->network->address |= (gint64) src[4] << 8;
-    data->network->address |= (gint64) src[5] << 0;
-
-    /* Fill the signal level value */
-    if(rssi)
-        data->network->rssi = *rssi;
+    network->address  = (gint64) src[0] << 40;
+    network->address |= (gint64) src[1] << 32;
+    network->address |= (gint64) src[2] << 24;
+    network->address |= (gint64) src[3] << 16;
+    network->address |= (gint64) src[4] << 8;
+    network->address |= (gint64) src[5] << 0;
 
     if(net_80211)
     {
         if(net_80211->ie_mikrotik)
         {
-            if(!data->network->radioname)
-                data->network->radioname = g_strdup(ie_mikrotik_get_radioname(net_80211->ie_mikrotik));
-
-            if(!data->network->routeros_ver)
-                data->network->routeros_ver = g_strdup(ie_mikrotik_get_version(net_80211->ie_mikrotik));
-
-            data->network->frequency = ie_mikrotik_get_frequency(net_80211->ie_mikrotik) * 1000;
-            data->network->flags.routeros = TRUE;
-            data->network->flags.nstreme = ie_mikrotik_is_nstreme(net_80211->ie_mikrotik);
-            data->network->flags.tdma = FALSE;
-            data->network->flags.wds = ie_mikrotik_is_wds(net_80211->ie_mikrotik);
-            data->network->flags.bridge = ie_mikrotik_is_bridge(net_80211->ie_mikrotik);
+            if(!network->radioname)
+                network->radioname = g_strdup(ie_mikrotik_get_radioname(net_80211->ie_mikrotik));
+
+            if(!network->routeros_ver)
+                network->routeros_ver = g_strdup(ie_mikrotik_get_version(net_80211->ie_mikrotik));
+
+            network->frequency = ie_mikrotik_get_frequency(net_80211->ie_mikrotik) * 1000;
+            network->flags.routeros = TRUE;
+            network->flags.nstreme = ie_mikrotik_is_nstreme(net_80211->ie_mikrotik);
+            network->flags.tdma = FALSE;
+            network->flags.wds = ie_mikrotik_is_wds(net_80211->ie_mikrotik);
+            network->flags.bridge = ie_mikrotik_is_bridge(net_80211->ie_mikrotik);
         }
 
-        data->network->ubnt_airmax = GPOINTER_TO_INT(net_80211->ie_airmax);
+        network->ubnt_airmax = net_80211->ie_airmax;
         if(net_80211->ie_airmax_ac)
         {
-            data->network->ubnt_airmax = TRUE;
+            network->ubnt_airmax = TRUE;
 
-            if(!data->network->ssid)
-                data->network->ssid = g_strdup(ie_airmax_ac_get_ssid(net_80211->ie_airmax_ac));
+            if(!network->ssid)
+                network->ssid = g_strdup(ie_airmax_ac_get_ssid(net_80211->ie_airmax_ac));
 
-            if(!data->network->radioname)
-                data->network->radioname = g_strdup(ie_airmax_ac_get_radioname(net_80211->ie_airmax_ac));
+            if(!network->radioname)
+                network->radioname = g_strdup(ie_airmax_ac_get_radioname(net_80211->ie_airmax_ac));
 
-            data->network->ubnt_ptp = ie_airmax_ac_is_ptp(net_80211->ie_airmax_ac);
-            data->network->ubnt_ptmp = ie_airmax_ac_is_ptmp(net_80211->ie_airmax_ac);
-            data->network->ubnt_mixed = ie_airmax_ac_is_mixed(net_80211->ie_airmax_ac);
+            network->ubnt_ptp = ie_airmax_ac_is_ptp(net_80211->ie_airmax_ac);
+            network->ubnt_ptmp = ie_airmax_ac_is_ptmp(net_80211->ie_airmax_ac);
+            network->ubnt_mixed = ie_airmax_ac_is_mixed(net_80211->ie_airmax_ac);
         }
 
-        if(!data->network->frequency && channel)
-            data->network->frequency = (*channel * 5 + context->frequency_base) * 1000;
+        if(!network->frequency && channel)
+            network->frequency = (*channel * 5 + frequency_base) * 1000;
 
-        if(!data->network->ssid)
-            data->network->ssid = g_strdup(net_80211->ssid);
+        if(!network->ssid)
+            network->ssid = g_strdup(mac80211_net_get_ssid(net_80211));
 
-        if(!data->network->radioname)
-            data->network->radioname = g_strdup(net_80211->radioname);
+        if(!network->radioname)
+            network->radioname = g_strdup(mac80211_net_get_radioname(net_80211));
 
-        data->network->streams = mac80211_net_get_chains(net_80211);
-        data->network->flags.privacy = mac80211_net_is_privacy(net_80211);
+        network->streams = mac80211_net_get_chains(net_80211);
+        network->flags.privacy = mac80211_net_is_privacy(net_80211);
 
-        if(!data->network->channel)
+        if(!network->channel)
         {
             if(mac80211_net_get_ext_channel(net_80211))
-                data->network->channel = g_strdup_printf("%d-%s", context->channel_width, mac80211_net_get_ext_channel(net_80211));
+                network->channel = g_strdup_printf("%d-%s", channel_width, mac80211_net_get_ext_channel(net_80211));
             else
-                data->network->channel = g_strdup_printf("%d", context->channel_width);
+                network->channel = g_strdup_printf("%d", channel_width);
         }
 
         if(mac80211_net_is_vht(net_80211))
-            data->network->mode = g_strdup("ac");
+            network->mode = g_strdup("ac");
         else if(mac80211_net_is_ht(net_80211))
         {
-            if(data->network->frequency &&
-               data->network->frequency < 3000000)
-                data->network->mode = g_strdup("gn");
+            if(network->frequency &&
+               network->frequency < 3000000)
+                network->mode = g_strdup("gn");
             else
-                data->network->mode = g_strdup("an");
+                network->mode = g_strdup("an");
         }
         else if(mac80211_net_is_ofdm(net_80211))
         {
-            if(data->network->frequency &&
-               data->network->frequency < 3000000)
-                data->network->mode = g_strdup("g");
+            if(network->frequency &&
+               network->frequency < 3000000)
+                network->mode = g_strdup("g");
             else
-                data->network->mode = g_strdup("a");
+                network->mode = g_strdup("a");
         }
         else if(mac80211_net_is_dsss(net_80211))
         {
-            data->network->mode = g_strdup("b");
+            network->mode = g_strdup("b");
         }
-        nv2_net_free(net_nv2);
-        mac80211_net_free(net_80211);
     }
 
     if(net_nv2)
     {
-        data->network->ssid = g_strdup(nv2_net_get_ssid(net_nv2));
-        data->network->radioname = g_strdup(nv2_net_get_radioname(net_nv2));
-        data->network->routeros_ver = g_strdup(nv2_net_get_version(net_nv2));
+        network->ssid = g_strdup(nv2_net_get_ssid(net_nv2));
+        network->radioname = g_strdup(nv2_net_get_radioname(net_nv2));
+        network->routeros_ver = g_strdup(nv2_net_get_version(net_nv2));
 
         if(nv2_net_get_frequency(net_nv2))
-            data->network->frequency = nv2_net_get_frequency(net_nv2) * 1000;
+            network->frequency = nv2_net_get_frequency(net_nv2) * 1000;
 
-        data->network->flags.privacy = nv2_net_is_privacy(net_nv2);
-        data->network->flags.routeros = TRUE;
-        data->network->flags.nstreme = FALSE;
-        data->network->flags.tdma = TRUE;
-        data->network->flags.wds = nv2_net_is_wds(net_nv2);
-        data->network->flags.bridge = nv2_net_is_bridge(net_nv2);
+        network->flags.privacy = nv2_net_is_privacy(net_nv2);
+        network->flags.routeros = TRUE;
+        network->flags.nstreme = FALSE;
+        network->flags.tdma = TRUE;
+        network->flags.wds = nv2_net_is_wds(net_nv2);
+        network->flags.bridge = nv2_net_is_bridge(net_nv2);
 
         if(nv2_net_get_ext_channel(net_nv2))
-            data->network->channel = g_strdup_printf("%d-%s", context->channel_width, nv2_net_get_ext_channel(net_nv2));
+            network->channel = g_strdup_printf("%d-%s", channel_width, nv2_net_get_ext_channel(net_nv2));
         else
-            data->network->channel = g_strdup_printf("%d", context->channel_width);
+            network->channel = g_strdup_printf("%d", channel_width);
 
-        data->network->streams = nv2_net_get_chains(net_nv2);
+        network->streams = nv2_net_get_chains(net_nv2);
 
         if(nv2_net_is_vht(net_nv2))
-            data->network->mode = g_strdup("ac");
+            network->mode = g_strdup("ac");
         else if(nv2_net_is_ht(net_nv2))
         {
             if(nv2_net_get_frequency(net_nv2) < 3000)
-                data->network->mode = g_strdup("gn");
+                network->mode = g_strdup("gn");
             else
-                data->network->mode = g_strdup("an");
+                network->mode = g_strdup("an");
         }
         else if(nv2_net_get_frequency(net_nv2) < 3000)
         {
             if(nv2_net_is_ofdm(net_nv2))
-                data->network->mode = g_strdup("g");
+                network->mode = g_strdup("g");
             else
-                data->network->mode = g_strdup("b");
+                network->mode = g_strdup("b");
         }
         else
         {
-            data->network->mode = g_strdup("a");
+            network->mode = g_strdup("a");
         }
-        nv2_net_free(net_nv2);
     }
 
-    data->network->firstseen = g_get_real_time() / 1000000;
-    data->network->lastseen = data->network->firstseen;
+    return network;
+}
+
+static guint32
+tzsp_receiver_cache_hash(const tzsp_receiver_frame_t *frame)
+{
+    guint32 hash = FNV_OFFSET_BASIS;
+    guint32 i;
 
-    /* Network must be added from main thread */
-    g_idle_add(tzsp_receiver_callback_network, data);
+    /* Skip the sequence number and the timestamp */
+    for(i=0; i<TZSP_RECEIVER_FRAME_SEQ_OFFSET; i++)
+    {
+        hash ^= frame->data[i];
+        hash *= FNV_PRIME;
+    }
+    for(i=TZSP_RECEIVER_FRAME_BODY_OFFSET; i<frame->len; i++)
+    {
+        hash ^= frame->data[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
 }
 
 static gboolean
-tzsp_receiver_callback_network(gpointer user_data)
+tzsp_receiver_cache_match(const tzsp_receiver_cache_t *entry,
+                          const tzsp_receiver_frame_t *frame,
+                          guint32                      hash)
 {
-    tzsp_receiver_net_t *data = (tzsp_receiver_net_t*)user_data;
-    data->context->cb_network(data->context, data->network);
-    g_free(data);
-    return G_SOURCE_REMOVE;
+    return (entry->hash == hash &&
+            entry->len == frame->len &&
+            entry->channel_valid == frame->channel_valid &&
+            entry->channel == frame->channel &&
+            memcmp(entry->data, frame->data, TZSP_RECEIVER_FRAME_SEQ_OFFSET) == 0 &&
+            memcmp(entry->data + TZSP_RECEIVER_FRAME_BODY_OFFSET,
+                   frame->data + TZSP_RECEIVER_FRAME_BODY_OFFSET,
+                   frame->len - TZSP_RECEIVER_FRAME_BODY_OFFSET) == 0);
+}
+
+static gint64
+tzsp_receiver_cache_address(const tzsp_receiver_frame_t *frame)
+{
+    return tzsp_receiver_address(frame->data + TZSP_RECEIVER_FRAME_SRC_OFFSET);
+}
+
+static network_t*
+tzsp_receiver_cache_lookup(tzsp_receiver_worker_t      *worker,
+                           const tzsp_receiver_frame_t *frame)
+{
+    tzsp_receiver_cache_t *entry;
+    gint64 address;
+
+    /* Only beacons and probe responses are cached */
+    if(frame->len <= TZSP_RECEIVER_FRAME_BODY_OFFSET ||
+       (frame->data[0] != 0x80 && frame->data[0] != 0x50))
+        return NULL;
+
+    address = tzsp_receiver_cache_address(frame);
+    entry = g_hash_table_lookup(worker->cache, &address);
+    if(!entry || !tzsp_receiver_cache_match(entry, frame, tzsp_receiver_cache_hash(frame)))
+        return NULL;
+
+    return network_dup(entry->network);
+}
+
+static void
+tzsp_receiver_cache_store(tzsp_receiver_worker_t      *worker,
+                          const tzsp_receiver_frame_t *frame,
+                          const network_t             *network)
+{
+    tzsp_receiver_cache_t *entry;
+
+    if(frame->len <= TZSP_RECEIVER_FRAME_BODY_OFFSET ||
+       (frame->data[0] != 0x80 && frame->data[0] != 0x50))
+        return;
+
+    if(g_hash_table_size(worker->cache) >= TZSP_RECEIVER_CACHE_LIMIT)
+        g_hash_table_remove_all(worker->cache);
+
+    entry = g_malloc(sizeof(tzsp_receiver_cache_t) + frame->len);
+    entry->address = tzsp_receiver_cache_address(frame);
+    entry->hash = tzsp_receiver_cache_hash(frame);
+    entry->channel_valid = frame->channel_valid;
+    entry->channel = frame->channel;
+    entry->network = network_dup(network);
+    entry->len = frame->len;
+    memcpy(entry->data, frame->data, frame->len);
+
+    /* The key is a part of the entry, replace it as well */
+    g_hash_table_replace(worker->cache, &entry->address, entry);
+}
+
+static void
+tzsp_receiver_cache_free(gpointer data)
+{
+    tzsp_receiver_cache_t *entry = (tzsp_receiver_cache_t*)data;
+
+    network_free(entry->network);
+    g_free(entry->network);
+    g_free(entry);
+}
+
+static gboolean
+tzsp_receiver_drain(gpointer user_data)
+{
+    tzsp_receiver_t *context = (tzsp_receiver_t*)user_data;
+    network_t *network;
+    station_t *station;
+    guint count;
+    guint i;
+
+    for(i=0; i<context->workers_count; i++)
+    {
+        /* Take only what is already there, so that a busy
+           worker cannot keep the main loop here forever */
+        count = ring_length(context->workers[i].ring);
+        while(count-- && (network = ring_pop(context->workers[i].ring)))
+        {
+            context->networks++;
+            context->cb_network(context, network);
+        }
+    }
+
+    if(context->station_ring)
+    {
+        count = ring_length(context->station_ring);
+        while(count-- && (station = ring_pop(context->station_ring)))
+        {
+            context->stations++;
+            context->cb_station(context, station);
+        }
+    }
+    return G_SOURCE_CONTINUE;
 }
 
 static gboolean
@@ -316,6 +835,11 @@ tzsp_receiver_callback_final(gpointer user_data)
 {
     tzsp_receiver_t *context = (tzsp_receiver_t*)user_data;
 
+    /* All workers are finished, collect the remaining networks */
+    g_source_remove(context->drain_source);
+    context->drain_source = 0;
+    tzsp_receiver_drain(context);
+
     if(context->tzsp_sniffer)
     {
         tzsp_sniffer_free(context->tzsp_sniffer);
@@ -349,6 +873,34 @@ tzsp_receiver_disable(tzsp_receiver_t *context)
         tzsp_socket_disable(context->tzsp_socket);
 }
 
+void
+tzsp_receiver_get_stats(const tzsp_receiver_t *context,
+                        tzsp_receiver_stats_t *stats)
+{
+    /* Function called from the main thread */
+    memset(stats, 0, sizeof(tzsp_receiver_stats_t));
+
+    if(context->tzsp_sniffer)
+    {
+        stats->kernel_dropped = tzsp_sniffer_get_dropped(context->tzsp_sniffer);
+        stats->invalid = tzsp_sniffer_get_invalid(context->tzsp_sniffer);
+    }
+    else if(context->tzsp_socket)
+    {
+        stats->kernel_dropped = tzsp_socket_get_dropped(context->tzsp_socket);
+        stats->invalid = tzsp_socket_get_invalid(context->tzsp_socket);
+    }
+
+    stats->unknown_sensor = g_atomic_int_get(&context->unknown_sensor);
+    stats->filtered = g_atomic_int_get(&context->filtered);
+    stats->blacklisted = g_atomic_int_get(&context->blacklisted);
+    stats->queue_dropped = g_atomic_int_get(&context->dropped_frames);
+    stats->parse_errors = g_atomic_int_get(&context->parse_errors);
+    stats->ring_dropped = g_atomic_int_get(&context->dropped_networks) + g_atomic_int_get(&context->dropped_stations);
+    stats->networks = context->networks;
+    stats->stations = context->stations;
+}
+
 void
 tzsp_receiver_cancel(tzsp_receiver_t *context)
 {
@@ -3,17 +3,37 @@
 
 typedef struct tzsp_receiver tzsp_receiver_t;
 
+/* Frames lost or rejected at every stage of the receiver */
+typedef struct tzsp_receiver_stats
+{
+    guint kernel_dropped;
+    guint invalid;
+    guint unknown_sensor;
+    guint filtered;
+    guint blacklisted;
+    guint queue_dropped;
+    guint parse_errors;
+    guint ring_dropped;
+    guint networks;
+    guint stations;
+} tzsp_receiver_stats_t;
+
 tzsp_receiver_t* tzsp_receiver_new(guint16,
                                    const gchar*,
-                                   guint8[6],
+                                   const guint8*,
+                                   guint,
                                    gint,
                                    gint,
                                    void (*)(tzsp_receiver_t*),
-                                   void (*)(const tzsp_receiver_t*, network_t*));
+                                   void (*)(const tzsp_receiver_t*, network_t*),
+                                   void (*)(const tzsp_receiver_t*, station_t*));
 void tzsp_receiver_free(tzsp_receiver_t*);
 void tzsp_receiver_enable(tzsp_receiver_t*);
 void tzsp_receiver_disable(tzsp_receiver_t*);
 void tzsp_receiver_cancel(tzsp_receiver_t*);
+void tzsp_receiver_get_stats(const tzsp_receiver_t*, tzsp_receiver_stats_t*);
+network_t* tzsp_receiver_network(const guint8*, guint32, const guint8*, gint, gint);
+gint64 tzsp_receiver_address(const guint8*);
 
 
 #endif
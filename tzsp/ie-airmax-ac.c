@@ -15,10 +15,11 @@
 
 /* Based on reverse engineering, may be not fully accurate */
 
+#include <openssl/evp.h>
 #include <openssl/hmac.h>
 #include <openssl/sha.h>
-#include <openssl/aes.h>
 #include <string.h>
+#include <stdlib.h>
 #include "ie-airmax-ac.h"
 #include "utils.h"
 
@@ -41,80 +42,202 @@
 #define IE_AIRMAX_AC_TAG_RADIONAME  0x01
 #define IE_AIRMAX_AC_TAG_SSID       0x02
 
-typedef struct ie_airmax_ac
+#define IE_AIRMAX_AC_BLOCK_LEN   16
+#define IE_AIRMAX_AC_CACHE_SIZE  32
+
+typedef struct ie_airmax_ac_key
+{
+    uint8_t addr[6];
+    EVP_CIPHER_CTX *ctx;
+    uint32_t used;
+    /* Last decrypted payload */
+    uint8_t len;
+    uint8_t cipher[UINT8_MAX];
+    uint8_t plain[UINT8_MAX];
+} ie_airmax_ac_key_t;
+
+typedef struct ie_airmax_ac_cache
+{
+    ie_airmax_ac_key_t keys[IE_AIRMAX_AC_CACHE_SIZE];
+    uint32_t clock;
+} ie_airmax_ac_cache_t;
+
+/* Every parser thread keeps its own key schedules */
+static __thread ie_airmax_ac_cache_t *ie_airmax_ac_cache;
+
+static ie_airmax_ac_key_t* ie_airmax_ac_key(const uint8_t[6]);
+static bool ie_airmax_ac_decrypt(ie_airmax_ac_key_t*, const uint8_t*, uint8_t, uint8_t*);
+static void ie_airmax_ac_process_data(ie_airmax_ac_t*, const uint8_t*, uint8_t);
+static void ie_airmax_ac_tag_radioname(ie_airmax_ac_t*, uint8_t, const uint8_t*);
+static void ie_airmax_ac_tag_ssid(ie_airmax_ac_t*, uint8_t, const uint8_t*);
+
+static void (*const ie_airmax_ac_tags[UINT8_MAX+1])(ie_airmax_ac_t*, uint8_t, const uint8_t*) =
 {
-    uint8_t mode;
-    char *radioname;
-    char *ssid;
-} ie_airmax_ac_t;
-
-static ie_airmax_ac_t* ie_airmax_ac_process_data(const uint8_t*, uint8_t);
-static void ie_airmax_ac_process_tag(ie_airmax_ac_t*, uint8_t, uint8_t, const uint8_t*);
-
-ie_airmax_ac_t*
-ie_airmax_ac_parse(const uint8_t *ie,
-                   uint8_t        ie_len,
-                   const uint8_t  addr[6])
+    [IE_AIRMAX_AC_TAG_RADIONAME] = ie_airmax_ac_tag_radioname,
+    [IE_AIRMAX_AC_TAG_SSID]      = ie_airmax_ac_tag_ssid
+};
+
+bool
+ie_airmax_ac_parse(ie_airmax_ac_t *context,
+                   const uint8_t  *ie,
+                   uint8_t         ie_len,
+                   const uint8_t   addr[6])
 {
     static const uint8_t magic[] = { 0x00, 0x27, 0x22, 0xff, 0xff, 0xff, 0x02, 0x01, 0x00 };
-    static const uint8_t hmac_key[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
     uint8_t data[UINT8_MAX];
     uint8_t data_len;
-    uint8_t hmac[SHA_DIGEST_LENGTH];
-    AES_KEY aes_key;
-    int i;
+    ie_airmax_ac_key_t *key;
 
     if(ie_len < IE_AIRMAX_AC_HEADER_LEN + IE_AIRMAX_AC_DATA_HEADER_LEN)
-        return NULL;
+        return false;
 
     /* The IE must start with a magic byte sequence */
     if(memcmp(magic, ie, sizeof(magic)) != 0)
-        return NULL;
+        return false;
 
     data_len = ie[IE_AIRMAX_AC_DATA_LEN_IDX];
 
     /* Data must be aligned to 128-bit blocks */
-    if(data_len % 16)
-        return NULL;
+    if(data_len % IE_AIRMAX_AC_BLOCK_LEN)
+        return false;
 
     /* The IE length must match the data length */
     if(IE_AIRMAX_AC_HEADER_LEN + data_len < ie_len)
-        return NULL;
+        return false;
 
-    /* Generate the AES key */
-    if(HMAC(EVP_sha1(), hmac_key, 6, addr, 6, hmac, NULL))
+    key = ie_airmax_ac_key(addr);
+    if(key == NULL)
+        return false;
+
+    if(!ie_airmax_ac_decrypt(key, ie + IE_AIRMAX_AC_HEADER_LEN, data_len, data))
+        return false;
+
+    /* Verify the data */
+    if(memcmp(data+IE_AIRMAX_AC_ADDR1, addr, 6) != 0 ||
+       memcmp(data+IE_AIRMAX_AC_ADDR2, addr, 6) != 0)
     {
-        /* The AES uses only 128 bits (16B) of the HMAC-SHA1 hash */
-        AES_set_decrypt_key(hmac, 128, &aes_key);
+        return false;
+    }
+
+    ie_airmax_ac_process_data(context, data, data_len);
+    return true;
+}
 
-        /* Decrypt each 128-bit data block */
-        for(i=0; i<data_len; i+=16)
-            AES_decrypt(ie + IE_AIRMAX_AC_HEADER_LEN + i, data + i, &aes_key);
+void
+ie_airmax_ac_cache_clear(void)
+{
+    int i;
 
-        /* Verify the data */
-        if(memcmp(data+IE_AIRMAX_AC_ADDR1, addr, 6) != 0 ||
-           memcmp(data+IE_AIRMAX_AC_ADDR2, addr, 6) != 0)
-        {
+    if(ie_airmax_ac_cache == NULL)
+        return;
+
+    for(i=0; i<IE_AIRMAX_AC_CACHE_SIZE; i++)
+        EVP_CIPHER_CTX_free(ie_airmax_ac_cache->keys[i].ctx);
+
+    free(ie_airmax_ac_cache);
+    ie_airmax_ac_cache = NULL;
+}
+
+static ie_airmax_ac_key_t*
+ie_airmax_ac_key(const uint8_t addr[6])
+{
+    static const uint8_t hmac_key[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    uint8_t hmac[SHA_DIGEST_LENGTH];
+    ie_airmax_ac_key_t *key;
+    ie_airmax_ac_key_t *lru;
+    int i;
+
+    if(ie_airmax_ac_cache == NULL)
+    {
+        ie_airmax_ac_cache = calloc(sizeof(ie_airmax_ac_cache_t), 1);
+        if(ie_airmax_ac_cache == NULL)
             return NULL;
+    }
+
+    ie_airmax_ac_cache->clock++;
+
+    lru = &ie_airmax_ac_cache->keys[0];
+    for(i=0; i<IE_AIRMAX_AC_CACHE_SIZE; i++)
+    {
+        key = &ie_airmax_ac_cache->keys[i];
+        if(key->ctx && memcmp(key->addr, addr, 6) == 0)
+        {
+            key->used = ie_airmax_ac_cache->clock;
+            return key;
         }
 
-        return ie_airmax_ac_process_data(data, data_len);
+        if(!key->ctx)
+            lru = key;
+        else if(lru->ctx && key->used < lru->used)
+            lru = key;
+    }
+
+    /* Generate the AES key, evicting the least recently used one */
+    if(!HMAC(EVP_sha1(), hmac_key, 6, addr, 6, hmac, NULL))
+        return NULL;
+
+    if(lru->ctx == NULL)
+    {
+        lru->ctx = EVP_CIPHER_CTX_new();
+        if(lru->ctx == NULL)
+            return NULL;
+    }
+
+    /* The AES uses only 128 bits (16B) of the HMAC-SHA1 hash */
+    if(!EVP_DecryptInit_ex(lru->ctx, EVP_aes_128_ecb(), NULL, hmac, NULL))
+    {
+        EVP_CIPHER_CTX_free(lru->ctx);
+        lru->ctx = NULL;
+        return NULL;
+    }
+    EVP_CIPHER_CTX_set_padding(lru->ctx, 0);
+
+    memcpy(lru->addr, addr, 6);
+    lru->used = ie_airmax_ac_cache->clock;
+    lru->len = 0;
+    return lru;
+}
+
+static bool
+ie_airmax_ac_decrypt(ie_airmax_ac_key_t *key,
+                     const uint8_t      *cipher,
+                     uint8_t             len,
+                     uint8_t            *plain)
+{
+    int out_len;
+
+    /* The payload usually repeats in every beacon */
+    if(key->len == len &&
+       memcmp(key->cipher, cipher, len) == 0)
+    {
+        memcpy(plain, key->plain, len);
+        return true;
+    }
+
+    /* Decrypt each 128-bit data block, keeping the key schedule */
+    if(!EVP_DecryptInit_ex(key->ctx, NULL, NULL, NULL, NULL) ||
+       !EVP_DecryptUpdate(key->ctx, plain, &out_len, cipher, len) ||
+       out_len != len)
+    {
+        key->len = 0;
+        return false;
     }
-    return NULL;
+
+    key->len = len;
+    memcpy(key->cipher, cipher, len);
+    memcpy(key->plain, plain, len);
+    return true;
 }
 
-static ie_airmax_ac_t*
-ie_airmax_ac_process_data(const uint8_t *data,
-                          uint8_t        data_len)
+static void
+ie_airmax_ac_process_data(ie_airmax_ac_t *context,
+                          const uint8_t  *data,
+                          uint8_t         data_len)
 {
-    ie_airmax_ac_t *context;
     uint8_t tag_len;
     int i;
 
-    context = calloc(sizeof(ie_airmax_ac_t), 1);
-    if(context == NULL)
-        return NULL;
-
+    memset(context, 0, sizeof(ie_airmax_ac_t));
     context->mode = data[IE_AIRMAX_AC_MODE];
 
     for(i=IE_AIRMAX_AC_DATA_HEADER_LEN;
@@ -128,30 +251,27 @@ ie_airmax_ac_process_data(const uint8_t *data,
         if((i + IE_AIRMAX_AC_TAG_HEADER_LEN + tag_len) > data_len)
             break;
 
-        ie_airmax_ac_process_tag(context, data[i], tag_len, data+i+IE_AIRMAX_AC_TAG_HEADER_LEN);
+        if(tag_len && ie_airmax_ac_tags[data[i]])
+            ie_airmax_ac_tags[data[i]](context, tag_len, data+i+IE_AIRMAX_AC_TAG_HEADER_LEN);
     }
+}
 
-    return context;
+static void
+ie_airmax_ac_tag_radioname(ie_airmax_ac_t *context,
+                           uint8_t         len,
+                           const uint8_t  *value)
+{
+    if(!context->radioname[0])
+        tzsp_utils_string(context->radioname, sizeof(context->radioname), value, len);
 }
 
 static void
-ie_airmax_ac_process_tag(ie_airmax_ac_t *context,
-                         uint8_t         type,
-                         uint8_t         len,
-                         const uint8_t  *value)
+ie_airmax_ac_tag_ssid(ie_airmax_ac_t *context,
+                      uint8_t         len,
+                      const uint8_t  *value)
 {
-    if(type == IE_AIRMAX_AC_TAG_RADIONAME &&
-       !context->radioname &&
-       len)
-    {
-        context->radioname = tzsp_utils_string(value, len);
-    }
-    else if(type == IE_AIRMAX_AC_TAG_SSID &&
-            !context->ssid &&
-            len)
-    {
-        context->ssid = tzsp_utils_string(value, len);
-    }
+    if(!context->ssid[0])
+        tzsp_utils_string(context->ssid, sizeof(context->ssid), value, len);
 }
 
 bool
@@ -177,22 +297,11 @@ ie_airmax_ac_is_mixed(ie_airmax_ac_t *context)
 const char*
 ie_airmax_ac_get_radioname(ie_airmax_ac_t *context)
 {
-    return context->radioname;
+    return (context->radioname[0] ? context->radioname : NULL);
 }
 
 const char*
 ie_airmax_ac_get_ssid(ie_airmax_ac_t *context)
 {
-    return context->ssid;
-}
-
-void
-ie_airmax_ac_free(ie_airmax_ac_t *context)
-{
-    if(context)
-    {
-        free(context->radioname);
-        free(context->ssid);
-        free(context);
-    }
+    return (context->ssid[0] ? context->ssid : NULL);
 }
@@ -17,10 +17,16 @@
 #define MTSCAN_TZSP_IE_AIRMAX_AC_H
 #include <stdint.h>
 #include <stdbool.h>
+#include "utils.h"
 
-typedef struct ie_airmax_ac ie_airmax_ac_t;
+typedef struct ie_airmax_ac
+{
+    uint8_t mode;
+    char radioname[TZSP_UTILS_STRING_MAX];
+    char ssid[TZSP_UTILS_STRING_MAX];
+} ie_airmax_ac_t;
 
-ie_airmax_ac_t* ie_airmax_ac_parse(const uint8_t*, uint8_t, const uint8_t[6]);
+bool ie_airmax_ac_parse(ie_airmax_ac_t*, const uint8_t*, uint8_t, const uint8_t[6]);
 
 bool ie_airmax_ac_is_ptp(ie_airmax_ac_t*);
 bool ie_airmax_ac_is_ptmp(ie_airmax_ac_t*);
@@ -29,6 +35,6 @@ bool ie_airmax_ac_is_mixed(ie_airmax_ac_t*);
 const char* ie_airmax_ac_get_radioname(ie_airmax_ac_t*);
 const char* ie_airmax_ac_get_ssid(ie_airmax_ac_t*);
 
-void ie_airmax_ac_free(ie_airmax_ac_t*);
+void ie_airmax_ac_cache_clear(void);
 
 #endif
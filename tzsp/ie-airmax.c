@@ -14,40 +14,24 @@
  */
 
 #include <string.h>
-#include <stdlib.h>
 #include "ie-airmax.h"
 
 #define IE_AIRMAX_LEN 38
 
-typedef struct ie_airmax
-{
-    uint8_t placeholder;
-} ie_airmax_t;
-
-ie_airmax_t*
+bool
 ie_airmax_parse(const uint8_t *ie,
                 uint8_t        ie_len)
 {
     static const uint8_t magic[] = { 0x00, 0x15, 0x6d, 0xff, 0xff, 0xff };
 
     if(ie_len != IE_AIRMAX_LEN)
-        return NULL;
+        return false;
 
     /* The IE must start with a magic byte sequence */
     if(memcmp(magic, ie, sizeof(magic)) != 0)
-        return NULL;
+        return false;
 
     /* TODO: reverse engineering */
 
-    return malloc(sizeof(ie_airmax_t));
-}
-
-void
-ie_airmax_free(ie_airmax_t *context)
-{
-    if(context)
-    {
-        /* ... */
-        free(context);
-    }
+    return true;
 }
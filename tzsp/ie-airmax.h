@@ -18,9 +18,6 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-typedef struct ie_airmax ie_airmax_t;
-
-ie_airmax_t* ie_airmax_parse(const uint8_t*, uint8_t);
-void ie_airmax_free(ie_airmax_t*);
+bool ie_airmax_parse(const uint8_t*, uint8_t);
 
 #endif
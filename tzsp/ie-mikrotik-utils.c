@@ -13,9 +13,9 @@
  *  GNU General Public License for more details.
  */
 
-#define _GNU_SOURCE
 #include <stdint.h>
 #include <stdio.h>
+#include "ie-mikrotik-utils.h"
 
 #define MIKROTIK_VERSION_ALPHA     'a'
 #define MIKROTIK_VERSION_BETA      'b'
@@ -24,32 +24,28 @@
 
 static const char* ie_mikrotik_version_separator(uint8_t);
 
-char*
-ie_mikrotik_version(uint8_t major,
-                    uint8_t minor,
-                    uint8_t type,
-                    uint8_t rev)
+void
+ie_mikrotik_version(char    *version,
+                    size_t   size,
+                    uint8_t  major,
+                    uint8_t  minor,
+                    uint8_t  type,
+                    uint8_t  rev)
 {
-    char *version;
-
     if(rev)
     {
-        if(asprintf(&version, "%d.%d%s%d",
-                    major,
-                    minor,
-                    ie_mikrotik_version_separator(type),
-                    rev) < 0)
-            version = NULL;
+        snprintf(version, size, "%d.%d%s%d",
+                 major,
+                 minor,
+                 ie_mikrotik_version_separator(type),
+                 rev);
     }
     else
     {
-        if(asprintf(&version, "%d.%d",
-                    major,
-                    minor) < 0)
-            version = NULL;
+        snprintf(version, size, "%d.%d",
+                 major,
+                 minor);
     }
-
-    return version;
 }
 
 static const char*
@@ -16,7 +16,10 @@
 #ifndef MTSCAN_TZSP_IE_MIKROTIK_UTILS_H
 #define MTSCAN_TZSP_IE_MIKROTIK_UTILS_H
 #include <stdint.h>
+#include <stddef.h>
 
-char* ie_mikrotik_version(uint8_t, uint8_t, uint8_t, uint8_t);
+#define IE_MIKROTIK_VERSION_LEN 32
+
+void ie_mikrotik_version(char*, size_t, uint8_t, uint8_t, uint8_t, uint8_t);
 
 #endif
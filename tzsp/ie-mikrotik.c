@@ -16,7 +16,6 @@
 /* Based on reverse engineering, may be not fully accurate */
 
 #include <string.h>
-#include <stdlib.h>
 #include "ie-mikrotik.h"
 #include "ie-mikrotik-utils.h"
 #include "utils.h"
@@ -45,7 +44,6 @@
 #define IE_MIKROTIK_DATA_FRAMER_LIMIT_H 27
 #define IE_MIKROTIK_DATA_NSTREME        28
 
-#define IE_MIKROTIK_DATA_RADIONAME_LEN  16
 
 #define IE_MIKROTIK_FLAGS1_NSTREME                (1 << 0)
 #define IE_MIKROTIK_FLAGS1_FAST_FRAMES            (1 << 1)
@@ -61,47 +59,39 @@
 #define IE_MIKROTIK_FREQUENCY_L 0
 #define IE_MIKROTIK_FREQUENCY_H 1
 
-typedef struct ie_mikrotik
+typedef struct ie_mikrotik_tag
 {
-    uint8_t flags1;
-    uint8_t flags2;
-    uint16_t mru;
-    uint16_t framer_limit;
-    uint16_t frequency;
-    char *radioname;
-    char *version;
-} ie_mikrotik_t;
-
-static ie_mikrotik_t* ie_mikrotik_process_data(const uint8_t*, uint8_t);
-static void ie_mikrotik_process_tag(ie_mikrotik_t*, uint8_t, uint8_t, const uint8_t*);
-
-ie_mikrotik_t*
-ie_mikrotik_parse(const uint8_t *ie,
+    void (*func)(ie_mikrotik_t*, const uint8_t*);
+    uint8_t len;
+} ie_mikrotik_tag_t;
+
+static void ie_mikrotik_tag_data(ie_mikrotik_t*, const uint8_t*);
+static void ie_mikrotik_tag_freq(ie_mikrotik_t*, const uint8_t*);
+
+static const ie_mikrotik_tag_t ie_mikrotik_tags[UINT8_MAX+1] =
+{
+    [IE_MIKROTIK_TAG_DATA] = { ie_mikrotik_tag_data, IE_MIKROTIK_TAG_DATA_LEN },
+    [IE_MIKROTIK_TAG_FREQ] = { ie_mikrotik_tag_freq, IE_MIKROTIK_TAG_FREQ_LEN }
+};
+
+bool
+ie_mikrotik_parse(ie_mikrotik_t *context,
+                  const uint8_t *ie,
                   uint8_t        ie_len)
 {
     static const uint8_t magic[] = { 0x00, 0x0c, 0x42, 0x00, 0x00, 0x00 };
+    const ie_mikrotik_tag_t *tag;
+    uint8_t tag_len;
+    int i;
 
     if(ie_len < IE_MIKROTIK_HEADER_LEN)
-        return NULL;
+        return false;
 
     /* The IE must start with a magic byte sequence */
     if(memcmp(magic, ie, sizeof(magic)) != 0)
-        return NULL;
+        return false;
 
-    return ie_mikrotik_process_data(ie, ie_len);
-}
-
-static ie_mikrotik_t*
-ie_mikrotik_process_data(const uint8_t *ie,
-                         uint8_t        ie_len)
-{
-    ie_mikrotik_t *context;
-    uint8_t tag_len;
-    int i;
-
-    context = calloc(sizeof(ie_mikrotik_t), 1);
-    if(context == NULL)
-        return NULL;
+    memset(context, 0, sizeof(ie_mikrotik_t));
 
     for(i=IE_MIKROTIK_HEADER_LEN;
         i+IE_MIKROTIK_TAG_HEADER_LEN <= ie_len;
@@ -111,49 +101,50 @@ ie_mikrotik_process_data(const uint8_t *ie,
         if((i + IE_MIKROTIK_TAG_HEADER_LEN + tag_len) > ie_len)
             break;
 
-        ie_mikrotik_process_tag(context, ie[i], tag_len, ie+i+IE_MIKROTIK_TAG_HEADER_LEN);
+        tag = &ie_mikrotik_tags[ie[i]];
+        if(tag->func && tag->len == tag_len)
+            tag->func(context, ie+i+IE_MIKROTIK_TAG_HEADER_LEN);
     }
 
-    return context;
+    return true;
 }
 
 static void
-ie_mikrotik_process_tag(ie_mikrotik_t *context,
-                        uint8_t        type,
-                        uint8_t        len,
-                        const uint8_t *value)
+ie_mikrotik_tag_data(ie_mikrotik_t *context,
+                     const uint8_t *value)
 {
-    if(type == IE_MIKROTIK_TAG_DATA &&
-       len == IE_MIKROTIK_TAG_DATA_LEN)
-    {
-        context->flags1 = value[IE_MIKROTIK_DATA_FLAGS1];
-        context->flags2 = value[IE_MIKROTIK_DATA_FLAGS2];
-
-        if(!context->version)
-        {
-            context->version = ie_mikrotik_version(value[IE_MIKROTIK_DATA_VERSION_MAJOR],
-                                                   value[IE_MIKROTIK_DATA_VERSION_MINOR],
-                                                   value[IE_MIKROTIK_DATA_VERSION_TYPE],
-                                                   value[IE_MIKROTIK_DATA_VERSION_REV]);
-        }
-
-        context->mru = (value[IE_MIKROTIK_DATA_MRU_H] << 8) |
-                        value[IE_MIKROTIK_DATA_MRU_L];
-
-        if(!context->radioname &&
-           *(value+IE_MIKROTIK_DATA_RADIONAME))
-            context->radioname = tzsp_utils_string(value+IE_MIKROTIK_DATA_RADIONAME,
-                                                   IE_MIKROTIK_DATA_RADIONAME_LEN);
-
-        context->framer_limit = (value[IE_MIKROTIK_DATA_FRAMER_LIMIT_H] << 8) |
-                                 value[IE_MIKROTIK_DATA_FRAMER_LIMIT_L];
-    }
-    else if(type == IE_MIKROTIK_TAG_FREQ &&
-            len == IE_MIKROTIK_TAG_FREQ_LEN)
+    context->flags1 = value[IE_MIKROTIK_DATA_FLAGS1];
+    context->flags2 = value[IE_MIKROTIK_DATA_FLAGS2];
+
+    if(!context->version[0])
     {
-        context->frequency = (value[IE_MIKROTIK_FREQUENCY_H] << 8) |
-                              value[IE_MIKROTIK_FREQUENCY_L];
+        ie_mikrotik_version(context->version,
+                            sizeof(context->version),
+                            value[IE_MIKROTIK_DATA_VERSION_MAJOR],
+                            value[IE_MIKROTIK_DATA_VERSION_MINOR],
+                            value[IE_MIKROTIK_DATA_VERSION_TYPE],
+                            value[IE_MIKROTIK_DATA_VERSION_REV]);
     }
+
+    context->mru = (value[IE_MIKROTIK_DATA_MRU_H] << 8) |
+                    value[IE_MIKROTIK_DATA_MRU_L];
+
+    if(!context->radioname[0])
+        tzsp_utils_string(context->radioname,
+                          sizeof(context->radioname),
+                          value+IE_MIKROTIK_DATA_RADIONAME,
+                          IE_MIKROTIK_RADIONAME_LEN);
+
+    context->framer_limit = (value[IE_MIKROTIK_DATA_FRAMER_LIMIT_H] << 8) |
+                             value[IE_MIKROTIK_DATA_FRAMER_LIMIT_L];
+}
+
+static void
+ie_mikrotik_tag_freq(ie_mikrotik_t *context,
+                     const uint8_t *value)
+{
+    context->frequency = (value[IE_MIKROTIK_FREQUENCY_H] << 8) |
+                          value[IE_MIKROTIK_FREQUENCY_L];
 }
 
 bool
@@ -194,22 +185,11 @@ ie_mikrotik_get_frequency(ie_mikrotik_t *context)
 const char*
 ie_mikrotik_get_radioname(ie_mikrotik_t *context)
 {
-    return context->radioname;
+    return (context->radioname[0] ? context->radioname : NULL);
 }
 
 const char*
 ie_mikrotik_get_version(ie_mikrotik_t *context)
 {
-    return context->version;
-}
-
-void
-ie_mikrotik_free(ie_mikrotik_t *context)
-{
-    if(context)
-    {
-        free(context->radioname);
-        free(context->version);
-        free(context);
-    }
+    return (context->version[0] ? context->version : NULL);
 }
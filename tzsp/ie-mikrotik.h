@@ -17,10 +17,22 @@
 #define MTSCAN_TZSP_IE_MIKROTIK_H
 #include <stdint.h>
 #include <stdbool.h>
+#include "ie-mikrotik-utils.h"
 
-typedef struct ie_mikrotik ie_mikrotik_t;
+#define IE_MIKROTIK_RADIONAME_LEN 16
 
-ie_mikrotik_t* ie_mikrotik_parse(const uint8_t*, uint8_t);
+typedef struct ie_mikrotik
+{
+    uint8_t flags1;
+    uint8_t flags2;
+    uint16_t mru;
+    uint16_t framer_limit;
+    uint16_t frequency;
+    char radioname[IE_MIKROTIK_RADIONAME_LEN+1];
+    char version[IE_MIKROTIK_VERSION_LEN];
+} ie_mikrotik_t;
+
+bool ie_mikrotik_parse(ie_mikrotik_t*, const uint8_t*, uint8_t);
 
 bool ie_mikrotik_is_nstreme(ie_mikrotik_t*);
 bool ie_mikrotik_is_wds(ie_mikrotik_t*);
@@ -32,6 +44,4 @@ uint16_t ie_mikrotik_get_frequency(ie_mikrotik_t*);
 const char* ie_mikrotik_get_radioname(ie_mikrotik_t*);
 const char* ie_mikrotik_get_version(ie_mikrotik_t*);
 
-void ie_mikrotik_free(ie_mikrotik_t*);
-
 #endif
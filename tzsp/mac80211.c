@@ -14,7 +14,6 @@
  */
 
 #include <string.h>
-#include <stdlib.h>
 #include <stdio.h>
 #ifdef _WIN32
 #include <Winsock2.h>
@@ -28,6 +27,13 @@
 #define MAC80211_ADDR_DST         4
 #define MAC80211_ADDR_SRC        10
 #define MAC80211_ADDR_BSSID      16
+#define MAC80211_ADDR_STA_BSSID   4
+
+#define MAC80211_FC_TYPE_MASK  0x0C
+#define MAC80211_FC_TYPE_DATA  0x08
+#define MAC80211_FC_DS_MASK    0x03
+#define MAC80211_FC_TO_DS      0x01
+#define MAC80211_FC_PROBE_REQ  0x40
 
 #define MAC80211_MGMT_HEADER_LEN 12
 #define MAC80211_MGMT_TAG_LEN     2
@@ -92,32 +98,120 @@
 #define VHT_CHANNEL_MODE_160  2
 #define VHT_CHANNEL_MODE_2x80 3
 
+typedef struct mac80211_tag
+{
+    void (*func)(mac80211_net_t*, uint8_t, const uint8_t*, const uint8_t*);
+    uint8_t min_len;
+    uint8_t max_len;
+} mac80211_tag_t;
+
 static int mac80211_frame(const uint8_t*, uint32_t);
+static void mac80211_probe_ssid(mac80211_sta_t*, const uint8_t*, uint32_t);
 static void mac80211_process(mac80211_net_t*, const uint8_t*, uint32_t);
-static void mac80211_process_tag(mac80211_net_t*, uint8_t, uint8_t, const uint8_t*, const uint8_t*);
+static void mac80211_tag_ssid(mac80211_net_t*, uint8_t, const uint8_t*, const uint8_t*);
+static void mac80211_tag_rates(mac80211_net_t*, uint8_t, const uint8_t*, const uint8_t*);
+static void mac80211_tag_ht_caps(mac80211_net_t*, uint8_t, const uint8_t*, const uint8_t*);
+static void mac80211_tag_ht_info(mac80211_net_t*, uint8_t, const uint8_t*, const uint8_t*);
+static void mac80211_tag_cisco(mac80211_net_t*, uint8_t, const uint8_t*, const uint8_t*);
+static void mac80211_tag_vht_caps(mac80211_net_t*, uint8_t, const uint8_t*, const uint8_t*);
+static void mac80211_tag_vht_info(mac80211_net_t*, uint8_t, const uint8_t*, const uint8_t*);
+static void mac80211_tag_vendor(mac80211_net_t*, uint8_t, const uint8_t*, const uint8_t*);
+
+static const mac80211_tag_t mac80211_tags[UINT8_MAX+1] =
+{
+    [MAC80211_MGMT_TAG_SSID]      = { mac80211_tag_ssid,     1,                               UINT8_MAX                       },
+    [MAC80211_MGMT_TAG_RATES]     = { mac80211_tag_rates,    1,                               UINT8_MAX                       },
+    [MAC80211_MGMT_TAG_RATES_EXT] = { mac80211_tag_rates,    1,                               UINT8_MAX                       },
+    [MAC80211_MGMT_TAG_HT_CAPS]   = { mac80211_tag_ht_caps,  MAC80211_MGMT_TAG_HT_CAPS_LEN,   MAC80211_MGMT_TAG_HT_CAPS_LEN   },
+    [MAC80211_MGMT_TAG_HT_INFO]   = { mac80211_tag_ht_info,  MAC80211_MGMT_TAG_HT_INFO_LEN,   MAC80211_MGMT_TAG_HT_INFO_LEN   },
+    [MAC80211_MGMT_TAG_CISCO]     = { mac80211_tag_cisco,    MAC80211_MGMT_TAG_CISCO_MIN_LEN, UINT8_MAX                       },
+    [MAC80211_MGMT_TAG_VHT_CAPS]  = { mac80211_tag_vht_caps, MAC80211_MGMT_TAG_VHT_CAPS_LEN,  MAC80211_MGMT_TAG_VHT_CAPS_LEN  },
+    [MAC80211_MGMT_TAG_VHT_INFO]  = { mac80211_tag_vht_info, MAC80211_MGMT_TAG_VHT_INFO_LEN,  MAC80211_MGMT_TAG_VHT_INFO_LEN  },
+    [MAC80211_MGMT_TAG_VENDOR_IE] = { mac80211_tag_vendor,   1,                               UINT8_MAX                       }
+};
+
+static const uint8_t mac80211_rates_dsss[UINT8_MAX+1] =
+{
+    [MAC80211_DSSS_RATE_1M]   = INTERNAL_DSSS_RATE_1M,
+    [MAC80211_DSSS_RATE_2M]   = INTERNAL_DSSS_RATE_2M,
+    [MAC80211_DSSS_RATE_5_5M] = INTERNAL_DSSS_RATE_5_5M,
+    [MAC80211_DSSS_RATE_11M]  = INTERNAL_DSSS_RATE_11M
+};
+
+static const uint8_t mac80211_rates_ofdm[UINT8_MAX+1] =
+{
+    [MAC80211_OFDM_RATE_6M]  = INTERNAL_OFDM_RATE_6M,
+    [MAC80211_OFDM_RATE_9M]  = INTERNAL_OFDM_RATE_9M,
+    [MAC80211_OFDM_RATE_12M] = INTERNAL_OFDM_RATE_12M,
+    [MAC80211_OFDM_RATE_18M] = INTERNAL_OFDM_RATE_18M,
+    [MAC80211_OFDM_RATE_24M] = INTERNAL_OFDM_RATE_24M,
+    [MAC80211_OFDM_RATE_36M] = INTERNAL_OFDM_RATE_36M,
+    [MAC80211_OFDM_RATE_48M] = INTERNAL_OFDM_RATE_48M,
+    [MAC80211_OFDM_RATE_54M] = INTERNAL_OFDM_RATE_54M
+};
 
-mac80211_net_t*
-mac80211_network(const uint8_t  *data,
+bool
+mac80211_network(mac80211_net_t *net,
+                 const uint8_t  *data,
                  uint32_t        len,
                  const uint8_t **src)
 {
-    mac80211_net_t *net;
     int frame;
 
     frame = mac80211_frame(data, len);
     if(frame == MAC80211_FRAME_INVALID)
-        return NULL;
+        return false;
 
     *src = data+MAC80211_ADDR_SRC;
 
     if(frame == MAC80211_FRAME_UNKNOWN)
-        return NULL;
+        return false;
 
-    net = calloc(sizeof(mac80211_net_t), 1);
+    memset(net, 0, sizeof(mac80211_net_t));
     net->source = frame;
 
     mac80211_process(net, data, len);
-    return net;
+    return true;
+}
+
+bool
+mac80211_station(mac80211_sta_t *sta,
+                 const uint8_t  *data,
+                 uint32_t        len)
+{
+    bool probe;
+
+    if(len < MAC80211_HEADER_LEN)
+        return false;
+
+    /* Cheap frame control check first, most of the traffic ends here */
+    if(data[0] == MAC80211_FC_PROBE_REQ)
+        probe = true;
+    else if((data[0] & MAC80211_FC_TYPE_MASK) == MAC80211_FC_TYPE_DATA &&
+            (data[1] & MAC80211_FC_DS_MASK) == MAC80211_FC_TO_DS)
+        probe = false;
+    else
+        return false;
+
+    /* Skip group addressed transmitters */
+    if(data[MAC80211_ADDR_SRC] & 0x01)
+        return false;
+
+    memset(sta, 0, sizeof(mac80211_sta_t));
+    sta->probe = probe;
+    memcpy(sta->address, data + MAC80211_ADDR_SRC, sizeof(sta->address));
+
+    if(probe)
+    {
+        mac80211_probe_ssid(sta, data + MAC80211_HEADER_LEN, len - MAC80211_HEADER_LEN);
+    }
+    else
+    {
+        /* ToDS data frame: addr1 is the BSSID of the associated AP */
+        memcpy(sta->bssid, data + MAC80211_ADDR_STA_BSSID, sizeof(sta->bssid));
+        sta->bssid_valid = true;
+    }
+    return true;
 }
 
 static int
@@ -150,6 +244,7 @@ mac80211_process(mac80211_net_t *context,
                  const uint8_t  *data,
                  uint32_t        len)
 {
+    const mac80211_tag_t *tag;
     const uint8_t *src;
     uint8_t data_type;
     uint8_t data_len;
@@ -172,144 +267,171 @@ mac80211_process(mac80211_net_t *context,
         {
             if ((i + MAC80211_MGMT_TAG_LEN + data_len) > len)
                 break;
-            mac80211_process_tag(context,
-                                 data_type,
-                                 data_len,
-                                 data+i+MAC80211_MGMT_TAG_LEN,
-                                 src);
+
+            tag = &mac80211_tags[data_type];
+            if(tag->func &&
+               data_len >= tag->min_len &&
+               data_len <= tag->max_len)
+            {
+                tag->func(context,
+                          data_len,
+                          data+i+MAC80211_MGMT_TAG_LEN,
+                          src);
+            }
         }
     }
 }
 
 static void
-mac80211_process_tag(mac80211_net_t *context,
-                     uint8_t         type,
-                     uint8_t         len,
-                     const uint8_t  *data,
-                     const uint8_t  *bssid)
+mac80211_probe_ssid(mac80211_sta_t *sta,
+                    const uint8_t  *data,
+                    uint32_t        len)
 {
-    static const uint8_t oui_epigram[] = { 0x00, 0x90, 0x4c };
+    uint32_t i;
+    uint8_t data_len;
 
-    if(type == MAC80211_MGMT_TAG_SSID &&
-       !context->ssid &&
-       len &&
-       data[0])
+    /* Probe request has no fixed parameters, tags start right after the header */
+    for(i=0;
+        i+MAC80211_MGMT_TAG_LEN <= len;
+        i+=MAC80211_MGMT_TAG_LEN + data_len)
     {
+        data_len = data[i+1];
+        if((i + MAC80211_MGMT_TAG_LEN + data_len) > len)
+            break;
 
-        context->ssid = tzsp_utils_string(data, len);
-    }
-    else if((type == MAC80211_MGMT_TAG_RATES ||
-             type == MAC80211_MGMT_TAG_RATES_EXT) &&
-            len)
-    {
-        int i;
-        for(i=0;i<len;i++)
+        if(data[i] == MAC80211_MGMT_TAG_SSID)
         {
-            int rate = data[i] & ~MAC80211_BASIC_RATE;
-            if(rate == MAC80211_DSSS_RATE_1M)
-                context->dsss_rates |= INTERNAL_DSSS_RATE_1M;
-            else if(rate == MAC80211_DSSS_RATE_2M)
-                context->dsss_rates |= INTERNAL_DSSS_RATE_2M;
-            else if(rate == MAC80211_DSSS_RATE_5_5M)
-                context->dsss_rates |= INTERNAL_DSSS_RATE_5_5M;
-            else if(rate == MAC80211_DSSS_RATE_11M)
-                context->dsss_rates |= INTERNAL_DSSS_RATE_11M;
-            else if(rate == MAC80211_OFDM_RATE_6M)
-                context->ofdm_rates |= INTERNAL_OFDM_RATE_6M;
-            else if(rate == MAC80211_OFDM_RATE_9M)
-                context->ofdm_rates |= INTERNAL_OFDM_RATE_9M;
-            else if(rate == MAC80211_OFDM_RATE_12M)
-                context->ofdm_rates |= INTERNAL_OFDM_RATE_12M;
-            else if(rate == MAC80211_OFDM_RATE_18M)
-                context->ofdm_rates |= INTERNAL_OFDM_RATE_18M;
-            else if(rate == MAC80211_OFDM_RATE_24M)
-                context->ofdm_rates |= INTERNAL_OFDM_RATE_24M;
-            else if(rate == MAC80211_OFDM_RATE_36M)
-                context->ofdm_rates |= INTERNAL_OFDM_RATE_36M;
-            else if(rate == MAC80211_OFDM_RATE_48M)
-                context->ofdm_rates |= INTERNAL_OFDM_RATE_48M;
-            else if(rate == MAC80211_OFDM_RATE_54M)
-                context->ofdm_rates |= INTERNAL_OFDM_RATE_54M;
+            if(data_len)
+                tzsp_utils_string(sta->ssid, sizeof(sta->ssid), data+i+MAC80211_MGMT_TAG_LEN, data_len);
+            break;
         }
     }
-    else if(type == MAC80211_MGMT_TAG_HT_CAPS &&
-            len == MAC80211_MGMT_TAG_HT_CAPS_LEN)
-    {
-        if(data[6])
-            context->ht_chains = 4;
-        else if(data[5])
-            context->ht_chains = 3;
-        else if(data[4])
-            context->ht_chains = 2;
-        else if(data[3])
-            context->ht_chains = 1;
-    }
-    else if(type == MAC80211_MGMT_TAG_HT_INFO &&
-            len == MAC80211_MGMT_TAG_HT_INFO_LEN)
-    {
-        context->ht = true;
-        context->ht_chan = data[MAC80211_HT_INFO_CHANNEL];
-        context->ht_mode = data[MAC80211_HT_INFO_SUBSET_1];
-    }
-    else if(type == MAC80211_MGMT_TAG_CISCO &&
-            len >= MAC80211_MGMT_TAG_CISCO_MIN_LEN)
-    {
-        context->radioname = tzsp_utils_string(data+10, 16);
-    }
-    else if(type == MAC80211_MGMT_TAG_VHT_CAPS &&
-            len == MAC80211_MGMT_TAG_VHT_CAPS_LEN)
+}
+
+static void
+mac80211_tag_ssid(mac80211_net_t *context,
+                  uint8_t         len,
+                  const uint8_t  *data,
+                  const uint8_t  *bssid)
+{
+    if(!context->ssid[0])
+        tzsp_utils_string(context->ssid, sizeof(context->ssid), data, len);
+}
+
+static void
+mac80211_tag_rates(mac80211_net_t *context,
+                   uint8_t         len,
+                   const uint8_t  *data,
+                   const uint8_t  *bssid)
+{
+    int i;
+
+    for(i=0; i<len; i++)
     {
-        uint16_t tx_mcs_map = (data[9] << 8) | data[8];
-        if((tx_mcs_map      & 0xC000) >> 14 != 0x03)
-            context->vht_chains = 8;
-        else if((tx_mcs_map & 0x3000) >> 12 != 0x03)
-            context->vht_chains = 7;
-        else if((tx_mcs_map & 0x0C00) >> 10 != 0x03)
-            context->vht_chains = 6;
-        else if((tx_mcs_map & 0x0300) >>  8 != 0x03)
-            context->vht_chains = 5;
-        else if((tx_mcs_map & 0x00C0) >>  6 != 0x03)
-            context->vht_chains = 4;
-        else if((tx_mcs_map & 0x0030) >>  4 != 0x03)
-            context->vht_chains = 3;
-        else if((tx_mcs_map & 0x000C) >>  2 != 0x03)
-            context->vht_chains = 2;
-        else if((tx_mcs_map & 0x0003) >>  0 != 0x03)
-            context->vht_chains = 1;
+        context->dsss_rates |= mac80211_rates_dsss[data[i] & ~MAC80211_BASIC_RATE];
+        context->ofdm_rates |= mac80211_rates_ofdm[data[i] & ~MAC80211_BASIC_RATE];
     }
-    else if(type == MAC80211_MGMT_TAG_VHT_INFO &&
-            len == MAC80211_MGMT_TAG_VHT_INFO_LEN)
+}
+
+static void
+mac80211_tag_ht_caps(mac80211_net_t *context,
+                     uint8_t         len,
+                     const uint8_t  *data,
+                     const uint8_t  *bssid)
+{
+    if(data[6])
+        context->ht_chains = 4;
+    else if(data[5])
+        context->ht_chains = 3;
+    else if(data[4])
+        context->ht_chains = 2;
+    else if(data[3])
+        context->ht_chains = 1;
+}
+
+static void
+mac80211_tag_ht_info(mac80211_net_t *context,
+                     uint8_t         len,
+                     const uint8_t  *data,
+                     const uint8_t  *bssid)
+{
+    context->ht = true;
+    context->ht_chan = data[MAC80211_HT_INFO_CHANNEL];
+    context->ht_mode = data[MAC80211_HT_INFO_SUBSET_1];
+}
+
+static void
+mac80211_tag_cisco(mac80211_net_t *context,
+                   uint8_t         len,
+                   const uint8_t  *data,
+                   const uint8_t  *bssid)
+{
+    tzsp_utils_string(context->radioname, sizeof(context->radioname), data+10, MAC80211_RADIONAME_LEN);
+}
+
+static void
+mac80211_tag_vht_caps(mac80211_net_t *context,
+                      uint8_t         len,
+                      const uint8_t  *data,
+                      const uint8_t  *bssid)
+{
+    uint16_t tx_mcs_map = (data[9] << 8) | data[8];
+    int chains;
+
+    /* Find the highest spatial stream that is supported */
+    for(chains=8; chains>0; chains--)
     {
-        context->vht = true;
-        context->vht_mode = data[0];
-        context->vht_chan0 = data[1];
-        context->vht_chan1 = data[2];
+        if(((tx_mcs_map >> ((chains-1)*2)) & 0x03) != 0x03)
+        {
+            context->vht_chains = chains;
+            break;
+        }
     }
-    else if(type == MAC80211_MGMT_TAG_VENDOR_IE &&
-            len)
+}
+
+static void
+mac80211_tag_vht_info(mac80211_net_t *context,
+                      uint8_t         len,
+                      const uint8_t  *data,
+                      const uint8_t  *bssid)
+{
+    context->vht = true;
+    context->vht_mode = data[0];
+    context->vht_chan0 = data[1];
+    context->vht_chan1 = data[2];
+}
+
+static void
+mac80211_tag_vendor(mac80211_net_t *context,
+                    uint8_t         len,
+                    const uint8_t  *data,
+                    const uint8_t  *bssid)
+{
+    static const uint8_t oui_epigram[] = { 0x00, 0x90, 0x4c };
+
+    if(len == 26 &&
+       memcmp(oui_epigram, data, sizeof(oui_epigram)) == 0 &&
+       data[3] == 0x34)
     {
-        if(len == 26 &&
-           memcmp(oui_epigram, data, sizeof(oui_epigram)) == 0 &&
-           data[3] == 0x34)
+        /* HT Additional Capabilities (802.11n draft) */
+        if(!context->ht)
         {
-            /* HT Additional Capabilities (802.11n draft) */
-            if(!context->ht)
-            {
-                context->ht = true;
-                context->ht_chan = data[4+MAC80211_HT_INFO_CHANNEL];
-                context->ht_mode = data[4+MAC80211_HT_INFO_SUBSET_1];
-            }
+            context->ht = true;
+            context->ht_chan = data[4+MAC80211_HT_INFO_CHANNEL];
+            context->ht_mode = data[4+MAC80211_HT_INFO_SUBSET_1];
         }
+    }
 
-        if(!context->ie_mikrotik)
-            context->ie_mikrotik = ie_mikrotik_parse(data, len);
+    if(!context->ie_mikrotik &&
+       ie_mikrotik_parse(&context->ie_mikrotik_data, data, len))
+        context->ie_mikrotik = &context->ie_mikrotik_data;
 
-        if(!context->ie_airmax)
-            context->ie_airmax = ie_airmax_parse(data, len);
+    if(!context->ie_airmax)
+        context->ie_airmax = ie_airmax_parse(data, len);
 
-        if(!context->ie_airmax_ac)
-            context->ie_airmax_ac = ie_airmax_ac_parse(data, len, bssid);
-    }
+    if(!context->ie_airmax_ac &&
+       ie_airmax_ac_parse(&context->ie_airmax_ac_data, data, len, bssid))
+        context->ie_airmax_ac = &context->ie_airmax_ac_data;
 }
 
 bool
@@ -349,6 +471,18 @@ mac80211_net_get_chains(mac80211_net_t *context)
             context->vht_chains : context->ht_chains);
 }
 
+const char*
+mac80211_net_get_ssid(mac80211_net_t *context)
+{
+    return (context->ssid[0] ? context->ssid : NULL);
+}
+
+const char*
+mac80211_net_get_radioname(mac80211_net_t *context)
+{
+    return (context->radioname[0] ? context->radioname : NULL);
+}
+
 const char*
 mac80211_net_get_ext_channel(mac80211_net_t *context)
 {
@@ -403,14 +537,3 @@ mac80211_net_get_ext_channel(mac80211_net_t *context)
 
     return NULL;
 }
-
-void
-mac80211_net_free(mac80211_net_t *context)
-{
-    free(context->ssid);
-    free(context->radioname);
-    ie_mikrotik_free(context->ie_mikrotik);
-    ie_airmax_free(context->ie_airmax);
-    ie_airmax_ac_free(context->ie_airmax_ac);
-    free(context);
-}
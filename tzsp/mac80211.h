@@ -19,6 +19,9 @@
 #include "ie-mikrotik.h"
 #include "nv2.h"
 #include "ie-airmax.h"
+#include "utils.h"
+
+#define MAC80211_RADIONAME_LEN 16
 
 enum
 {
@@ -31,8 +34,8 @@ enum
 typedef struct mac80211_net
 {
     int source;
-    char *ssid;
-    char *radioname;
+    char ssid[TZSP_UTILS_STRING_MAX];
+    char radioname[MAC80211_RADIONAME_LEN+1];
     uint16_t caps;
     uint8_t dsss_rates;
     uint8_t ofdm_rates;
@@ -45,12 +48,25 @@ typedef struct mac80211_net
     uint8_t vht_chan0;
     uint8_t vht_chan1;
     uint8_t vht_chains;
+    /* Point to the storage below if the IE is present */
     ie_mikrotik_t *ie_mikrotik;
-    ie_airmax_t *ie_airmax;
+    bool ie_airmax;
     ie_airmax_ac_t *ie_airmax_ac;
+    ie_mikrotik_t ie_mikrotik_data;
+    ie_airmax_ac_t ie_airmax_ac_data;
 } mac80211_net_t;
 
-mac80211_net_t* mac80211_network(const uint8_t *, uint32_t, const uint8_t **);
+typedef struct mac80211_sta
+{
+    uint8_t address[6];
+    uint8_t bssid[6];
+    bool bssid_valid;
+    bool probe;
+    char ssid[TZSP_UTILS_STRING_MAX];
+} mac80211_sta_t;
+
+bool mac80211_network(mac80211_net_t *, const uint8_t *, uint32_t, const uint8_t **);
+bool mac80211_station(mac80211_sta_t *, const uint8_t *, uint32_t);
 
 bool mac80211_net_is_privacy(mac80211_net_t *);
 bool mac80211_net_is_dsss(mac80211_net_t *);
@@ -59,8 +75,8 @@ bool mac80211_net_is_ht(mac80211_net_t *);
 bool mac80211_net_is_vht(mac80211_net_t *);
 
 uint8_t mac80211_net_get_chains(mac80211_net_t *);
+const char* mac80211_net_get_ssid(mac80211_net_t *);
+const char* mac80211_net_get_radioname(mac80211_net_t *);
 const char* mac80211_net_get_ext_channel(mac80211_net_t *);
 
-void mac80211_net_free(mac80211_net_t *);
-
 #endif
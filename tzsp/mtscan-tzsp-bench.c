@@ -0,0 +1,689 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+/* Micro-benchmark of the TZSP and IEEE 802.11 parsers on a synthetic corpus */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/sha.h>
+#include "tzsp-decap.h"
+#include "mac80211.h"
+#include "nv2.h"
+
+#define BENCH_FRAME_MAX     512
+#define BENCH_DEFAULT_NETS   64
+#define BENCH_DEFAULT_COUNT  1000000
+
+#define BENCH_TAG_SSID      0x00
+#define BENCH_TAG_RATES     0x01
+#define BENCH_TAG_HT_CAPS   0x2D
+#define BENCH_TAG_HT_INFO   0x3D
+#define BENCH_TAG_VHT_CAPS  0xBF
+#define BENCH_TAG_VHT_INFO  0xC0
+#define BENCH_TAG_VENDOR_IE 0xDD
+
+#define BENCH_AIRMAX_AC_HEADER_LEN 10
+#define BENCH_AIRMAX_AC_DATA_LEN   64
+
+enum
+{
+    BENCH_KIND_HT_MIKROTIK,
+    BENCH_KIND_VHT_PROBE,
+    BENCH_KIND_AIRMAX,
+    BENCH_KIND_AIRMAX_AC,
+    BENCH_KIND_NV2,
+    BENCH_KINDS
+};
+
+typedef struct bench_item
+{
+    const uint8_t *data;
+    uint32_t len;
+    const uint8_t *addr;
+} bench_item_t;
+
+typedef struct bench_frame
+{
+    int kind;
+    uint8_t addr[6];
+    uint8_t data[BENCH_FRAME_MAX];
+    uint32_t len;
+    uint8_t tzsp[BENCH_FRAME_MAX];
+    uint32_t tzsp_len;
+    /* Vendor IE body inside the data, if any */
+    const uint8_t *ie;
+    uint8_t ie_len;
+} bench_frame_t;
+
+typedef struct bench_set
+{
+    bench_item_t *items;
+    size_t count;
+} bench_set_t;
+
+typedef uint32_t (*bench_func_t)(const bench_item_t*);
+
+static uint32_t bench_random(void);
+static void bench_corpus(bench_frame_t*, size_t);
+static uint32_t bench_header(uint8_t*, uint8_t, uint8_t, const uint8_t*, const uint8_t*);
+static uint32_t bench_tag(uint8_t*, uint32_t, uint8_t, const uint8_t*, uint8_t);
+static uint32_t bench_mgmt(bench_frame_t*, size_t);
+static uint32_t bench_ie_mikrotik(uint8_t*, size_t);
+static uint32_t bench_ie_airmax(uint8_t*);
+static uint32_t bench_ie_airmax_ac(uint8_t*, const uint8_t*, size_t);
+static uint32_t bench_nv2(bench_frame_t*, size_t);
+static void bench_tzsp(bench_frame_t*);
+static void bench_run(const char*, bench_func_t, const bench_set_t*, size_t);
+static uint32_t bench_decap_tzsp(const bench_item_t*);
+static uint32_t bench_mac80211(const bench_item_t*);
+static uint32_t bench_nv2_network(const bench_item_t*);
+static uint32_t bench_ie_mikrotik_parse(const bench_item_t*);
+static uint32_t bench_ie_airmax_parse(const bench_item_t*);
+static uint32_t bench_ie_airmax_ac_parse(const bench_item_t*);
+static uint32_t bench_pipeline(const bench_item_t*);
+
+static uint32_t bench_seed = 0x6d747363;
+static volatile uint32_t bench_sink;
+
+#ifdef __GLIBC__
+/* Count the heap allocations of the parsers, including libcrypto */
+extern void* __libc_malloc(size_t);
+extern void* __libc_calloc(size_t, size_t);
+extern void* __libc_realloc(void*, size_t);
+static volatile unsigned long bench_allocs;
+
+void*
+malloc(size_t size)
+{
+    bench_allocs++;
+    return __libc_malloc(size);
+}
+
+void*
+calloc(size_t nmemb,
+       size_t size)
+{
+    bench_allocs++;
+    return __libc_calloc(nmemb, size);
+}
+
+void*
+realloc(void   *ptr,
+        size_t  size)
+{
+    bench_allocs++;
+    return __libc_realloc(ptr, size);
+}
+#define BENCH_ALLOCS() (bench_allocs)
+#else
+#define BENCH_ALLOCS() (0UL)
+#endif
+
+static void
+show_usage(FILE *fp,
+           char *arg)
+{
+    fprintf(fp, "usage: %s [ -n <networks> ] [ -c <frames> ]\n", arg);
+    fprintf(fp, "  -n  number of synthetic networks (default %d)\n", BENCH_DEFAULT_NETS);
+    fprintf(fp, "  -c  frames parsed by each benchmark (default %d)\n", BENCH_DEFAULT_COUNT);
+}
+
+int
+main(int   argc,
+     char *argv[])
+{
+    size_t nets = BENCH_DEFAULT_NETS;
+    size_t count = BENCH_DEFAULT_COUNT;
+    bench_frame_t *corpus;
+    bench_set_t set_tzsp = { NULL, 0 };
+    bench_set_t set_mac80211 = { NULL, 0 };
+    bench_set_t set_nv2 = { NULL, 0 };
+    bench_set_t set_mikrotik = { NULL, 0 };
+    bench_set_t set_airmax = { NULL, 0 };
+    bench_set_t set_airmax_ac = { NULL, 0 };
+    bench_frame_t *frame;
+    size_t i;
+    int c;
+
+    while((c = getopt(argc, argv, "hn:c:")) != -1)
+    {
+        switch(c)
+        {
+            case 'h':
+                show_usage(stdout, argv[0]);
+                exit(EXIT_SUCCESS);
+
+            case 'n':
+                nets = strtoul(optarg, NULL, 10);
+                break;
+
+            case 'c':
+                count = strtoul(optarg, NULL, 10);
+                break;
+
+            case ':':
+            case '?':
+                show_usage(stderr, argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    /* At least one network of every kind */
+    if(nets < BENCH_KINDS || !count)
+    {
+        show_usage(stderr, argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    corpus = calloc(nets, sizeof(bench_frame_t));
+    set_tzsp.items = calloc(nets, sizeof(bench_item_t));
+    set_mac80211.items = calloc(nets, sizeof(bench_item_t));
+    set_nv2.items = calloc(nets, sizeof(bench_item_t));
+    set_mikrotik.items = calloc(nets, sizeof(bench_item_t));
+    set_airmax.items = calloc(nets, sizeof(bench_item_t));
+    set_airmax_ac.items = calloc(nets, sizeof(bench_item_t));
+    if(!corpus || !set_tzsp.items || !set_mac80211.items || !set_nv2.items ||
+       !set_mikrotik.items || !set_airmax.items || !set_airmax_ac.items)
+    {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    bench_corpus(corpus, nets);
+
+    for(i=0; i<nets; i++)
+    {
+        frame = &corpus[i];
+        set_tzsp.items[set_tzsp.count++] = (bench_item_t){ frame->tzsp, frame->tzsp_len, frame->addr };
+
+        if(frame->kind == BENCH_KIND_NV2)
+            set_nv2.items[set_nv2.count++] = (bench_item_t){ frame->data, frame->len, frame->addr };
+        else
+            set_mac80211.items[set_mac80211.count++] = (bench_item_t){ frame->data, frame->len, frame->addr };
+
+        if(frame->kind == BENCH_KIND_HT_MIKROTIK || frame->kind == BENCH_KIND_VHT_PROBE)
+            set_mikrotik.items[set_mikrotik.count++] = (bench_item_t){ frame->ie, frame->ie_len, frame->addr };
+        else if(frame->kind == BENCH_KIND_AIRMAX)
+            set_airmax.items[set_airmax.count++] = (bench_item_t){ frame->ie, frame->ie_len, frame->addr };
+        else if(frame->kind == BENCH_KIND_AIRMAX_AC)
+            set_airmax_ac.items[set_airmax_ac.count++] = (bench_item_t){ frame->ie, frame->ie_len, frame->addr };
+    }
+
+    printf("%zu networks, %zu frames per benchmark\n\n", nets, count);
+    printf("%-20s %12s %12s %14s\n", "parser", "frames", "ns/frame", "allocs/frame");
+
+    bench_run("decap_tzsp", bench_decap_tzsp, &set_tzsp, count);
+    bench_run("mac80211_network", bench_mac80211, &set_mac80211, count);
+    bench_run("nv2_network", bench_nv2_network, &set_nv2, count);
+    bench_run("ie_mikrotik_parse", bench_ie_mikrotik_parse, &set_mikrotik, count);
+    bench_run("ie_airmax_parse", bench_ie_airmax_parse, &set_airmax, count);
+    bench_run("ie_airmax_ac_parse", bench_ie_airmax_ac_parse, &set_airmax_ac, count);
+    bench_run("pipeline", bench_pipeline, &set_tzsp, count);
+
+    ie_airmax_ac_cache_clear();
+    free(set_airmax_ac.items);
+    free(set_airmax.items);
+    free(set_mikrotik.items);
+    free(set_nv2.items);
+    free(set_mac80211.items);
+    free(set_tzsp.items);
+    free(corpus);
+    return 0;
+}
+
+static uint32_t
+bench_random(void)
+{
+    /* xorshift32, the corpus is the same on every run */
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 17;
+    bench_seed ^= bench_seed << 5;
+    return bench_seed;
+}
+
+static void
+bench_corpus(bench_frame_t *corpus,
+             size_t         nets)
+{
+    bench_frame_t *frame;
+    size_t i;
+    int j;
+
+    for(i=0; i<nets; i++)
+    {
+        frame = &corpus[i];
+        frame->kind = i % BENCH_KINDS;
+
+        /* Locally administered unicast address */
+        for(j=0; j<6; j++)
+            frame->addr[j] = bench_random();
+        frame->addr[0] = (frame->addr[0] & 0xFC) | 0x02;
+
+        if(frame->kind == BENCH_KIND_NV2)
+            frame->len = bench_nv2(frame, i);
+        else
+            frame->len = bench_mgmt(frame, i);
+
+        bench_tzsp(frame);
+    }
+}
+
+static uint32_t
+bench_header(uint8_t       *data,
+             uint8_t        type,
+             uint8_t        flags,
+             const uint8_t *dst,
+             const uint8_t *addr)
+{
+    uint16_t seq = bench_random();
+
+    data[0] = type;
+    data[1] = flags;
+    data[2] = 0x00;
+    data[3] = 0x00;
+    memcpy(data + 4, dst, 6);
+    memcpy(data + 10, addr, 6);
+    memcpy(data + 16, addr, 6);
+    data[22] = seq & 0xFF;
+    data[23] = seq >> 8;
+    return 24;
+}
+
+static uint32_t
+bench_tag(uint8_t       *data,
+          uint32_t       len,
+          uint8_t        type,
+          const uint8_t *value,
+          uint8_t        value_len)
+{
+    data[len] = type;
+    data[len+1] = value_len;
+    memcpy(data + len + 2, value, value_len);
+    return len + 2 + value_len;
+}
+
+static uint32_t
+bench_mgmt(bench_frame_t *frame,
+           size_t         id)
+{
+    static const uint8_t broadcast[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    static const uint8_t rates[] = { 0x8C, 0x12, 0x98, 0x24, 0xB0, 0x48, 0x60, 0x6C };
+    uint8_t station[6];
+    uint8_t value[UINT8_MAX];
+    uint8_t *ie;
+    uint32_t len;
+    int ssid_len;
+    int j;
+
+    if(frame->kind == BENCH_KIND_VHT_PROBE)
+    {
+        for(j=0; j<6; j++)
+            station[j] = bench_random();
+        station[0] &= 0xFE;
+        len = bench_header(frame->data, 0x50, 0x00, station, frame->addr);
+    }
+    else
+    {
+        len = bench_header(frame->data, 0x80, 0x00, broadcast, frame->addr);
+    }
+
+    /* Timestamp, beacon interval and capabilities */
+    for(j=0; j<8; j++)
+        frame->data[len++] = bench_random();
+    frame->data[len++] = 0x64;
+    frame->data[len++] = 0x00;
+    frame->data[len++] = 0x01 | ((id & 1) ? 0x10 : 0x00);
+    frame->data[len++] = 0x00;
+
+    ssid_len = snprintf((char*)value, sizeof(value), "bench-network-%04zu", id);
+    len = bench_tag(frame->data, len, BENCH_TAG_SSID, value, ssid_len);
+    len = bench_tag(frame->data, len, BENCH_TAG_RATES, rates, sizeof(rates));
+
+    /* Two spatial streams, 40 MHz with the secondary channel above */
+    memset(value, 0, 26);
+    value[3] = 0xFF;
+    value[4] = 0xFF;
+    len = bench_tag(frame->data, len, BENCH_TAG_HT_CAPS, value, 26);
+    memset(value, 0, 22);
+    value[0] = 36;
+    value[1] = 0x05;
+    len = bench_tag(frame->data, len, BENCH_TAG_HT_INFO, value, 22);
+
+    if(frame->kind == BENCH_KIND_VHT_PROBE ||
+       frame->kind == BENCH_KIND_AIRMAX_AC)
+    {
+        /* 80 MHz channel, two spatial streams */
+        memset(value, 0, 12);
+        value[8] = 0xFA;
+        value[9] = 0xFF;
+        len = bench_tag(frame->data, len, BENCH_TAG_VHT_CAPS, value, 12);
+        memset(value, 0, 5);
+        value[0] = 1;
+        value[1] = 42;
+        len = bench_tag(frame->data, len, BENCH_TAG_VHT_INFO, value, 5);
+    }
+
+    ie = frame->data + len + 2;
+    switch(frame->kind)
+    {
+        case BENCH_KIND_HT_MIKROTIK:
+        case BENCH_KIND_VHT_PROBE:
+            frame->ie_len = bench_ie_mikrotik(value, id);
+            break;
+
+        case BENCH_KIND_AIRMAX:
+            frame->ie_len = bench_ie_airmax(value);
+            break;
+
+        case BENCH_KIND_AIRMAX_AC:
+            frame->ie_len = bench_ie_airmax_ac(value, frame->addr, id);
+            break;
+    }
+
+    len = bench_tag(frame->data, len, BENCH_TAG_VENDOR_IE, value, frame->ie_len);
+    frame->ie = ie;
+    return len;
+}
+
+static uint32_t
+bench_ie_mikrotik(uint8_t *ie,
+                  size_t   id)
+{
+    static const uint8_t magic[] = { 0x00, 0x0c, 0x42, 0x00, 0x00, 0x00 };
+    uint16_t frequency = 5180 + (id % 8) * 20;
+    uint32_t len = 0;
+
+    memcpy(ie, magic, sizeof(magic));
+    len += sizeof(magic);
+
+    /* Data tag: flags, version 6.44.3, MRU, radio name, framer limit */
+    ie[len++] = 0x01;
+    ie[len++] = 30;
+    memset(ie + len, 0, 30);
+    ie[len+0] = 0x04;
+    ie[len+1] = 0x10;
+    ie[len+4] = 3;
+    ie[len+6] = 44;
+    ie[len+7] = 6;
+    ie[len+8] = 0xDC;
+    ie[len+9] = 0x05;
+    snprintf((char*)ie + len + 10, 17, "mt-%04u", (unsigned)(id % 10000));
+    ie[len+26] = 0xDC;
+    ie[len+27] = 0x0F;
+    len += 30;
+
+    /* Frequency tag */
+    ie[len++] = 0x05;
+    ie[len++] = 2;
+    ie[len++] = frequency & 0xFF;
+    ie[len++] = frequency >> 8;
+    return len;
+}
+
+static uint32_t
+bench_ie_airmax(uint8_t *ie)
+{
+    static const uint8_t magic[] = { 0x00, 0x15, 0x6d, 0xff, 0xff, 0xff };
+
+    memset(ie, 0, 38);
+    memcpy(ie, magic, sizeof(magic));
+    return 38;
+}
+
+static uint32_t
+bench_ie_airmax_ac(uint8_t       *ie,
+                   const uint8_t *addr,
+                   size_t         id)
+{
+    static const uint8_t magic[] = { 0x00, 0x27, 0x22, 0xff, 0xff, 0xff, 0x02, 0x01, 0x00 };
+    static const uint8_t hmac_key[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    uint8_t hmac[SHA_DIGEST_LENGTH];
+    uint8_t plain[BENCH_AIRMAX_AC_DATA_LEN];
+    EVP_CIPHER_CTX *ctx;
+    int out_len = 0;
+    int len;
+
+    memset(plain, 0, sizeof(plain));
+    memcpy(plain + 2, addr, 6);
+    memcpy(plain + 8, addr, 6);
+    plain[17] = 0x02;
+
+    len = 22;
+    plain[len] = 0x01;
+    plain[len+1] = snprintf((char*)plain + len + 2, 16, "ubnt-%04zu", id);
+    len += 2 + plain[len+1];
+    plain[len] = 0x02;
+    plain[len+1] = snprintf((char*)plain + len + 2, 20, "bench-ac-%04zu", id);
+
+    memcpy(ie, magic, sizeof(magic));
+    ie[sizeof(magic)] = BENCH_AIRMAX_AC_DATA_LEN;
+
+    /* Same key derivation as the decoder, HMAC-SHA1 truncated to AES-128 */
+    ctx = EVP_CIPHER_CTX_new();
+    if(!ctx ||
+       !HMAC(EVP_sha1(), hmac_key, sizeof(hmac_key), addr, 6, hmac, NULL) ||
+       !EVP_EncryptInit_ex(ctx, EVP_aes_128_ecb(), NULL, hmac, NULL) ||
+       !EVP_CIPHER_CTX_set_padding(ctx, 0) ||
+       !EVP_EncryptUpdate(ctx, ie + BENCH_AIRMAX_AC_HEADER_LEN, &out_len, plain, sizeof(plain)) ||
+       out_len != sizeof(plain))
+    {
+        fprintf(stderr, "Failed to encrypt the airMAX AC IE\n");
+        exit(EXIT_FAILURE);
+    }
+    EVP_CIPHER_CTX_free(ctx);
+
+    return BENCH_AIRMAX_AC_HEADER_LEN + BENCH_AIRMAX_AC_DATA_LEN;
+}
+
+static uint32_t
+bench_nv2(bench_frame_t *frame,
+          size_t         id)
+{
+    static const uint8_t broadcast[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+    uint8_t beacon[UINT8_MAX];
+    uint8_t value[64];
+    uint16_t frequency = 5500 + (id % 8) * 20;
+    uint32_t beacon_len = 0;
+    uint32_t len;
+    int j;
+
+    len = bench_header(frame->data, 0x08, 0x90, broadcast, frame->addr);
+
+    /* Management header */
+    for(j=0; j<8; j++)
+        frame->data[len++] = 0x00;
+
+    /* TDMA tag, skipped by the parser */
+    frame->data[len++] = 0x00;
+    frame->data[len++] = 0x00;
+    frame->data[len++] = 0x00;
+    frame->data[len++] = 0x08;
+    for(j=0; j<8; j++)
+        frame->data[len++] = bench_random();
+
+    beacon_len = bench_tag(beacon, beacon_len, 0x00, value, snprintf((char*)value, sizeof(value), "bench-nv2-%04zu", id));
+    beacon_len = bench_tag(beacon, beacon_len, 0x01, value, snprintf((char*)value, sizeof(value), "nv2-%04zu", id));
+
+    /* Frequency, privacy, two chains, 802.11n with the upper extension channel */
+    memset(value, 0, 10);
+    value[0] = frequency >> 8;
+    value[1] = frequency & 0xFF;
+    value[2] = (1 << 4);
+    value[3] = (1 << 4) | (1 << 3) | (1 << 1) | (1 << 0);
+    value[4] = 0x08;
+    value[5] = 0xFF;
+    beacon_len = bench_tag(beacon, beacon_len, 0x02, value, 10);
+
+    value[0] = 6;
+    value[1] = 44;
+    value[2] = 0;
+    value[3] = 3;
+    beacon_len = bench_tag(beacon, beacon_len, 0x03, value, 4);
+
+    /* Beacon tag */
+    frame->data[len++] = 0x00;
+    frame->data[len++] = 0x05;
+    frame->data[len++] = beacon_len >> 8;
+    frame->data[len++] = beacon_len & 0xFF;
+    memcpy(frame->data + len, beacon, beacon_len);
+    return len + beacon_len;
+}
+
+static void
+bench_tzsp(bench_frame_t *frame)
+{
+    uint32_t len = 0;
+    int8_t rssi = -40 - (int8_t)(bench_random() % 50);
+    uint8_t channel = 36;
+
+    /* TZSP header: version 1, received frame, IEEE 802.11 */
+    frame->tzsp[len++] = 0x01;
+    frame->tzsp[len++] = 0x00;
+    frame->tzsp[len++] = 0x00;
+    frame->tzsp[len++] = 0x12;
+
+    len = bench_tag(frame->tzsp, len, 0x0A, (const uint8_t*)&rssi, 1);
+    len = bench_tag(frame->tzsp, len, 0x12, &channel, 1);
+    len = bench_tag(frame->tzsp, len, 0x3C, frame->addr, 6);
+    frame->tzsp[len++] = 0x01;
+
+    memcpy(frame->tzsp + len, frame->data, frame->len);
+    frame->tzsp_len = len + frame->len;
+}
+
+static void
+bench_run(const char         *name,
+          bench_func_t        func,
+          const bench_set_t  *set,
+          size_t              count)
+{
+    struct timespec start;
+    struct timespec end;
+    unsigned long allocs;
+    uint32_t sink = 0;
+    double elapsed;
+    size_t i;
+    size_t j;
+
+    if(!set->count)
+        return;
+
+    /* Warm up the caches with one pass over the corpus */
+    for(j=0; j<set->count; j++)
+        sink += func(&set->items[j]);
+
+    allocs = BENCH_ALLOCS();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(i=0, j=0; i<count; i++)
+    {
+        sink += func(&set->items[j]);
+        if(++j == set->count)
+            j = 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    allocs = BENCH_ALLOCS() - allocs;
+
+    /* Every parser must accept every frame of its set */
+    if(sink != count + set->count)
+        fprintf(stderr, "%s: %u of %zu frames parsed\n", name, sink, count + set->count);
+    bench_sink += sink;
+
+    elapsed = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    printf("%-20s %12zu %12.1f %14.2f\n", name, count, elapsed / count, (double)allocs / count);
+
+    if(func == bench_pipeline)
+        printf("\n%.0f frames/s\n", count / (elapsed / 1e9));
+}
+
+static uint32_t
+bench_decap_tzsp(const bench_item_t *item)
+{
+    const int8_t *rssi = NULL;
+    const uint8_t *channel = NULL;
+    const uint8_t *sensor_mac = NULL;
+    uint32_t len = item->len;
+
+    return decap_tzsp(item->data, &len, &rssi, &channel, &sensor_mac) != NULL;
+}
+
+static uint32_t
+bench_mac80211(const bench_item_t *item)
+{
+    mac80211_net_t net;
+    const uint8_t *src;
+
+    return mac80211_network(&net, item->data, item->len, &src);
+}
+
+static uint32_t
+bench_nv2_network(const bench_item_t *item)
+{
+    nv2_net_t net;
+    const uint8_t *src;
+
+    return nv2_network(&net, item->data, item->len, &src);
+}
+
+static uint32_t
+bench_ie_mikrotik_parse(const bench_item_t *item)
+{
+    ie_mikrotik_t ie;
+
+    return ie_mikrotik_parse(&ie, item->data, item->len);
+}
+
+static uint32_t
+bench_ie_airmax_parse(const bench_item_t *item)
+{
+    return ie_airmax_parse(item->data, item->len);
+}
+
+static uint32_t
+bench_ie_airmax_ac_parse(const bench_item_t *item)
+{
+    ie_airmax_ac_t ie;
+
+    return ie_airmax_ac_parse(&ie, item->data, item->len, item->addr);
+}
+
+static uint32_t
+bench_pipeline(const bench_item_t *item)
+{
+    const int8_t *rssi = NULL;
+    const uint8_t *channel = NULL;
+    const uint8_t *sensor_mac = NULL;
+    const uint8_t *packet;
+    const uint8_t *src;
+    uint32_t len = item->len;
+    mac80211_net_t net;
+    nv2_net_t net_nv2;
+
+    /* Same order as the receiver */
+    packet = decap_tzsp(item->data, &len, &rssi, &channel, &sensor_mac);
+    if(!packet)
+        return 0;
+
+    if(nv2_network(&net_nv2, packet, len, &src))
+        return 1;
+
+    return mac80211_network(&net, packet, len, &src);
+}
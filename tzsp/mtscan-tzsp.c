@@ -16,16 +16,29 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <time.h>
 #include <getopt.h>
 #include <signal.h>
+#ifndef _WIN32
+#include <arpa/inet.h>
+#endif
 #include "tzsp-sniffer.h"
 #include "tzsp-socket.h"
+#include "tzsp-writer.h"
+#include "tzsp-collector.h"
+#include "tzsp-gpsd.h"
 #include "mac80211.h"
 
 #define TZSP_UDP_PORT 0x9090
+#define GPSD_DEFAULT_PORT "2947"
+#define COLLECTOR_LOG_INTERVAL 60
 
 static tzsp_sniffer_t *tzsp_sniffer = NULL;
 static tzsp_socket_t *tzsp_socket = NULL;
+static tzsp_collector_t *collector = NULL;
+static uint32_t frames_received = 0;
+static uint32_t frames_ignored = 0;
 
 static void
 signal_handler(int signo)
@@ -65,7 +78,24 @@ show_usage(FILE *fp,
            char *arg)
 {
     fprintf(fp, "network socket usage: %s [ -o <filename> ] [ -s <src-ip> ]\n", arg);
-    fprintf(fp, "pcap capture usage:   %s -p -i <interface> [ -o <filename> ]  [ -s <src-ip> ] \n", arg);
+    fprintf(fp, "pcap capture usage:   %s -p [ -P ] -i <interface> [ -o <filename> ]  [ -s <src-ip> ] \n", arg);
+    fprintf(fp, "capture file usage:   %s -r <filename> [ -o <filename> ]\n", arg);
+    fprintf(fp, "output options:       [ -C <megabytes> ] [ -G <seconds> ] [ -W <files> ] [ -z ]\n");
+    fprintf(fp, "collector options:    [ -l <filename> [ -L <seconds> ] ] [ -j <filename> ] [ -g <host[:port]> ] [ -a ] [ -b <2|5> ] [ -w <MHz> ]\n");
+    fprintf(fp, "  -P  use libpcap only, without the memory-mapped ring (Linux)\n");
+    fprintf(fp, "  -r  replay a pcap or pcapng file (TZSP or raw IEEE 802.11)\n");
+    fprintf(fp, "  -o  write IEEE 802.11 frames to a pcapng file\n");
+    fprintf(fp, "  -C  start a new output file after given size\n");
+    fprintf(fp, "  -G  start a new output file after given time\n");
+    fprintf(fp, "  -W  keep only given number of output files\n");
+    fprintf(fp, "  -z  compress completed output files with gzip\n");
+    fprintf(fp, "  -l  write collected networks to a mtscan log (gzipped with .gz suffix)\n");
+    fprintf(fp, "  -L  rewrite the log after given time (default: %d, 0 = on exit only)\n", COLLECTOR_LOG_INTERVAL);
+    fprintf(fp, "  -j  append network updates as JSON lines to a file (- for stdout)\n");
+    fprintf(fp, "  -g  read position from gpsd (default port: %s)\n", GPSD_DEFAULT_PORT);
+    fprintf(fp, "  -a  keep signal samples in the log (one per second)\n");
+    fprintf(fp, "  -b  frequency band of the channel numbers (default: 5)\n");
+    fprintf(fp, "  -w  channel width (default: 20)\n");
 }
 
 static void
@@ -74,24 +104,41 @@ process(const uint8_t *packet,
         const int8_t  *rssi,
         const uint8_t *channel,
         const uint8_t *sensor_mac,
+        uint32_t       sensor_ip,
         void          *user_data)
 {
+    mac80211_net_t net_data;
+    nv2_net_t net_nv2_data;
     mac80211_net_t *net = NULL;
     nv2_net_t *net_nv2 = NULL;
     const uint8_t *src;
 
+    frames_received++;
 
-    net_nv2 = nv2_network(packet, len, &src);
-    if(!net_nv2)
+    if(collector)
     {
-        net = mac80211_network(packet, len, &src);
-        if(!net)
+        if(!tzsp_collector_frame(collector,
+                                 (tzsp_sniffer ? tzsp_sniffer_get_timestamp(tzsp_sniffer) : time(NULL)),
+                                 packet, len, rssi, channel, sensor_mac))
+            frames_ignored++;
+        return;
+    }
+
+    if(nv2_network(&net_nv2_data, packet, len, &src))
+        net_nv2 = &net_nv2_data;
+    else
+    {
+        if(!mac80211_network(&net_data, packet, len, &src))
+        {
+            frames_ignored++;
             return;
+        }
+        net = &net_data;
 
         if(net->source != MAC80211_FRAME_BEACON &&
            net->source != MAC80211_FRAME_PROBE_RESPONSE)
         {
-            mac80211_net_free(net);
+            frames_ignored++;
             return;
         }
     }
@@ -110,6 +157,11 @@ process(const uint8_t *packet,
         printf("[SENSOR=%02X:%02X:%02X:%02X:%02X:%02X] ",
                sensor_mac[0], sensor_mac[1], sensor_mac[2], sensor_mac[3], sensor_mac[4], sensor_mac[5]);
 
+#ifndef _WIN32
+    if(sensor_ip)
+        printf("[FROM=%s] ", inet_ntoa(*(struct in_addr*)&sensor_ip));
+#endif
+
     if(net)
     {
         if(net->source == MAC80211_FRAME_BEACON)
@@ -118,11 +170,11 @@ process(const uint8_t *packet,
         if(net->source == MAC80211_FRAME_PROBE_RESPONSE)
             printf("SRC=PROBE_RESPONSE ");
 
-        if(net->ssid)
-            printf("SSID=%s ", net->ssid);
+        if(mac80211_net_get_ssid(net))
+            printf("SSID=%s ", mac80211_net_get_ssid(net));
 
-        if(net->radioname)
-            printf("RADIONAME=%s ", net->radioname);
+        if(mac80211_net_get_radioname(net))
+            printf("RADIONAME=%s ", mac80211_net_get_radioname(net));
 
         if(mac80211_net_is_privacy(net))
             printf("PRIVACY ");
@@ -184,7 +236,6 @@ process(const uint8_t *packet,
         {
             printf("80211B");
         }
-        mac80211_net_free(net);
     }
 
     if(net_nv2)
@@ -230,7 +281,6 @@ process(const uint8_t *packet,
         {
             printf("80211B");
         }
-        nv2_net_free(net_nv2);
     }
 
     printf("\n");
@@ -243,10 +293,27 @@ main(int   argc,
     char *dev_if = NULL;
     char *output = NULL;
     char *ip_src = NULL;
+    char *input = NULL;
     bool use_pcap = false;
+    bool use_ring = true;
+    uint64_t max_size = 0;
+    uint32_t max_seconds = 0;
+    uint32_t max_files = 0;
+    bool compress = false;
+    tzsp_writer_t *writer = NULL;
+    char *log = NULL;
+    uint32_t log_interval = COLLECTOR_LOG_INTERVAL;
+    char *stream = NULL;
+    char *gpsd_host = NULL;
+    char *gpsd_port;
+    tzsp_gpsd_t *gpsd = NULL;
+    bool samples = false;
+    int band = 5;
+    int width = 20;
+    bool collector_opts = false;
     int c;
 
-    while((c = getopt(argc, argv, "hi:o:s:p")) != -1)
+    while((c = getopt(argc, argv, "hi:o:s:pPr:C:G:W:zl:L:j:g:ab:w:")) != -1)
     {
         switch(c)
         {
@@ -270,6 +337,63 @@ main(int   argc,
                 use_pcap = true;
                 break;
 
+            case 'P':
+                use_ring = false;
+                break;
+
+            case 'r':
+                input = optarg;
+                break;
+
+            case 'C':
+                max_size = strtoull(optarg, NULL, 10) * 1000000;
+                break;
+
+            case 'G':
+                max_seconds = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'W':
+                max_files = (uint32_t)strtoul(optarg, NULL, 10);
+                break;
+
+            case 'z':
+                compress = true;
+                break;
+
+            case 'l':
+                log = optarg;
+                break;
+
+            case 'L':
+                log_interval = (uint32_t)strtoul(optarg, NULL, 10);
+                collector_opts = true;
+                break;
+
+            case 'j':
+                stream = optarg;
+                break;
+
+            case 'g':
+                gpsd_host = optarg;
+                collector_opts = true;
+                break;
+
+            case 'a':
+                samples = true;
+                collector_opts = true;
+                break;
+
+            case 'b':
+                band = atoi(optarg);
+                collector_opts = true;
+                break;
+
+            case 'w':
+                width = atoi(optarg);
+                collector_opts = true;
+                break;
+
             case ':':
             case '?':
                 show_usage(stderr, argv[0]);
@@ -277,6 +401,41 @@ main(int   argc,
         }
     }
 
+    if(!output && (max_size || max_seconds || max_files || compress))
+    {
+        fprintf(stderr, "Output options require an output file\n");
+        show_usage(stderr, argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if(!log && !stream && collector_opts)
+    {
+        fprintf(stderr, "Collector options require -l or -j\n");
+        show_usage(stderr, argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if(band != 2 && band != 5)
+    {
+        fprintf(stderr, "Invalid frequency band\n");
+        show_usage(stderr, argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if(width <= 0)
+    {
+        fprintf(stderr, "Invalid channel width\n");
+        show_usage(stderr, argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if(input && (use_pcap || dev_if))
+    {
+        fprintf(stderr, "Capture file cannot be combined with a live capture\n");
+        show_usage(stderr, argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
     if(use_pcap && !dev_if)
     {
         fprintf(stderr, "No local device interface specified\n");
@@ -291,10 +450,37 @@ main(int   argc,
         exit(EXIT_FAILURE);
     }
 
-    if(use_pcap)
+    if(input)
+    {
+        tzsp_sniffer = tzsp_sniffer_new();
+        switch(tzsp_sniffer_init_offline(tzsp_sniffer, TZSP_UDP_PORT, input))
+        {
+            case TZSP_SNIFFER_OK:
+                break;
+
+            case TZSP_SNIFFER_ERROR_CAPTURE:
+                fprintf(stderr, "Could not open file %s\n", tzsp_sniffer_get_error(tzsp_sniffer));
+                exit(EXIT_FAILURE);
+
+            case TZSP_SNIFFER_ERROR_DATALINK:
+                fprintf(stderr, "Capture file %s has unsupported datalink\n", input);
+                exit(EXIT_FAILURE);
+
+            case TZSP_SNIFFER_ERROR_FILTER:
+            case TZSP_SNIFFER_ERROR_SET_FILTER:
+                fprintf(stderr, "Could not install packet filter\n");
+                exit(EXIT_FAILURE);
+
+            default:
+                fprintf(stderr, "Unknown error\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+    else if(use_pcap)
     {
         tzsp_sniffer = tzsp_sniffer_new();
-        switch(tzsp_sniffer_init(tzsp_sniffer, TZSP_UDP_PORT, output, ip_src, dev_if, 100))
+        tzsp_sniffer_set_ring(tzsp_sniffer, use_ring);
+        switch(tzsp_sniffer_init(tzsp_sniffer, TZSP_UDP_PORT, ip_src, dev_if, 100))
         {
             case TZSP_SNIFFER_OK:
                 break;
@@ -319,14 +505,6 @@ main(int   argc,
                 fprintf(stderr, "Could not install packet filter\n");
                 exit(EXIT_FAILURE);
 
-            case TZSP_SNIFFER_ERROR_DUMP_OPEN_DEAD:
-                fprintf(stderr, "Could not open virtual output device\n");
-                exit(EXIT_FAILURE);
-
-            case TZSP_SNIFFER_ERROR_DUMP_OPEN:
-                fprintf(stderr, "Could not open output file %s\n", output);
-                exit(EXIT_FAILURE);
-
             default:
                 fprintf(stderr, "Unknown error\n");
                 exit(EXIT_FAILURE);
@@ -335,7 +513,7 @@ main(int   argc,
     else
     {
         tzsp_socket = tzsp_socket_new();
-        switch(tzsp_socket_init(tzsp_socket, TZSP_UDP_PORT, output, ip_src))
+        switch(tzsp_socket_init(tzsp_socket, TZSP_UDP_PORT, ip_src))
         {
             case TZSP_SOCKET_OK:
                 break;
@@ -352,18 +530,103 @@ main(int   argc,
                 fprintf(stderr, "Failed to bind a port\n");
                 exit(EXIT_FAILURE);
 
-            case TZSP_SOCKET_ERROR_DUMP_OPEN_DEAD:
-                fprintf(stderr, "Could not open virtual output device\n");
+            default:
+                fprintf(stderr, "Unknown error\n");
                 exit(EXIT_FAILURE);
 
-            case TZSP_SOCKET_ERROR_DUMP_OPEN:
+        }
+    }
+
+    if(output)
+    {
+        writer = tzsp_writer_new();
+        if(writer)
+        {
+            tzsp_writer_set_rotation(writer, max_size, max_seconds, max_files);
+            tzsp_writer_set_compress(writer, compress);
+        }
+
+        switch(writer ? tzsp_writer_init(writer, output) : TZSP_WRITER_ERROR_MEMORY)
+        {
+            case TZSP_WRITER_OK:
+                break;
+
+            case TZSP_WRITER_ERROR_MEMORY:
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(EXIT_FAILURE);
+
+            case TZSP_WRITER_ERROR_OPEN:
                 fprintf(stderr, "Could not open output file %s\n", output);
                 exit(EXIT_FAILURE);
 
+            case TZSP_WRITER_ERROR_THREAD:
+                fprintf(stderr, "Could not start the output thread\n");
+                exit(EXIT_FAILURE);
+
             default:
                 fprintf(stderr, "Unknown error\n");
                 exit(EXIT_FAILURE);
+        }
+
+        if(tzsp_sniffer)
+            tzsp_sniffer_set_writer(tzsp_sniffer, writer);
+        if(tzsp_socket)
+            tzsp_socket_set_writer(tzsp_socket, writer);
+    }
+
+    if(gpsd_host)
+    {
+        gpsd_port = strrchr(gpsd_host, ':');
+        if(gpsd_port)
+            *gpsd_port++ = '\0';
+
+        gpsd = tzsp_gpsd_new();
+        switch(gpsd ? tzsp_gpsd_init(gpsd, gpsd_host, (gpsd_port ? gpsd_port : GPSD_DEFAULT_PORT)) : TZSP_GPSD_ERROR_MEMORY)
+        {
+            case TZSP_GPSD_OK:
+                break;
 
+            case TZSP_GPSD_ERROR_MEMORY:
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(EXIT_FAILURE);
+
+            case TZSP_GPSD_ERROR_THREAD:
+                fprintf(stderr, "Could not start the gpsd thread\n");
+                exit(EXIT_FAILURE);
+
+            default:
+                fprintf(stderr, "Unknown error\n");
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if(log || stream)
+    {
+        collector = tzsp_collector_new();
+        if(collector)
+        {
+            tzsp_collector_set_band(collector, width, (band == 2 ? 2407 : 5000));
+            tzsp_collector_set_log(collector, log, log_interval);
+            tzsp_collector_set_samples(collector, samples);
+            tzsp_collector_set_gpsd(collector, gpsd);
+        }
+
+        switch(collector ? tzsp_collector_init(collector, stream) : TZSP_COLLECTOR_ERROR_MEMORY)
+        {
+            case TZSP_COLLECTOR_OK:
+                break;
+
+            case TZSP_COLLECTOR_ERROR_MEMORY:
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(EXIT_FAILURE);
+
+            case TZSP_COLLECTOR_ERROR_OPEN:
+                fprintf(stderr, "Could not open output file %s\n", stream);
+                exit(EXIT_FAILURE);
+
+            default:
+                fprintf(stderr, "Unknown error\n");
+                exit(EXIT_FAILURE);
         }
     }
 
@@ -393,11 +656,39 @@ main(int   argc,
     signal(SIGUSR1, SIG_DFL);
     signal(SIGUSR2, SIG_DFL);
 
+    /* Summary of every stage, printed to stderr to keep stdout parseable */
+    fprintf(stderr, "Frames received:   %u\n", frames_received);
+    fprintf(stderr, "Frames ignored:    %u\n", frames_ignored);
     if(tzsp_sniffer)
+    {
+        fprintf(stderr, "Kernel drops:      %u\n", tzsp_sniffer_get_dropped(tzsp_sniffer));
+        fprintf(stderr, "Invalid packets:   %u\n", tzsp_sniffer_get_invalid(tzsp_sniffer));
         tzsp_sniffer_free(tzsp_sniffer);
+    }
 
     if(tzsp_socket)
+    {
+        fprintf(stderr, "Kernel drops:      %u\n", tzsp_socket_get_dropped(tzsp_socket));
+        fprintf(stderr, "Invalid packets:   %u\n", tzsp_socket_get_invalid(tzsp_socket));
         tzsp_socket_free(tzsp_socket);
+    }
+
+    if(writer)
+    {
+        fprintf(stderr, "Output drops:      %u\n", tzsp_writer_get_dropped(writer));
+        /* Waits for the queued frames and compression */
+        tzsp_writer_free(writer);
+    }
+
+    if(collector)
+    {
+        if(log && !tzsp_collector_save(collector))
+            fprintf(stderr, "Could not write log file %s\n", log);
+        fprintf(stderr, "Networks collected: %u\n", tzsp_collector_get_networks(collector));
+        tzsp_collector_free(collector);
+    }
 
+    tzsp_gpsd_free(gpsd);
+    ie_airmax_ac_cache_clear();
     return 0;
 }
@@ -17,7 +17,6 @@
  
 #include <string.h>
 #include <stdbool.h>
-#include <stdlib.h>
 #include <stdint.h>
 #ifdef _WIN32
 #include <Winsock2.h>
@@ -148,47 +147,53 @@
 #define NV2_BEACON_AC_EXT_CHAN_eeCe 0x2A
 #define NV2_BEACON_AC_EXT_CHAN_eeeC 0x2E
 
-typedef struct nv2_net
+typedef struct nv2_beacon_tag
 {
-    uint8_t flags1;
-    uint8_t flags2;
-    uint8_t rates_ofdm;
-    bool vht;
-    uint8_t vht_chan;
-    uint16_t frequency;
-    char *ssid;
-    char *radioname;
-    char *version;
-} nv2_net_t;
-
-static nv2_net_t* nv2_process_tag(uint16_t, uint16_t, const uint8_t*);
-static void nv2_process_beacon_tag(nv2_net_t*, uint8_t, uint8_t, const uint8_t*);
-
-nv2_net_t*
-nv2_network(const uint8_t *data,
-            uint32_t       len,
+    void (*func)(nv2_net_t*, uint8_t, const uint8_t*);
+    uint8_t len; /* 0 - any length */
+} nv2_beacon_tag_t;
+
+static bool nv2_process_tag(nv2_net_t*, uint16_t, uint16_t, const uint8_t*);
+static void nv2_beacon_tag_ssid(nv2_net_t*, uint8_t, const uint8_t*);
+static void nv2_beacon_tag_radioname(nv2_net_t*, uint8_t, const uint8_t*);
+static void nv2_beacon_tag_info(nv2_net_t*, uint8_t, const uint8_t*);
+static void nv2_beacon_tag_version(nv2_net_t*, uint8_t, const uint8_t*);
+static void nv2_beacon_tag_80211ac(nv2_net_t*, uint8_t, const uint8_t*);
+
+static const nv2_beacon_tag_t nv2_beacon_tags[UINT8_MAX+1] =
+{
+    [NV2_BEACON_TAG_SSID]      = { nv2_beacon_tag_ssid,      0                          },
+    [NV2_BEACON_TAG_RADIONAME] = { nv2_beacon_tag_radioname, 0                          },
+    [NV2_BEACON_TAG_INFO]      = { nv2_beacon_tag_info,      NV2_BEACON_TAG_INFO_LEN    },
+    [NV2_BEACON_TAG_VERSION]   = { nv2_beacon_tag_version,   NV2_BEACON_TAG_VERSION_LEN },
+    [NV2_BEACON_TAG_80211AC]   = { nv2_beacon_tag_80211ac,   NV2_BEACON_TAG_80211AC_LEN }
+};
+
+bool
+nv2_network(nv2_net_t      *context,
+            const uint8_t  *data,
+            uint32_t        len,
             const uint8_t **src)
 {
     static uint8_t broadcast[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
-    nv2_net_t *context;
     uint16_t data_type;
     uint16_t data_len;
     int i;
     
     if(len <= MAC80211_HEADER_LEN + NV2_MGMT_HEADER_LEN + NV2_MGMT_TAG_LEN)
-        return NULL;
+        return false;
 
     /* 802.11 Data frame */
     if(data[0] != 0x08)
-        return NULL;
+        return false;
     
     /* Flags */
     if(data[1] != 0x90)
-        return NULL;
+        return false;
 
     /* Destination address */
     if(memcmp(data + MAC80211_ADDR_DST, broadcast, sizeof(broadcast)) != 0)
-        return NULL;
+        return false;
 
     *src = data+MAC80211_ADDR_SRC;
 
@@ -205,28 +210,28 @@ nv2_network(const uint8_t *data,
         {
             if ((i + NV2_MGMT_TAG_LEN + data_len) > len)
                 break;
-            context = nv2_process_tag(data_type, data_len, data + i + NV2_MGMT_TAG_LEN);
-            if(context)
-                return context;
+            if(nv2_process_tag(context, data_type, data_len, data + i + NV2_MGMT_TAG_LEN))
+                return true;
         }
     }
-    return NULL;
+    return false;
 }
 
-static nv2_net_t*
-nv2_process_tag(uint16_t       type,
+static bool
+nv2_process_tag(nv2_net_t     *context,
+                uint16_t       type,
                 uint16_t       len,
                 const uint8_t *data)
 {
-    nv2_net_t *context;
+    const nv2_beacon_tag_t *tag;
     uint8_t data_type;
     uint8_t data_len;
     int i;
 
     if(type != NV2_MGMT_TAG_BEACON)
-        return NULL;
+        return false;
 
-    context = calloc(sizeof(nv2_net_t), 1);
+    memset(context, 0, sizeof(nv2_net_t));
 
     for(i=0;
         i+NV2_BEACON_TAG_LEN <= len;
@@ -239,66 +244,71 @@ nv2_process_tag(uint16_t       type,
         {
             if((i + NV2_BEACON_TAG_LEN + data_len) > len)
                 break;
-            nv2_process_beacon_tag(context, data_type, data_len, data+i+NV2_BEACON_TAG_LEN);
+            tag = &nv2_beacon_tags[data_type];
+            if(tag->func && (!tag->len || tag->len == data_len))
+                tag->func(context, data_len, data+i+NV2_BEACON_TAG_LEN);
         }
     }
 
-    return context;
+    return true;
 }
 
 static void
-nv2_process_beacon_tag(nv2_net_t     *context,
-                       uint8_t        type,
-                       uint8_t        len,
-                       const uint8_t *value)
+nv2_beacon_tag_ssid(nv2_net_t     *context,
+                    uint8_t        len,
+                    const uint8_t *value)
 {
-    if(type == NV2_BEACON_TAG_SSID &&
-       !context->ssid &&
-       len)
-    {
-        context->ssid = tzsp_utils_string(value, len);
-    }
-    else if(type == NV2_BEACON_TAG_RADIONAME &&
-            !context->radioname &&
-            len)
-    {
-        context->radioname = tzsp_utils_string(value, len);
-    }
-    else if(type == NV2_BEACON_TAG_INFO &&
-            len == NV2_BEACON_TAG_INFO_LEN)
-    {
-        /* Info (channel, rates, flags, etc) */
-        context->frequency = (value[NV2_BEACON_INFO_FREQUENCY_H] << 8) |
-                              value[NV2_BEACON_INFO_FREQUENCY_L];
+    if(!context->ssid[0])
+        tzsp_utils_string(context->ssid, sizeof(context->ssid), value, len);
+}
 
-        context->flags1 = value[NV2_BEACON_INFO_FLAGS_1];
-        context->flags2 = value[NV2_BEACON_INFO_FLAGS_2];
+static void
+nv2_beacon_tag_radioname(nv2_net_t     *context,
+                         uint8_t        len,
+                         const uint8_t *value)
+{
+    if(!context->radioname[0])
+        tzsp_utils_string(context->radioname, sizeof(context->radioname), value, len);
+}
 
-        context->rates_ofdm = value[NV2_BEACON_INFO_RATES_OFDM];
-    }
-    else if(type == NV2_BEACON_TAG_VERSION &&
-            len == NV2_BEACON_TAG_VERSION_LEN &&
-            !context->version)
-    {
-        /* RouterOS version */
-        context->version = ie_mikrotik_version(value[NV2_BEACON_VERSION_MAJOR],
-                                               value[NV2_BEACON_VERSION_MINOR],
-                                               value[NV2_BEACON_VERSION_TYPE],
-                                               value[NV2_BEACON_VERSION_REV]);
-    }
-    else if(type == NV2_BEACON_TAG_HT_EXTENDED &&
-            len == NV2_BEACON_TAG_HT_EXT_LEN)
-    {
-        /* >=MCS16 rates */
+static void
+nv2_beacon_tag_info(nv2_net_t     *context,
+                    uint8_t        len,
+                    const uint8_t *value)
+{
+    /* Info (channel, rates, flags, etc) */
+    context->frequency = (value[NV2_BEACON_INFO_FREQUENCY_H] << 8) |
+                          value[NV2_BEACON_INFO_FREQUENCY_L];
 
-    }
-    else if(type == NV2_BEACON_TAG_80211AC &&
-            len == NV2_BEACON_TAG_80211AC_LEN)
-    {
-        /* 802.11ac */
-        context->vht = true;
-        context->vht_chan = value[NV2_BEACON_AC_EXT_CHAN];
-    }
+    context->flags1 = value[NV2_BEACON_INFO_FLAGS_1];
+    context->flags2 = value[NV2_BEACON_INFO_FLAGS_2];
+
+    context->rates_ofdm = value[NV2_BEACON_INFO_RATES_OFDM];
+}
+
+static void
+nv2_beacon_tag_version(nv2_net_t     *context,
+                       uint8_t        len,
+                       const uint8_t *value)
+{
+    /* RouterOS version */
+    if(!context->version[0])
+        ie_mikrotik_version(context->version,
+                            sizeof(context->version),
+                            value[NV2_BEACON_VERSION_MAJOR],
+                            value[NV2_BEACON_VERSION_MINOR],
+                            value[NV2_BEACON_VERSION_TYPE],
+                            value[NV2_BEACON_VERSION_REV]);
+}
+
+static void
+nv2_beacon_tag_80211ac(nv2_net_t     *context,
+                       uint8_t        len,
+                       const uint8_t *value)
+{
+    /* 802.11ac */
+    context->vht = true;
+    context->vht_chan = value[NV2_BEACON_AC_EXT_CHAN];
 }
 
 bool
@@ -386,19 +396,19 @@ nv2_net_get_frequency(nv2_net_t *context)
 const char*
 nv2_net_get_ssid(nv2_net_t *context)
 {
-    return context->ssid;
+    return (context->ssid[0] ? context->ssid : NULL);
 }
 
 const char*
 nv2_net_get_radioname(nv2_net_t *context)
 {
-    return context->radioname;
+    return (context->radioname[0] ? context->radioname : NULL);
 }
 
 const char*
 nv2_net_get_version(nv2_net_t *context)
 {
-    return context->version;
+    return (context->version[0] ? context->version : NULL);
 }
 
 const char*
@@ -446,15 +456,3 @@ nv2_net_get_ext_channel(nv2_net_t *context)
     }
     return NULL;
 }
-
-void
-nv2_net_free(nv2_net_t *context)
-{
-    if(context)
-    {
-        free(context->version);
-        free(context->radioname);
-        free(context->ssid);
-        free(context);
-    }
-}
@@ -15,10 +15,25 @@
 
 #ifndef MTSCAN_TZSP_NV2_H
 #define MTSCAN_TZSP_NV2_H
-
-typedef struct nv2_net nv2_net_t;
-
-nv2_net_t* nv2_network(const uint8_t*, uint32_t, const uint8_t**);
+#include <stdint.h>
+#include <stdbool.h>
+#include "ie-mikrotik-utils.h"
+#include "utils.h"
+
+typedef struct nv2_net
+{
+    uint8_t flags1;
+    uint8_t flags2;
+    uint8_t rates_ofdm;
+    bool vht;
+    uint8_t vht_chan;
+    uint16_t frequency;
+    char ssid[TZSP_UTILS_STRING_MAX];
+    char radioname[TZSP_UTILS_STRING_MAX];
+    char version[IE_MIKROTIK_VERSION_LEN];
+} nv2_net_t;
+
+bool nv2_network(nv2_net_t*, const uint8_t*, uint32_t, const uint8_t**);
 
 bool nv2_net_is_ofdm(nv2_net_t*);
 bool nv2_net_is_ht(nv2_net_t*);
@@ -39,6 +54,4 @@ const char* nv2_net_get_version(nv2_net_t*);
 const char* nv2_net_get_mode(nv2_net_t*);
 const char* nv2_net_get_ext_channel(nv2_net_t*);
 
-void nv2_net_free(nv2_net_t*);
-
 #endif
@@ -0,0 +1,1159 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+/* Headless network collector, frames are aggregated per BSSID
+   the same way as in the network list of the main application */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "mac80211.h"
+#include "nv2.h"
+#include "tzsp-collector.h"
+
+#define TZSP_COLLECTOR_BUCKETS_MIN      1024
+#define TZSP_COLLECTOR_SAMPLES_MIN        16
+#define TZSP_COLLECTOR_STREAM_BUFFER    (1 << 20)
+#define TZSP_COLLECTOR_STREAM_INTERVAL     1
+#define TZSP_COLLECTOR_WRITE_CHUNK     65536
+#define TZSP_COLLECTOR_CHANNEL_LEN        24
+#define TZSP_COLLECTOR_MODE_LEN            3
+#define TZSP_COLLECTOR_SOURCE_LEN         17
+#define TZSP_COLLECTOR_NO_SIGNAL    INT8_MIN
+#define TZSP_COLLECTOR_GZ_SUFFIX       ".gz"
+#define TZSP_COLLECTOR_TMP_SUFFIX     ".tmp"
+
+typedef struct tzsp_collector_flags
+{
+    bool privacy;
+    bool routeros;
+    bool nstreme;
+    bool tdma;
+    bool wds;
+    bool bridge;
+    bool airmax;
+    bool airmax_ptp;
+    bool airmax_ptmp;
+    bool airmax_mixed;
+} tzsp_collector_flags_t;
+
+typedef struct tzsp_collector_sample
+{
+    int64_t timestamp;
+    int8_t rssi;
+    double lat;
+    double lon;
+} tzsp_collector_sample_t;
+
+typedef struct tzsp_collector_net
+{
+    uint64_t address;
+    int frequency;
+    char channel[TZSP_COLLECTOR_CHANNEL_LEN];
+    char mode[TZSP_COLLECTOR_MODE_LEN+1];
+    uint8_t streams;
+    tzsp_collector_flags_t flags;
+    char *ssid;
+    char *radioname;
+    char *routeros_ver;
+    int8_t rssi;
+    int64_t firstseen;
+    int64_t lastseen;
+    double lat;
+    double lon;
+    char source[TZSP_COLLECTOR_SOURCE_LEN+1];
+    tzsp_collector_sample_t *samples;
+    uint32_t samples_count;
+    uint32_t samples_size;
+    int64_t streamed;
+    struct tzsp_collector_net *next;
+} tzsp_collector_net_t;
+
+/* Single parsed frame, the strings point to the parser data */
+typedef struct tzsp_collector_obs
+{
+    mac80211_net_t net_80211_data;
+    nv2_net_t net_nv2_data;
+    uint64_t address;
+    int frequency;
+    char channel[TZSP_COLLECTOR_CHANNEL_LEN];
+    const char *mode;
+    uint8_t streams;
+    tzsp_collector_flags_t flags;
+    const char *ssid;
+    const char *radioname;
+    const char *routeros_ver;
+} tzsp_collector_obs_t;
+
+typedef struct tzsp_collector_buf
+{
+    char *data;
+    size_t len;
+    size_t size;
+    bool failed;
+} tzsp_collector_buf_t;
+
+/* Copy of the network table, written out by the saver thread */
+typedef struct tzsp_collector_snapshot
+{
+    tzsp_collector_net_t *nets;
+    uint32_t count;
+} tzsp_collector_snapshot_t;
+
+typedef struct tzsp_collector
+{
+    /* Configuration */
+    int channel_width;
+    int frequency_base;
+    char *log;
+    uint32_t log_interval;
+    bool samples;
+    tzsp_gpsd_t *gpsd;
+
+    /* Networks by BSSID */
+    tzsp_collector_net_t **buckets;
+    uint32_t buckets_count;
+    uint32_t networks;
+
+    /* Outputs */
+    FILE *stream;
+    tzsp_collector_buf_t buf;
+    int64_t second;
+    int64_t saved;
+
+    /* Periodic log writes, kept out of the receive loop */
+    pthread_t saver;
+    pthread_mutex_t saver_mutex;
+    pthread_cond_t saver_cond;
+    tzsp_collector_snapshot_t *pending;
+    tzsp_collector_buf_t saver_buf;
+    bool saver_running;
+    bool saver_stop;
+
+    /* Position, refreshed once a second */
+    bool fix;
+    double lat;
+    double lon;
+} tzsp_collector_t;
+
+static bool tzsp_collector_parse(const tzsp_collector_t*, tzsp_collector_obs_t*, const uint8_t*, uint32_t, const uint8_t*);
+static void tzsp_collector_tick(tzsp_collector_t*, int64_t);
+static tzsp_collector_snapshot_t* tzsp_collector_snapshot(const tzsp_collector_t*);
+static void tzsp_collector_snapshot_free(tzsp_collector_snapshot_t*);
+static bool tzsp_collector_save_snapshot(const tzsp_collector_t*, tzsp_collector_buf_t*, const tzsp_collector_snapshot_t*);
+static void* tzsp_collector_saver(void*);
+static void tzsp_collector_saver_stop(tzsp_collector_t*);
+static tzsp_collector_net_t* tzsp_collector_lookup(tzsp_collector_t*, uint64_t);
+static uint32_t tzsp_collector_bucket(uint64_t, uint32_t);
+static void tzsp_collector_grow(tzsp_collector_t*);
+static void tzsp_collector_update(tzsp_collector_t*, tzsp_collector_net_t*, const tzsp_collector_obs_t*, int64_t, const int8_t*, const uint8_t*);
+static void tzsp_collector_string(char**, const char*);
+static void tzsp_collector_sample(tzsp_collector_net_t*, int64_t, int8_t, double, double);
+static void tzsp_collector_stream(tzsp_collector_t*, const tzsp_collector_net_t*);
+static void tzsp_collector_json(tzsp_collector_buf_t*, const tzsp_collector_net_t*, bool);
+static bool tzsp_collector_write(FILE*, gzFile, tzsp_collector_buf_t*);
+static void tzsp_collector_net_free(tzsp_collector_net_t*);
+
+static bool tzsp_collector_buf_reserve(tzsp_collector_buf_t*, size_t);
+static void tzsp_collector_buf_append(tzsp_collector_buf_t*, const char*, size_t);
+static void tzsp_collector_buf_printf(tzsp_collector_buf_t*, const char*, ...);
+static void tzsp_collector_buf_key(tzsp_collector_buf_t*, const char*);
+static void tzsp_collector_buf_string(tzsp_collector_buf_t*, const char*);
+static void tzsp_collector_buf_double(tzsp_collector_buf_t*, double);
+static void tzsp_collector_buf_frequency(tzsp_collector_buf_t*, int);
+static int tzsp_collector_utf8(const uint8_t*);
+
+
+tzsp_collector_t*
+tzsp_collector_new()
+{
+    tzsp_collector_t *context = calloc(sizeof(tzsp_collector_t), 1);
+
+    if(context)
+    {
+        context->channel_width = 20;
+        context->frequency_base = 5000;
+    }
+    return context;
+}
+
+void
+tzsp_collector_set_band(tzsp_collector_t *context,
+                        int               channel_width,
+                        int               frequency_base)
+{
+    context->channel_width = channel_width;
+    context->frequency_base = frequency_base;
+}
+
+void
+tzsp_collector_set_log(tzsp_collector_t *context,
+                       const char       *filename,
+                       uint32_t          interval)
+{
+    free(context->log);
+    context->log = (filename ? strdup(filename) : NULL);
+    context->log_interval = interval;
+}
+
+void
+tzsp_collector_set_samples(tzsp_collector_t *context,
+                           bool              samples)
+{
+    context->samples = samples;
+}
+
+void
+tzsp_collector_set_gpsd(tzsp_collector_t *context,
+                        tzsp_gpsd_t      *gpsd)
+{
+    context->gpsd = gpsd;
+}
+
+int
+tzsp_collector_init(tzsp_collector_t *context,
+                    const char       *stream)
+{
+    context->buckets_count = TZSP_COLLECTOR_BUCKETS_MIN;
+    context->buckets = calloc(sizeof(tzsp_collector_net_t*), context->buckets_count);
+    if(!context->buckets)
+        return TZSP_COLLECTOR_ERROR_MEMORY;
+
+    if(stream)
+    {
+        if(strcmp(stream, "-") == 0)
+            context->stream = stdout;
+        else if(!(context->stream = fopen(stream, "a")))
+            return TZSP_COLLECTOR_ERROR_OPEN;
+
+        /* Lines are flushed once a second at most */
+        setvbuf(context->stream, NULL, _IOFBF, TZSP_COLLECTOR_STREAM_BUFFER);
+    }
+
+    context->second = -1;
+    context->saved = -1;
+
+    if(context->log && context->log_interval)
+    {
+        pthread_mutex_init(&context->saver_mutex, NULL);
+        pthread_cond_init(&context->saver_cond, NULL);
+        if(pthread_create(&context->saver, NULL, tzsp_collector_saver, context) != 0)
+        {
+            pthread_cond_destroy(&context->saver_cond);
+            pthread_mutex_destroy(&context->saver_mutex);
+            return TZSP_COLLECTOR_ERROR_MEMORY;
+        }
+        context->saver_running = true;
+    }
+    return TZSP_COLLECTOR_OK;
+}
+
+bool
+tzsp_collector_frame(tzsp_collector_t *context,
+                     int64_t           timestamp,
+                     const uint8_t    *packet,
+                     uint32_t          len,
+                     const int8_t     *rssi,
+                     const uint8_t    *channel,
+                     const uint8_t    *sensor_mac)
+{
+    tzsp_collector_obs_t obs;
+    tzsp_collector_net_t *net;
+
+    if(timestamp != context->second)
+        tzsp_collector_tick(context, timestamp);
+
+    if(!tzsp_collector_parse(context, &obs, packet, len, channel))
+        return false;
+
+    net = tzsp_collector_lookup(context, obs.address);
+    if(!net)
+        return false;
+
+    tzsp_collector_update(context, net, &obs, timestamp, rssi, sensor_mac);
+
+    if(context->stream &&
+       timestamp - net->streamed >= TZSP_COLLECTOR_STREAM_INTERVAL)
+    {
+        tzsp_collector_stream(context, net);
+        net->streamed = timestamp;
+    }
+    return true;
+}
+
+bool
+tzsp_collector_save(tzsp_collector_t *context)
+{
+    tzsp_collector_snapshot_t *snapshot;
+    bool ret;
+
+    if(!context->log)
+        return true;
+
+    /* Let the periodic writes finish first */
+    tzsp_collector_saver_stop(context);
+
+    if(!(snapshot = tzsp_collector_snapshot(context)))
+        return false;
+
+    ret = tzsp_collector_save_snapshot(context, &context->saver_buf, snapshot);
+    tzsp_collector_snapshot_free(snapshot);
+    return ret;
+}
+
+uint32_t
+tzsp_collector_get_networks(const tzsp_collector_t *context)
+{
+    return context->networks;
+}
+
+void
+tzsp_collector_free(tzsp_collector_t *context)
+{
+    tzsp_collector_net_t *net;
+    tzsp_collector_net_t *next;
+    uint32_t i;
+
+    if(!context)
+        return;
+
+    for(i=0; i<context->buckets_count; i++)
+    {
+        for(net = context->buckets[i]; net; net = next)
+        {
+            next = net->next;
+            tzsp_collector_net_free(net);
+        }
+    }
+    free(context->buckets);
+
+    if(context->stream)
+    {
+        if(context->stream == stdout)
+            fflush(stdout);
+        else
+            fclose(context->stream);
+    }
+
+    tzsp_collector_saver_stop(context);
+    free(context->buf.data);
+    free(context->saver_buf.data);
+    free(context->log);
+    free(context);
+}
+
+static bool
+tzsp_collector_parse(const tzsp_collector_t *context,
+                     tzsp_collector_obs_t   *obs,
+                     const uint8_t          *packet,
+                     uint32_t                len,
+                     const uint8_t          *channel)
+{
+    mac80211_net_t *net_80211 = NULL;
+    nv2_net_t *net_nv2 = NULL;
+    const uint8_t *src;
+    const char *ext_channel;
+    int i;
+
+    if(nv2_network(&obs->net_nv2_data, packet, len, &src))
+        net_nv2 = &obs->net_nv2_data;
+    else
+    {
+        if(!mac80211_network(&obs->net_80211_data, packet, len, &src))
+            return false;
+        net_80211 = &obs->net_80211_data;
+
+        if(net_80211->source != MAC80211_FRAME_BEACON &&
+           net_80211->source != MAC80211_FRAME_PROBE_RESPONSE)
+            return false;
+    }
+
+    obs->address = 0;
+    for(i=0; i<6; i++)
+        obs->address = (obs->address << 8) | src[i];
+
+    memset(&obs->flags, 0, sizeof(obs->flags));
+    obs->frequency = 0;
+    obs->mode = "";
+    obs->ssid = NULL;
+    obs->radioname = NULL;
+    obs->routeros_ver = NULL;
+
+    if(net_80211)
+    {
+        if(net_80211->ie_mikrotik)
+        {
+            obs->radioname = ie_mikrotik_get_radioname(net_80211->ie_mikrotik);
+            obs->routeros_ver = ie_mikrotik_get_version(net_80211->ie_mikrotik);
+            obs->frequency = ie_mikrotik_get_frequency(net_80211->ie_mikrotik) * 1000;
+            obs->flags.routeros = true;
+            obs->flags.nstreme = ie_mikrotik_is_nstreme(net_80211->ie_mikrotik);
+            obs->flags.wds = ie_mikrotik_is_wds(net_80211->ie_mikrotik);
+            obs->flags.bridge = ie_mikrotik_is_bridge(net_80211->ie_mikrotik);
+        }
+
+        obs->flags.airmax = net_80211->ie_airmax;
+        if(net_80211->ie_airmax_ac)
+        {
+            obs->flags.airmax = true;
+            obs->ssid = ie_airmax_ac_get_ssid(net_80211->ie_airmax_ac);
+            if(!obs->radioname)
+                obs->radioname = ie_airmax_ac_get_radioname(net_80211->ie_airmax_ac);
+            obs->flags.airmax_ptp = ie_airmax_ac_is_ptp(net_80211->ie_airmax_ac);
+            obs->flags.airmax_ptmp = ie_airmax_ac_is_ptmp(net_80211->ie_airmax_ac);
+            obs->flags.airmax_mixed = ie_airmax_ac_is_mixed(net_80211->ie_airmax_ac);
+        }
+
+        if(!obs->frequency && channel)
+            obs->frequency = (*channel * 5 + context->frequency_base) * 1000;
+
+        if(!obs->ssid)
+            obs->ssid = mac80211_net_get_ssid(net_80211);
+        if(!obs->radioname)
+            obs->radioname = mac80211_net_get_radioname(net_80211);
+
+        obs->streams = mac80211_net_get_chains(net_80211);
+        obs->flags.privacy = mac80211_net_is_privacy(net_80211);
+        ext_channel = mac80211_net_get_ext_channel(net_80211);
+
+        if(mac80211_net_is_vht(net_80211))
+            obs->mode = "ac";
+        else if(mac80211_net_is_ht(net_80211))
+            obs->mode = (obs->frequency && obs->frequency < 3000000) ? "gn" : "an";
+        else if(mac80211_net_is_ofdm(net_80211))
+            obs->mode = (obs->frequency && obs->frequency < 3000000) ? "g" : "a";
+        else if(mac80211_net_is_dsss(net_80211))
+            obs->mode = "b";
+    }
+    else
+    {
+        obs->ssid = nv2_net_get_ssid(net_nv2);
+        obs->radioname = nv2_net_get_radioname(net_nv2);
+        obs->routeros_ver = nv2_net_get_version(net_nv2);
+        obs->frequency = nv2_net_get_frequency(net_nv2) * 1000;
+        obs->flags.privacy = nv2_net_is_privacy(net_nv2);
+        obs->flags.routeros = true;
+        obs->flags.tdma = true;
+        obs->flags.wds = nv2_net_is_wds(net_nv2);
+        obs->flags.bridge = nv2_net_is_bridge(net_nv2);
+        obs->streams = nv2_net_get_chains(net_nv2);
+        ext_channel = nv2_net_get_ext_channel(net_nv2);
+
+        if(nv2_net_is_vht(net_nv2))
+            obs->mode = "ac";
+        else if(nv2_net_is_ht(net_nv2))
+            obs->mode = (nv2_net_get_frequency(net_nv2) < 3000) ? "gn" : "an";
+        else if(nv2_net_get_frequency(net_nv2) < 3000)
+            obs->mode = nv2_net_is_ofdm(net_nv2) ? "g" : "b";
+        else
+            obs->mode = "a";
+    }
+
+    if(ext_channel)
+        snprintf(obs->channel, sizeof(obs->channel), "%d-%s", context->channel_width, ext_channel);
+    else
+        snprintf(obs->channel, sizeof(obs->channel), "%d", context->channel_width);
+
+    return true;
+}
+
+static void
+tzsp_collector_tick(tzsp_collector_t *context,
+                    int64_t           timestamp)
+{
+    context->second = timestamp;
+
+    if(context->gpsd)
+        context->fix = tzsp_gpsd_get_fix(context->gpsd, &context->lat, &context->lon);
+
+    if(context->stream)
+        fflush(context->stream);
+
+    if(context->saved < 0)
+        context->saved = timestamp;
+
+    if(context->log &&
+       context->log_interval &&
+       timestamp - context->saved >= context->log_interval &&
+       context->saver_running)
+    {
+        pthread_mutex_lock(&context->saver_mutex);
+        if(!context->pending)
+        {
+            /* Only the copy is made here, the saver does the rest */
+            context->pending = tzsp_collector_snapshot(context);
+            pthread_cond_signal(&context->saver_cond);
+            context->saved = timestamp;
+        }
+        pthread_mutex_unlock(&context->saver_mutex);
+    }
+}
+
+static tzsp_collector_snapshot_t*
+tzsp_collector_snapshot(const tzsp_collector_t *context)
+{
+    tzsp_collector_snapshot_t *snapshot;
+    const tzsp_collector_net_t *net;
+    tzsp_collector_net_t *copy;
+    uint32_t i;
+
+    if(!(snapshot = calloc(sizeof(tzsp_collector_snapshot_t), 1)))
+        return NULL;
+
+    if(context->networks &&
+       !(snapshot->nets = calloc(sizeof(tzsp_collector_net_t), context->networks)))
+    {
+        free(snapshot);
+        return NULL;
+    }
+
+    for(i=0; i<context->buckets_count; i++)
+    {
+        for(net = context->buckets[i]; net; net = net->next)
+        {
+            copy = &snapshot->nets[snapshot->count++];
+            *copy = *net;
+            copy->next = NULL;
+            copy->ssid = (net->ssid ? strdup(net->ssid) : NULL);
+            copy->radioname = (net->radioname ? strdup(net->radioname) : NULL);
+            copy->routeros_ver = (net->routeros_ver ? strdup(net->routeros_ver) : NULL);
+            copy->samples = NULL;
+            copy->samples_count = 0;
+            copy->samples_size = 0;
+
+            if(context->samples &&
+               net->samples_count &&
+               (copy->samples = malloc(sizeof(tzsp_collector_sample_t) * net->samples_count)))
+            {
+                memcpy(copy->samples, net->samples, sizeof(tzsp_collector_sample_t) * net->samples_count);
+                copy->samples_count = net->samples_count;
+                copy->samples_size = net->samples_count;
+            }
+        }
+    }
+    return snapshot;
+}
+
+static void
+tzsp_collector_snapshot_free(tzsp_collector_snapshot_t *snapshot)
+{
+    uint32_t i;
+
+    for(i=0; i<snapshot->count; i++)
+    {
+        free(snapshot->nets[i].ssid);
+        free(snapshot->nets[i].radioname);
+        free(snapshot->nets[i].routeros_ver);
+        free(snapshot->nets[i].samples);
+    }
+    free(snapshot->nets);
+    free(snapshot);
+}
+
+static bool
+tzsp_collector_save_snapshot(const tzsp_collector_t          *context,
+                             tzsp_collector_buf_t            *buf,
+                             const tzsp_collector_snapshot_t *snapshot)
+{
+    const tzsp_collector_net_t *net;
+    char *tmp;
+    FILE *fp = NULL;
+    gzFile gz = NULL;
+    size_t len;
+    bool ret = true;
+    uint32_t i;
+
+    /* Readers never see a partially written log */
+    len = strlen(context->log);
+    if(!(tmp = malloc(len + sizeof(TZSP_COLLECTOR_TMP_SUFFIX))))
+        return false;
+    memcpy(tmp, context->log, len);
+    memcpy(tmp + len, TZSP_COLLECTOR_TMP_SUFFIX, sizeof(TZSP_COLLECTOR_TMP_SUFFIX));
+
+    if(len > strlen(TZSP_COLLECTOR_GZ_SUFFIX) &&
+       strcmp(context->log + len - strlen(TZSP_COLLECTOR_GZ_SUFFIX), TZSP_COLLECTOR_GZ_SUFFIX) == 0)
+        gz = gzopen(tmp, "wb");
+    else
+        fp = fopen(tmp, "w");
+
+    if(!fp && !gz)
+    {
+        free(tmp);
+        return false;
+    }
+
+    buf->len = 0;
+    buf->failed = false;
+    tzsp_collector_buf_append(buf, "{", 1);
+
+    for(i=0; i<snapshot->count && ret; i++)
+    {
+        net = &snapshot->nets[i];
+        if(i)
+            tzsp_collector_buf_append(buf, ",", 1);
+
+        tzsp_collector_buf_printf(buf, "\"%012" PRIX64 "\":", net->address);
+        tzsp_collector_json(buf, net, context->samples);
+
+        if(buf->len >= TZSP_COLLECTOR_WRITE_CHUNK)
+            ret = tzsp_collector_write(fp, gz, buf);
+    }
+
+    if(ret)
+    {
+        tzsp_collector_buf_append(buf, "}", 1);
+        ret = tzsp_collector_write(fp, gz, buf);
+    }
+
+    if(fp && fclose(fp) != 0)
+        ret = false;
+    if(gz && gzclose(gz) != Z_OK)
+        ret = false;
+
+    if(ret)
+        ret = (rename(tmp, context->log) == 0);
+    else
+        remove(tmp);
+
+    free(tmp);
+    return ret;
+}
+
+static void*
+tzsp_collector_saver(void *user_data)
+{
+    tzsp_collector_t *context = (tzsp_collector_t*)user_data;
+    tzsp_collector_snapshot_t *snapshot;
+
+    pthread_mutex_lock(&context->saver_mutex);
+    while(true)
+    {
+        while(!context->pending && !context->saver_stop)
+            pthread_cond_wait(&context->saver_cond, &context->saver_mutex);
+
+        if(!(snapshot = context->pending))
+            break;
+        pthread_mutex_unlock(&context->saver_mutex);
+
+        /* Compression and disk writes happen outside of the lock */
+        if(!tzsp_collector_save_snapshot(context, &context->saver_buf, snapshot))
+            fprintf(stderr, "Could not write log file %s\n", context->log);
+        tzsp_collector_snapshot_free(snapshot);
+
+        pthread_mutex_lock(&context->saver_mutex);
+        context->pending = NULL;
+    }
+    pthread_mutex_unlock(&context->saver_mutex);
+    return NULL;
+}
+
+static void
+tzsp_collector_saver_stop(tzsp_collector_t *context)
+{
+    if(!context->saver_running)
+        return;
+
+    /* The pending snapshot is still written */
+    pthread_mutex_lock(&context->saver_mutex);
+    context->saver_stop = true;
+    pthread_cond_signal(&context->saver_cond);
+    pthread_mutex_unlock(&context->saver_mutex);
+    pthread_join(context->saver, NULL);
+
+    pthread_cond_destroy(&context->saver_cond);
+    pthread_mutex_destroy(&context->saver_mutex);
+    context->saver_running = false;
+}
+
+static tzsp_collector_net_t*
+tzsp_collector_lookup(tzsp_collector_t *context,
+                      uint64_t          address)
+{
+    tzsp_collector_net_t *net;
+    uint32_t bucket;
+
+    bucket = tzsp_collector_bucket(address, context->buckets_count);
+    for(net = context->buckets[bucket]; net; net = net->next)
+    {
+        if(net->address == address)
+            return net;
+    }
+
+    if(!(net = calloc(sizeof(tzsp_collector_net_t), 1)))
+        return NULL;
+
+    net->address = address;
+    net->rssi = TZSP_COLLECTOR_NO_SIGNAL;
+    net->firstseen = INT64_MAX;
+    net->lastseen = INT64_MIN;
+    net->lat = NAN;
+    net->lon = NAN;
+    net->streamed = INT64_MIN / 2;
+
+    net->next = context->buckets[bucket];
+    context->buckets[bucket] = net;
+
+    if(++context->networks > context->buckets_count)
+        tzsp_collector_grow(context);
+
+    return net;
+}
+
+static uint32_t
+tzsp_collector_bucket(uint64_t address,
+                      uint32_t count)
+{
+    /* Vendors share the upper half of the address, mix it well */
+    return (uint32_t)((address * 0x9E3779B97F4A7C15ULL) >> 32) & (count - 1);
+}
+
+static void
+tzsp_collector_grow(tzsp_collector_t *context)
+{
+    tzsp_collector_net_t **buckets;
+    tzsp_collector_net_t *net;
+    tzsp_collector_net_t *next;
+    uint32_t count = context->buckets_count * 2;
+    uint32_t bucket;
+    uint32_t i;
+
+    /* Keep the current table when out of memory, only longer chains */
+    if(!(buckets = calloc(sizeof(tzsp_collector_net_t*), count)))
+        return;
+
+    for(i=0; i<context->buckets_count; i++)
+    {
+        for(net = context->buckets[i]; net; net = next)
+        {
+            next = net->next;
+            bucket = tzsp_collector_bucket(net->address, count);
+            net->next = buckets[bucket];
+            buckets[bucket] = net;
+        }
+    }
+
+    free(context->buckets);
+    context->buckets = buckets;
+    context->buckets_count = count;
+}
+
+static void
+tzsp_collector_update(tzsp_collector_t           *context,
+                      tzsp_collector_net_t       *net,
+                      const tzsp_collector_obs_t *obs,
+                      int64_t                     timestamp,
+                      const int8_t               *rssi,
+                      const uint8_t              *sensor_mac)
+{
+    double lat = (context->fix ? context->lat : NAN);
+    double lon = (context->fix ? context->lon : NAN);
+
+    if(obs->frequency)
+        net->frequency = obs->frequency;
+    memcpy(net->channel, obs->channel, sizeof(net->channel));
+    snprintf(net->mode, sizeof(net->mode), "%s", obs->mode);
+    net->streams = obs->streams;
+    net->flags = obs->flags;
+
+    /* Preserve hidden SSIDs and Radio Names */
+    tzsp_collector_string(&net->ssid, obs->ssid);
+    tzsp_collector_string(&net->radioname, obs->radioname);
+    tzsp_collector_string(&net->routeros_ver, obs->routeros_ver);
+
+    if(timestamp < net->firstseen)
+        net->firstseen = timestamp;
+    if(timestamp > net->lastseen)
+        net->lastseen = timestamp;
+
+    if(!rssi)
+        return;
+
+    /* At new signal peak, update the position and source */
+    if(*rssi > net->rssi)
+    {
+        net->rssi = *rssi;
+        net->lat = lat;
+        net->lon = lon;
+        if(sensor_mac)
+            snprintf(net->source, sizeof(net->source),
+                     "%02X:%02X:%02X:%02X:%02X:%02X",
+                     sensor_mac[0], sensor_mac[1], sensor_mac[2],
+                     sensor_mac[3], sensor_mac[4], sensor_mac[5]);
+    }
+
+    /* One signal sample per second is enough */
+    if(context->samples &&
+       (!net->samples_count || net->samples[net->samples_count-1].timestamp != timestamp))
+        tzsp_collector_sample(net, timestamp, *rssi, lat, lon);
+}
+
+static void
+tzsp_collector_string(char       **current,
+                      const char  *value)
+{
+    if(!value || !value[0])
+        return;
+
+    if(*current && strcmp(*current, value) == 0)
+        return;
+
+    free(*current);
+    *current = strdup(value);
+}
+
+static void
+tzsp_collector_sample(tzsp_collector_net_t *net,
+                      int64_t               timestamp,
+                      int8_t                rssi,
+                      double                lat,
+                      double                lon)
+{
+    tzsp_collector_sample_t *samples;
+    uint32_t size;
+
+    if(net->samples_count == net->samples_size)
+    {
+        size = (net->samples_size ? net->samples_size * 2 : TZSP_COLLECTOR_SAMPLES_MIN);
+        if(!(samples = realloc(net->samples, size * sizeof(tzsp_collector_sample_t))))
+            return;
+        net->samples = samples;
+        net->samples_size = size;
+    }
+
+    net->samples[net->samples_count].timestamp = timestamp;
+    net->samples[net->samples_count].rssi = rssi;
+    net->samples[net->samples_count].lat = lat;
+    net->samples[net->samples_count].lon = lon;
+    net->samples_count++;
+}
+
+static void
+tzsp_collector_stream(tzsp_collector_t           *context,
+                      const tzsp_collector_net_t *net)
+{
+    tzsp_collector_buf_t *buf = &context->buf;
+
+    buf->len = 0;
+    buf->failed = false;
+
+    /* One self-contained object per line, without signal samples */
+    tzsp_collector_buf_printf(buf, "{\"address\":\"%012" PRIX64 "\",\"network\":", net->address);
+    tzsp_collector_json(buf, net, false);
+    tzsp_collector_buf_append(buf, "}\n", 2);
+
+    if(!buf->failed)
+        fwrite(buf->data, 1, buf->len, context->stream);
+}
+
+static void
+tzsp_collector_json(tzsp_collector_buf_t       *buf,
+                    const tzsp_collector_net_t *net,
+                    bool                        samples)
+{
+    const tzsp_collector_sample_t *sample;
+    uint32_t i;
+
+    /* Same keys as in the mtscan log format */
+    tzsp_collector_buf_append(buf, "{", 1);
+
+    tzsp_collector_buf_key(buf, "freq");
+    tzsp_collector_buf_frequency(buf, net->frequency);
+
+    tzsp_collector_buf_append(buf, ",", 1);
+    tzsp_collector_buf_key(buf, "chan");
+    tzsp_collector_buf_string(buf, net->channel);
+
+    tzsp_collector_buf_append(buf, ",", 1);
+    tzsp_collector_buf_key(buf, "mode");
+    tzsp_collector_buf_string(buf, net->mode);
+
+    if(net->streams)
+        tzsp_collector_buf_printf(buf, ",\"ss\":%u", net->streams);
+
+    tzsp_collector_buf_append(buf, ",", 1);
+    tzsp_collector_buf_key(buf, "ssid");
+    tzsp_collector_buf_string(buf, (net->ssid ? net->ssid : ""));
+
+    tzsp_collector_buf_append(buf, ",", 1);
+    tzsp_collector_buf_key(buf, "name");
+    tzsp_collector_buf_string(buf, (net->radioname ? net->radioname : ""));
+
+    tzsp_collector_buf_printf(buf, ",\"s\":%d", net->rssi);
+    tzsp_collector_buf_printf(buf, ",\"priv\":%d", net->flags.privacy);
+
+    tzsp_collector_buf_append(buf, ",", 1);
+    tzsp_collector_buf_key(buf, "ros");
+    if(net->routeros_ver)
+        tzsp_collector_buf_string(buf, net->routeros_ver);
+    else
+        tzsp_collector_buf_printf(buf, "%d", net->flags.routeros);
+
+    if(net->flags.routeros)
+    {
+        tzsp_collector_buf_printf(buf, ",\"ns\":%d,\"tdma\":%d,\"wds\":%d,\"br\":%d",
+                                  net->flags.nstreme, net->flags.tdma,
+                                  net->flags.wds, net->flags.bridge);
+    }
+
+    tzsp_collector_buf_printf(buf, ",\"airmax\":%d", net->flags.airmax);
+    if(net->flags.airmax)
+    {
+        tzsp_collector_buf_printf(buf, ",\"airmax-ac-ptp\":%d,\"airmax-ac-ptmp\":%d,\"airmax-ac-mixed\":%d",
+                                  net->flags.airmax_ptp, net->flags.airmax_ptmp,
+                                  net->flags.airmax_mixed);
+    }
+
+    tzsp_collector_buf_printf(buf, ",\"first\":%" PRId64 ",\"last\":%" PRId64,
+                              net->firstseen, net->lastseen);
+
+    if(!isnan(net->lat) && !isnan(net->lon))
+    {
+        tzsp_collector_buf_append(buf, ",\"lat\":", 7);
+        tzsp_collector_buf_double(buf, net->lat);
+        tzsp_collector_buf_append(buf, ",\"lon\":", 7);
+        tzsp_collector_buf_double(buf, net->lon);
+    }
+
+    if(net->source[0])
+    {
+        tzsp_collector_buf_append(buf, ",", 1);
+        tzsp_collector_buf_key(buf, "src");
+        tzsp_collector_buf_string(buf, net->source);
+    }
+
+    if(samples && net->samples_count)
+    {
+        tzsp_collector_buf_append(buf, ",\"signals\":[", 12);
+        for(i=0; i<net->samples_count; i++)
+        {
+            sample = &net->samples[i];
+            tzsp_collector_buf_printf(buf, "%s{\"t\":%" PRId64 ",\"s\":%d",
+                                      (i ? "," : ""), sample->timestamp, sample->rssi);
+            if(!isnan(sample->lat) && !isnan(sample->lon))
+            {
+                tzsp_collector_buf_append(buf, ",\"lat\":", 7);
+                tzsp_collector_buf_double(buf, sample->lat);
+                tzsp_collector_buf_append(buf, ",\"lon\":", 7);
+                tzsp_collector_buf_double(buf, sample->lon);
+            }
+            tzsp_collector_buf_append(buf, "}", 1);
+        }
+        tzsp_collector_buf_append(buf, "]", 1);
+    }
+
+    tzsp_collector_buf_append(buf, "}", 1);
+}
+
+static bool
+tzsp_collector_write(FILE                 *fp,
+                     gzFile                gz,
+                     tzsp_collector_buf_t *buf)
+{
+    bool ret;
+
+    if(buf->failed)
+        return false;
+
+    if(gz)
+        ret = (!buf->len || gzwrite(gz, buf->data, buf->len) == (int)buf->len);
+    else
+        ret = (fwrite(buf->data, 1, buf->len, fp) == buf->len);
+
+    buf->len = 0;
+    return ret;
+}
+
+static void
+tzsp_collector_net_free(tzsp_collector_net_t *net)
+{
+    free(net->ssid);
+    free(net->radioname);
+    free(net->routeros_ver);
+    free(net->samples);
+    free(net);
+}
+
+static bool
+tzsp_collector_buf_reserve(tzsp_collector_buf_t *buf,
+                           size_t                len)
+{
+    size_t size;
+    char *data;
+
+    if(buf->failed)
+        return false;
+
+    if(buf->len + len <= buf->size)
+        return true;
+
+    size = (buf->size ? buf->size : 4096);
+    while(size < buf->len + len)
+        size *= 2;
+
+    if(!(data = realloc(buf->data, size)))
+    {
+        buf->failed = true;
+        return false;
+    }
+
+    buf->data = data;
+    buf->size = size;
+    return true;
+}
+
+static void
+tzsp_collector_buf_append(tzsp_collector_buf_t *buf,
+                          const char           *data,
+                          size_t                len)
+{
+    if(!tzsp_collector_buf_reserve(buf, len))
+        return;
+
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+static void
+tzsp_collector_buf_printf(tzsp_collector_buf_t *buf,
+                          const char           *format,
+                          ...)
+{
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if(len < 0 || !tzsp_collector_buf_reserve(buf, len + 1))
+        return;
+
+    va_start(args, format);
+    vsnprintf(buf->data + buf->len, len + 1, format, args);
+    va_end(args);
+    buf->len += len;
+}
+
+static void
+tzsp_collector_buf_key(tzsp_collector_buf_t *buf,
+                       const char           *key)
+{
+    tzsp_collector_buf_string(buf, key);
+    tzsp_collector_buf_append(buf, ":", 1);
+}
+
+static void
+tzsp_collector_buf_string(tzsp_collector_buf_t *buf,
+                          const char           *str)
+{
+    const uint8_t *ptr = (const uint8_t*)str;
+    int len;
+
+    tzsp_collector_buf_append(buf, "\"", 1);
+    while(*ptr)
+    {
+        if(*ptr == '"' || *ptr == '\\')
+        {
+            tzsp_collector_buf_append(buf, "\\", 1);
+            tzsp_collector_buf_append(buf, (const char*)ptr++, 1);
+        }
+        else if(*ptr < 0x20)
+        {
+            tzsp_collector_buf_printf(buf, "\\u%04x", *ptr++);
+        }
+        else if(*ptr < 0x80)
+        {
+            tzsp_collector_buf_append(buf, (const char*)ptr++, 1);
+        }
+        else if((len = tzsp_collector_utf8(ptr)))
+        {
+            tzsp_collector_buf_append(buf, (const char*)ptr, len);
+            ptr += len;
+        }
+        else
+        {
+            /* Not a valid UTF-8 sequence, the log must stay parseable */
+            tzsp_collector_buf_append(buf, "?", 1);
+            ptr++;
+        }
+    }
+    tzsp_collector_buf_append(buf, "\"", 1);
+}
+
+static void
+tzsp_collector_buf_double(tzsp_collector_buf_t *buf,
+                          double                value)
+{
+    char output[24];
+    int i;
+
+    snprintf(output, sizeof(output), "%.6f", value);
+    for(i=strlen(output)-1; i>0 && output[i] == '0'; i--);
+    if(output[i] == '.')
+        i--;
+    tzsp_collector_buf_append(buf, output, i+1);
+}
+
+static void
+tzsp_collector_buf_frequency(tzsp_collector_buf_t *buf,
+                             int                   value)
+{
+    char output[16];
+    int frac;
+    int i;
+
+    /* Frequency is stored in MHz */
+    if((frac = value % 1000))
+    {
+        snprintf(output, sizeof(output), "%d.%03d", value/1000, frac);
+        for(i=strlen(output)-1; i>=0 && output[i] == '0'; i--);
+        tzsp_collector_buf_append(buf, output, i+1);
+        return;
+    }
+
+    tzsp_collector_buf_printf(buf, "%d", value/1000);
+}
+
+static int
+tzsp_collector_utf8(const uint8_t *ptr)
+{
+    int len;
+    int i;
+
+    if(ptr[0] >= 0xC2 && ptr[0] <= 0xDF)
+        len = 2;
+    else if((ptr[0] & 0xF0) == 0xE0)
+        len = 3;
+    else if(ptr[0] >= 0xF0 && ptr[0] <= 0xF4)
+        len = 4;
+    else
+        return 0;
+
+    /* Stops at the terminating null as well */
+    for(i=1; i<len; i++)
+    {
+        if((ptr[i] & 0xC0) != 0x80)
+            return 0;
+    }
+    return len;
+}
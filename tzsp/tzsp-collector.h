@@ -0,0 +1,43 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_TZSP_COLLECTOR_H
+#define MTSCAN_TZSP_COLLECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tzsp-gpsd.h"
+
+typedef struct tzsp_collector tzsp_collector_t;
+
+enum
+{
+    TZSP_COLLECTOR_OK           =  0,
+    TZSP_COLLECTOR_ERROR_MEMORY = -1,
+    TZSP_COLLECTOR_ERROR_OPEN   = -2
+};
+
+tzsp_collector_t* tzsp_collector_new();
+void tzsp_collector_set_band(tzsp_collector_t*, int, int);
+void tzsp_collector_set_log(tzsp_collector_t*, const char*, uint32_t);
+void tzsp_collector_set_samples(tzsp_collector_t*, bool);
+void tzsp_collector_set_gpsd(tzsp_collector_t*, tzsp_gpsd_t*);
+int tzsp_collector_init(tzsp_collector_t*, const char*);
+bool tzsp_collector_frame(tzsp_collector_t*, int64_t, const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*);
+bool tzsp_collector_save(tzsp_collector_t*);
+uint32_t tzsp_collector_get_networks(const tzsp_collector_t*);
+void tzsp_collector_free(tzsp_collector_t*);
+
+#endif
@@ -45,6 +45,37 @@
 #define TZSP_TAG_LENGTH     0x29
 #define TZSP_TAG_SENSOR_MAC 0x3C
 
+#define RADIOTAP_HEADER_LEN      8
+#define RADIOTAP_PRESENT_EXT     31
+#define RADIOTAP_FLAGS_FCS       0x10
+#define FCS_LEN                  4
+
+enum
+{
+    RADIOTAP_TSFT,
+    RADIOTAP_FLAGS,
+    RADIOTAP_RATE,
+    RADIOTAP_CHANNEL,
+    RADIOTAP_FHSS,
+    RADIOTAP_DBM_ANTSIGNAL,
+    RADIOTAP_FIELDS
+};
+
+/* Alignment and size of the leading radiotap fields */
+static const struct
+{
+    uint8_t align;
+    uint8_t size;
+} radiotap_fields[RADIOTAP_FIELDS] =
+{
+    [RADIOTAP_TSFT]          = { 8, 8 },
+    [RADIOTAP_FLAGS]         = { 1, 1 },
+    [RADIOTAP_RATE]          = { 1, 1 },
+    [RADIOTAP_CHANNEL]       = { 2, 4 },
+    [RADIOTAP_FHSS]          = { 1, 2 },
+    [RADIOTAP_DBM_ANTSIGNAL] = { 1, 1 }
+};
+
 struct tzsp_header
 {
     uint8_t version;
@@ -211,3 +242,69 @@ tzsp_process_tags(const uint8_t  *packet,
     }
     return NULL;
 }
+
+const uint8_t*
+decap_radiotap(const uint8_t  *packet,
+               uint32_t       *len,
+               const int8_t  **rssi)
+{
+    uint16_t header_len;
+    uint32_t present;
+    uint32_t offset;
+    uint8_t flags = 0;
+    int i;
+
+    if(!packet ||
+       *len < RADIOTAP_HEADER_LEN ||
+       packet[0] != 0)
+        return NULL;
+
+    /* All radiotap fields are little-endian */
+    header_len = packet[2] | (packet[3] << 8);
+    present = packet[4] | (packet[5] << 8) | (packet[6] << 16) | ((uint32_t)packet[7] << 24);
+    if(header_len < RADIOTAP_HEADER_LEN ||
+       header_len >= *len)
+        return NULL;
+
+    /* Skip the extended presence bitmaps */
+    offset = RADIOTAP_HEADER_LEN;
+    if(present & (1U << RADIOTAP_PRESENT_EXT))
+    {
+        do
+        {
+            if(offset + 4 > header_len)
+                return NULL;
+            offset += 4;
+        } while(packet[offset-1] & 0x80);
+    }
+
+    /* Only the leading fields are of interest */
+    for(i=0; i<RADIOTAP_FIELDS; i++)
+    {
+        if(!(present & (1U << i)))
+            continue;
+
+        offset = (offset + radiotap_fields[i].align - 1) & ~(uint32_t)(radiotap_fields[i].align - 1);
+        if(offset + radiotap_fields[i].size > header_len)
+            return NULL;
+
+        if(i == RADIOTAP_FLAGS)
+            flags = packet[offset];
+        else if(i == RADIOTAP_DBM_ANTSIGNAL)
+            *rssi = (const int8_t*)(packet + offset);
+
+        offset += radiotap_fields[i].size;
+    }
+
+    *len -= header_len;
+
+    /* Strip the frame check sequence */
+    if(flags & RADIOTAP_FLAGS_FCS)
+    {
+        if(*len <= FCS_LEN)
+            return NULL;
+        *len -= FCS_LEN;
+    }
+
+    return packet + header_len;
+}
@@ -21,5 +21,6 @@ const uint8_t* decap_ethernet(const uint8_t*, uint32_t*);
 const uint8_t* decap_ip(const uint8_t*, uint32_t*);
 const uint8_t* decap_udp(const uint8_t*, uint32_t*);
 const uint8_t* decap_tzsp(const uint8_t*, uint32_t*, const int8_t**, const uint8_t**, const uint8_t**);
+const uint8_t* decap_radiotap(const uint8_t*, uint32_t*, const int8_t**);
 
 #endif
@@ -0,0 +1,272 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+/* Minimal gpsd client for the headless collector, only TPV reports
+   are used and the connection is restored in the background */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include "tzsp-gpsd.h"
+
+#define TZSP_GPSD_BUFFER_LEN  4096
+#define TZSP_GPSD_TIMEOUT_SEC 1
+#define TZSP_GPSD_RETRY_SEC   5
+#define TZSP_GPSD_FIX_MAX_AGE 10
+
+#define TZSP_GPSD_INIT_STRING "?WATCH={\"enable\":true,\"json\":true};\n"
+
+typedef struct tzsp_gpsd
+{
+    char *hostname;
+    char *port;
+
+    pthread_t thread;
+    bool running;
+    volatile bool stop;
+
+    /* Last fix, guarded by the mutex */
+    pthread_mutex_t mutex;
+    double lat;
+    double lon;
+    time_t updated;
+} tzsp_gpsd_t;
+
+static void* tzsp_gpsd_thread(void*);
+static int tzsp_gpsd_connect(const tzsp_gpsd_t*);
+static void tzsp_gpsd_line(tzsp_gpsd_t*, const char*);
+static bool tzsp_gpsd_number(const char*, const char*, double*);
+
+
+tzsp_gpsd_t*
+tzsp_gpsd_new()
+{
+    return calloc(sizeof(tzsp_gpsd_t), 1);
+}
+
+int
+tzsp_gpsd_init(tzsp_gpsd_t *context,
+               const char  *hostname,
+               const char  *port)
+{
+    context->hostname = strdup(hostname);
+    context->port = strdup(port);
+    if(!context->hostname || !context->port)
+        return TZSP_GPSD_ERROR_MEMORY;
+
+    pthread_mutex_init(&context->mutex, NULL);
+    if(pthread_create(&context->thread, NULL, tzsp_gpsd_thread, context) != 0)
+    {
+        pthread_mutex_destroy(&context->mutex);
+        return TZSP_GPSD_ERROR_THREAD;
+    }
+
+    context->running = true;
+    return TZSP_GPSD_OK;
+}
+
+bool
+tzsp_gpsd_get_fix(tzsp_gpsd_t *context,
+                  double      *lat,
+                  double      *lon)
+{
+    bool valid;
+
+    if(!context->running)
+        return false;
+
+    pthread_mutex_lock(&context->mutex);
+    valid = (context->updated &&
+             time(NULL) - context->updated <= TZSP_GPSD_FIX_MAX_AGE);
+    if(valid)
+    {
+        *lat = context->lat;
+        *lon = context->lon;
+    }
+    pthread_mutex_unlock(&context->mutex);
+
+    return valid;
+}
+
+void
+tzsp_gpsd_free(tzsp_gpsd_t *context)
+{
+    if(!context)
+        return;
+
+    if(context->running)
+    {
+        context->stop = true;
+        pthread_join(context->thread, NULL);
+        pthread_mutex_destroy(&context->mutex);
+    }
+
+    free(context->hostname);
+    free(context->port);
+    free(context);
+}
+
+static void*
+tzsp_gpsd_thread(void *user_data)
+{
+    tzsp_gpsd_t *context = (tzsp_gpsd_t*)user_data;
+    char buffer[TZSP_GPSD_BUFFER_LEN];
+    size_t length;
+    ssize_t n;
+    char *start;
+    char *end;
+    int fd;
+    int i;
+
+    while(!context->stop)
+    {
+        if((fd = tzsp_gpsd_connect(context)) < 0)
+        {
+            for(i=0; i<TZSP_GPSD_RETRY_SEC && !context->stop; i++)
+                sleep(1);
+            continue;
+        }
+
+        length = 0;
+        while(!context->stop)
+        {
+            n = recv(fd, buffer + length, sizeof(buffer) - length - 1, 0);
+            if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+                continue;
+            if(n <= 0)
+                break;
+
+            length += n;
+            buffer[length] = '\0';
+
+            /* Handle every complete report */
+            start = buffer;
+            while((end = strchr(start, '\n')))
+            {
+                *end = '\0';
+                tzsp_gpsd_line(context, start);
+                start = end + 1;
+            }
+
+            length -= (start - buffer);
+            memmove(buffer, start, length);
+
+            /* Truncated report, drop it */
+            if(length == sizeof(buffer) - 1)
+                length = 0;
+        }
+        close(fd);
+    }
+    return NULL;
+}
+
+static int
+tzsp_gpsd_connect(const tzsp_gpsd_t *context)
+{
+    struct addrinfo hints;
+    struct addrinfo *result;
+    struct addrinfo *rp;
+    struct timeval timeout;
+    int fd = -1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if(getaddrinfo(context->hostname, context->port, &hints, &result) != 0)
+        return -1;
+
+    for(rp = result; rp; rp = rp->ai_next)
+    {
+        fd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+        if(fd < 0)
+            continue;
+        if(connect(fd, rp->ai_addr, rp->ai_addrlen) == 0)
+            break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(result);
+
+    if(fd < 0)
+        return -1;
+
+    /* Wake up regularly to check the stop flag */
+    timeout.tv_sec = TZSP_GPSD_TIMEOUT_SEC;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if(send(fd, TZSP_GPSD_INIT_STRING, strlen(TZSP_GPSD_INIT_STRING), MSG_NOSIGNAL) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void
+tzsp_gpsd_line(tzsp_gpsd_t *context,
+               const char  *line)
+{
+    double mode;
+    double lat;
+    double lon;
+
+    if(!strstr(line, "\"class\":\"TPV\""))
+        return;
+
+    /* 2D fix at least */
+    if(!tzsp_gpsd_number(line, "mode", &mode) || mode < 2)
+        return;
+
+    if(!tzsp_gpsd_number(line, "lat", &lat) ||
+       !tzsp_gpsd_number(line, "lon", &lon))
+        return;
+
+    pthread_mutex_lock(&context->mutex);
+    context->lat = lat;
+    context->lon = lon;
+    context->updated = time(NULL);
+    pthread_mutex_unlock(&context->mutex);
+}
+
+static bool
+tzsp_gpsd_number(const char *line,
+                 const char *key,
+                 double     *value)
+{
+    char pattern[16];
+    const char *ptr;
+    char *end;
+
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    if(!(ptr = strstr(line, pattern)))
+        return false;
+
+    ptr += strlen(pattern);
+    *value = strtod(ptr, &end);
+    return (end != ptr);
+}
@@ -0,0 +1,35 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_TZSP_GPSD_H
+#define MTSCAN_TZSP_GPSD_H
+
+#include <stdbool.h>
+
+typedef struct tzsp_gpsd tzsp_gpsd_t;
+
+enum
+{
+    TZSP_GPSD_OK           =  0,
+    TZSP_GPSD_ERROR_MEMORY = -1,
+    TZSP_GPSD_ERROR_THREAD = -2
+};
+
+tzsp_gpsd_t* tzsp_gpsd_new();
+int tzsp_gpsd_init(tzsp_gpsd_t*, const char*, const char*);
+bool tzsp_gpsd_get_fix(tzsp_gpsd_t*, double*, double*);
+void tzsp_gpsd_free(tzsp_gpsd_t*);
+
+#endif
@@ -18,6 +18,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
+#include <time.h>
 #ifdef _WIN32
 #include <Winsock2.h>
 #include <Ws2tcpip.h>
@@ -27,41 +29,91 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #endif
+#ifdef __linux__
+#include <poll.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#define TZSP_SNIFFER_RING
+#endif
 #include "tzsp-sniffer.h"
 #include "tzsp-decap.h"
 
+#define IP_HEADER_SRC_OFFSET 12
+
+#define TZSP_SNIFFER_RING_BLOCK_SIZE  (1 << 20)
+#define TZSP_SNIFFER_RING_BLOCK_NR    32
+#define TZSP_SNIFFER_RING_FRAME_SIZE  2048
+#define TZSP_SNIFFER_RING_RETIRE_MS   10
+#define TZSP_SNIFFER_RING_POLL_MS     100
+
 typedef struct tzsp_sniffer
 {
     pcap_t         *capture;
-    pcap_t         *dump;
-    pcap_dumper_t  *dumper;
+    tzsp_writer_t  *writer;
+    bool            ring_allowed;
+    int             ring_fd;
+    uint8_t        *ring;
+    int             datalink;
+    int64_t         timestamp;
+    uint32_t        dropped;
+    uint32_t        invalid;
+    time_t          stats_ts;
     volatile bool   canceled;
     volatile bool   enabled;
     char            errbuf[PCAP_ERRBUF_SIZE];
-    void          (*user_func)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, void*);
+    void          (*user_func)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, uint32_t, void*);
     void           *user_data;
 } tzsp_sniffer_t;
 
+static int tzsp_sniffer_pcap_open(tzsp_sniffer_t*, const char*, const char*, bpf_u_int32, int);
+static void tzsp_sniffer_packet(tzsp_sniffer_t*, struct pcap_pkthdr*, const u_char*);
+static void tzsp_sniffer_stats(tzsp_sniffer_t*);
+static void tzsp_sniffer_close(tzsp_sniffer_t*);
+#ifdef TZSP_SNIFFER_RING
+static int tzsp_sniffer_ring_open(tzsp_sniffer_t*, const char*, const char*, bpf_u_int32, int);
+static void tzsp_sniffer_ring_loop(tzsp_sniffer_t*);
+#endif
+
 
 tzsp_sniffer_t*
 tzsp_sniffer_new()
 {
-    return calloc(sizeof(tzsp_sniffer_t), 1);
+    tzsp_sniffer_t *context;
+
+    context = calloc(sizeof(tzsp_sniffer_t), 1);
+    if(context)
+    {
+        context->ring_allowed = true;
+        context->ring_fd = -1;
+    }
+    return context;
+}
+
+void
+tzsp_sniffer_set_ring(tzsp_sniffer_t *context,
+                      bool            allowed)
+{
+    context->ring_allowed = allowed;
 }
 
 int
 tzsp_sniffer_init(tzsp_sniffer_t *context,
                   uint16_t        udp_port,
-                  const char     *output,
                   const char     *ip_src,
                   const char     *dev_if,
                   int             latency)
 {
     char *filter_exp;
-    struct bpf_program fp;
     bpf_u_int32 net;
     bpf_u_int32 mask;
-    int ret;
+    int ret = TZSP_SNIFFER_ERROR_CAPTURE;
 
     /* Clear the string error buffer */
     *context->errbuf = '\0';
@@ -83,12 +135,102 @@ tzsp_sniffer_init(tzsp_sniffer_t *context,
         return TZSP_SNIFFER_ERROR_MEMORY;
     }
 
-    if((context->capture = pcap_open_live(dev_if, BUFSIZ, 1, latency, context->errbuf)) == NULL)
+    if(pcap_lookupnet(dev_if, &net, &mask, context->errbuf) == -1)
+    {
+        net = 0;
+        mask = 0;
+    }
+
+#ifdef TZSP_SNIFFER_RING
+    /* Prefer the memory-mapped ring, libpcap is the fallback */
+    if(context->ring_allowed)
+        ret = tzsp_sniffer_ring_open(context, dev_if, filter_exp, net, latency);
+#endif
+
+    if(ret != TZSP_SNIFFER_OK)
     {
-        ret = TZSP_SNIFFER_ERROR_CAPTURE;
-        goto free_filter_exp;
+        *context->errbuf = '\0';
+        ret = tzsp_sniffer_pcap_open(context, dev_if, filter_exp, net, latency);
+    }
+
+    free(filter_exp);
+    if(ret != TZSP_SNIFFER_OK)
+        return ret;
+
+    context->datalink = DLT_EN10MB;
+    return TZSP_SNIFFER_OK;
+}
+
+int
+tzsp_sniffer_init_offline(tzsp_sniffer_t *context,
+                          uint16_t        udp_port,
+                          const char     *input)
+{
+    struct bpf_program fp;
+    char filter_exp[32];
+    int ret;
+
+    /* Clear the string error buffer */
+    *context->errbuf = '\0';
+
+    /* Both pcap and pcapng files are handled by libpcap */
+    if((context->capture = pcap_open_offline(input, context->errbuf)) == NULL)
+        return TZSP_SNIFFER_ERROR_CAPTURE;
+
+    context->datalink = pcap_datalink(context->capture);
+    switch(context->datalink)
+    {
+        case DLT_EN10MB:
+            /* TZSP encapsulated frames, skip other traffic */
+            snprintf(filter_exp, sizeof(filter_exp), "udp dst port %d", udp_port);
+            if(pcap_compile(context->capture, &fp, filter_exp, 0, 0) == -1)
+            {
+                snprintf(context->errbuf, PCAP_ERRBUF_SIZE, "pcap_compile failed");
+                ret = TZSP_SNIFFER_ERROR_FILTER;
+                goto free_capture;
+            }
+
+            if(pcap_setfilter(context->capture, &fp) == -1)
+            {
+                pcap_freecode(&fp);
+                snprintf(context->errbuf, PCAP_ERRBUF_SIZE, "pcap_setfilter failed");
+                ret = TZSP_SNIFFER_ERROR_SET_FILTER;
+                goto free_capture;
+            }
+            pcap_freecode(&fp);
+            break;
+
+        case DLT_IEEE802_11:
+        case DLT_IEEE802_11_RADIO:
+            /* Raw IEEE 802.11 frames */
+            break;
+
+        default:
+            snprintf(context->errbuf, PCAP_ERRBUF_SIZE, "Capture file has unsupported datalink");
+            ret = TZSP_SNIFFER_ERROR_DATALINK;
+            goto free_capture;
     }
 
+    return TZSP_SNIFFER_OK;
+
+free_capture:
+    tzsp_sniffer_close(context);
+    return ret;
+}
+
+static int
+tzsp_sniffer_pcap_open(tzsp_sniffer_t *context,
+                       const char     *dev_if,
+                       const char     *filter_exp,
+                       bpf_u_int32     net,
+                       int             latency)
+{
+    struct bpf_program fp;
+    int ret;
+
+    if((context->capture = pcap_open_live(dev_if, BUFSIZ, 1, latency, context->errbuf)) == NULL)
+        return TZSP_SNIFFER_ERROR_CAPTURE;
+
     if(pcap_datalink(context->capture) != DLT_EN10MB)
     {
         snprintf(context->errbuf, PCAP_ERRBUF_SIZE, "Selected interface has wrong datalink");
@@ -96,12 +238,6 @@ tzsp_sniffer_init(tzsp_sniffer_t *context,
         goto free_capture;
     }
 
-    if(pcap_lookupnet(dev_if, &net, &mask, context->errbuf) == -1)
-    {
-        net = 0;
-        mask = 0;
-    }
-
     if(pcap_compile(context->capture, &fp, filter_exp, 0, net) == -1)
     {
         snprintf(context->errbuf, PCAP_ERRBUF_SIZE, "pcap_compile failed");
@@ -116,49 +252,182 @@ tzsp_sniffer_init(tzsp_sniffer_t *context,
         goto free_filter;
     }
 
-    if(output)
-    {
-        if ((context->dump = pcap_open_dead(DLT_IEEE802_11, BUFSIZ)) == NULL)
-        {
-            snprintf(context->errbuf, PCAP_ERRBUF_SIZE, "pcap_open_dead failed");
-            ret = TZSP_SNIFFER_ERROR_DUMP_OPEN_DEAD;
-            goto free_filter;
-        }
-
-        if ((context->dumper = pcap_dump_open(context->dump, output)) == NULL)
-        {
-            snprintf(context->errbuf, PCAP_ERRBUF_SIZE, "pcap_open_dead failed");
-            ret = TZSP_SNIFFER_ERROR_DUMP_OPEN;
-            goto free_dump;
-        }
-    }
-
     pcap_freecode(&fp);
-    free(filter_exp);
     return TZSP_SNIFFER_OK;
 
-free_dump:
-    pcap_close(context->dump);
-    context->dump = NULL;
 free_filter:
     pcap_freecode(&fp);
 free_capture:
     pcap_close(context->capture);
     context->capture = NULL;
-free_filter_exp:
-    free(filter_exp);
     return ret;
 }
 
+#ifdef TZSP_SNIFFER_RING
+static int
+tzsp_sniffer_ring_open(tzsp_sniffer_t *context,
+                       const char     *dev_if,
+                       const char     *filter_exp,
+                       bpf_u_int32     net,
+                       int             latency)
+{
+    struct tpacket_req3 req;
+    struct sockaddr_ll addr;
+    struct packet_mreq mreq;
+    struct sock_fprog prog;
+    struct bpf_program fp;
+    struct ifreq ifr;
+    pcap_t *dead;
+    int version = TPACKET_V3;
+    int ifindex;
+    int ret;
+
+    if(dev_if == NULL ||
+       (ifindex = if_nametoindex(dev_if)) == 0)
+        return TZSP_SNIFFER_ERROR_CAPTURE;
+
+    /* Nothing is received before the socket is bound */
+    if((context->ring_fd = socket(AF_PACKET, SOCK_RAW, 0)) < 0)
+        return TZSP_SNIFFER_ERROR_CAPTURE;
+
+    /* The same datalink is required as with libpcap */
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, dev_if, IFNAMSIZ-1);
+    if(ioctl(context->ring_fd, SIOCGIFHWADDR, &ifr) < 0 ||
+       ifr.ifr_hwaddr.sa_family != ARPHRD_ETHER)
+    {
+        ret = TZSP_SNIFFER_ERROR_DATALINK;
+        goto close_fd;
+    }
+
+    /* Compile the filter with libpcap and attach it as a classic BPF */
+    if((dead = pcap_open_dead(DLT_EN10MB, BUFSIZ)) == NULL)
+    {
+        ret = TZSP_SNIFFER_ERROR_FILTER;
+        goto close_fd;
+    }
+
+    if(pcap_compile(dead, &fp, filter_exp, 0, net) == -1)
+    {
+        pcap_close(dead);
+        ret = TZSP_SNIFFER_ERROR_FILTER;
+        goto close_fd;
+    }
+
+    prog.len = fp.bf_len;
+    prog.filter = (struct sock_filter*)fp.bf_insns;
+    ret = setsockopt(context->ring_fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+    pcap_freecode(&fp);
+    pcap_close(dead);
+    if(ret < 0)
+    {
+        ret = TZSP_SNIFFER_ERROR_SET_FILTER;
+        goto close_fd;
+    }
+
+    ret = TZSP_SNIFFER_ERROR_CAPTURE;
+    if(setsockopt(context->ring_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+        goto close_fd;
+
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = TZSP_SNIFFER_RING_BLOCK_SIZE;
+    req.tp_block_nr = TZSP_SNIFFER_RING_BLOCK_NR;
+    req.tp_frame_size = TZSP_SNIFFER_RING_FRAME_SIZE;
+    req.tp_frame_nr = (TZSP_SNIFFER_RING_BLOCK_SIZE / TZSP_SNIFFER_RING_FRAME_SIZE) * TZSP_SNIFFER_RING_BLOCK_NR;
+    req.tp_retire_blk_tov = (latency > 0 ? latency : TZSP_SNIFFER_RING_RETIRE_MS);
+    if(setsockopt(context->ring_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0)
+        goto close_fd;
+
+    context->ring = mmap(NULL, (size_t)TZSP_SNIFFER_RING_BLOCK_SIZE * TZSP_SNIFFER_RING_BLOCK_NR,
+                         PROT_READ | PROT_WRITE, MAP_SHARED, context->ring_fd, 0);
+    if(context->ring == MAP_FAILED)
+    {
+        context->ring = NULL;
+        goto close_fd;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = ifindex;
+    if(bind(context->ring_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        goto unmap;
+
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.mr_ifindex = ifindex;
+    mreq.mr_type = PACKET_MR_PROMISC;
+    if(setsockopt(context->ring_fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+        goto unmap;
+
+    return TZSP_SNIFFER_OK;
+
+unmap:
+    munmap(context->ring, (size_t)TZSP_SNIFFER_RING_BLOCK_SIZE * TZSP_SNIFFER_RING_BLOCK_NR);
+    context->ring = NULL;
+close_fd:
+    close(context->ring_fd);
+    context->ring_fd = -1;
+    return ret;
+}
+#endif
+
+static void
+tzsp_sniffer_close(tzsp_sniffer_t *context)
+{
+    if(context->capture)
+    {
+        pcap_close(context->capture);
+        context->capture = NULL;
+    }
+#ifdef TZSP_SNIFFER_RING
+    if(context->ring)
+    {
+        munmap(context->ring, (size_t)TZSP_SNIFFER_RING_BLOCK_SIZE * TZSP_SNIFFER_RING_BLOCK_NR);
+        context->ring = NULL;
+    }
+    if(context->ring_fd >= 0)
+    {
+        close(context->ring_fd);
+        context->ring_fd = -1;
+    }
+#endif
+}
+
+void
+tzsp_sniffer_set_writer(tzsp_sniffer_t *context,
+                        tzsp_writer_t  *writer)
+{
+    /* The writer is owned by the caller */
+    context->writer = writer;
+}
+
 const char*
 tzsp_sniffer_get_error(const tzsp_sniffer_t *context)
 {
     return context->errbuf;
 }
 
+int64_t
+tzsp_sniffer_get_timestamp(const tzsp_sniffer_t *context)
+{
+    return context->timestamp;
+}
+
+uint32_t
+tzsp_sniffer_get_dropped(const tzsp_sniffer_t *context)
+{
+    return __atomic_load_n(&context->dropped, __ATOMIC_RELAXED);
+}
+
+uint32_t
+tzsp_sniffer_get_invalid(const tzsp_sniffer_t *context)
+{
+    return __atomic_load_n(&context->invalid, __ATOMIC_RELAXED);
+}
+
 void
 tzsp_sniffer_set_func(tzsp_sniffer_t  *context,
-                      void           (*user_func)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, void*),
+                      void           (*user_func)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, uint32_t, void*),
                       void           (*user_data))
 {
     context->user_func = user_func;
@@ -170,42 +439,175 @@ tzsp_sniffer_loop(tzsp_sniffer_t *context)
 {
     struct pcap_pkthdr *header;
     const u_char *packet;
-    const u_char *ptr;
-    const int8_t *rssi;
-    const uint8_t *channel;
-    const uint8_t *sensor_mac;
     int ret;
 
     printf("tzsp_sniffer_loop\n");
 
+#ifdef TZSP_SNIFFER_RING
+    if(context->ring)
+    {
+        tzsp_sniffer_ring_loop(context);
+        context->stats_ts = 0;
+        tzsp_sniffer_stats(context);
+        printf("tzsp_sniffer_loop END\n");
+        return;
+    }
+#endif
+
     while(!context->canceled &&
           (ret = pcap_next_ex(context->capture, &header, &packet)) >= 0)
     {
         if(ret != 0 && !context->canceled && context->enabled)
+            tzsp_sniffer_packet(context, header, packet);
+        tzsp_sniffer_stats(context);
+    }
+
+    /* Final readout of the kernel counters */
+    context->stats_ts = 0;
+    tzsp_sniffer_stats(context);
+
+    printf("tzsp_sniffer_loop END\n");
+}
+
+#ifdef TZSP_SNIFFER_RING
+static void
+tzsp_sniffer_ring_loop(tzsp_sniffer_t *context)
+{
+    struct tpacket_block_desc *block;
+    struct tpacket3_hdr *hdr;
+    struct pcap_pkthdr header;
+    struct pollfd pfd;
+    unsigned int current = 0;
+    uint32_t i;
+
+    pfd.fd = context->ring_fd;
+    pfd.events = POLLIN | POLLERR;
+    pfd.revents = 0;
+
+    while(!context->canceled)
+    {
+        block = (struct tpacket_block_desc*)(context->ring + (size_t)current * TZSP_SNIFFER_RING_BLOCK_SIZE);
+        if(!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+        {
+            /* Wake up periodically to check for cancellation */
+            poll(&pfd, 1, TZSP_SNIFFER_RING_POLL_MS);
+            tzsp_sniffer_stats(context);
+            continue;
+        }
+
+        /* Process the whole block per wakeup */
+        hdr = (struct tpacket3_hdr*)((uint8_t*)block + block->hdr.bh1.offset_to_first_pkt);
+        for(i=0; i<block->hdr.bh1.num_pkts; i++)
         {
-            if((ptr = decap_ethernet(packet, &header->caplen)) == NULL)
-                continue;
-            if((ptr = decap_ip(ptr, &header->caplen)) == NULL)
-                continue;
-            if((ptr = decap_udp(ptr, &header->caplen)) == NULL)
-                continue;
-
-            rssi = NULL;
-            if((ptr = decap_tzsp(ptr, &header->caplen, &rssi, &channel, &sensor_mac)) == NULL)
-                continue;
-
-            if(context->dumper)
+            if(!context->canceled && context->enabled)
             {
-                header->len = header->caplen;
-                pcap_dump((u_char*)context->dumper, header, ptr);
+                header.ts.tv_sec = hdr->tp_sec;
+                header.ts.tv_usec = hdr->tp_nsec / 1000;
+                header.caplen = hdr->tp_snaplen;
+                header.len = hdr->tp_len;
+                tzsp_sniffer_packet(context, &header, (const u_char*)hdr + hdr->tp_mac);
             }
-
-            if(context->user_func)
-                context->user_func(ptr, header->caplen, rssi, channel, sensor_mac, context->user_data);
+            hdr = (struct tpacket3_hdr*)((uint8_t*)hdr + hdr->tp_next_offset);
         }
+
+        /* Return the block to the kernel */
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        current = (current + 1) % TZSP_SNIFFER_RING_BLOCK_NR;
+        tzsp_sniffer_stats(context);
     }
+}
+#endif
 
-    printf("tzsp_sniffer_loop END\n");
+static void
+tzsp_sniffer_stats(tzsp_sniffer_t *context)
+{
+    struct pcap_stat ps;
+#ifdef TZSP_SNIFFER_RING
+    struct tpacket_stats_v3 st;
+    socklen_t len;
+#endif
+    time_t now;
+
+    /* Kernel counters are read once per second */
+    now = time(NULL);
+    if(now == context->stats_ts)
+        return;
+    context->stats_ts = now;
+
+#ifdef TZSP_SNIFFER_RING
+    if(context->ring)
+    {
+        /* PACKET_STATISTICS is reset on every read */
+        len = sizeof(st);
+        if(getsockopt(context->ring_fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0)
+            __atomic_add_fetch(&context->dropped, st.tp_drops, __ATOMIC_RELAXED);
+        return;
+    }
+#endif
+
+    /* Not available for capture files */
+    if(context->datalink == DLT_EN10MB &&
+       pcap_stats(context->capture, &ps) == 0)
+        __atomic_store_n(&context->dropped, ps.ps_drop + ps.ps_ifdrop, __ATOMIC_RELAXED);
+}
+
+static void
+tzsp_sniffer_packet(tzsp_sniffer_t     *context,
+                    struct pcap_pkthdr *header,
+                    const u_char       *packet)
+{
+    const u_char *ptr;
+    const u_char *ip;
+    const int8_t *rssi;
+    const uint8_t *channel;
+    const uint8_t *sensor_mac;
+    uint32_t src;
+
+    /* Capture time of the frame currently passed to the user */
+    context->timestamp = header->ts.tv_sec;
+
+    if(context->datalink != DLT_EN10MB)
+    {
+        /* Raw IEEE 802.11 frames read from a capture file */
+        rssi = NULL;
+        ptr = packet;
+        if(context->datalink == DLT_IEEE802_11_RADIO &&
+           (ptr = decap_radiotap(packet, &header->caplen, &rssi)) == NULL)
+            goto invalid;
+
+        if(context->writer)
+            tzsp_writer_write(context->writer, &header->ts, ptr, header->caplen, rssi, NULL);
+
+        if(context->user_func)
+            context->user_func(ptr, header->caplen, rssi, NULL, NULL, 0, context->user_data);
+        return;
+    }
+
+    if((ptr = decap_ethernet(packet, &header->caplen)) == NULL)
+        goto invalid;
+    ip = ptr;
+    if((ptr = decap_ip(ptr, &header->caplen)) == NULL)
+        goto invalid;
+
+    /* Keep the source address for sensor demultiplexing */
+    memcpy(&src, ip + IP_HEADER_SRC_OFFSET, sizeof(src));
+
+    if((ptr = decap_udp(ptr, &header->caplen)) == NULL)
+        goto invalid;
+
+    rssi = NULL;
+    if((ptr = decap_tzsp(ptr, &header->caplen, &rssi, &channel, &sensor_mac)) == NULL)
+        goto invalid;
+
+    if(context->writer)
+        tzsp_writer_write(context->writer, &header->ts, ptr, header->caplen, rssi, channel);
+
+    if(context->user_func)
+        context->user_func(ptr, header->caplen, rssi, channel, sensor_mac, src, context->user_data);
+    return;
+
+invalid:
+    __atomic_add_fetch(&context->invalid, 1, __ATOMIC_RELAXED);
 }
 
 void
@@ -224,7 +626,8 @@ void
 tzsp_sniffer_cancel(tzsp_sniffer_t *context)
 {
     context->canceled = true;
-    pcap_breakloop(context->capture);
+    if(context->capture)
+        pcap_breakloop(context->capture);
 }
 
 void
@@ -232,12 +635,7 @@ tzsp_sniffer_free(tzsp_sniffer_t *context)
 {
     if(context)
     {
-        if(context->dumper)
-            pcap_dump_close(context->dumper);
-        if(context->dump)
-            pcap_close(context->dump);
-        if(context->capture)
-            pcap_close(context->capture);
+        tzsp_sniffer_close(context);
         free(context);
     }
 }
@@ -17,6 +17,8 @@
 #define MTSCAN_TZSP_SNIFFER_H
 
 #include <stdint.h>
+#include <stdbool.h>
+#include "tzsp-writer.h"
 
 typedef struct tzsp_sniffer tzsp_sniffer_t;
 
@@ -28,15 +30,19 @@ enum
     TZSP_SNIFFER_ERROR_CAPTURE        = -3,
     TZSP_SNIFFER_ERROR_DATALINK       = -4,
     TZSP_SNIFFER_ERROR_FILTER         = -5,
-    TZSP_SNIFFER_ERROR_SET_FILTER     = -6,
-    TZSP_SNIFFER_ERROR_DUMP_OPEN_DEAD = -7,
-    TZSP_SNIFFER_ERROR_DUMP_OPEN      = -8
+    TZSP_SNIFFER_ERROR_SET_FILTER     = -6
 };
 
 tzsp_sniffer_t* tzsp_sniffer_new();
-int tzsp_sniffer_init(tzsp_sniffer_t*, uint16_t, const char*, const char*, const char*, int);
+void tzsp_sniffer_set_ring(tzsp_sniffer_t*, bool);
+int tzsp_sniffer_init(tzsp_sniffer_t*, uint16_t, const char*, const char*, int);
+int tzsp_sniffer_init_offline(tzsp_sniffer_t*, uint16_t, const char*);
+void tzsp_sniffer_set_writer(tzsp_sniffer_t*, tzsp_writer_t*);
 const char* tzsp_sniffer_get_error(const tzsp_sniffer_t*);
-void tzsp_sniffer_set_func(tzsp_sniffer_t*, void (*)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, void*), void*);
+int64_t tzsp_sniffer_get_timestamp(const tzsp_sniffer_t*);
+uint32_t tzsp_sniffer_get_dropped(const tzsp_sniffer_t*);
+uint32_t tzsp_sniffer_get_invalid(const tzsp_sniffer_t*);
+void tzsp_sniffer_set_func(tzsp_sniffer_t*, void (*)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, uint32_t, void*), void*);
 void tzsp_sniffer_loop(tzsp_sniffer_t*);
 void tzsp_sniffer_enable(tzsp_sniffer_t*);
 void tzsp_sniffer_disable(tzsp_sniffer_t*);
@@ -48,15 +48,17 @@ typedef int socket_t;
 typedef struct tzsp_socket
 {
     socket_t         socket;
-    pcap_t          *dump;
-    pcap_dumper_t   *dumper;
+    tzsp_writer_t   *writer;
     volatile bool    canceled;
     volatile bool    enabled;
     uint32_t         src;
-    void           (*user_func)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, void*);
+    uint32_t         dropped;
+    uint32_t         invalid;
+    void           (*user_func)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, uint32_t, void*);
     void            *user_data;
 } tzsp_socket_t;
 
+static ssize_t tzsp_socket_recv(tzsp_socket_t*, uint8_t*, struct sockaddr_in*);
 static void tzsp_socket_close(tzsp_socket_t*);
 
 
@@ -69,7 +71,6 @@ tzsp_socket_new()
 int
 tzsp_socket_init(tzsp_socket_t *context,
                  uint16_t       tzsp_port,
-                 const char    *output,
                  const char    *ip_src)
 {
     struct sockaddr_in addr;
@@ -92,6 +93,10 @@ tzsp_socket_init(tzsp_socket_t *context,
     int opt = 1;
     setsockopt(context->socket, SOL_SOCKET, SO_REUSEADDR, (const char*)&opt, sizeof(opt));
 #endif
+#ifdef SO_RXQ_OVFL
+    /* Report datagrams dropped by the kernel with every receive */
+    setsockopt(context->socket, SOL_SOCKET, SO_RXQ_OVFL, (const char*)&opt, sizeof(opt));
+#endif
 
     memset((char*)&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -104,34 +109,24 @@ tzsp_socket_init(tzsp_socket_t *context,
         goto free_socket;
     }
 
-    if(output)
-    {
-        if((context->dump = pcap_open_dead(DLT_IEEE802_11, BUFSIZ)) == NULL)
-        {
-            ret = TZSP_SOCKET_ERROR_DUMP_OPEN_DEAD;
-            goto free_socket;
-        }
-
-        if((context->dumper = pcap_dump_open(context->dump, output)) == NULL)
-        {
-            ret = TZSP_SOCKET_ERROR_DUMP_OPEN;
-            goto free_dump;
-        }
-    }
-
     return TZSP_SOCKET_OK;
 
-free_dump:
-    pcap_close(context->dump);
-    context->dump = NULL;
 free_socket:
     tzsp_socket_close(context);
     return ret;
 }
 
+void
+tzsp_socket_set_writer(tzsp_socket_t *context,
+                       tzsp_writer_t *writer)
+{
+    /* The writer is owned by the caller */
+    context->writer = writer;
+}
+
 void
 tzsp_socket_set_func(tzsp_socket_t  *context,
-                     void          (*user_func)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, void*),
+                     void          (*user_func)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, uint32_t, void*),
                      void          (*user_data))
 {
     context->user_func = user_func;
@@ -144,7 +139,6 @@ tzsp_socket_loop(tzsp_socket_t *context)
     uint8_t packet[SOCKET_BUFF_LEN];
     const uint8_t *ptr;
     struct sockaddr_in addr;
-    socklen_t len;
     struct timeval timeout;
     struct pcap_pkthdr header;
     fd_set input;
@@ -172,8 +166,7 @@ tzsp_socket_loop(tzsp_socket_t *context)
         if(ret == 0)
             continue;
 
-        len = sizeof(addr);
-        ret = recvfrom(context->socket, (char*)packet, SOCKET_BUFF_LEN, 0, (struct sockaddr*)&addr, &len);
+        ret = tzsp_socket_recv(context, packet, &addr);
         if(ret <= 0)
         {
             if(ret == -1 && errno == EINTR)
@@ -192,22 +185,34 @@ tzsp_socket_loop(tzsp_socket_t *context)
 
             rssi = NULL;
             if((ptr = decap_tzsp(packet, &header.caplen, &rssi, &channel, &sensor_mac)) == NULL)
-                continue;
-
-            if(context->dumper)
             {
-                header.len = header.caplen;
-                pcap_dump((u_char*)context->dumper, &header, ptr);
+                __atomic_add_fetch(&context->invalid, 1, __ATOMIC_RELAXED);
+                continue;
             }
 
+            if(context->writer)
+                tzsp_writer_write(context->writer, &header.ts, ptr, header.caplen, rssi, channel);
+
             if(context->user_func)
-                context->user_func(ptr, header.caplen, rssi, channel, sensor_mac, context->user_data);
+                context->user_func(ptr, header.caplen, rssi, channel, sensor_mac, addr.sin_addr.s_addr, context->user_data);
         }
     }
 
     printf("tzsp_sniffer_loop END\n");
 }
 
+uint32_t
+tzsp_socket_get_dropped(const tzsp_socket_t *context)
+{
+    return __atomic_load_n(&context->dropped, __ATOMIC_RELAXED);
+}
+
+uint32_t
+tzsp_socket_get_invalid(const tzsp_socket_t *context)
+{
+    return __atomic_load_n(&context->invalid, __ATOMIC_RELAXED);
+}
+
 void
 tzsp_socket_enable(tzsp_socket_t *context)
 {
@@ -232,14 +237,53 @@ tzsp_socket_free(tzsp_socket_t *context)
     if(context)
     {
         tzsp_socket_close(context);
-        if(context->dumper)
-            pcap_dump_close(context->dumper);
-        if(context->dump)
-            pcap_close(context->dump);
         free(context);
     }
 }
 
+static ssize_t
+tzsp_socket_recv(tzsp_socket_t      *context,
+                 uint8_t            *packet,
+                 struct sockaddr_in *addr)
+{
+#ifdef SO_RXQ_OVFL
+    char control[CMSG_SPACE(sizeof(uint32_t))];
+    struct cmsghdr *cmsg;
+    struct msghdr msg;
+    struct iovec iov;
+    uint32_t dropped;
+    ssize_t ret;
+
+    iov.iov_base = packet;
+    iov.iov_len = SOCKET_BUFF_LEN;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = addr;
+    msg.msg_namelen = sizeof(*addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ret = recvmsg(context->socket, &msg, 0);
+    if(ret <= 0)
+        return ret;
+
+    /* The counter is cumulative for the socket lifetime */
+    for(cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+        {
+            memcpy(&dropped, CMSG_DATA(cmsg), sizeof(dropped));
+            __atomic_store_n(&context->dropped, dropped, __ATOMIC_RELAXED);
+        }
+    }
+    return ret;
+#else
+    socklen_t len = sizeof(*addr);
+    return recvfrom(context->socket, (char*)packet, SOCKET_BUFF_LEN, 0, (struct sockaddr*)addr, &len);
+#endif
+}
+
 static void
 tzsp_socket_close(tzsp_socket_t *context)
 {
@@ -17,6 +17,7 @@
 #define MTSCAN_TZSP_SOCKET_H
 
 #include <stdint.h>
+#include "tzsp-writer.h"
 
 typedef struct tzsp_socket tzsp_socket_t;
 
@@ -25,15 +26,16 @@ enum
     TZSP_SOCKET_OK                   =  0,
     TZSP_SOCKET_ERROR_INVALID_IP     = -1,
     TZSP_SOCKET_ERROR_SOCKET         = -2,
-    TZSP_SOCKET_ERROR_BIND           = -3,
-    TZSP_SOCKET_ERROR_DUMP_OPEN_DEAD = -4,
-    TZSP_SOCKET_ERROR_DUMP_OPEN      = -5
+    TZSP_SOCKET_ERROR_BIND           = -3
 };
 
 tzsp_socket_t* tzsp_socket_new();
-int tzsp_socket_init(tzsp_socket_t*, uint16_t, const char*, const char*);
-void tzsp_socket_set_func(tzsp_socket_t*, void (*)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, void*), void*);
+int tzsp_socket_init(tzsp_socket_t*, uint16_t, const char*);
+void tzsp_socket_set_writer(tzsp_socket_t*, tzsp_writer_t*);
+void tzsp_socket_set_func(tzsp_socket_t*, void (*)(const uint8_t*, uint32_t, const int8_t*, const uint8_t*, const uint8_t*, uint32_t, void*), void*);
 void tzsp_socket_loop(tzsp_socket_t*);
+uint32_t tzsp_socket_get_dropped(const tzsp_socket_t*);
+uint32_t tzsp_socket_get_invalid(const tzsp_socket_t*);
 void tzsp_socket_enable(tzsp_socket_t*);
 void tzsp_socket_disable(tzsp_socket_t*);
 void tzsp_socket_cancel(tzsp_socket_t*);
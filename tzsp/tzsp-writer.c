@@ -0,0 +1,700 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+/* Capture writer, frames are written to pcapng files on a separate thread */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "tzsp-writer.h"
+
+#define TZSP_WRITER_SLOTS       2048
+#define TZSP_WRITER_SNAPLEN     2560
+#define TZSP_WRITER_WAIT_MS     100
+#define TZSP_WRITER_BUFFER      (1 << 20)
+#define TZSP_WRITER_COMMENT_LEN 64
+#define TZSP_WRITER_CACHE_LINE  64
+#define TZSP_WRITER_GZ_SUFFIX   ".gz"
+#define TZSP_WRITER_GZ_CHUNK    65536
+
+#define PCAPNG_BLOCK_SHB        0x0A0D0D0A
+#define PCAPNG_BLOCK_IDB        0x00000001
+#define PCAPNG_BLOCK_EPB        0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_OPT_END          0
+#define PCAPNG_OPT_COMMENT      1
+#define PCAPNG_OPT_USERAPPL     4
+#define PCAPNG_LINKTYPE_80211   105
+#define PCAPNG_APPLICATION      "MTscan"
+
+#define PCAPNG_PAD(x) (((x) + 3) & ~3U)
+
+typedef struct tzsp_writer_slot
+{
+    struct timeval ts;
+    uint32_t len;
+    uint32_t orig_len;
+    bool rssi_valid;
+    int8_t rssi;
+    bool channel_valid;
+    uint8_t channel;
+    uint8_t data[TZSP_WRITER_SNAPLEN];
+} tzsp_writer_slot_t;
+
+/* Single-producer, single-consumer queue of slot indexes */
+typedef struct tzsp_writer_queue
+{
+    uint32_t index[TZSP_WRITER_SLOTS];
+    uint32_t head;
+    char pad[TZSP_WRITER_CACHE_LINE];
+    uint32_t tail;
+} tzsp_writer_queue_t;
+
+typedef struct tzsp_writer_file
+{
+    char *filename;
+    struct tzsp_writer_file *next;
+} tzsp_writer_file_t;
+
+typedef struct tzsp_writer
+{
+    /* Configuration */
+    char *output;
+    char *prefix;
+    const char *suffix;
+    uint64_t max_size;
+    uint32_t max_seconds;
+    uint32_t max_files;
+    bool compress;
+
+    /* Buffer pool, filled by the receive loop */
+    tzsp_writer_slot_t *slots;
+    tzsp_writer_queue_t ready;
+    tzsp_writer_queue_t free;
+    uint32_t dropped;
+
+    /* Writer thread */
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool sleeping;
+    bool stop;
+
+    /* Current segment */
+    FILE *fp;
+    char *filename;
+    uint32_t segment;
+    uint64_t written;
+    time_t started;
+    bool failed;
+
+    /* Background compression of completed segments */
+    pthread_t compressor;
+    pthread_mutex_t compressor_mutex;
+    pthread_cond_t compressor_cond;
+    tzsp_writer_file_t *pending;
+    bool compressor_running;
+    bool compressor_stop;
+} tzsp_writer_t;
+
+static bool tzsp_writer_queue_push(tzsp_writer_queue_t*, uint32_t);
+static bool tzsp_writer_queue_pop(tzsp_writer_queue_t*, uint32_t*);
+static void* tzsp_writer_thread(void*);
+static void tzsp_writer_wait(tzsp_writer_t*);
+static void tzsp_writer_packet(tzsp_writer_t*, const tzsp_writer_slot_t*);
+static bool tzsp_writer_open(tzsp_writer_t*, time_t);
+static void tzsp_writer_close(tzsp_writer_t*);
+static char* tzsp_writer_segment(const tzsp_writer_t*, uint32_t);
+static bool tzsp_writer_header(FILE*);
+static void* tzsp_writer_compressor(void*);
+static void tzsp_writer_gzip(const char*);
+
+
+tzsp_writer_t*
+tzsp_writer_new()
+{
+    return calloc(sizeof(tzsp_writer_t), 1);
+}
+
+void
+tzsp_writer_set_rotation(tzsp_writer_t *context,
+                         uint64_t       max_size,
+                         uint32_t       max_seconds,
+                         uint32_t       max_files)
+{
+    context->max_size = max_size;
+    context->max_seconds = max_seconds;
+    context->max_files = max_files;
+}
+
+void
+tzsp_writer_set_compress(tzsp_writer_t *context,
+                         bool           compress)
+{
+    context->compress = compress;
+}
+
+int
+tzsp_writer_init(tzsp_writer_t *context,
+                 const char    *output)
+{
+    const char *name;
+    const char *ext;
+    uint32_t i;
+    int ret;
+
+    context->output = strdup(output);
+    context->slots = malloc(sizeof(tzsp_writer_slot_t) * TZSP_WRITER_SLOTS);
+    if(!context->output || !context->slots)
+        return TZSP_WRITER_ERROR_MEMORY;
+
+    /* Segments are named <prefix>-<number><suffix> */
+    name = strrchr(output, '/');
+    name = (name ? name + 1 : output);
+    ext = strrchr(name, '.');
+    context->suffix = (ext && ext != name ? output + (ext - output) : "");
+    context->prefix = strndup(output, strlen(output) - strlen(context->suffix));
+    if(!context->prefix)
+        return TZSP_WRITER_ERROR_MEMORY;
+
+    for(i=0; i<TZSP_WRITER_SLOTS; i++)
+        tzsp_writer_queue_push(&context->free, i);
+
+    /* The first segment is opened here to report errors early */
+    if(!tzsp_writer_open(context, time(NULL)))
+        return TZSP_WRITER_ERROR_OPEN;
+
+    pthread_mutex_init(&context->mutex, NULL);
+    pthread_cond_init(&context->cond, NULL);
+    pthread_mutex_init(&context->compressor_mutex, NULL);
+    pthread_cond_init(&context->compressor_cond, NULL);
+
+    if(context->compress &&
+       (context->max_size || context->max_seconds))
+    {
+        if(pthread_create(&context->compressor, NULL, tzsp_writer_compressor, context) != 0)
+        {
+            ret = TZSP_WRITER_ERROR_THREAD;
+            goto close_file;
+        }
+        context->compressor_running = true;
+    }
+
+    if(pthread_create(&context->thread, NULL, tzsp_writer_thread, context) != 0)
+    {
+        ret = TZSP_WRITER_ERROR_THREAD;
+        goto stop_compressor;
+    }
+
+    return TZSP_WRITER_OK;
+
+stop_compressor:
+    if(context->compressor_running)
+    {
+        pthread_mutex_lock(&context->compressor_mutex);
+        context->compressor_stop = true;
+        pthread_cond_signal(&context->compressor_cond);
+        pthread_mutex_unlock(&context->compressor_mutex);
+        pthread_join(context->compressor, NULL);
+        context->compressor_running = false;
+    }
+close_file:
+    fclose(context->fp);
+    context->fp = NULL;
+    return ret;
+}
+
+bool
+tzsp_writer_write(tzsp_writer_t        *context,
+                  const struct timeval *ts,
+                  const uint8_t        *data,
+                  uint32_t              len,
+                  const int8_t         *rssi,
+                  const uint8_t        *channel)
+{
+    /* Function called from the receive loop, must never block */
+    tzsp_writer_slot_t *slot;
+    uint32_t index;
+
+    if(!tzsp_writer_queue_pop(&context->free, &index))
+    {
+        /* The disk falls behind, drop the frame */
+        __atomic_add_fetch(&context->dropped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    slot = &context->slots[index];
+    slot->ts = *ts;
+    slot->orig_len = len;
+    slot->len = (len < TZSP_WRITER_SNAPLEN ? len : TZSP_WRITER_SNAPLEN);
+    slot->rssi_valid = (rssi != NULL);
+    slot->rssi = (rssi ? *rssi : 0);
+    slot->channel_valid = (channel != NULL);
+    slot->channel = (channel ? *channel : 0);
+    memcpy(slot->data, data, slot->len);
+
+    tzsp_writer_queue_push(&context->ready, index);
+
+    /* Wake up the writer only if it went to sleep */
+    if(__atomic_load_n(&context->sleeping, __ATOMIC_SEQ_CST))
+    {
+        pthread_mutex_lock(&context->mutex);
+        pthread_cond_signal(&context->cond);
+        pthread_mutex_unlock(&context->mutex);
+    }
+    return true;
+}
+
+uint32_t
+tzsp_writer_get_dropped(const tzsp_writer_t *context)
+{
+    return __atomic_load_n(&context->dropped, __ATOMIC_RELAXED);
+}
+
+void
+tzsp_writer_free(tzsp_writer_t *context)
+{
+    tzsp_writer_file_t *file;
+
+    if(!context)
+        return;
+
+    if(context->thread)
+    {
+        /* Let the writer finish already queued frames */
+        pthread_mutex_lock(&context->mutex);
+        __atomic_store_n(&context->stop, true, __ATOMIC_SEQ_CST);
+        pthread_cond_signal(&context->cond);
+        pthread_mutex_unlock(&context->mutex);
+        pthread_join(context->thread, NULL);
+
+        if(context->compressor_running)
+        {
+            pthread_mutex_lock(&context->compressor_mutex);
+            context->compressor_stop = true;
+            pthread_cond_signal(&context->compressor_cond);
+            pthread_mutex_unlock(&context->compressor_mutex);
+            pthread_join(context->compressor, NULL);
+        }
+
+        pthread_cond_destroy(&context->compressor_cond);
+        pthread_mutex_destroy(&context->compressor_mutex);
+        pthread_cond_destroy(&context->cond);
+        pthread_mutex_destroy(&context->mutex);
+    }
+    else if(context->fp)
+    {
+        fclose(context->fp);
+    }
+
+    while((file = context->pending))
+    {
+        context->pending = file->next;
+        free(file->filename);
+        free(file);
+    }
+
+    free(context->filename);
+    free(context->prefix);
+    free(context->output);
+    free(context->slots);
+    free(context);
+}
+
+static bool
+tzsp_writer_queue_push(tzsp_writer_queue_t *queue,
+                       uint32_t             index)
+{
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+
+    if(head - tail == TZSP_WRITER_SLOTS)
+        return false;
+
+    queue->index[head % TZSP_WRITER_SLOTS] = index;
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+static bool
+tzsp_writer_queue_pop(tzsp_writer_queue_t *queue,
+                      uint32_t            *index)
+{
+    uint32_t tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&queue->head, __ATOMIC_SEQ_CST);
+
+    if(tail == head)
+        return false;
+
+    *index = queue->index[tail % TZSP_WRITER_SLOTS];
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static void*
+tzsp_writer_thread(void *user_data)
+{
+    tzsp_writer_t *context = (tzsp_writer_t*)user_data;
+    uint32_t index;
+
+    while(true)
+    {
+        if(!tzsp_writer_queue_pop(&context->ready, &index))
+        {
+            if(__atomic_load_n(&context->stop, __ATOMIC_SEQ_CST))
+                break;
+
+            /* Nothing to do, make the data visible to readers */
+            if(context->fp)
+                fflush(context->fp);
+            tzsp_writer_wait(context);
+            continue;
+        }
+
+        tzsp_writer_packet(context, &context->slots[index]);
+        tzsp_writer_queue_push(&context->free, index);
+    }
+
+    tzsp_writer_close(context);
+    return NULL;
+}
+
+static void
+tzsp_writer_wait(tzsp_writer_t *context)
+{
+    struct timespec deadline;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += TZSP_WRITER_WAIT_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+
+    pthread_mutex_lock(&context->mutex);
+    __atomic_store_n(&context->sleeping, true, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&context->ready.head, __ATOMIC_SEQ_CST) == context->ready.tail &&
+       !__atomic_load_n(&context->stop, __ATOMIC_SEQ_CST))
+        pthread_cond_timedwait(&context->cond, &context->mutex, &deadline);
+    __atomic_store_n(&context->sleeping, false, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&context->mutex);
+}
+
+static void
+tzsp_writer_packet(tzsp_writer_t            *context,
+                   const tzsp_writer_slot_t *slot)
+{
+    uint8_t block[32 + TZSP_WRITER_SNAPLEN + 4 + TZSP_WRITER_COMMENT_LEN + 8];
+    char comment[TZSP_WRITER_COMMENT_LEN];
+    uint64_t timestamp;
+    uint32_t comment_len = 0;
+    uint32_t block_len;
+    uint32_t value;
+    uint16_t option;
+    uint8_t *ptr;
+
+    /* Per-packet signal and channel, as reported by the sensor */
+    if(slot->rssi_valid && slot->channel_valid)
+        comment_len = snprintf(comment, sizeof(comment), "rssi=%d channel=%u", slot->rssi, slot->channel);
+    else if(slot->rssi_valid)
+        comment_len = snprintf(comment, sizeof(comment), "rssi=%d", slot->rssi);
+    else if(slot->channel_valid)
+        comment_len = snprintf(comment, sizeof(comment), "channel=%u", slot->channel);
+
+    block_len = 32 + PCAPNG_PAD(slot->len);
+    if(comment_len)
+        block_len += 4 + PCAPNG_PAD(comment_len) + 4;
+
+    /* Start a new segment when the current one is full or too old */
+    if(context->fp &&
+       context->written > 0 &&
+       ((context->max_size && context->written + block_len > context->max_size) ||
+        (context->max_seconds && slot->ts.tv_sec - context->started >= context->max_seconds)))
+    {
+        tzsp_writer_close(context);
+        context->failed = !tzsp_writer_open(context, slot->ts.tv_sec);
+    }
+
+    if(!context->fp)
+    {
+        __atomic_add_fetch(&context->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    if(!context->written)
+        context->started = slot->ts.tv_sec;
+
+    /* Enhanced Packet Block */
+    timestamp = (uint64_t)slot->ts.tv_sec * 1000000 + slot->ts.tv_usec;
+    memset(block, 0, block_len);
+    ptr = block;
+    value = PCAPNG_BLOCK_EPB;        memcpy(ptr, &value, 4); ptr += 4;
+    memcpy(ptr, &block_len, 4);      ptr += 4;
+    value = 0;                       memcpy(ptr, &value, 4); ptr += 4;
+    value = timestamp >> 32;         memcpy(ptr, &value, 4); ptr += 4;
+    value = timestamp & 0xFFFFFFFF;  memcpy(ptr, &value, 4); ptr += 4;
+    memcpy(ptr, &slot->len, 4);      ptr += 4;
+    memcpy(ptr, &slot->orig_len, 4); ptr += 4;
+    memcpy(ptr, slot->data, slot->len);
+    ptr += PCAPNG_PAD(slot->len);
+
+    if(comment_len)
+    {
+        option = PCAPNG_OPT_COMMENT;
+        memcpy(ptr, &option, 2);
+        option = comment_len;
+        memcpy(ptr + 2, &option, 2);
+        memcpy(ptr + 4, comment, comment_len);
+        ptr += 4 + PCAPNG_PAD(comment_len);
+        /* opt_endofopt is already zeroed */
+        ptr += 4;
+    }
+    memcpy(ptr, &block_len, 4);
+
+    if(fwrite(block, block_len, 1, context->fp) != 1)
+    {
+        __atomic_add_fetch(&context->dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    context->written += block_len;
+}
+
+static bool
+tzsp_writer_open(tzsp_writer_t *context,
+                 time_t         now)
+{
+    char *old;
+
+    context->segment++;
+    if(context->max_size || context->max_seconds)
+        context->filename = tzsp_writer_segment(context, context->segment);
+    else
+        context->filename = strdup(context->output);
+
+    if(!context->filename)
+        return false;
+
+    if(!(context->fp = fopen(context->filename, "wb")))
+    {
+        free(context->filename);
+        context->filename = NULL;
+        return false;
+    }
+
+    setvbuf(context->fp, NULL, _IOFBF, TZSP_WRITER_BUFFER);
+    if(!tzsp_writer_header(context->fp))
+    {
+        fclose(context->fp);
+        context->fp = NULL;
+        free(context->filename);
+        context->filename = NULL;
+        return false;
+    }
+
+    context->written = 0;
+    context->started = now;
+
+    /* Keep the disk usage bounded */
+    if(context->max_files &&
+       context->segment > context->max_files &&
+       (old = tzsp_writer_segment(context, context->segment - context->max_files)))
+    {
+        unlink(old);
+        old = realloc(old, strlen(old) + sizeof(TZSP_WRITER_GZ_SUFFIX));
+        if(old)
+        {
+            strcat(old, TZSP_WRITER_GZ_SUFFIX);
+            unlink(old);
+            free(old);
+        }
+    }
+    return true;
+}
+
+static void
+tzsp_writer_close(tzsp_writer_t *context)
+{
+    tzsp_writer_file_t *file;
+    tzsp_writer_file_t **last;
+
+    if(!context->fp)
+        return;
+
+    fclose(context->fp);
+    context->fp = NULL;
+
+    if(!context->compressor_running)
+    {
+        free(context->filename);
+        context->filename = NULL;
+        return;
+    }
+
+    /* Hand the completed segment over to the compressor */
+    file = malloc(sizeof(tzsp_writer_file_t));
+    if(!file)
+    {
+        free(context->filename);
+        context->filename = NULL;
+        return;
+    }
+    file->filename = context->filename;
+    file->next = NULL;
+    context->filename = NULL;
+
+    pthread_mutex_lock(&context->compressor_mutex);
+    for(last = &context->pending; *last; last = &(*last)->next);
+    *last = file;
+    pthread_cond_signal(&context->compressor_cond);
+    pthread_mutex_unlock(&context->compressor_mutex);
+}
+
+static char*
+tzsp_writer_segment(const tzsp_writer_t *context,
+                    uint32_t             segment)
+{
+    char *filename;
+
+    if(asprintf(&filename, "%s-%05u%s", context->prefix, segment, context->suffix) < 0)
+        return NULL;
+    return filename;
+}
+
+static bool
+tzsp_writer_header(FILE *fp)
+{
+    static const char application[] = PCAPNG_APPLICATION;
+    uint8_t block[28 + PCAPNG_PAD(sizeof(application) - 1) + 4 + 4 + 20];
+    uint32_t block_len;
+    uint32_t value;
+    uint16_t option;
+    int64_t section_len = -1;
+    uint8_t *ptr;
+
+    memset(block, 0, sizeof(block));
+    ptr = block;
+
+    /* Section Header Block */
+    block_len = 28 + PCAPNG_PAD(sizeof(application) - 1) + 4 + 4;
+    value = PCAPNG_BLOCK_SHB;         memcpy(ptr, &value, 4); ptr += 4;
+    memcpy(ptr, &block_len, 4);       ptr += 4;
+    value = PCAPNG_BYTE_ORDER_MAGIC;  memcpy(ptr, &value, 4); ptr += 4;
+    option = 1;                       memcpy(ptr, &option, 2); ptr += 2;
+    option = 0;                       memcpy(ptr, &option, 2); ptr += 2;
+    memcpy(ptr, &section_len, 8);     ptr += 8;
+    option = PCAPNG_OPT_USERAPPL;     memcpy(ptr, &option, 2); ptr += 2;
+    option = sizeof(application) - 1; memcpy(ptr, &option, 2); ptr += 2;
+    memcpy(ptr, application, sizeof(application) - 1);
+    ptr += PCAPNG_PAD(sizeof(application) - 1);
+    /* opt_endofopt is already zeroed */
+    ptr += 4;
+    memcpy(ptr, &block_len, 4);       ptr += 4;
+
+    /* Interface Description Block */
+    block_len = 20;
+    value = PCAPNG_BLOCK_IDB;         memcpy(ptr, &value, 4); ptr += 4;
+    memcpy(ptr, &block_len, 4);       ptr += 4;
+    option = PCAPNG_LINKTYPE_80211;   memcpy(ptr, &option, 2); ptr += 2;
+    option = 0;                       memcpy(ptr, &option, 2); ptr += 2;
+    value = TZSP_WRITER_SNAPLEN;      memcpy(ptr, &value, 4); ptr += 4;
+    memcpy(ptr, &block_len, 4);       ptr += 4;
+
+    return fwrite(block, ptr - block, 1, fp) == 1;
+}
+
+static void*
+tzsp_writer_compressor(void *user_data)
+{
+    tzsp_writer_t *context = (tzsp_writer_t*)user_data;
+    tzsp_writer_file_t *file;
+
+    pthread_mutex_lock(&context->compressor_mutex);
+    while(true)
+    {
+        if(!context->pending)
+        {
+            /* Completed segments are compressed before the exit */
+            if(context->compressor_stop)
+                break;
+            pthread_cond_wait(&context->compressor_cond, &context->compressor_mutex);
+            continue;
+        }
+
+        file = context->pending;
+        context->pending = file->next;
+        pthread_mutex_unlock(&context->compressor_mutex);
+
+        tzsp_writer_gzip(file->filename);
+        free(file->filename);
+        free(file);
+
+        pthread_mutex_lock(&context->compressor_mutex);
+    }
+    pthread_mutex_unlock(&context->compressor_mutex);
+    return NULL;
+}
+
+static void
+tzsp_writer_gzip(const char *filename)
+{
+    char buffer[TZSP_WRITER_GZ_CHUNK];
+    char *output;
+    FILE *in;
+    gzFile out;
+    size_t len;
+    bool ok = true;
+
+    if(asprintf(&output, "%s" TZSP_WRITER_GZ_SUFFIX, filename) < 0)
+        return;
+
+    if(!(in = fopen(filename, "rb")))
+    {
+        /* Already removed by the rotation */
+        free(output);
+        return;
+    }
+
+    if(!(out = gzopen(output, "wb")))
+    {
+        fclose(in);
+        free(output);
+        return;
+    }
+
+    while((len = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    {
+        if(gzwrite(out, buffer, len) != (int)len)
+        {
+            ok = false;
+            break;
+        }
+    }
+
+    if(ferror(in))
+        ok = false;
+    fclose(in);
+
+    if(gzclose(out) != Z_OK)
+        ok = false;
+
+    /* Keep only one copy of the segment */
+    unlink(ok ? filename : output);
+    free(output);
+}
@@ -0,0 +1,41 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_TZSP_WRITER_H
+#define MTSCAN_TZSP_WRITER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/time.h>
+
+typedef struct tzsp_writer tzsp_writer_t;
+
+enum
+{
+    TZSP_WRITER_OK           =  0,
+    TZSP_WRITER_ERROR_MEMORY = -1,
+    TZSP_WRITER_ERROR_OPEN   = -2,
+    TZSP_WRITER_ERROR_THREAD = -3
+};
+
+tzsp_writer_t* tzsp_writer_new();
+void tzsp_writer_set_rotation(tzsp_writer_t*, uint64_t, uint32_t, uint32_t);
+void tzsp_writer_set_compress(tzsp_writer_t*, bool);
+int tzsp_writer_init(tzsp_writer_t*, const char*);
+bool tzsp_writer_write(tzsp_writer_t*, const struct timeval*, const uint8_t*, uint32_t, const int8_t*, const uint8_t*);
+uint32_t tzsp_writer_get_dropped(const tzsp_writer_t*);
+void tzsp_writer_free(tzsp_writer_t*);
+
+#endif
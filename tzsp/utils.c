@@ -20,21 +20,21 @@
 #include <stdlib.h>
 #include "utils.h"
 
-char* tzsp_utils_string(const uint8_t *input,
-                        size_t         maxlen)
+size_t
+tzsp_utils_string(char          *output,
+                  size_t         size,
+                  const uint8_t *input,
+                  size_t         maxlen)
 {
     size_t len;
-    char *output;
 
     len = strnlen((const char*)input, maxlen);
-    output = malloc(sizeof(char)*(len+1));
-    if(output)
-    {
-        memcpy(output, (const char *)input, len);
-        output[len] = '\0';
-    }
+    if(len >= size)
+        len = size - 1;
 
-    return output;
+    memcpy(output, (const char*)input, len);
+    output[len] = '\0';
+    return len;
 }
 
 #endif
\ No newline at end of file
@@ -33,6 +33,9 @@
 #include <stdint.h>
 #include <stddef.h>
 
-char* tzsp_utils_string(const uint8_t*, size_t);
+/* Enough for any string carried in a single 8-bit length tag */
+#define TZSP_UTILS_STRING_MAX (UINT8_MAX+1)
+
+size_t tzsp_utils_string(char*, size_t, const uint8_t*, size_t);
 
 #endif
\ No newline at end of file
@@ -13,6 +13,7 @@
  *  GNU General Public License for more details.
  */
 
+#include <math.h>
 #include "model.h"
 #include "ui-callbacks.h"
 #include "ui-toolbar.h"
@@ -24,6 +25,7 @@
 #include "misc.h"
 #include "tzsp-receiver.h"
 #include "callbacks.h"
+#include "ui-sources.h"
 
 static void ui_callback_network_real(network_t*);
 
@@ -36,7 +38,10 @@ ui_callback_status(const mt_ssh_t *context,
                    const gchar    *extended_error)
 {
     if(ui.conn != context)
+    {
+        ui_sources_status(context, status);
         return;
+    }
 
     if(!ui.conn_dialog)
         return;
@@ -51,7 +56,10 @@ ui_callback_verify(const mt_ssh_t *context,
     gboolean verify;
 
     if(ui.conn != context)
+    {
+        ui_sources_verify(context, data);
         return;
+    }
 
     if(!ui.conn_dialog)
         return;
@@ -72,7 +80,10 @@ ui_callback_connected(const mt_ssh_t *context,
                       const gchar    *hwaddr)
 {
     if(ui.conn != context)
+    {
+        ui_sources_status(context, "connected");
         return;
+    }
 
     ui_connected(mt_ssh_get_login(context),
                  mt_ssh_get_hostname(context),
@@ -90,7 +101,10 @@ ui_callback_disconnected(const mt_ssh_t *context,
     ui_connection_mode_t mode;
 
     if(ui.conn != context)
+    {
+        ui_sources_disconnected(context, cancelled);
         return;
+    }
 
     mode = (ui.active ? UI_CONNECTION_MODE_RECONNECT : UI_CONNECTION_MODE_RECONNECT_IDLE);
 
@@ -115,7 +129,10 @@ ui_callback_state(const mt_ssh_t *context,
                   gint            value)
 {
     if(ui.conn != context)
+    {
+        ui_sources_status(context, (value == MTSCAN_MODE_SCANNER ? "scanning" : "idle"));
         return;
+    }
 
     ui.active = (gboolean)value;
     ui_toolbar_scan_set_state(ui.active);
@@ -137,8 +154,16 @@ void
 ui_callback_failure(const mt_ssh_t *context,
                     const gchar    *error)
 {
+    gchar *status;
+
     if(context != ui.conn)
+    {
+        /* Do not block the main window for background sources */
+        status = g_strdup_printf("failure: %s", error);
+        ui_sources_status(context, status);
+        g_free(status);
         return;
+    }
 
     ui_dialog(GTK_WINDOW(ui.window),
               GTK_MESSAGE_ERROR,
@@ -151,7 +176,17 @@ void
 ui_callback_network(const mt_ssh_t *context,
                     network_t      *net)
 {
-    if(ui.conn != context)
+    if(ui.conn == context)
+    {
+        /* Tag networks only when there is more than one source */
+        if(ui_sources_count() && !net->source)
+            net->source = g_strdup_printf("%s/%s", mt_ssh_get_hostname(context), mt_ssh_get_interface(context));
+    }
+    else if(ui_sources_lookup(context))
+    {
+        net->source = g_strdup(ui_sources_get_name(context));
+    }
+    else
     {
         network_free(net);
         g_free(net);
@@ -161,14 +196,48 @@ ui_callback_network(const mt_ssh_t *context,
     ui_callback_network_real(net);
 }
 
+void
+ui_callback_network_seen(const mt_ssh_t *context,
+                         gint64          address,
+                         gint64          captured)
+{
+    gdouble latitude = NAN;
+    gdouble longitude = NAN;
+
+    if(ui.conn != context &&
+       !ui_sources_lookup(context))
+        return;
+
+    /* A network still waiting in the buffer is added with the next update,
+       the seen entries are applied after that */
+    if(!g_hash_table_contains(ui.model->map, &address) &&
+       !mtscan_model_buffer_contains(ui.model, address))
+    {
+        /* The network was removed in the meantime, ask for full data */
+        if(ui.conn == context)
+            mt_ssh_cmd(ui.conn, MT_SSH_CMD_REFRESH, NULL);
+        else
+            ui_sources_refresh(context);
+        return;
+    }
+
+    if(!gps_get_position(captured, &latitude, &longitude))
+    {
+        latitude = NAN;
+        longitude = NAN;
+    }
+
+    mtscan_model_buffer_seen(ui.model, address, captured / G_USEC_PER_SEC, latitude, longitude);
+}
+
 static void
 ui_callback_network_real(network_t *net)
 {
-    const mtscan_gps_data_t *gps_data;
-    if(gps_get_data(&gps_data) == GPS_OK)
+    /* Position at the capture time, regardless of the main loop delay */
+    if(!gps_get_position(net->captured, &net->latitude, &net->longitude))
     {
-        net->latitude = gps_data->lat;
-        net->longitude = gps_data->lon;
+        net->latitude = NAN;
+        net->longitude = NAN;
     }
 
     mtscan_model_buffer_add(ui.model, net);
@@ -180,7 +249,17 @@ ui_callback_heartbeat(const mt_ssh_t *context)
     gint ret;
 
     if(ui.conn != context)
-        return;
+    {
+        if(!ui_sources_lookup(context))
+            return;
+
+        ui_sources_heartbeat(context);
+
+        /* Results of all sources are merged and applied
+           once per heartbeat of the main scanner */
+        if(ui.conn && ui.active && ui.mode == MTSCAN_MODE_SCANNER)
+            return;
+    }
 
     gtk_widget_freeze_child_notify(ui.treeview);
     ret = mtscan_model_buffer_and_inactive_update(ui.model);
@@ -210,7 +289,7 @@ ui_callback_heartbeat(const mt_ssh_t *context)
 
     gtk_widget_thaw_child_notify(ui.treeview);
 
-    ui.activity = ui.mode;
+    ui.activity = (ui.conn == context ? ui.mode : MTSCAN_MODE_SCANNER);
     ui.activity_ts = UNIX_TIMESTAMP();
     gtk_widget_queue_draw(ui.activity_icon);
 
@@ -278,6 +357,20 @@ ui_callback_tzsp_network(const tzsp_receiver_t *context,
     ui_callback_network_real(network);
 }
 
+void
+ui_callback_tzsp_station(const tzsp_receiver_t *context,
+                         station_t             *station)
+{
+    if(ui.tzsp_rx == context)
+    {
+        ui_stations_add(station);
+        ui_changed();
+    }
+
+    station_free(station);
+    g_free(station);
+}
+
 void
 ui_callback_geoloc(gint64 addr)
 {
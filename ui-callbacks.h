@@ -24,11 +24,13 @@ void ui_callback_disconnected(const mt_ssh_t*, gboolean);
 void ui_callback_state(const mt_ssh_t*, gint);
 void ui_callback_failure(const mt_ssh_t*, const gchar*);
 void ui_callback_network(const mt_ssh_t*, network_t*);
+void ui_callback_network_seen(const mt_ssh_t*, gint64, gint64);
 void ui_callback_heartbeat(const mt_ssh_t*);
 void ui_callback_scanlist(const mt_ssh_t*, const gchar*);
 
 void ui_callback_tzsp(tzsp_receiver_t*);
 void ui_callback_tzsp_network(const tzsp_receiver_t*, network_t*);
+void ui_callback_tzsp_station(const tzsp_receiver_t*, station_t*);
 
 void ui_callback_geoloc(gint64);
 
@@ -20,8 +20,12 @@
 #include "ui-connection.h"
 #include "ui-dialogs.h"
 #include "ui-callbacks.h"
+#include "ui-sources.h"
 #include "callbacks.h"
 
+#define UI_CONNECTION_PORT_SSH 22
+#define UI_CONNECTION_PORT_API 8728
+
 typedef struct ui_connection
 {
     GtkWidget *dialog;
@@ -40,6 +44,11 @@ typedef struct ui_connection
     GtkWidget *e_host;
     GtkWidget *s_port;
 
+    GtkWidget *l_protocol;
+    GtkWidget *box_protocol;
+    GtkWidget *r_ssh;
+    GtkWidget *r_api;
+
     GtkWidget *l_login;
     GtkWidget *e_login;
 
@@ -70,6 +79,7 @@ typedef struct ui_connection
     GtkWidget *l_status;
 
     GtkWidget *box_button;
+    GtkWidget *b_sources;
     GtkWidget *b_connect;
     GtkWidget *b_cancel;
     GtkWidget *b_close;
@@ -83,6 +93,7 @@ static void ui_connection_destroy(GtkWidget*, gpointer);
 static void ui_connection_format_desc(GtkCellLayout*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
 static void ui_connection_profile_changed(GtkComboBox*, gpointer);
 static void ui_connection_profile_unset(GtkWidget*, gpointer);
+static void ui_connection_protocol_toggled(GtkWidget*, gpointer);
 static void ui_connection_mode_toggled(GtkWidget*, gpointer);
 static void ui_connection_duration_toggled(GtkWidget*, gpointer);
 static void ui_connection_remote_toggled(GtkWidget*, gpointer);
@@ -95,6 +106,7 @@ static void ui_connection_profile_remove(GtkWidget*, gpointer);
 static void ui_connection_profile_clear(GtkWidget*, gpointer);
 static void ui_connection_connect(GtkWidget*, gpointer);
 static void ui_connection_cancel(GtkWidget*, gpointer);
+static void ui_connection_sources(GtkWidget*, gpointer);
 
 static void ui_connection_from_profile(ui_connection_t *, const conf_profile_t *);
 static conf_profile_t* ui_connection_to_profile(ui_connection_t *, const gchar *);
@@ -147,7 +159,7 @@ ui_connection_new(gint                 profile,
 
     gtk_box_pack_start(GTK_BOX(c->content), gtk_hseparator_new(), FALSE, FALSE, 4);
 
-    c->table = gtk_table_new(8, 3, TRUE);
+    c->table = gtk_table_new(9, 3, TRUE);
     gtk_table_set_homogeneous(GTK_TABLE(c->table), FALSE);
     gtk_table_set_row_spacings(GTK_TABLE(c->table), 2);
     gtk_table_set_col_spacings(GTK_TABLE(c->table), 2);
@@ -158,11 +170,22 @@ ui_connection_new(gint                 profile,
     gtk_misc_set_alignment(GTK_MISC(c->l_host), 0.0, 0.5);
     c->e_host = gtk_entry_new();
     gtk_entry_set_width_chars(GTK_ENTRY(c->e_host), 20);
-    c->s_port = gtk_spin_button_new(GTK_ADJUSTMENT(gtk_adjustment_new((gdouble)22.0, 1.0, 65535.0, 1.0, 10.0, 0.0)), 0, 0);
+    c->s_port = gtk_spin_button_new(GTK_ADJUSTMENT(gtk_adjustment_new((gdouble)UI_CONNECTION_PORT_SSH, 1.0, 65535.0, 1.0, 10.0, 0.0)), 0, 0);
     gtk_table_attach(GTK_TABLE(c->table), c->l_host, 0, 1, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
     gtk_table_attach(GTK_TABLE(c->table), c->e_host, 1, 2, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
     gtk_table_attach(GTK_TABLE(c->table), c->s_port, 2, 3, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
 
+    row++;
+    c->l_protocol = gtk_label_new("Protocol:");
+    gtk_misc_set_alignment(GTK_MISC(c->l_protocol), 0.0, 0.5);
+    c->box_protocol = gtk_hbox_new(FALSE, 6);
+    c->r_ssh = gtk_radio_button_new_with_label(NULL, "SSH");
+    gtk_box_pack_start(GTK_BOX(c->box_protocol), c->r_ssh, FALSE, FALSE, 0);
+    c->r_api = gtk_radio_button_new_with_label_from_widget(GTK_RADIO_BUTTON(c->r_ssh), "RouterOS API");
+    gtk_box_pack_start(GTK_BOX(c->box_protocol), c->r_api, FALSE, FALSE, 0);
+    gtk_table_attach(GTK_TABLE(c->table), c->l_protocol, 0, 1, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
+    gtk_table_attach(GTK_TABLE(c->table), c->box_protocol, 1, 2, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
+
     row++;
     c->l_login = gtk_label_new("Login:");
     gtk_misc_set_alignment(GTK_MISC(c->l_login), 0.0, 0.5);
@@ -231,6 +254,9 @@ ui_connection_new(gint                 profile,
     gtk_box_set_spacing(GTK_BOX(c->box_button), 5);
     gtk_box_pack_start(GTK_BOX(c->content), c->box_button, FALSE, FALSE, 5);
 
+    c->b_sources = gtk_button_new_with_label("Sources...");
+    gtk_container_add(GTK_CONTAINER(c->box_button), c->b_sources);
+    gtk_button_box_set_child_secondary(GTK_BUTTON_BOX(c->box_button), c->b_sources, TRUE);
     c->b_connect = gtk_button_new_from_stock(GTK_STOCK_OK);
     gtk_container_add(GTK_CONTAINER(c->box_button), c->b_connect);
     c->b_cancel = gtk_button_new_from_stock(GTK_STOCK_CANCEL);
@@ -245,6 +271,8 @@ ui_connection_new(gint                 profile,
 
     g_signal_connect(c->e_host, "changed", G_CALLBACK(ui_connection_profile_unset), c);
     g_signal_connect(c->s_port, "changed", G_CALLBACK(ui_connection_profile_unset), c);
+    g_signal_connect(c->r_ssh, "toggled", G_CALLBACK(ui_connection_profile_unset), c);
+    g_signal_connect(c->r_api, "toggled", G_CALLBACK(ui_connection_profile_unset), c);
     g_signal_connect(c->e_login, "changed", G_CALLBACK(ui_connection_profile_unset), c);
     g_signal_connect(c->e_password, "changed", G_CALLBACK(ui_connection_profile_unset), c);
     g_signal_connect(c->e_interface, "changed", G_CALLBACK(ui_connection_profile_unset), c);
@@ -255,6 +283,7 @@ ui_connection_new(gint                 profile,
     g_signal_connect(c->c_remote, "toggled", G_CALLBACK(ui_connection_profile_unset), c);
     g_signal_connect(c->c_background, "toggled", G_CALLBACK(ui_connection_profile_unset), c);
 
+    g_signal_connect(c->r_api, "toggled", G_CALLBACK(ui_connection_protocol_toggled), c);
     g_signal_connect(c->r_scanner, "toggled", G_CALLBACK(ui_connection_mode_toggled), c);
     g_signal_connect(c->r_sniffer, "toggled", G_CALLBACK(ui_connection_mode_toggled), c);
     g_signal_connect(c->c_duration, "toggled", G_CALLBACK(ui_connection_duration_toggled), c);
@@ -263,6 +292,7 @@ ui_connection_new(gint                 profile,
 
     g_signal_connect(c->b_connect, "clicked", G_CALLBACK(ui_connection_connect), c);
     g_signal_connect(c->b_cancel, "clicked", G_CALLBACK(ui_connection_cancel), c);
+    g_signal_connect(c->b_sources, "clicked", G_CALLBACK(ui_connection_sources), c);
     g_signal_connect_swapped(c->b_close, "clicked", G_CALLBACK(gtk_widget_destroy), c->dialog);
 
     g_signal_connect(c->dialog, "key-press-event", G_CALLBACK(ui_connection_key), c);
@@ -378,6 +408,21 @@ ui_connection_profile_unset(GtkWidget *widget,
         gtk_combo_box_set_active(GTK_COMBO_BOX(c->c_profile), -1);
 }
 
+static void
+ui_connection_protocol_toggled(GtkWidget *widget,
+                               gpointer   user_data)
+{
+    ui_connection_t *c = (ui_connection_t*)user_data;
+    gboolean api = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(c->r_api));
+    gint port = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(c->s_port));
+
+    /* Follow the default port, keep a custom one */
+    if(api && port == UI_CONNECTION_PORT_SSH)
+        gtk_spin_button_set_value(GTK_SPIN_BUTTON(c->s_port), (gdouble)UI_CONNECTION_PORT_API);
+    else if(!api && port == UI_CONNECTION_PORT_API)
+        gtk_spin_button_set_value(GTK_SPIN_BUTTON(c->s_port), (gdouble)UI_CONNECTION_PORT_SSH);
+}
+
 static void
 ui_connection_mode_toggled(GtkWidget *widget,
                            gpointer   user_data)
@@ -458,6 +503,8 @@ ui_connection_unlock(ui_connection_t *c,
     gtk_widget_set_sensitive(c->b_profile_clear, value);
     gtk_widget_set_sensitive(c->e_host, value);
     gtk_widget_set_sensitive(c->s_port, value);
+    gtk_widget_set_sensitive(c->r_ssh, value);
+    gtk_widget_set_sensitive(c->r_api, value);
     gtk_widget_set_sensitive(c->e_login, value);
     gtk_widget_set_sensitive(c->e_password, value);
     gtk_widget_set_sensitive(c->c_password, value);
@@ -581,6 +628,7 @@ ui_connection_connect(GtkWidget *widget,
     ui_connection_t *c = (ui_connection_t*)user_data;
     const gchar *hostname = gtk_entry_get_text(GTK_ENTRY(c->e_host));
     gint port = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(c->s_port));
+    gboolean api = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(c->r_api));
     const gchar *login = gtk_entry_get_text(GTK_ENTRY(c->e_login));
     const gchar *password = gtk_entry_get_text(GTK_ENTRY(c->e_password));
     const gchar *iface = gtk_entry_get_text(GTK_ENTRY(c->e_interface));
@@ -634,6 +682,7 @@ ui_connection_connect(GtkWidget *widget,
     ui.conn = mt_ssh_new(callback_mt_ssh,
                          callback_mt_ssh_msg,
                          (c->reconnect_idle ? MT_SSH_MODE_NONE : mode),
+                         (api ? MT_SSH_PROTOCOL_API : MT_SSH_PROTOCOL_SSH),
                          hostname,
                          port,
                          login,
@@ -666,6 +715,14 @@ ui_connection_cancel(GtkWidget *widget,
     }
 }
 
+static void
+ui_connection_sources(GtkWidget *widget,
+                      gpointer   user_data)
+{
+    ui_connection_t *c = (ui_connection_t*)user_data;
+    ui_sources_dialog(GTK_WINDOW(c->dialog));
+}
+
 static void
 ui_connection_from_profile(ui_connection_t      *c,
                            const conf_profile_t *p)
@@ -673,6 +730,8 @@ ui_connection_from_profile(ui_connection_t      *c,
     c->profile_reset_flag = FALSE;
 
     gtk_entry_set_text(GTK_ENTRY(c->e_host), conf_profile_get_host(p));
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(c->r_ssh), conf_profile_get_protocol(p) == MTSCAN_CONF_PROFILE_PROTOCOL_SSH);
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(c->r_api), conf_profile_get_protocol(p) == MTSCAN_CONF_PROFILE_PROTOCOL_API);
     gtk_spin_button_set_value(GTK_SPIN_BUTTON(c->s_port), (gdouble)conf_profile_get_port(p));
     gtk_entry_set_text(GTK_ENTRY(c->e_login), conf_profile_get_login(p));
     gtk_entry_set_text(GTK_ENTRY(c->e_password), conf_profile_get_password(p));
@@ -699,6 +758,7 @@ ui_connection_to_profile(ui_connection_t *c,
     p = conf_profile_new(g_strdup(name),
                          g_strdup(gtk_entry_get_text(GTK_ENTRY(c->e_host))),
                          gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(c->s_port)),
+                         (mtscan_conf_profile_protocol_t)gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(c->r_api)),
                          g_strdup(gtk_entry_get_text(GTK_ENTRY(c->e_login))),
                          g_strdup(keep_pass ? gtk_entry_get_text(GTK_ENTRY(c->e_password)) : ""),
                          g_strdup(gtk_entry_get_text(GTK_ENTRY(c->e_interface))),
@@ -66,6 +66,7 @@ ui_dialog_open(GtkWindow *window,
     GtkWidget *box;
     GtkWidget *strip_signals;
     GtkFileFilter *filter;
+    GtkFileFilter *filter_pcap;
     GtkFileFilter *filter_all;
     GSList *filenames = NULL;
     const gchar *dir;
@@ -98,6 +99,13 @@ ui_dialog_open(GtkWindow *window,
     gtk_file_filter_add_pattern(filter, "*" APP_FILE_EXT APP_FILE_COMPRESS);
     gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(dialog), filter);
 
+    filter_pcap = gtk_file_filter_new();
+    gtk_file_filter_set_name(filter_pcap, "Packet capture");
+    gtk_file_filter_add_pattern(filter_pcap, "*.pcap");
+    gtk_file_filter_add_pattern(filter_pcap, "*.pcapng");
+    gtk_file_filter_add_pattern(filter_pcap, "*.cap");
+    gtk_file_chooser_add_filter(GTK_FILE_CHOOSER(dialog), filter_pcap);
+
     filter_all = gtk_file_filter_new();
     gtk_file_filter_set_name(filter_all, "All files");
     gtk_file_filter_add_pattern(filter_all, "*");
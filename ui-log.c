@@ -14,19 +14,39 @@
  */
 
 #include <gtk/gtk.h>
+#include <math.h>
 #include "ui.h"
 #include "ui-view.h"
 #include "ui-dialogs.h"
 #include "log.h"
+#include "pcap-import.h"
+#include "signals.h"
 #include "conf.h"
+#include "task.h"
 
 typedef struct ui_log_open_context
 {
+    GSList *filenames;
     gboolean merge;
-    gboolean changed;
+    gboolean strip_samples;
+    gboolean imported;
+    gchar *title;
+    GPtrArray *networks;
+    GPtrArray *stations;
+    GArray *track;
+    GSList *errors;
+    task_t *task;
 } ui_log_open_context_t;
 
+static task_t *ui_log_open_pending = NULL;
+
+static void ui_log_open_task(task_t*, gpointer);
+static void ui_log_open_done(task_t*, gpointer);
 static void ui_log_open_net_cb(network_t*, gpointer);
+static void ui_log_open_sta_cb(station_t*, gpointer);
+static void ui_log_open_track_cb(const track_point_t*, gpointer);
+static void ui_log_open_position(network_t*);
+static void ui_log_open_free(ui_log_open_context_t*);
 
 
 void
@@ -34,13 +54,7 @@ ui_log_open(GSList   *list,
             gboolean  merge,
             gboolean  strip_samples)
 {
-    ui_log_open_context_t context;
-    GSList *errors = NULL;
-    const gchar *filename;
-    gint count;
-    GString *text;
-    GSList *it;
-    gchar *str;
+    ui_log_open_context_t *context;
 
     if(!list)
         return;
@@ -48,67 +62,150 @@ ui_log_open(GSList   *list,
     if(!ui_can_discard_unsaved())
         return;
 
-    context.merge = merge;
-    context.changed = FALSE;
+    /* Only the most recent request is applied */
+    if(ui_log_open_pending)
+        task_cancel(ui_log_open_pending);
 
-    if(!context.merge)
+    if(!merge)
         ui_clear();
 
     ui_set_title(NULL);
-    ui_view_lock(ui.treeview);
 
-    while(list != NULL)
+    context = g_malloc0(sizeof(ui_log_open_context_t));
+    context->filenames = g_slist_copy_deep(list, (GCopyFunc)g_strdup, NULL);
+    context->merge = merge;
+    context->strip_samples = strip_samples;
+    context->networks = g_ptr_array_new();
+    context->stations = g_ptr_array_new();
+    context->track = g_array_new(FALSE, FALSE, sizeof(track_point_t));
+
+    /* Files are parsed on a worker, the model is filled when all are done */
+    ui_log_open_pending = task_run(TASK_PRIORITY_UI, ui_log_open_task, ui_log_open_done, context);
+}
+
+static void
+ui_log_open_task(task_t   *task,
+                 gpointer  user_data)
+{
+    ui_log_open_context_t *context = (ui_log_open_context_t*)user_data;
+    const gchar *filename;
+    gboolean capture;
+    gint count;
+    GSList *list;
+
+    context->task = task;
+
+    for(list = context->filenames; list && !task_is_canceled(task); list = list->next)
     {
         filename = (gchar*)list->data;
+        capture = pcap_import_check(filename);
 
-        count = log_read(filename,
-                         ui_log_open_net_cb,
-                         &context,
-                         strip_samples);
+        if(capture)
+        {
+            /* Replay a packet capture instead of reading a log */
+            count = pcap_import(filename,
+                                ui_log_open_net_cb,
+                                context,
+                                context->strip_samples);
+        }
+        else
+        {
+            count = log_read(filename,
+                             ui_log_open_net_cb,
+                             ui_log_open_sta_cb,
+                             ui_log_open_track_cb,
+                             context,
+                             context->strip_samples);
+        }
 
         if(count <= 0)
         {
             switch(count)
             {
                 case LOG_READ_ERROR_OPEN:
-                    errors = g_slist_append(errors, g_markup_printf_escaped("<b>Failed to open a file:</b>\n%s", filename));
+                    context->errors = g_slist_append(context->errors, g_markup_printf_escaped("<b>Failed to open a file:</b>\n%s", filename));
                     break;
 
                 case LOG_READ_ERROR_READ:
-                    errors = g_slist_append(errors, g_markup_printf_escaped("<b>Failed to read a file:</b>\n%s", filename));
+                    context->errors = g_slist_append(context->errors, g_markup_printf_escaped("<b>Failed to read a file:</b>\n%s", filename));
                     break;
 
                 case LOG_READ_ERROR_PARSE:
                 case LOG_READ_ERROR_EMPTY:
-                    errors = g_slist_append(errors, g_markup_printf_escaped("<b>Failed to parse a file:</b>\n%s", filename));
+                    context->errors = g_slist_append(context->errors, g_markup_printf_escaped("<b>Failed to parse a file:</b>\n%s", filename));
                     break;
 
                 default:
-                    errors = g_slist_append(errors, g_markup_printf_escaped("<b>Unknown error:</b>\n%s", filename));
+                    context->errors = g_slist_append(context->errors, g_markup_printf_escaped("<b>Unknown error:</b>\n%s", filename));
                     break;
             }
         }
-        else if(!context.merge)
-            ui_set_title(g_strdup(filename));
+        else if(capture)
+            context->imported = TRUE;
+        else if(!context->merge)
+        {
+            g_free(context->title);
+            context->title = g_strdup(filename);
+        }
+    }
+}
 
-        list = list->next;
+static void
+ui_log_open_done(task_t   *task,
+                 gpointer  user_data)
+{
+    ui_log_open_context_t *context = (ui_log_open_context_t*)user_data;
+    gboolean merge;
+    GString *text;
+    GSList *it;
+    gchar *str;
+    guint i;
+
+    if(ui_log_open_pending == task)
+        ui_log_open_pending = NULL;
+
+    if(task_is_canceled(task))
+    {
+        ui_log_open_free(context);
+        return;
     }
 
-    if(context.changed)
+    if(context->title)
     {
+        ui_set_title(context->title);
+        context->title = NULL;
+    }
+
+    for(i = 0; i < context->track->len; i++)
+        mtscan_track_add(ui.track, &g_array_index(context->track, track_point_t, i));
+
+    if(context->networks->len || context->stations->len)
+    {
+        /* The scanner might have added networks in the meantime */
+        merge = (context->merge || g_hash_table_size(ui.model->map));
+
+        ui_view_lock(ui.treeview);
+        for(i = 0; i < context->networks->len; i++)
+        {
+            ui_log_open_position(g_ptr_array_index(context->networks, i));
+            mtscan_model_add(ui.model, g_ptr_array_index(context->networks, i), merge);
+        }
+        for(i = 0; i < context->stations->len; i++)
+            ui_stations_add(g_ptr_array_index(context->stations, i));
+
         if(conf_get_interface_geoloc())
             mtscan_model_geoloc_all(ui.model);
         ui_status_update_networks();
-        if(context.merge)
+        /* Imported captures are not saved as a log yet */
+        if(context->merge || context->imported)
             ui_changed();
+        ui_view_unlock(ui.treeview);
     }
 
-    ui_view_unlock(ui.treeview);
-
-    if(errors)
+    if(context->errors)
     {
         text = g_string_new("<big><b>Some errors occurred:</b></big>");
-        for(it = errors; it; it=it->next)
+        for(it = context->errors; it; it=it->next)
         {
             text = g_string_append(text, "\n\n");
             text = g_string_append(text, (gchar*)it->data);
@@ -117,9 +214,9 @@ ui_log_open(GSList   *list,
         str = g_string_free(text, FALSE);
         ui_dialog(GTK_WINDOW(ui.window), GTK_MESSAGE_ERROR, APP_NAME, str);
         g_free(str);
-
-        g_slist_free_full(errors, g_free);
     }
+
+    ui_log_open_free(context);
 }
 
 static void
@@ -127,12 +224,112 @@ ui_log_open_net_cb(network_t *network,
                    gpointer   user_data)
 {
     ui_log_open_context_t *context = (ui_log_open_context_t*)user_data;
+    network_t *copy;
 
-    mtscan_model_add(ui.model,
-                     network,
-                     context->merge);
+    if(task_is_canceled(context->task))
+        return;
+
+    /* The reader reuses its network, keep a copy with the signal samples */
+    copy = network_dup(network);
+    copy->signals = network->signals;
+    network->signals = NULL;
+    g_ptr_array_add(context->networks, copy);
+}
+
+static void
+ui_log_open_sta_cb(station_t *station,
+                   gpointer   user_data)
+{
+    ui_log_open_context_t *context = (ui_log_open_context_t*)user_data;
+    station_t *copy;
+
+    if(task_is_canceled(context->task))
+        return;
+
+    copy = g_memdup(station, sizeof(station_t));
+    station->ssid = NULL;
+    station->source = NULL;
+    g_ptr_array_add(context->stations, copy);
+}
+
+static void
+ui_log_open_track_cb(const track_point_t *point,
+                     gpointer             user_data)
+{
+    ui_log_open_context_t *context = (ui_log_open_context_t*)user_data;
+
+    if(task_is_canceled(context->task))
+        return;
+
+    g_array_append_vals(context->track, point, 1);
+}
+
+static void
+ui_log_open_position(network_t *network)
+{
+    signals_node_t *sample;
+    gint8 rssi = G_MININT8;
+
+    if(!network->signals ||
+       !mtscan_track_count(ui.track))
+        return;
+
+    /* Samples without a position (e.g. from imported captures)
+       are placed on the GPS track at their timestamp */
+    for(sample = network->signals->head; sample; sample = sample->next)
+    {
+        if(isnan(sample->latitude) || isnan(sample->longitude))
+        {
+            if(!mtscan_track_lookup(ui.track, sample->timestamp, &sample->latitude, &sample->longitude))
+                continue;
+        }
+
+        if(isnan(network->latitude) && sample->rssi > rssi)
+            rssi = sample->rssi;
+    }
+
+    if(!isnan(network->latitude) || rssi == G_MININT8)
+        return;
+
+    /* The network itself is placed at its strongest sample */
+    for(sample = network->signals->head; sample; sample = sample->next)
+    {
+        if(sample->rssi == rssi && !isnan(sample->latitude))
+        {
+            network->latitude = sample->latitude;
+            network->longitude = sample->longitude;
+            break;
+        }
+    }
+}
+
+static void
+ui_log_open_free(ui_log_open_context_t *context)
+{
+    network_t *network;
+    station_t *station;
+    guint i;
+
+    for(i = 0; i < context->networks->len; i++)
+    {
+        network = g_ptr_array_index(context->networks, i);
+        network_free(network);
+        g_free(network);
+    }
+    for(i = 0; i < context->stations->len; i++)
+    {
+        station = g_ptr_array_index(context->stations, i);
+        station_free(station);
+        g_free(station);
+    }
 
-    context->changed = TRUE;
+    g_ptr_array_free(context->networks, TRUE);
+    g_ptr_array_free(context->stations, TRUE);
+    g_array_free(context->track, TRUE);
+    g_slist_free_full(context->errors, g_free);
+    g_slist_free_full(context->filenames, g_free);
+    g_free(context->title);
+    g_free(context);
 }
 
 gboolean
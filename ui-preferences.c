@@ -23,6 +23,7 @@
 #include "misc.h"
 #include "ui-dialog-pcap.h"
 #include "ui-callbacks.h"
+#include "blacklist.h"
 
 enum
 {
@@ -110,6 +111,9 @@ typedef struct ui_preferences
     GtkWidget *box_tzsp_band;
     GtkWidget *r_tzsp_band_2g;
     GtkWidget *r_tzsp_band_5g;
+    GtkWidget *l_tzsp_sensors;
+    GtkWidget *e_tzsp_sensors;
+    GtkWidget *x_tzsp_stations;
     GtkWidget *box_tzsp_info;
     GtkWidget *i_tzsp_info;
     GtkWidget *l_tzsp_info;
@@ -163,7 +167,7 @@ static void ui_preferences_tzsp_mode_callback(GtkWidget*, gpointer);
 static void ui_preferences_tzsp_interface(GtkWidget*, gpointer);
 static void ui_preferences_tzsp_interface_callback(const gchar*, gpointer);
 
-static void ui_preferences_list_create(ui_preferences_list_t*, GtkWidget*, const gchar*, const gchar*, const gchar*);
+static void ui_preferences_list_create(ui_preferences_list_t*, GtkWidget*, const gchar*, const gchar*, const gchar*, gboolean);
 static void ui_preferences_list_format(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
 
 static gboolean ui_preferences_key(GtkWidget*, GdkEventKey*, gpointer);
@@ -375,7 +379,7 @@ ui_preferences_dialog(void)
     gtk_notebook_append_page(GTK_NOTEBOOK(p.notebook), p.page_tzsp, gtk_label_new("TZSP"));
     gtk_container_child_set(GTK_CONTAINER(p.notebook), p.page_tzsp, "tab-expand", FALSE, "tab-fill", FALSE, NULL);
 
-    p.table_tzsp = gtk_table_new(5, 3, TRUE);
+    p.table_tzsp = gtk_table_new(7, 3, TRUE);
     gtk_table_set_homogeneous(GTK_TABLE(p.table_tzsp), FALSE);
     gtk_table_set_row_spacings(GTK_TABLE(p.table_tzsp), 4);
     gtk_table_set_col_spacings(GTK_TABLE(p.table_tzsp), 4);
@@ -432,6 +436,19 @@ ui_preferences_dialog(void)
     gtk_box_pack_start(GTK_BOX(p.box_tzsp_band), p.r_tzsp_band_5g, FALSE, FALSE, 0);
     gtk_table_attach(GTK_TABLE(p.table_tzsp), p.box_tzsp_band, 1, 3, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
 
+    row++;
+    p.l_tzsp_sensors = gtk_label_new("Extra sensors:");
+    gtk_misc_set_alignment(GTK_MISC(p.l_tzsp_sensors), 0.0, 0.5);
+    gtk_table_attach(GTK_TABLE(p.table_tzsp), p.l_tzsp_sensors, 0, 1, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
+    p.e_tzsp_sensors = gtk_entry_new();
+    gtk_widget_set_tooltip_text(p.e_tzsp_sensors, "Additional sensor MAC addresses, separated by spaces or commas");
+    gtk_table_attach(GTK_TABLE(p.table_tzsp), p.e_tzsp_sensors, 1, 3, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
+
+    row++;
+    p.x_tzsp_stations = gtk_check_button_new_with_label("Discover client stations");
+    gtk_widget_set_tooltip_text(p.x_tzsp_stations, "Track stations from data and probe request frames");
+    gtk_table_attach(GTK_TABLE(p.table_tzsp), p.x_tzsp_stations, 0, 3, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
+
     p.box_tzsp_info = gtk_hbox_new(FALSE, 5);
     p.i_tzsp_info = gtk_image_new_from_icon_name("gtk-dialog-warning", GTK_ICON_SIZE_MENU);
     gtk_box_pack_start(GTK_BOX(p.box_tzsp_info), p.i_tzsp_info, FALSE, FALSE, 1);
@@ -476,13 +493,13 @@ ui_preferences_dialog(void)
     gtk_table_attach(GTK_TABLE(p.table_gps), p.x_gps_show_errors, 0, 2, row, row+1, GTK_EXPAND|GTK_FILL, 0, 0, 0);
 
     /* Blacklist */
-    ui_preferences_list_create(&p.blacklist, p.notebook, "Blacklist", "Enable blacklist", "Invert to whitelist");
+    ui_preferences_list_create(&p.blacklist, p.notebook, "Blacklist", "Enable blacklist", "Invert to whitelist", TRUE);
 
     /* Highlight list */
-    ui_preferences_list_create(&p.highlightlist, p.notebook, "Highlight", "Enable highlight list", "Invert highlight list");
+    ui_preferences_list_create(&p.highlightlist, p.notebook, "Highlight", "Enable highlight list", "Invert highlight list", FALSE);
 
     /* Alarm list */
-    ui_preferences_list_create(&p.alarmlist, p.notebook, "Alarm", "Enable alarm list", NULL);
+    ui_preferences_list_create(&p.alarmlist, p.notebook, "Alarm", "Enable alarm list", NULL, FALSE);
 
     /* Location */
     p.page_location = gtk_vbox_new(FALSE, 5);
@@ -657,7 +674,8 @@ ui_preferences_list_create(ui_preferences_list_t *l,
                            GtkWidget             *notebook,
                            const gchar           *title,
                            const gchar           *enable_title,
-                           const gchar           *invert_title)
+                           const gchar           *invert_title,
+                           gboolean               prefixes)
 {
     GtkTreeViewColumn *column;
     GtkCellRenderer *renderer;
@@ -684,6 +702,7 @@ ui_preferences_list_create(ui_preferences_list_t *l,
     }
 
     l->view = gtk_tree_view_new();
+    g_object_set_data(G_OBJECT(l->view), "mtscan-prefixes", GINT_TO_POINTER(prefixes));
     renderer = gtk_cell_renderer_text_new();
     gtk_cell_renderer_text_set_fixed_height_from_font(GTK_CELL_RENDERER_TEXT(renderer), 1);
     column = gtk_tree_view_column_new_with_attributes("Address", renderer, NULL);
@@ -723,8 +742,16 @@ ui_preferences_list_format(GtkTreeViewColumn *col,
                            GtkTreeIter       *iter,
                            gpointer           data)
 {
+    gchar text[8];
     gint64 address;
     gtk_tree_model_get(store, iter, 0, &address, -1);
+
+    if(address & BLACKLIST_OUI)
+    {
+        g_snprintf(text, sizeof(text), "%06X*", (gint)(address & BLACKLIST_OUI_MASK));
+        g_object_set(renderer, "text", text, NULL);
+        return;
+    }
     g_object_set(renderer, "text", model_format_address(address, FALSE), NULL);
 }
 
@@ -785,6 +812,7 @@ ui_preferences_list_add(GtkWidget *widget,
     GRegex *regex;
     gchar *match = NULL;
     gint64 addr = -1;
+    gboolean prefixes = GPOINTER_TO_INT(g_object_get_data(G_OBJECT(treeview), "mtscan-prefixes"));
 
     dialog = gtk_message_dialog_new_with_markup(GTK_WINDOW(toplevel),
                                                 GTK_DIALOG_MODAL,
@@ -792,7 +820,8 @@ ui_preferences_list_add(GtkWidget *widget,
                                                 GTK_BUTTONS_OK_CANCEL,
                                                 "<big>Enter network address</big>\n"
                                                 "eg. 01:23:45:67:89:AB\n"
-                                                "or 0123456789AB");
+                                                "or 0123456789AB%s",
+                                                (prefixes ? "\nor vendor prefix, eg. 01:23:45" : ""));
 
     gtk_window_set_title(GTK_WINDOW(dialog), "New network entry");
     entry = gtk_entry_new();
@@ -831,8 +860,33 @@ ui_preferences_list_add(GtkWidget *widget,
             }
         }
 
-        if(!match ||
-           ((addr = str_addr_to_gint64(match, strlen(match))) < 0))
+        if(match)
+        {
+            addr = str_addr_to_gint64(match, strlen(match));
+        }
+        else if(prefixes)
+        {
+            /* Whole vendor rule */
+            regex = g_regex_new("^([0-9A-Fa-f]{2}:?){2}([0-9A-Fa-f]{2})$", 0, 0, &err);
+            if(regex)
+            {
+                g_regex_match(regex, value, 0, &matchInfo);
+                if(g_match_info_matches(matchInfo))
+                {
+                    match = g_match_info_fetch(matchInfo, 0);
+                    if(match)
+                        remove_char(match, ':');
+                }
+                g_match_info_free(matchInfo);
+                g_regex_unref(regex);
+            }
+
+            if(match &&
+               (addr = str_oui_to_gint64(match, strlen(match))) >= 0)
+                addr |= BLACKLIST_OUI;
+        }
+
+        if(addr < 0)
         {
             ui_dialog(GTK_WINDOW(toplevel),
                       GTK_MESSAGE_ERROR,
@@ -952,6 +1006,8 @@ ui_preferences_load(ui_preferences_t *p)
     gtk_spin_button_set_value(GTK_SPIN_BUTTON(p->s_tzsp_channel_width), conf_get_preferences_tzsp_channel_width());
     gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(p->r_tzsp_band_2g), conf_get_preferences_tzsp_band() == MTSCAN_CONF_TZSP_BAND_2GHZ);
     gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(p->r_tzsp_band_5g), conf_get_preferences_tzsp_band() == MTSCAN_CONF_TZSP_BAND_5GHZ);
+    gtk_entry_set_text(GTK_ENTRY(p->e_tzsp_sensors), conf_get_preferences_tzsp_sensors());
+    gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(p->x_tzsp_stations), conf_get_preferences_tzsp_stations());
 
     /* GPS */
     gtk_entry_set_text(GTK_ENTRY(p->e_gps_hostname), conf_get_preferences_gps_hostname());
@@ -1038,6 +1094,9 @@ ui_preferences_apply(GtkWidget *widget,
     const gchar *new_tzsp_interface;
     gint new_tzsp_channel_width;
     mtscan_conf_tzsp_band_t new_tzsp_band;
+    const gchar *new_tzsp_sensors;
+    gboolean new_tzsp_stations;
+    gboolean tzsp_changed;
     const gchar *new_gps_hostname;
     gint new_gps_tcp_port;
     gdouble new_location_latitude;
@@ -1112,22 +1171,29 @@ ui_preferences_apply(GtkWidget *widget,
     new_tzsp_interface = gtk_entry_get_text(GTK_ENTRY(p->e_tzsp_interface));
     new_tzsp_channel_width = gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(p->s_tzsp_channel_width));
     new_tzsp_band = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(p->r_tzsp_band_2g)) ? MTSCAN_CONF_TZSP_BAND_2GHZ : MTSCAN_CONF_TZSP_BAND_5GHZ;
-
-    if(ui.tzsp_rx &&
-       ((conf_get_preferences_tzsp_mode() != new_tzsp_mode) ||
-        (conf_get_preferences_tzsp_udp_port() != new_tzsp_udp_port) ||
-        (strcmp(conf_get_preferences_tzsp_interface(), new_tzsp_interface) != 0) ||
-        (conf_get_preferences_tzsp_channel_width() != new_tzsp_channel_width) ||
-        (conf_get_preferences_tzsp_band() != new_tzsp_band)))
-    {
-
-    }
+    new_tzsp_sensors = gtk_entry_get_text(GTK_ENTRY(p->e_tzsp_sensors));
+    new_tzsp_stations = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(p->x_tzsp_stations));
+
+    tzsp_changed = (ui.tzsp_rx &&
+                    ((conf_get_preferences_tzsp_mode() != new_tzsp_mode) ||
+                     (conf_get_preferences_tzsp_udp_port() != new_tzsp_udp_port) ||
+                     (strcmp(conf_get_preferences_tzsp_interface(), new_tzsp_interface) != 0) ||
+                     (conf_get_preferences_tzsp_channel_width() != new_tzsp_channel_width) ||
+                     (conf_get_preferences_tzsp_band() != new_tzsp_band) ||
+                     (strcmp(conf_get_preferences_tzsp_sensors(), new_tzsp_sensors) != 0) ||
+                     (conf_get_preferences_tzsp_stations() != new_tzsp_stations)));
 
     conf_set_preferences_tzsp_mode(new_tzsp_mode);
     conf_set_preferences_tzsp_udp_port(new_tzsp_udp_port);
     conf_set_preferences_tzsp_interface(new_tzsp_interface);
     conf_set_preferences_tzsp_channel_width(new_tzsp_channel_width);
     conf_set_preferences_tzsp_band(new_tzsp_band);
+    conf_set_preferences_tzsp_sensors(new_tzsp_sensors);
+    conf_set_preferences_tzsp_stations(new_tzsp_stations);
+
+    /* Restart the tzsp-receiver with new settings */
+    if(tzsp_changed)
+        ui_tzsp();
 
     /* GPS */
     new_gps_hostname = gtk_entry_get_text(GTK_ENTRY(p->e_gps_hostname));
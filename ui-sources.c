@@ -0,0 +1,490 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include "ui.h"
+#include "ui-sources.h"
+#include "conf.h"
+#include "ui-dialogs.h"
+#include "callbacks.h"
+
+#define UI_SOURCES_RECONNECT_MS 3000
+
+#define UI_SOURCES_DEFAULT_WIDTH  360
+#define UI_SOURCES_DEFAULT_HEIGHT 150
+
+enum
+{
+    UI_SOURCES_COL_NAME,
+    UI_SOURCES_COL_STATUS,
+    UI_SOURCES_COL_SOURCE,
+    UI_SOURCES_COLS
+};
+
+/* Additional scanners working alongside the main connection,
+   all of them are feeding the same model */
+typedef struct ui_source
+{
+    gint         profile;
+    gchar       *name;
+    mt_ssh_t    *conn;
+    gchar       *status;
+    gint64       heartbeat_ts;
+    guint        reconnect;
+    GtkTreeIter  iter;
+} ui_source_t;
+
+typedef struct ui_sources_dialog
+{
+    GtkWidget *window;
+    GtkWidget *content;
+    GtkWidget *scrolled;
+    GtkWidget *view;
+    GtkWidget *box_profile;
+    GtkWidget *c_profile;
+    GtkWidget *b_add;
+    GtkWidget *box_button;
+    GtkWidget *b_remove;
+    GtkWidget *b_close;
+} ui_sources_dialog_t;
+
+static GSList *sources = NULL;
+static GtkListStore *store = NULL;
+static ui_sources_dialog_t *dialog = NULL;
+
+static ui_source_t* ui_sources_find(const mt_ssh_t*);
+static gboolean ui_sources_start(ui_source_t*);
+static gboolean ui_sources_reconnect(gpointer);
+static void ui_sources_stop(ui_source_t*);
+static void ui_sources_remove(ui_source_t*);
+static void ui_sources_update(void);
+
+static void ui_sources_dialog_destroy(GtkWidget*, gpointer);
+static void ui_sources_dialog_format_profile(GtkCellLayout*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
+static void ui_sources_dialog_add(GtkWidget*, gpointer);
+static void ui_sources_dialog_remove(GtkWidget*, gpointer);
+
+
+void
+ui_sources_connect(gint profile)
+{
+    ui_source_t *s;
+
+    if(profile <= 0)
+        return;
+
+    if(!store)
+        store = gtk_list_store_new(UI_SOURCES_COLS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_POINTER);
+
+    s = g_malloc0(sizeof(ui_source_t));
+    s->profile = profile;
+    sources = g_slist_append(sources, s);
+    gtk_list_store_insert_with_values(store, &s->iter, -1,
+                                      UI_SOURCES_COL_SOURCE, s,
+                                      -1);
+
+    if(!ui_sources_start(s))
+        ui_sources_remove(s);
+}
+
+void
+ui_sources_cancel(void)
+{
+    GSList *current = sources;
+    ui_source_t *s;
+
+    while(current)
+    {
+        s = (ui_source_t*)current->data;
+        current = current->next;
+        ui_sources_stop(s);
+    }
+}
+
+void
+ui_sources_dialog(GtkWindow *parent)
+{
+    GtkCellRenderer *renderer;
+    GtkTreeViewColumn *column;
+
+    if(dialog)
+    {
+        gtk_window_present(GTK_WINDOW(dialog->window));
+        return;
+    }
+
+    if(!store)
+        store = gtk_list_store_new(UI_SOURCES_COLS, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_POINTER);
+
+    dialog = g_malloc(sizeof(ui_sources_dialog_t));
+    dialog->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_modal(GTK_WINDOW(dialog->window), TRUE);
+    gtk_window_set_title(GTK_WINDOW(dialog->window), "Sources");
+    gtk_window_set_destroy_with_parent(GTK_WINDOW(dialog->window), TRUE);
+    gtk_container_set_border_width(GTK_CONTAINER(dialog->window), 2);
+    gtk_window_set_transient_for(GTK_WINDOW(dialog->window), parent);
+    gtk_window_set_position(GTK_WINDOW(dialog->window), GTK_WIN_POS_CENTER_ON_PARENT);
+
+    dialog->content = gtk_vbox_new(FALSE, 0);
+    gtk_container_add(GTK_CONTAINER(dialog->window), dialog->content);
+
+    dialog->view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
+    gtk_tree_view_set_rules_hint(GTK_TREE_VIEW(dialog->view), TRUE);
+
+    renderer = gtk_cell_renderer_text_new();
+    column = gtk_tree_view_column_new_with_attributes("Source", renderer, "text", UI_SOURCES_COL_NAME, NULL);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(dialog->view), column);
+
+    renderer = gtk_cell_renderer_text_new();
+    g_object_set(renderer, "ellipsize", PANGO_ELLIPSIZE_END, "ellipsize-set", TRUE, NULL);
+    column = gtk_tree_view_column_new_with_attributes("Status", renderer, "text", UI_SOURCES_COL_STATUS, NULL);
+    gtk_tree_view_column_set_expand(column, TRUE);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(dialog->view), column);
+
+    dialog->scrolled = gtk_scrolled_window_new(NULL, NULL);
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(dialog->scrolled), GTK_POLICY_NEVER, GTK_POLICY_AUTOMATIC);
+    gtk_container_add(GTK_CONTAINER(dialog->scrolled), dialog->view);
+    gtk_widget_set_size_request(dialog->scrolled, UI_SOURCES_DEFAULT_WIDTH, UI_SOURCES_DEFAULT_HEIGHT);
+    gtk_container_add(GTK_CONTAINER(dialog->content), dialog->scrolled);
+
+    /* Additional sources are started from saved profiles, in scanner mode */
+    dialog->box_profile = gtk_hbox_new(FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(dialog->content), dialog->box_profile, FALSE, FALSE, 4);
+
+    dialog->c_profile = gtk_combo_box_new_with_model(GTK_TREE_MODEL(conf_get_profiles()));
+    renderer = gtk_cell_renderer_text_new();
+    g_object_set(renderer, "ellipsize", PANGO_ELLIPSIZE_END, "ellipsize-set", TRUE, NULL);
+    gtk_cell_layout_pack_start(GTK_CELL_LAYOUT(dialog->c_profile), renderer, TRUE);
+    gtk_cell_layout_set_cell_data_func(GTK_CELL_LAYOUT(dialog->c_profile), renderer, ui_sources_dialog_format_profile, NULL, NULL);
+    gtk_combo_box_set_active(GTK_COMBO_BOX(dialog->c_profile), 0);
+    gtk_box_pack_start(GTK_BOX(dialog->box_profile), dialog->c_profile, TRUE, TRUE, 0);
+
+    dialog->b_add = gtk_button_new_from_stock(GTK_STOCK_ADD);
+    g_signal_connect(dialog->b_add, "clicked", G_CALLBACK(ui_sources_dialog_add), dialog);
+    gtk_box_pack_start(GTK_BOX(dialog->box_profile), dialog->b_add, FALSE, FALSE, 4);
+
+    dialog->box_button = gtk_hbutton_box_new();
+    gtk_button_box_set_layout(GTK_BUTTON_BOX(dialog->box_button), GTK_BUTTONBOX_END);
+    gtk_box_set_spacing(GTK_BOX(dialog->box_button), 5);
+    gtk_box_pack_start(GTK_BOX(dialog->content), dialog->box_button, FALSE, FALSE, 5);
+
+    dialog->b_remove = gtk_button_new_from_stock(GTK_STOCK_REMOVE);
+    g_signal_connect(dialog->b_remove, "clicked", G_CALLBACK(ui_sources_dialog_remove), dialog);
+    gtk_container_add(GTK_CONTAINER(dialog->box_button), dialog->b_remove);
+
+    dialog->b_close = gtk_button_new_from_stock(GTK_STOCK_CLOSE);
+    g_signal_connect_swapped(dialog->b_close, "clicked", G_CALLBACK(gtk_widget_destroy), dialog->window);
+    gtk_container_add(GTK_CONTAINER(dialog->box_button), dialog->b_close);
+
+    g_signal_connect(dialog->window, "destroy", G_CALLBACK(ui_sources_dialog_destroy), dialog);
+    gtk_widget_show_all(dialog->window);
+}
+
+gint
+ui_sources_count(void)
+{
+    return g_slist_length(sources);
+}
+
+gboolean
+ui_sources_lookup(const mt_ssh_t *context)
+{
+    return (context && ui_sources_find(context) != NULL);
+}
+
+const gchar*
+ui_sources_get_name(const mt_ssh_t *context)
+{
+    ui_source_t *s = ui_sources_find(context);
+    return (s ? s->name : NULL);
+}
+
+void
+ui_sources_status(const mt_ssh_t *context,
+                  const gchar    *status)
+{
+    ui_source_t *s = ui_sources_find(context);
+
+    if(!s)
+        return;
+
+    g_free(s->status);
+    s->status = g_strdup(status);
+    ui_sources_update();
+}
+
+void
+ui_sources_verify(const mt_ssh_t *context,
+                  const gchar    *info)
+{
+    ui_source_t *s = ui_sources_find(context);
+
+    if(!s)
+        return;
+
+    if(ui_dialog_yesno(GTK_WINDOW(ui.window), info) == UI_DIALOG_YES)
+        mt_ssh_cmd(s->conn, MT_SSH_CMD_AUTH, NULL);
+    else
+        mt_ssh_cancel(s->conn);
+}
+
+void
+ui_sources_refresh(const mt_ssh_t *context)
+{
+    ui_source_t *s = ui_sources_find(context);
+
+    if(s)
+        mt_ssh_cmd(s->conn, MT_SSH_CMD_REFRESH, NULL);
+}
+
+void
+ui_sources_disconnected(const mt_ssh_t *context,
+                        gboolean        cancelled)
+{
+    ui_source_t *s = ui_sources_find(context);
+
+    if(!s)
+        return;
+
+    s->conn = NULL;
+
+    if(cancelled || !conf_get_preferences_reconnect())
+    {
+        ui_sources_remove(s);
+        return;
+    }
+
+    g_free(s->status);
+    s->status = g_strdup("reconnecting");
+    s->reconnect = g_timeout_add(UI_SOURCES_RECONNECT_MS, ui_sources_reconnect, s);
+    ui_sources_update();
+}
+
+void
+ui_sources_heartbeat(const mt_ssh_t *context)
+{
+    ui_source_t *s = ui_sources_find(context);
+
+    if(!s)
+        return;
+
+    s->heartbeat_ts = UNIX_TIMESTAMP();
+    ui_sources_update();
+}
+
+static ui_source_t*
+ui_sources_find(const mt_ssh_t *context)
+{
+    GSList *current;
+
+    for(current = sources; current; current = current->next)
+        if(((ui_source_t*)current->data)->conn == context)
+            return (ui_source_t*)current->data;
+
+    return NULL;
+}
+
+static gboolean
+ui_sources_start(ui_source_t *s)
+{
+    GtkTreeModel *model = GTK_TREE_MODEL(conf_get_profiles());
+    GtkTreeIter iter;
+    conf_profile_t *p;
+
+    if(!gtk_tree_model_iter_nth_child(model, &iter, NULL, s->profile-1))
+        return FALSE;
+
+    p = conf_profile_list_get(GTK_LIST_STORE(model), &iter);
+
+    g_free(s->name);
+    if(strlen(conf_profile_get_name(p)))
+        s->name = g_strdup(conf_profile_get_name(p));
+    else
+        s->name = g_strdup_printf("%s/%s", conf_profile_get_host(p), conf_profile_get_interface(p));
+
+    g_free(s->status);
+    s->status = g_strdup("connecting");
+
+    /* Sniffer mode is reserved for the main connection,
+       the tzsp-receiver is bound to its interface */
+    s->conn = mt_ssh_new(callback_mt_ssh,
+                         callback_mt_ssh_msg,
+                         MT_SSH_MODE_SCANNER,
+                         (conf_profile_get_protocol(p) == MTSCAN_CONF_PROFILE_PROTOCOL_API ? MT_SSH_PROTOCOL_API : MT_SSH_PROTOCOL_SSH),
+                         conf_profile_get_host(p),
+                         conf_profile_get_port(p),
+                         conf_profile_get_login(p),
+                         conf_profile_get_password(p),
+                         conf_profile_get_interface(p),
+                         (conf_profile_get_duration(p) ? conf_profile_get_duration_time(p) : 0),
+                         conf_profile_get_remote(p),
+                         conf_profile_get_background(p));
+
+    conf_profile_free(p);
+    ui_sources_update();
+    return TRUE;
+}
+
+static gboolean
+ui_sources_reconnect(gpointer user_data)
+{
+    ui_source_t *s = (ui_source_t*)user_data;
+
+    s->reconnect = 0;
+    if(!ui_sources_start(s))
+        ui_sources_remove(s);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+ui_sources_stop(ui_source_t *s)
+{
+    if(s->conn)
+    {
+        /* Source is removed once its thread is finished */
+        mt_ssh_cancel(s->conn);
+        g_free(s->status);
+        s->status = g_strdup("disconnecting");
+        ui_sources_update();
+    }
+    else
+    {
+        /* Waiting for reconnect */
+        ui_sources_remove(s);
+    }
+}
+
+static void
+ui_sources_remove(ui_source_t *s)
+{
+    if(s->reconnect)
+        g_source_remove(s->reconnect);
+
+    gtk_list_store_remove(store, &s->iter);
+    sources = g_slist_remove(sources, s);
+    g_free(s->name);
+    g_free(s->status);
+    g_free(s);
+    ui_sources_update();
+}
+
+static void
+ui_sources_update(void)
+{
+    GString *string;
+    GSList *current;
+    ui_source_t *s;
+    gint64 now;
+    gchar *status;
+    gchar *text;
+
+    if(!sources)
+    {
+        gtk_widget_set_tooltip_text(ui.l_conn_status, NULL);
+        return;
+    }
+
+    now = UNIX_TIMESTAMP();
+    string = g_string_new(NULL);
+    for(current = sources; current; current = current->next)
+    {
+        s = (ui_source_t*)current->data;
+        if(s->heartbeat_ts)
+            status = g_strdup_printf("%s (%" G_GINT64_FORMAT "s ago)", s->status, now - s->heartbeat_ts);
+        else
+            status = g_strdup(s->status);
+
+        gtk_list_store_set(store, &s->iter,
+                           UI_SOURCES_COL_NAME, s->name,
+                           UI_SOURCES_COL_STATUS, status,
+                           -1);
+
+        g_string_append_printf(string, "%s%s: %s",
+                               (string->len ? "\n" : ""),
+                               s->name, status);
+        g_free(status);
+    }
+
+    text = g_string_free(string, FALSE);
+    gtk_widget_set_tooltip_text(ui.l_conn_status, text);
+    g_free(text);
+}
+
+static void
+ui_sources_dialog_destroy(GtkWidget *widget,
+                          gpointer   user_data)
+{
+    g_free(dialog);
+    dialog = NULL;
+}
+
+static void
+ui_sources_dialog_format_profile(GtkCellLayout   *cell,
+                                 GtkCellRenderer *renderer,
+                                 GtkTreeModel    *model,
+                                 GtkTreeIter     *iter,
+                                 gpointer         user_data)
+{
+    gchar *name;
+    gchar *iter_str;
+    gchar *text;
+
+    iter_str = gtk_tree_model_get_string_from_iter(model, iter);
+    gtk_tree_model_get(model, iter, CONF_PROFILE_COL_NAME, &name, -1);
+    text = g_strdup_printf("%d. %s", atoi(iter_str)+1, name);
+    g_object_set(renderer, "text", text, NULL);
+
+    g_free(iter_str);
+    g_free(text);
+    g_free(name);
+}
+
+static void
+ui_sources_dialog_add(GtkWidget *widget,
+                      gpointer   user_data)
+{
+    ui_sources_dialog_t *d = (ui_sources_dialog_t*)user_data;
+    gint profile = gtk_combo_box_get_active(GTK_COMBO_BOX(d->c_profile));
+
+    if(profile < 0)
+    {
+        ui_dialog(GTK_WINDOW(d->window),
+                  GTK_MESSAGE_ERROR,
+                  APP_NAME,
+                  "<b><big>Error:</big></b>\nSelect a saved connection profile first.");
+        return;
+    }
+
+    ui_sources_connect(profile + 1);
+}
+
+static void
+ui_sources_dialog_remove(GtkWidget *widget,
+                         gpointer   user_data)
+{
+    ui_sources_dialog_t *d = (ui_sources_dialog_t*)user_data;
+    GtkTreeSelection *selection;
+    GtkTreeIter iter;
+    ui_source_t *s;
+
+    selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(d->view));
+    if(!gtk_tree_selection_get_selected(selection, NULL, &iter))
+        return;
+
+    gtk_tree_model_get(GTK_TREE_MODEL(store), &iter, UI_SOURCES_COL_SOURCE, &s, -1);
+    ui_sources_stop(s);
+}
@@ -0,0 +1,35 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_UI_SOURCES_H_
+#define MTSCAN_UI_SOURCES_H_
+#include <gtk/gtk.h>
+#include "mt-ssh.h"
+
+void ui_sources_connect(gint);
+void ui_sources_cancel(void);
+gint ui_sources_count(void);
+void ui_sources_dialog(GtkWindow*);
+
+gboolean ui_sources_lookup(const mt_ssh_t*);
+const gchar* ui_sources_get_name(const mt_ssh_t*);
+
+void ui_sources_status(const mt_ssh_t*, const gchar*);
+void ui_sources_verify(const mt_ssh_t*, const gchar*);
+void ui_sources_refresh(const mt_ssh_t*);
+void ui_sources_disconnected(const mt_ssh_t*, gboolean);
+void ui_sources_heartbeat(const mt_ssh_t*);
+
+#endif
@@ -0,0 +1,311 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#include <gdk/gdkkeysyms.h>
+#include "ui.h"
+#include "ui-stations.h"
+#include "stations.h"
+#include "model.h"
+#include "conf.h"
+#include "oui.h"
+
+struct ui_stations
+{
+    GtkWidget *parent;
+    GtkWidget *window;
+    GtkWidget *content;
+    GtkWidget *scroll;
+    GtkWidget *treeview;
+    GtkWidget *box_button;
+    GtkWidget *l_count;
+    GtkWidget *b_close;
+} typedef ui_stations_t;
+
+static void ui_stations_destroy(GtkWidget*, gpointer);
+static gboolean ui_stations_key(GtkWidget*, GdkEventKey*, gpointer);
+static void ui_stations_update_count(ui_stations_t*);
+static GtkTreeViewColumn* ui_stations_column(GtkWidget*, const gchar*, gint, GtkTreeCellDataFunc);
+
+static void ui_stations_format_address(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
+static void ui_stations_format_vendor(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
+static void ui_stations_format_ap_ssid(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
+static void ui_stations_format_level(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
+static void ui_stations_format_date(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
+
+ui_stations_t*
+ui_stations(GtkWidget *parent)
+{
+    ui_stations_t *s;
+
+    s = g_malloc(sizeof(ui_stations_t));
+    s->parent = parent;
+
+    s->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+    gtk_window_set_modal(GTK_WINDOW(s->window), FALSE);
+    gtk_window_set_title(GTK_WINDOW(s->window), "Client stations");
+    gtk_window_set_destroy_with_parent(GTK_WINDOW(s->window), TRUE);
+    gtk_window_set_default_size(GTK_WINDOW(s->window), 800, 400);
+    gtk_container_set_border_width(GTK_CONTAINER(s->window), 2);
+
+    s->content = gtk_vbox_new(FALSE, 0);
+    gtk_container_add(GTK_CONTAINER(s->window), s->content);
+
+    s->scroll = gtk_scrolled_window_new(NULL, NULL);
+    gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(s->scroll), GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+    gtk_box_pack_start(GTK_BOX(s->content), s->scroll, TRUE, TRUE, 0);
+
+    s->treeview = gtk_tree_view_new_with_model(GTK_TREE_MODEL(ui.stations->store));
+    gtk_tree_view_set_rules_hint(GTK_TREE_VIEW(s->treeview), TRUE);
+    gtk_tree_view_set_enable_search(GTK_TREE_VIEW(s->treeview), FALSE);
+    gtk_container_add(GTK_CONTAINER(s->scroll), s->treeview);
+
+    ui_stations_column(s->treeview, "Address", STA_COL_ADDRESS, ui_stations_format_address);
+    ui_stations_column(s->treeview, "Vendor", STA_COL_ADDRESS, ui_stations_format_vendor);
+    ui_stations_column(s->treeview, "AP", STA_COL_BSSID, ui_stations_format_address);
+    ui_stations_column(s->treeview, "AP SSID", STA_COL_BSSID, ui_stations_format_ap_ssid);
+    ui_stations_column(s->treeview, "Probed SSID", STA_COL_SSID, NULL);
+    ui_stations_column(s->treeview, "Sig", STA_COL_RSSI, ui_stations_format_level);
+    ui_stations_column(s->treeview, "First log", STA_COL_FIRSTLOG, ui_stations_format_date);
+    ui_stations_column(s->treeview, "Last log", STA_COL_LASTLOG, ui_stations_format_date);
+    ui_stations_column(s->treeview, "Source", STA_COL_SOURCE, NULL);
+
+    s->box_button = gtk_hbox_new(FALSE, 5);
+    gtk_box_pack_start(GTK_BOX(s->content), s->box_button, FALSE, FALSE, 5);
+
+    s->l_count = gtk_label_new(NULL);
+    gtk_misc_set_alignment(GTK_MISC(s->l_count), 0.0, 0.5);
+    gtk_box_pack_start(GTK_BOX(s->box_button), s->l_count, TRUE, TRUE, 2);
+
+    s->b_close = gtk_button_new_from_stock(GTK_STOCK_CLOSE);
+    g_signal_connect_swapped(s->b_close, "clicked", G_CALLBACK(gtk_widget_hide), s->window);
+    gtk_box_pack_end(GTK_BOX(s->box_button), s->b_close, FALSE, FALSE, 0);
+
+    g_signal_connect(s->window, "key-press-event", G_CALLBACK(ui_stations_key), s);
+    g_signal_connect(s->window, "delete-event", G_CALLBACK(gtk_widget_hide_on_delete), NULL);
+    g_signal_connect(s->window, "destroy", G_CALLBACK(ui_stations_destroy), s);
+
+    return s;
+}
+
+void
+ui_stations_free(ui_stations_t *s)
+{
+    gtk_widget_destroy(s->window);
+}
+
+void
+ui_stations_show(ui_stations_t *s)
+{
+    ui_stations_update_count(s);
+
+    if(gtk_widget_get_visible(s->window))
+    {
+        gtk_window_present(GTK_WINDOW(s->window));
+    }
+    else
+    {
+        gtk_window_set_transient_for(GTK_WINDOW(s->window), GTK_WINDOW(s->parent));
+        gtk_window_set_position(GTK_WINDOW(s->window), GTK_WIN_POS_CENTER_ON_PARENT);
+        gtk_widget_show_all(s->window);
+
+        /* Stations window is now centered over parent, don't stay on top anymore */
+        gtk_window_set_transient_for(GTK_WINDOW(s->window), NULL);
+    }
+}
+
+void
+ui_stations_add(station_t *sta)
+{
+    gint64 previous;
+
+    station_to_utf8(sta, conf_get_preferences_fallback_encoding());
+
+    /* Keep the client count of both access points up to date */
+    if(mtscan_stations_add(ui.stations, sta, &previous) && previous >= 0)
+        mtscan_model_set_clients(ui.model, previous, mtscan_stations_get_clients(ui.stations, previous));
+
+    /* The network might have been added after its clients */
+    if(sta->bssid >= 0)
+        mtscan_model_set_clients(ui.model, sta->bssid, mtscan_stations_get_clients(ui.stations, sta->bssid));
+
+    if(ui.stations_window && gtk_widget_get_visible(ui.stations_window->window))
+        ui_stations_update_count(ui.stations_window);
+}
+
+void
+ui_stations_clear(void)
+{
+    mtscan_stations_clear(ui.stations);
+
+    if(ui.stations_window && gtk_widget_get_visible(ui.stations_window->window))
+        ui_stations_update_count(ui.stations_window);
+}
+
+static void
+ui_stations_destroy(GtkWidget *widget,
+                    gpointer   user_data)
+{
+    ui_stations_t *s = (ui_stations_t*)user_data;
+
+    if(ui.stations_window == s)
+        ui.stations_window = NULL;
+    g_free(s);
+}
+
+static gboolean
+ui_stations_key(GtkWidget   *widget,
+                GdkEventKey *event,
+                gpointer     user_data)
+{
+    ui_stations_t *s = (ui_stations_t*)user_data;
+    guint current = gdk_keyval_to_upper(event->keyval);
+    if(current == GDK_KEY_Escape)
+    {
+        gtk_button_clicked(GTK_BUTTON(s->b_close));
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static void
+ui_stations_update_count(ui_stations_t *s)
+{
+    gchar *text;
+    guint count;
+
+    count = mtscan_stations_count(ui.stations);
+    text = g_strdup_printf("%u station%s", count, (count == 1 ? "" : "s"));
+    gtk_label_set_text(GTK_LABEL(s->l_count), text);
+    g_free(text);
+}
+
+static GtkTreeViewColumn*
+ui_stations_column(GtkWidget           *treeview,
+                   const gchar         *title,
+                   gint                 col_id,
+                   GtkTreeCellDataFunc  func)
+{
+    GtkCellRenderer *renderer;
+    GtkTreeViewColumn *column;
+
+    renderer = gtk_cell_renderer_text_new();
+    gtk_cell_renderer_set_padding(renderer, 2, 0);
+    if(func)
+    {
+        column = gtk_tree_view_column_new_with_attributes(title, renderer, NULL);
+        gtk_tree_view_column_set_cell_data_func(column, renderer, func, GINT_TO_POINTER(col_id), NULL);
+    }
+    else
+    {
+        column = gtk_tree_view_column_new_with_attributes(title, renderer, "text", col_id, NULL);
+    }
+
+    gtk_tree_view_column_set_sort_column_id(column, col_id);
+    gtk_tree_view_column_set_resizable(column, TRUE);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
+    return column;
+}
+
+static void
+ui_stations_format_address(GtkTreeViewColumn *col,
+                           GtkCellRenderer   *renderer,
+                           GtkTreeModel      *store,
+                           GtkTreeIter       *iter,
+                           gpointer           data)
+{
+    gint col_id = GPOINTER_TO_INT(data);
+    gint64 address;
+
+    gtk_tree_model_get(store, iter, col_id, &address, -1);
+    g_object_set(renderer, "text", (address >= 0 ? model_format_address(address, TRUE) : ""), NULL);
+}
+
+static void
+ui_stations_format_vendor(GtkTreeViewColumn *col,
+                          GtkCellRenderer   *renderer,
+                          GtkTreeModel      *store,
+                          GtkTreeIter       *iter,
+                          gpointer           data)
+{
+    gint col_id = GPOINTER_TO_INT(data);
+    const gchar *vendor;
+    gint64 address;
+
+    gtk_tree_model_get(store, iter, col_id, &address, -1);
+    vendor = oui_lookup(address);
+    g_object_set(renderer, "text", (vendor ? vendor : ""), NULL);
+}
+
+static void
+ui_stations_format_ap_ssid(GtkTreeViewColumn *col,
+                           GtkCellRenderer   *renderer,
+                           GtkTreeModel      *store,
+                           GtkTreeIter       *iter,
+                           gpointer           data)
+{
+    gint col_id = GPOINTER_TO_INT(data);
+    GtkTreeIter *iter_net;
+    gchar *ssid = NULL;
+    gint64 bssid;
+
+    gtk_tree_model_get(store, iter, col_id, &bssid, -1);
+    if(bssid >= 0 &&
+       (iter_net = g_hash_table_lookup(ui.model->map, &bssid)))
+    {
+        gtk_tree_model_get(GTK_TREE_MODEL(ui.model->store), iter_net,
+                           COL_SSID, &ssid,
+                           -1);
+    }
+
+    g_object_set(renderer, "text", (ssid ? ssid : ""), NULL);
+    g_free(ssid);
+}
+
+static void
+ui_stations_format_level(GtkTreeViewColumn *col,
+                         GtkCellRenderer   *renderer,
+                         GtkTreeModel      *store,
+                         GtkTreeIter       *iter,
+                         gpointer           data)
+{
+    gint col_id = GPOINTER_TO_INT(data);
+    gchar text[10];
+    gint8 value;
+
+    gtk_tree_model_get(store, iter, col_id, &value, -1);
+    if(value == MODEL_NO_SIGNAL)
+    {
+        g_object_set(renderer, "text", "", NULL);
+    }
+    else
+    {
+        snprintf(text, sizeof(text), "%d", value);
+        g_object_set(renderer, "text", text, NULL);
+    }
+}
+
+static void
+ui_stations_format_date(GtkTreeViewColumn *col,
+                        GtkCellRenderer   *renderer,
+                        GtkTreeModel      *store,
+                        GtkTreeIter       *iter,
+                        gpointer           data)
+{
+    gint col_id = GPOINTER_TO_INT(data);
+    gint64 seen;
+
+    gtk_tree_model_get(store, iter, col_id, &seen, -1);
+    g_object_set(renderer, "text", model_format_date(seen), NULL);
+}
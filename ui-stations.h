@@ -0,0 +1,28 @@
+/*
+ *  MTscan - MikroTik RouterOS wireless scanner
+ *  Copyright (c) 2015-2019  Konrad Kosmatka
+ *
+ *  This program is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU General Public License
+ *  as published by the Free Software Foundation; either version 2
+ *  of the License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ */
+
+#ifndef MTSCAN_UI_STATIONS_H_
+#define MTSCAN_UI_STATIONS_H_
+#include "station.h"
+
+typedef struct ui_stations ui_stations_t;
+
+ui_stations_t* ui_stations(GtkWidget*);
+void ui_stations_free(ui_stations_t*);
+void ui_stations_show(ui_stations_t*);
+void ui_stations_add(station_t*);
+void ui_stations_clear(void);
+
+#endif
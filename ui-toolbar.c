@@ -38,6 +38,7 @@ static void ui_toolbar_restart(GtkWidget*, gpointer);
 static void ui_toolbar_scanlist_default(GtkWidget*, gpointer);
 static void ui_toolbar_scanlist(GtkWidget*, gpointer);
 static void ui_toolbar_scanlist_preset(GtkWidget *, gpointer);
+static void ui_toolbar_stations(GtkWidget*, gpointer);
 
 static gboolean ui_toolbar_scanlist_preset_foreach(GtkTreeModel*, GtkTreePath*, GtkTreeIter*, gpointer);
 static void ui_toolbar_scanlist_preset_apply(const gchar*, const gchar*);
@@ -119,6 +120,12 @@ ui_toolbar_create(void)
     g_signal_connect(ui.b_scanlist_preset, "show-menu", G_CALLBACK(ui_toolbar_scanlist_menu), NULL);
     gtk_toolbar_insert(GTK_TOOLBAR(toolbar), ui.b_scanlist_preset, -1);
 
+    ui.b_stations = gtk_tool_button_new(gtk_image_new_from_stock(GTK_STOCK_INDEX, GTK_ICON_SIZE_BUTTON), "Client stations");
+    gtk_widget_set_tooltip_text(GTK_WIDGET(ui.b_stations), "Client stations (Ctrl+K)");
+    g_signal_connect(ui.b_stations, "clicked", G_CALLBACK(ui_toolbar_stations), NULL);
+    gtk_toolbar_insert(GTK_TOOLBAR(toolbar), ui.b_stations, -1);
+    gtk_widget_add_accelerator(GTK_WIDGET(ui.b_stations), "clicked", accel_group, GDK_KEY_k, GDK_CONTROL_MASK, GTK_ACCEL_VISIBLE);
+
     gtk_toolbar_insert(GTK_TOOLBAR(toolbar), gtk_separator_tool_item_new(), -1);
 
     ui.b_new = gtk_tool_button_new(gtk_image_new_from_stock(GTK_STOCK_NEW, GTK_ICON_SIZE_BUTTON), "New");
@@ -284,6 +291,13 @@ ui_toolbar_scanlist(GtkWidget *widget,
     ui_scanlist_show(ui.scanlist);
 }
 
+static void
+ui_toolbar_stations(GtkWidget *widget,
+                    gpointer   data)
+{
+    ui_stations_show(ui.stations_window);
+}
+
 static void
 ui_toolbar_scanlist_preset(GtkWidget *widget,
                            gpointer data)
@@ -520,6 +534,7 @@ ui_toolbar_export(GtkWidget *widget,
         if(!export_html(filename,
                         ui.name,
                         ui.model,
+                        ui.track,
                         conf_get_preferences_view_cols_order(),
                         conf_get_preferences_view_cols_hidden()))
 
@@ -23,6 +23,7 @@
 #include "misc.h"
 #include "oui.h"
 #include "ui-log.h"
+#include "blacklist.h"
 
 static GtkWidget* ui_view_menu_create(GtkTreeView*, gint, gint64, gint, gint);
 static void ui_view_menu_addr(GtkWidget*, gpointer);
@@ -38,6 +39,8 @@ static void ui_view_menu_dehighlight(GtkWidget*, gpointer);
 static void ui_view_menu_alarm_set(GtkWidget*, gpointer);
 static void ui_view_menu_alarm_unset(GtkWidget*, gpointer);
 static void ui_view_menu_list(GtkTreeView*, gint);
+static gboolean ui_view_menu_is_blacklisted(gint64);
+static void ui_view_menu_unblacklist_address(gint64);
 static void ui_view_menu_save_as(GtkWidget*, gpointer);
 static void ui_view_menu_remove(GtkWidget*, gpointer);
 
@@ -85,7 +88,7 @@ ui_view_menu(GtkWidget      *treeview,
                                          -1);
 
         if(conf_get_preferences_blacklist_enabled())
-            flags |= conf_get_preferences_blacklist(address) ? FLAG_UNBLACKLIST : FLAG_BLACKLIST;
+            flags |= ui_view_menu_is_blacklisted(address) ? FLAG_UNBLACKLIST : FLAG_BLACKLIST;
 
         if(conf_get_preferences_highlightlist_enabled())
             flags |= conf_get_preferences_highlightlist(address) ? FLAG_DEHIGHLIGHT : FLAG_HIGHLIGHT;
@@ -541,7 +544,7 @@ ui_view_menu_list(GtkTreeView *treeview,
         if(mode == FLAG_BLACKLIST)
             conf_set_preferences_blacklist(address);
         else if(mode == FLAG_UNBLACKLIST)
-            conf_del_preferences_blacklist(address);
+            ui_view_menu_unblacklist_address(address);
         else if(mode == FLAG_HIGHLIGHT)
             conf_set_preferences_highlightlist(address);
         else if(mode == FLAG_DEHIGHLIGHT)
@@ -561,7 +564,7 @@ ui_view_menu_list(GtkTreeView *treeview,
             if(mode == FLAG_BLACKLIST)
                 conf_set_preferences_blacklist(address);
             else if(mode == FLAG_UNBLACKLIST)
-                conf_del_preferences_blacklist(address);
+                ui_view_menu_unblacklist_address(address);
             else if(mode == FLAG_HIGHLIGHT)
                 conf_set_preferences_highlightlist(address);
             else if(mode == FLAG_DEHIGHLIGHT)
@@ -577,6 +580,30 @@ ui_view_menu_list(GtkTreeView *treeview,
     g_list_free(list);
 }
 
+static gboolean
+ui_view_menu_is_blacklisted(gint64 address)
+{
+    blacklist_t *blacklist;
+    gboolean ret;
+
+    /* Vendor rules are not in the address list */
+    blacklist = blacklist_get();
+    ret = blacklist_match(blacklist, address);
+    if(blacklist)
+        blacklist_unref(blacklist);
+    return ret;
+}
+
+static void
+ui_view_menu_unblacklist_address(gint64 address)
+{
+    conf_del_preferences_blacklist(address);
+
+    /* Still hidden by its vendor, remove the OUI rule as well */
+    if(ui_view_menu_is_blacklisted(address))
+        conf_del_preferences_blacklist(BLACKLIST_OUI | (address >> 24));
+}
+
 static void
 ui_view_menu_save_as(GtkWidget *menuitem,
                      gpointer   user_data)
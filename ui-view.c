@@ -53,7 +53,9 @@ static const gchar* mtscan_view_cols[] =
     "latitude",
     "longitude",
     "azimuth",
-    "distance"
+    "distance",
+    "source",
+    "clients"
 };
 
 static const gchar* mtscan_view_titles[] =
@@ -85,7 +87,9 @@ static const gchar* mtscan_view_titles[] =
     "Latitude",
     "Longitude",
     "Az",
-    "Di"
+    "Di",
+    "Source",
+    "Clients"
 };
 
 
@@ -99,6 +103,7 @@ static void ui_view_format_icon(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeMod
 static void ui_view_format_address(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
 static void ui_view_format_freq(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
 static void ui_view_format_streams(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
+static void ui_view_format_clients(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
 static void ui_view_format_date(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
 static void ui_view_format_level(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
 static void ui_view_format_gps(GtkTreeViewColumn*, GtkCellRenderer*, GtkTreeModel*, GtkTreeIter*, gpointer);
@@ -463,6 +468,31 @@ ui_view_new(mtscan_model_t *model,
     g_signal_connect(column, "clicked", (GCallback)ui_view_column_clicked, GINT_TO_POINTER(COL_DISTANCE));
     g_hash_table_insert(cols, (gpointer)mtscan_view_cols[MTSCAN_VIEW_COL_DISTANCE], column);
 
+    /* Source column */
+    renderer = gtk_cell_renderer_text_new();
+    gtk_cell_renderer_set_padding(renderer, 2, 0);
+    gtk_cell_renderer_text_set_fixed_height_from_font(GTK_CELL_RENDERER_TEXT(renderer), 1);
+    column = gtk_tree_view_column_new_with_attributes(mtscan_view_titles[MTSCAN_VIEW_COL_SOURCE], renderer, "text", COL_SOURCE, NULL);
+    gtk_tree_view_column_set_clickable(column, TRUE);
+    gtk_tree_view_column_set_visible(column, FALSE);
+    gtk_tree_view_column_set_cell_data_func(column, renderer, ui_view_format_background, GINT_TO_POINTER(COL_SOURCE), NULL);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
+    g_signal_connect(column, "clicked", (GCallback)ui_view_column_clicked, GINT_TO_POINTER(COL_SOURCE));
+    g_hash_table_insert(cols, (gpointer)mtscan_view_cols[MTSCAN_VIEW_COL_SOURCE], column);
+
+    /* Clients column */
+    renderer = gtk_cell_renderer_text_new();
+    gtk_cell_renderer_set_padding(renderer, 1, 0);
+    gtk_cell_renderer_set_alignment(renderer, 1.0, 0.5);
+    gtk_cell_renderer_text_set_fixed_height_from_font(GTK_CELL_RENDERER_TEXT(renderer), 1);
+    column = gtk_tree_view_column_new_with_attributes(mtscan_view_titles[MTSCAN_VIEW_COL_CLIENTS], renderer, NULL);
+    gtk_tree_view_column_set_clickable(column, TRUE);
+    gtk_tree_view_column_set_visible(column, FALSE);
+    gtk_tree_view_column_set_cell_data_func(column, renderer, ui_view_format_clients, GINT_TO_POINTER(COL_CLIENTS), NULL);
+    gtk_tree_view_append_column(GTK_TREE_VIEW(treeview), column);
+    g_signal_connect(column, "clicked", (GCallback)ui_view_column_clicked, GINT_TO_POINTER(COL_CLIENTS));
+    g_hash_table_insert(cols, (gpointer)mtscan_view_cols[MTSCAN_VIEW_COL_CLIENTS], column);
+
     g_signal_connect(treeview, "popup-menu", G_CALLBACK(ui_view_popup), NULL);
     g_signal_connect(treeview, "button-press-event", G_CALLBACK(ui_view_clicked), NULL);
     g_signal_connect(treeview, "key-press-event", G_CALLBACK(ui_view_key_press), NULL);
@@ -732,6 +762,27 @@ ui_view_format_streams(GtkTreeViewColumn *col,
     ui_view_format_background(col, renderer, store, iter, data);
 }
 
+static void
+ui_view_format_clients(GtkTreeViewColumn *col,
+                       GtkCellRenderer   *renderer,
+                       GtkTreeModel      *store,
+                       GtkTreeIter       *iter,
+                       gpointer           data)
+{
+    gint col_id = GPOINTER_TO_INT(data);
+    gchar text[12];
+    gint value;
+
+    gtk_tree_model_get(store, iter, col_id, &value, -1);
+    if(value > 0)
+        snprintf(text, sizeof(text), "%d", value);
+    else
+        text[0] = '\0';
+
+    g_object_set(renderer, "text", text, NULL);
+    ui_view_format_background(col, renderer, store, iter, data);
+}
+
 static void
 ui_view_format_date(GtkTreeViewColumn *col,
                     GtkCellRenderer   *renderer,
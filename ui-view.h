@@ -49,6 +49,8 @@ enum
     MTSCAN_VIEW_COL_LONGITUDE,
     MTSCAN_VIEW_COL_AZIMUTH,
     MTSCAN_VIEW_COL_DISTANCE,
+    MTSCAN_VIEW_COL_SOURCE,
+    MTSCAN_VIEW_COL_CLIENTS,
     MTSCAN_VIEW_COLS
 };
 
@@ -31,6 +31,8 @@
 #include "signals.h"
 #include "misc.h"
 #include "ui-callbacks.h"
+#include "ui-sources.h"
+#include "msgbus.h"
 
 #ifdef G_OS_WIN32
 #include "win32.h"
@@ -61,8 +63,11 @@ static const char rc_string[] = "style \"minimal-toolbar-style\"\n"
 static void ui_restore(void);
 static gboolean ui_key(GtkWidget*, GdkEventKey*, gpointer);
 static gboolean ui_delete_event(GtkWidget*, GdkEvent*, gpointer);
+static gboolean ui_conn_status_clicked(GtkWidget*, GdkEventButton*, gpointer);
 static void ui_drag_data_received(GtkWidget*, GdkDragContext*, gint, gint, GtkSelectionData*, guint, guint);
 static gboolean ui_idle_timeout(gpointer);
+static void ui_status_update_tzsp(void);
+static void ui_status_update_msgbus(void);
 static gboolean ui_idle_timeout_autosave(gpointer);
 static void ui_gps(mtscan_gps_state_t, const mtscan_gps_data_t*, gpointer);
 static gchar* ui_get_name(const gchar*);
@@ -124,8 +129,13 @@ ui_init(void)
 
     gtk_box_pack_start(GTK_BOX(ui.statusbar), gtk_vseparator_new(), FALSE, FALSE, 5);
 
+    /* Clicking the connection status opens the sources */
+    ui.eb_conn_status = gtk_event_box_new();
+    gtk_event_box_set_visible_window(GTK_EVENT_BOX(ui.eb_conn_status), FALSE);
+    g_signal_connect(ui.eb_conn_status, "button-press-event", G_CALLBACK(ui_conn_status_clicked), NULL);
+    gtk_box_pack_start(GTK_BOX(ui.statusbar), ui.eb_conn_status, FALSE, FALSE, 0);
     ui.l_conn_status = gtk_label_new(NULL);
-    gtk_box_pack_start(GTK_BOX(ui.statusbar), ui.l_conn_status, FALSE, FALSE, 0);
+    gtk_container_add(GTK_CONTAINER(ui.eb_conn_status), ui.l_conn_status);
 
     ui.group_gps = gtk_hbox_new(FALSE, 6);
     gtk_box_pack_start(GTK_BOX(ui.group_gps), gtk_vseparator_new(), FALSE, FALSE, 5);
@@ -133,12 +143,21 @@ ui_init(void)
     gtk_box_pack_start(GTK_BOX(ui.group_gps), ui.l_gps_status, FALSE, FALSE, 0);
     gtk_box_pack_start(GTK_BOX(ui.statusbar), ui.group_gps, FALSE, FALSE, 0);
 
+    ui.group_tzsp = gtk_hbox_new(FALSE, 6);
+    gtk_box_pack_start(GTK_BOX(ui.group_tzsp), gtk_vseparator_new(), FALSE, FALSE, 5);
+    ui.l_tzsp_status = gtk_label_new(NULL);
+    gtk_box_pack_start(GTK_BOX(ui.group_tzsp), ui.l_tzsp_status, FALSE, FALSE, 0);
+    gtk_box_pack_start(GTK_BOX(ui.statusbar), ui.group_tzsp, FALSE, FALSE, 0);
+    gtk_widget_show_all(ui.group_tzsp);
+    gtk_widget_set_no_show_all(ui.group_tzsp, TRUE);
+
     ui_idle_timeout(&ui);
     g_timeout_add(1000, ui_idle_timeout, &ui);
     g_timeout_add(1000, ui_idle_timeout_autosave, &ui);
     gps_set_callback(ui_gps, &ui);
 
     ui.scanlist = ui_scanlist(ui.window, UI_SCANLIST_PAGE_5_GHZ);
+    ui.stations_window = ui_stations(ui.window);
 
     gtk_drag_dest_set(ui.window, GTK_DEST_DEFAULT_ALL, drop_types, n_drop_types, GDK_ACTION_COPY);
     g_signal_connect(ui.window, "drag-data-received", G_CALLBACK(ui_drag_data_received), NULL);
@@ -231,6 +250,19 @@ ui_key(GtkWidget   *widget,
     return FALSE;
 }
 
+static gboolean
+ui_conn_status_clicked(GtkWidget      *widget,
+                       GdkEventButton *event,
+                       gpointer        user_data)
+{
+    if(event->type == GDK_BUTTON_PRESS && event->button == 1)
+    {
+        ui_sources_dialog(GTK_WINDOW(ui.window));
+        return TRUE;
+    }
+    return FALSE;
+}
+
 static void
 ui_drag_data_received(GtkWidget        *widget,
                       GdkDragContext   *context,
@@ -299,6 +331,9 @@ ui_idle_timeout(gpointer user_data)
         mtscan_sound(APP_SOUND_NODATA);
     }
 
+    ui_status_update_tzsp();
+    ui_status_update_msgbus();
+
     state = gps_get_data(NULL);
     if(conf_get_interface_sound() &&
        conf_get_preferences_sounds_no_gps_data() &&
@@ -500,6 +535,87 @@ ui_status_update_networks(void)
     }
 }
 
+static void
+ui_status_update_tzsp(void)
+{
+    tzsp_receiver_stats_t stats;
+    guint dropped;
+    gchar *text;
+
+    if(!ui.tzsp_rx)
+    {
+        gtk_widget_hide(ui.group_tzsp);
+        return;
+    }
+
+    tzsp_receiver_get_stats(ui.tzsp_rx, &stats);
+
+    /* Frames lost because some stage could not keep up */
+    dropped = stats.kernel_dropped + stats.queue_dropped + stats.ring_dropped;
+    if(dropped)
+        text = g_strdup_printf("TZSP: <span color=\"red\"><b>%u dropped</b></span>", dropped);
+    else
+        text = g_strdup("TZSP: no drops");
+    gtk_label_set_markup(GTK_LABEL(ui.l_tzsp_status), text);
+    g_free(text);
+
+    text = g_strdup_printf("Kernel drops: %u\n"
+                           "Invalid packets: %u\n"
+                           "Unknown sensor: %u\n"
+                           "Ignored frames: %u\n"
+                           "Blacklisted frames: %u\n"
+                           "Parser queue drops: %u\n"
+                           "Parse failures: %u\n"
+                           "Handoff drops: %u\n"
+                           "Networks received: %u\n"
+                           "Stations received: %u",
+                           stats.kernel_dropped,
+                           stats.invalid,
+                           stats.unknown_sensor,
+                           stats.filtered,
+                           stats.blacklisted,
+                           stats.queue_dropped,
+                           stats.parse_errors,
+                           stats.ring_dropped,
+                           stats.networks,
+                           stats.stations);
+    gtk_widget_set_tooltip_text(ui.l_tzsp_status, text);
+    g_free(text);
+
+    gtk_widget_show(ui.group_tzsp);
+}
+
+static void
+ui_status_update_msgbus(void)
+{
+    msgbus_stats_t stats;
+    GString *text;
+    gint i;
+
+    /* Message bus from the worker threads, one line per queue */
+    text = g_string_new("Activity icon\n");
+    g_string_append_printf(text, "Dispatches: %" G_GUINT64_FORMAT, msgbus_get_dispatches());
+    for(i=0; i<MSGBUS_QUEUE_COUNT; i++)
+    {
+        msgbus_get_stats(i, &stats);
+        g_string_append_printf(text,
+                               "\n%s: %" G_GUINT64_FORMAT " messages, "
+                               "depth %u/%u (max %u), "
+                               "latency avg %.1f ms, max %.1f ms, "
+                               "%" G_GUINT64_FORMAT " overflows",
+                               msgbus_queue_name(i),
+                               stats.dispatched,
+                               stats.depth,
+                               stats.capacity,
+                               stats.depth_max,
+                               stats.latency_avg / 1000.0,
+                               stats.latency_max / 1000.0,
+                               stats.overflows);
+    }
+    gtk_widget_set_tooltip_text(ui.activity_icon, text->str);
+    g_string_free(text, TRUE);
+}
+
 void
 ui_set_title(gchar *filename)
 {
@@ -547,6 +663,8 @@ void
 ui_clear(void)
 {
     mtscan_model_clear(ui.model);
+    ui_stations_clear();
+    mtscan_track_clear(ui.track);
     ui.changed = FALSE;
     ui_status_update_networks();
 }
@@ -646,10 +764,11 @@ ui_toggle_connection(gint auto_connect_profile)
 {
     if(ui.conn)
     {
-        /* Close connection */
+        /* Close connection, along with all additional sources */
         ui_toolbar_connect_set_state(TRUE);
         gtk_widget_set_sensitive(GTK_WIDGET(ui.b_connect), FALSE);
 
+        ui_sources_cancel();
         mt_ssh_cancel(ui.conn);
         return;
     }
@@ -667,7 +786,10 @@ ui_tzsp(void)
     const gchar *tzsp_interface;
     gint frequency_base;
     gint channel_width;
-    guint8 tzsp_hwaddr[6];
+    GByteArray *tzsp_hwaddr;
+    guint8 addr[6];
+    gchar **sensors, **it;
+    guint i;
 
     if(ui.mode != MTSCAN_MODE_SNIFFER)
         return;
@@ -677,12 +799,33 @@ ui_tzsp(void)
 
     /* Make sure that sensor address is available */
     if(!ui.hwaddr ||
-       !str_addr_to_guint8(ui.hwaddr, (gint)strlen(ui.hwaddr), tzsp_hwaddr))
+       !str_addr_to_guint8(ui.hwaddr, (gint)strlen(ui.hwaddr), addr))
     {
         ui_dialog(NULL, GTK_MESSAGE_WARNING, "Error", "<b>Failed to create tzsp-receiver</b>\n\nSensor address is unavailable.");
         return;
     }
 
+    tzsp_hwaddr = g_byte_array_new();
+    g_byte_array_append(tzsp_hwaddr, addr, sizeof(addr));
+
+    /* Add extra sensors, skip invalid and duplicated addresses */
+    sensors = g_strsplit_set(conf_get_preferences_tzsp_sensors(), " ,;", -1);
+    for(it = sensors; *it; it++)
+    {
+        remove_char(*it, ':');
+        remove_char(*it, '-');
+        if(!str_addr_to_guint8(*it, (gint)strlen(*it), addr))
+            continue;
+
+        for(i=0; i<tzsp_hwaddr->len; i+=sizeof(addr))
+            if(!memcmp(tzsp_hwaddr->data + i, addr, sizeof(addr)))
+                break;
+
+        if(i == tzsp_hwaddr->len)
+            g_byte_array_append(tzsp_hwaddr, addr, sizeof(addr));
+    }
+    g_strfreev(sensors);
+
     /* Read configuration */
     sniffer_pcap_mode = conf_get_preferences_tzsp_mode() == MTSCAN_CONF_TZSP_MODE_PCAP;
     tzsp_interface = sniffer_pcap_mode ? conf_get_preferences_tzsp_interface() : NULL;
@@ -692,14 +835,22 @@ ui_tzsp(void)
 
     ui.tzsp_rx = tzsp_receiver_new((guint16)conf_get_preferences_tzsp_udp_port(),
                                    tzsp_interface,
-                                   tzsp_hwaddr,
+                                   tzsp_hwaddr->data,
+                                   tzsp_hwaddr->len / sizeof(addr),
                                    channel_width,
                                    frequency_base,
                                    ui_callback_tzsp,
-                                   ui_callback_tzsp_network);
+                                   ui_callback_tzsp_network,
+                                   (conf_get_preferences_tzsp_stations() ? ui_callback_tzsp_station : NULL));
+
+    g_byte_array_free(tzsp_hwaddr, TRUE);
 
     if(!ui.tzsp_rx)
         ui_dialog(NULL, GTK_MESSAGE_WARNING, "Error", "<b>Failed to enable tzsp-receiver.</b>");
+    else if(ui.active == MTSCAN_MODE_SNIFFER)
+        tzsp_receiver_enable(ui.tzsp_rx);
+
+    ui_status_update_tzsp();
 }
 
 void
@@ -709,5 +860,6 @@ ui_tzsp_destroy(void)
     {
         tzsp_receiver_cancel(ui.tzsp_rx);
         ui.tzsp_rx = NULL;
+        ui_status_update_tzsp();
     }
 }
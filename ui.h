@@ -18,10 +18,13 @@
 #include <gtk/gtk.h>
 #include "mtscan.h"
 #include "model.h"
+#include "stations.h"
+#include "track.h"
 #include "ui-connection.h"
 #include "mt-ssh.h"
 #include "tzsp-receiver.h"
 #include "ui-scanlist.h"
+#include "ui-stations.h"
 
 #define UNIX_TIMESTAMP() (g_get_real_time() / 1000000)
 
@@ -45,6 +48,7 @@ typedef struct mtscan_gtk
     GtkToolItem *b_scanlist_default;
     GtkToolItem *b_scanlist;
     GtkToolItem *b_scanlist_preset;
+    GtkToolItem *b_stations;
 
     GtkToolItem *b_new;
     GtkToolItem *b_open;
@@ -69,10 +73,14 @@ typedef struct mtscan_gtk
     GtkWidget *statusbar;
     GtkWidget *activity_icon;
     GtkWidget *l_net_status;
+    GtkWidget *eb_conn_status;
     GtkWidget *l_conn_status;
     GtkWidget *group_gps, *l_gps_status;
+    GtkWidget *group_tzsp, *l_tzsp_status;
 
     mtscan_model_t *model;
+    mtscan_stations_t *stations;
+    mtscan_track_t *track;
     gboolean changed;
     gchar *filename;
     gchar *name;
@@ -80,6 +88,7 @@ typedef struct mtscan_gtk
 
     ui_connection_t *conn_dialog;
     ui_scanlist_t *scanlist;
+    ui_stations_t *stations_window;
 
     mt_ssh_t *conn;
     gint mode;
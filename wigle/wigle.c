@@ -18,6 +18,7 @@
 #include "wigle.h"
 #include "wigle-msg.h"
 #include "wigle-json.h"
+#include "../msgbus.h"
 
 #define DEBUG      1
 #define DEBUG_READ 0
@@ -259,7 +260,7 @@ wigle_thread(gpointer user_data)
         }
 
         data = wigle_json_free(context->json);
-        g_idle_add(wigle_cb_msg, wigle_msg_new(context, data));
+        msgbus_post(MSGBUS_QUEUE_WIGLE, wigle_cb_msg, wigle_msg_new(context, data));
 
         curl_slist_free_all(chunk);
         g_free(auth_string);
@@ -274,7 +275,7 @@ wigle_thread(gpointer user_data)
     g_print("wigle_thread@%p: stop\n", (gpointer)context);
 #endif
 
-    g_idle_add(wigle_cb, context);
+    msgbus_post(MSGBUS_QUEUE_WIGLE, wigle_cb, context);
     return NULL;
 }
 